@@ -1,4 +1,11 @@
 #include "Application.h"
+#include "MeshSimplifier.h"
+
+//A camera where the scene layout says it starts
+static Camera* CreateCamera(const SceneLayout::CameraPreset& preset, UINT windowWidth, UINT windowHeight)
+{
+	return new Camera(preset.Eye, preset.At, preset.Up, (FLOAT)windowWidth, (FLOAT)windowHeight, preset.NearDepth, preset.FarDepth, preset.LookAt);
+}
 
 LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
 {
@@ -36,10 +43,12 @@ Application::Application()
 	_pPixelShader = nullptr;
 	_pVertexLayout = nullptr;
 	_pConstantBuffer = nullptr;
+	_pVertexShaderPacked = nullptr;
+	_pVertexLayoutPacked = nullptr;
 
 	//Added for Texturing
-	_pTextureRV = nullptr;
 	_pSamplerLinear = nullptr;
+	_assets = nullptr;
 }
 
 Application::~Application()
@@ -70,7 +79,7 @@ HRESULT Application::Initialise(HINSTANCE hInstance, int nCmdShow)
 	// Initialize the world matrix
 	//
 	XMStoreFloat4x4(&_world, XMMatrixIdentity());
-	XMStoreFloat4x4(&_world, XMMatrixScaling(0.25f, 0.25f, 0.25f));
+	XMStoreFloat4x4(&_world, XMMatrixScaling(SceneLayout::BoatScale, SceneLayout::BoatScale, SceneLayout::BoatScale));
 
 
 	//
@@ -81,39 +90,14 @@ HRESULT Application::Initialise(HINSTANCE hInstance, int nCmdShow)
 	boatUp = XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
 
 	//
-	//Camera Settings
+	//Camera Settings - where each one starts is in SceneLayout.h
 	//
 
-	eye = XMFLOAT3(0.0f, 5.0f, 25.0f);
-	at = XMFLOAT3(0.0f, 0.0f, -1.0f);
-	up = XMFLOAT3(0.0f, 1.0f, 0.0f);
-
-	freeMoveCamera = new Camera(eye, at, up, _WindowWidth, _WindowHeight, 0.01f, 150.0f, true); // Dynamic  Free Moving Camera
-
-	eye = XMFLOAT3(0.0f, 0.0f, 0.0f);
-	at = XMFLOAT3(0.0f, 0.0f, -1.0f); 
-	up = XMFLOAT3(0.0f, 1.0f, 0.0f);
-
-	firstPersonCamera = new Camera(eye, at, up, _WindowWidth, _WindowHeight, 0.01f, 150.0f, false); //First Person Camera
-
-	eye = XMFLOAT3(0.0f, 65.0f, 0.0f);
-	at = XMFLOAT3(0.0f, 0.0f, 0.0f);
-	up = XMFLOAT3(1.0f, 0.0f, 0.0f);
-
-	staticBirdsEyeCamera = new Camera(eye, at, up, _WindowWidth, _WindowHeight, 0.01f, 250.0f, true);  //Birds Eye View Camera
-
-	eye = XMFLOAT3(0.0f, 20.0f, -15.0f);
-	at = XMFLOAT3(0.0f, 0.0f, 0.0f);
-	up = XMFLOAT3(0.0f, 1.0f, 0.0f);
-
-	thirdPersonCamera = new Camera(eye, at, up, _WindowWidth, _WindowHeight, 0.01f, 150.0f, true); 
-
-	
-	eye = XMFLOAT3(10.0f, 50.0f, 15.0f);
-	at = XMFLOAT3(0.0f, 0.0f, 0.0f);
-	up = XMFLOAT3(0.0f, 1.0f, 0.0f);
-
-	staticPerspectiveCamera = new Camera(eye, at, up, _WindowWidth, _WindowHeight, 0.01f, 250.0f, true); 
+	freeMoveCamera = CreateCamera(SceneLayout::Cameras[0], _WindowWidth, _WindowHeight); // Dynamic  Free Moving Camera
+	firstPersonCamera = CreateCamera(SceneLayout::Cameras[1], _WindowWidth, _WindowHeight); //First Person Camera
+	staticBirdsEyeCamera = CreateCamera(SceneLayout::Cameras[2], _WindowWidth, _WindowHeight);  //Birds Eye View Camera
+	thirdPersonCamera = CreateCamera(SceneLayout::Cameras[3], _WindowWidth, _WindowHeight);
+	staticPerspectiveCamera = CreateCamera(SceneLayout::Cameras[4], _WindowWidth, _WindowHeight);
 
 	_view = freeMoveCamera->camera._view;
 	_projection = freeMoveCamera->camera._projection;
@@ -168,6 +152,25 @@ HRESULT Application::InitShadersAndInputLayout()
 		return hr;
 	}
 
+	// Packed Vertex VS
+	ID3DBlob* pVSBlobPacked = nullptr;
+	hr = CompileShaderFromFile(L"DX11 Framework.fx", "VSPACKED", "vs_4_0", &pVSBlobPacked);
+
+	if (FAILED(hr))
+	{
+		MessageBox(nullptr,
+			L"The FX file cannot be compiled.  Please run this executable from the directory that contains the FX file.", L"Error", MB_OK);
+		return hr;
+	}
+
+	hr = _pd3dDevice->CreateVertexShader(pVSBlobPacked->GetBufferPointer(), pVSBlobPacked->GetBufferSize(), nullptr, &_pVertexShaderPacked);
+
+	if (FAILED(hr))
+	{
+		pVSBlobPacked->Release();
+		return hr;
+	}
+
 
 	//
 	// Compile and Create the Pixel Shader
@@ -212,14 +215,12 @@ HRESULT Application::InitShadersAndInputLayout()
 	// Define the input 
 	//
 
-	D3D11_INPUT_ELEMENT_DESC layout[] =
-	{
-		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-		{ "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-		{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 24, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-	};
+	// Same layouts the mesh caches describe in their headers
+	D3D11_INPUT_ELEMENT_DESC layout[MeshCache::MaxAttributes];
+	UINT numElements = OBJLoader::GetInputLayout(VertexFormatFull, layout);
 
-	UINT numElements = ARRAYSIZE(layout);
+	D3D11_INPUT_ELEMENT_DESC layoutPacked[MeshCache::MaxAttributes];
+	UINT numElementsPacked = OBJLoader::GetInputLayout(VertexFormatPacked, layoutPacked);
 
 	//
 	// Create the input layout
@@ -237,6 +238,13 @@ HRESULT Application::InitShadersAndInputLayout()
 		pVSBlobWater->GetBufferSize(), &_pVertexLayoutWater);
 	pVSBlobWater->Release();
 
+	if (FAILED(hr))
+		return hr;
+
+	hr = _pd3dDevice->CreateInputLayout(layoutPacked, numElementsPacked, pVSBlobPacked->GetBufferPointer(),
+		pVSBlobPacked->GetBufferSize(), &_pVertexLayoutPacked);
+	pVSBlobPacked->Release();
+
 	if (FAILED(hr))
 		return hr;
 
@@ -247,6 +255,193 @@ HRESULT Application::InitShadersAndInputLayout()
 	return hr;
 }
 
+//Binds a mesh's buffers along with the input layout and vertex shader its vertex format needs.
+//vertexShader is used for full SimpleVertex meshes, packed ones always go through VSPACKED
+void Application::SetMeshBuffers(const MeshData& mesh, ID3D11VertexShader* vertexShader)
+{
+	_pImmediateContext->IASetVertexBuffers(0, 1, &mesh.VertexBuffer, &mesh.VBStride, &mesh.VBOffset);
+
+	//Slot 1 is cleared for meshes without tangents so a layout that reads it can't pick up the last mesh's
+	UINT tangentStride = sizeof(PackedTangent);
+	UINT tangentOffset = 0;
+	_pImmediateContext->IASetVertexBuffers(1, 1, &mesh.TangentBuffer, &tangentStride, &tangentOffset);
+	_pImmediateContext->IASetIndexBuffer(mesh.IndexBuffer, mesh.IndexFormat, 0);
+
+	if (mesh.Format == VertexFormatPacked)
+	{
+		_pImmediateContext->IASetInputLayout(_pVertexLayoutPacked);
+		_pImmediateContext->VSSetShader(_pVertexShaderPacked, nullptr, 0);
+	}
+	else
+	{
+		_pImmediateContext->IASetInputLayout(_pVertexLayout);
+		_pImmediateContext->VSSetShader(vertexShader, nullptr, 0);
+	}
+
+	cb.PosDecodeScale = XMFLOAT4(mesh.PositionScale.x, mesh.PositionScale.y, mesh.PositionScale.z, 0.0f);
+	cb.PosDecodeOffset = XMFLOAT4(mesh.PositionOffset.x, mesh.PositionOffset.y, mesh.PositionOffset.z, 0.0f);
+}
+
+//How far the current camera is from the nearest point of the bounding sphere of a mesh placed with 'world', in mesh units.
+//0 or less when the camera is inside it
+float Application::SphereDistance(const MeshData& mesh, const XMFLOAT4X4& world)
+{
+	XMMATRIX worldMatrix = XMLoadFloat4x4(&world);
+	XMVECTOR axisScale = XMVectorMax(XMVector3Length(worldMatrix.r[0]), XMVectorMax(XMVector3Length(worldMatrix.r[1]), XMVector3Length(worldMatrix.r[2])));
+	float scale = XMVectorGetX(axisScale);
+
+	XMVECTOR centre = XMVector3TransformCoord(XMLoadFloat3(&mesh.SphereCentre), worldMatrix * XMLoadFloat4x4(&_view));
+	return XMVectorGetX(XMVector3Length(centre)) / scale - mesh.SphereRadius;
+}
+
+//Pixels something a unit across covers a unit in front of the camera
+float Application::PixelScale() const
+{
+	//_22 of a perspective projection is 1 / tan(fovY / 2)
+	return _WindowHeight * 0.5f * _projection._22;
+}
+
+//The level of detail to draw a mesh with this frame: the coarsest whose error stays under SceneLayout::LodPixelError pixels
+//from the current camera, going by the nearest point of the mesh's bounding sphere. 0 (full detail) when the camera is inside it
+unsigned int Application::SelectLod(const MeshData& mesh, const XMFLOAT4X4& world)
+{
+	if (mesh.Lods.size() < 2)
+	{
+		return 0;
+	}
+
+	//Errors are in mesh units, so measure the distance in them too
+	float distance = SphereDistance(mesh, world);
+	if (distance <= 0.0f)
+	{
+		return 0;
+	}
+
+	return MeshSimplifier::SelectLod(mesh.Lods.data(), (unsigned int)mesh.Lods.size(), distance, PixelScale(), SceneLayout::LodPixelError);
+}
+
+//Tells the asset manager how much of 'texture', and of the mesh's own material textures, a mesh placed with 'world' could
+//show this frame, going by the nearest point of its bounding sphere, so the mips that needs get streamed in
+void Application::UseTextures(AssetManager::MeshHandle handle, AssetManager::TextureHandle texture, const XMFLOAT4X4& world)
+{
+	//The placeholder cube says nothing about the real mesh
+	if (!_assets->IsResident(handle))
+	{
+		return;
+	}
+
+	const MeshData& mesh = _assets->GetMesh(handle);
+	float pixelsPerUv = TextureStreaming::PixelsPerUv(mesh.UvDensity, SphereDistance(mesh, world), PixelScale());
+	_assets->UseTexture(texture, pixelsPerUv);
+	_assets->UseMaterialTextures(handle, pixelsPerUv);
+}
+
+//What the current camera can see of a mesh placed with 'world', in the mesh's own space for MeshClusters::Cull
+void Application::MakeClusterFrustum(const XMFLOAT4X4& world, float padding, MeshClusters::HiddenFaces hidden, MeshClusters::Frustum& outFrustum)
+{
+	XMMATRIX worldView = XMLoadFloat4x4(&world) * XMLoadFloat4x4(&_view);
+
+	XMFLOAT4X4 worldViewProjection;
+	XMStoreFloat4x4(&worldViewProjection, worldView * XMLoadFloat4x4(&_projection));
+
+	//The camera sits at the origin of view space, so the last row of the inverse is where it is in the mesh
+	XMFLOAT3 eye;
+	XMStoreFloat3(&eye, XMMatrixInverse(nullptr, worldView).r[3]);
+	const float eyePosition[3] = { eye.x, eye.y, eye.z };
+
+	MeshClusters::MakeFrustum(worldViewProjection.m, eyePosition, padding, hidden, outFrustum);
+}
+
+//One DrawIndexed for the range, or with a frustum, one for each run of its clusters that survives culling
+void Application::DrawRange(const MeshData& mesh, const MeshCache::Submesh& submesh, const MeshClusters::Frustum* frustum)
+{
+	if (frustum == nullptr || mesh.Clusters.empty())
+	{
+		_pImmediateContext->DrawIndexed(submesh.IndexCount, submesh.IndexStart, 0);
+		return;
+	}
+
+	_visibleRanges.clear();
+	MeshClusters::Cull(mesh.Clusters.data(), mesh.Clusters.size(), submesh, *frustum, _visibleRanges);
+	for (size_t i = 0; i < _visibleRanges.size(); ++i)
+	{
+		_pImmediateContext->DrawIndexed(_visibleRanges[i].IndexCount, _visibleRanges[i].IndexStart, 0);
+	}
+}
+
+//Draws level of detail 'lod' of the mesh SetMeshBuffers bound with one DrawIndexed per submesh, all from the same buffers.
+//Submeshes whose material came from a .mtl file get its colours (and diffuse map, if it has one) for their draw, everything
+//else is drawn with the constant buffer and texture the caller already set. Meshes without submeshes are a single draw as before.
+//Given a frustum (see MakeClusterFrustum), only the clusters of each submesh that could be seen are drawn
+void Application::DrawSubmeshes(AssetManager::MeshHandle handle, unsigned int lod, const MeshClusters::Frustum* frustum)
+{
+	const MeshData& mesh = _assets->GetMesh(handle);
+
+	if (mesh.Submeshes.empty())
+	{
+		MeshCache::Submesh wholeMesh = { 0, mesh.IndexCount, 0, 0 };
+		DrawRange(mesh, wholeMesh, frustum);
+		return;
+	}
+
+	//Without a LOD table every submesh is part of the full mesh
+	size_t first = 0;
+	size_t count = mesh.Submeshes.size();
+	if (lod < mesh.Lods.size())
+	{
+		first = mesh.Lods[lod].SubmeshStart;
+		count = mesh.Lods[lod].SubmeshCount;
+	}
+
+	if (mesh.Materials.empty())
+	{
+		for (size_t i = first; i < first + count; ++i)
+		{
+			DrawRange(mesh, mesh.Submeshes[i], frustum);
+		}
+		return;
+	}
+
+	ConstantBuffer sceneMaterial = cb;
+	ID3D11ShaderResourceView* sceneTexture = nullptr;
+	_pImmediateContext->PSGetShaderResources(0, 1, &sceneTexture);
+
+	for (size_t i = first; i < first + count; ++i)
+	{
+		const MeshCache::Submesh& submesh = mesh.Submeshes[i];
+		const MTLParser::Material& material = mesh.Materials[submesh.MaterialId];
+
+		ID3D11ShaderResourceView* texture = sceneTexture;
+		if (material.Defined)
+		{
+			cb.ambientMtrl = XMFLOAT4(material.Ambient.x, material.Ambient.y, material.Ambient.z, 1.0f);
+			cb.diffuseMtrl = XMFLOAT4(material.Diffuse.x, material.Diffuse.y, material.Diffuse.z, material.Opacity);
+			cb.SpecularMtrl = XMFLOAT4(material.Specular.x, material.Specular.y, material.Specular.z, 1.0f);
+			cb.SpecularPower = (material.SpecularPower > 0.0f) ? material.SpecularPower : sceneMaterial.SpecularPower;
+
+			ID3D11ShaderResourceView* diffuseMap = _assets->GetMaterialTexture(handle, submesh.MaterialId);
+			if (diffuseMap) texture = diffuseMap;
+		}
+		else
+		{
+			cb.ambientMtrl = sceneMaterial.ambientMtrl;
+			cb.diffuseMtrl = sceneMaterial.diffuseMtrl;
+			cb.SpecularMtrl = sceneMaterial.SpecularMtrl;
+			cb.SpecularPower = sceneMaterial.SpecularPower;
+		}
+
+		_pImmediateContext->UpdateSubresource(_pConstantBuffer, 0, nullptr, &cb, 0, 0);
+		_pImmediateContext->PSSetShaderResources(0, 1, &texture);
+		DrawRange(mesh, submesh, frustum);
+	}
+
+	//Leave everything as the caller had it
+	cb = sceneMaterial;
+	_pImmediateContext->UpdateSubresource(_pConstantBuffer, 0, nullptr, &cb, 0, 0);
+	_pImmediateContext->PSSetShaderResources(0, 1, &sceneTexture);
+	if (sceneTexture) sceneTexture->Release();
+}
+
 HRESULT Application::InitVertexBuffer()
 {
 	HRESULT hr;
@@ -297,7 +492,7 @@ HRESULT Application::InitWindow(HINSTANCE hInstance, int nCmdShow)
 	//
 
 	_hInst = hInstance;
-	RECT rc = { 0, 0, 1920, 1080 };
+	RECT rc = { 0, 0, (LONG)SceneLayout::WindowWidth, (LONG)SceneLayout::WindowHeight };
 	AdjustWindowRect(&rc, WS_OVERLAPPEDWINDOW, FALSE);
 	_hWnd = CreateWindow(L"TutorialWindowClass", L"Direct X 11 - Marine Ship Scene", WS_OVERLAPPEDWINDOW,
 		CW_USEDEFAULT, CW_USEDEFAULT, rc.right - rc.left, rc.bottom - rc.top, nullptr, nullptr, hInstance,
@@ -496,23 +691,40 @@ HRESULT Application::InitDevice()
 		return hr;
 
 
+#ifdef ASSET_BENCHMARKS
 	//
-	// Load in OBJ Model
+	// Asset pipeline timings, see Benchmarks.h
 	//
 
-	objMeshDataBoat = OBJLoader::Load("mainPlayerBoat.obj", _pd3dDevice, false);
-	objMeshDataWater = OBJLoader::Load("water.obj", _pd3dDevice, false);
-	objMeshDataRock = OBJLoader::Load("rockBorder.obj", _pd3dDevice, false);
-	objMeshDataSky = OBJLoader::Load("skyboxSphere.obj", _pd3dDevice, false);
+	Benchmarks::RunAll();
+#endif
 
 	//
-	// Create the sample state - Texturing
+	// Load in OBJ Models and Textures - files are read on worker threads and the GPU resources are created
+	// in Update as they arrive. Until then the handles give back placeholders, so we don't wait for anything here
 	//
 
-	CreateDDSTextureFromFile(_pd3dDevice, L"mainPlayerBoatTex.dds", nullptr, &_pTextureRV);
-	CreateDDSTextureFromFile(_pd3dDevice, L"oceanTex.dds", nullptr, &_pTextureRVWater);
-	CreateDDSTextureFromFile(_pd3dDevice, L"rock.dds", nullptr, &_pTextureRVRock);
-	CreateDDSTextureFromFile(_pd3dDevice, L"sky.dds", nullptr, &_pTextureRVSky);
+	// Water stays full precision as VSWATER displaces the raw positions, and full detail as the waves are made out of its vertices
+	OBJLoader::ImportSettings packedSettings;
+	packedSettings.Format = VertexFormatPacked;
+	OBJLoader::ImportSettings waterSettings;
+	waterSettings.LodLevels = 0;
+
+	_assets = new AssetManager(_pd3dDevice);
+	_assets->SetTextureBudget(SceneLayout::TextureBudget);
+	meshBoat = _assets->LoadMesh("mainPlayerBoat.obj", false, packedSettings);
+	meshWater = _assets->LoadMesh("water.obj", false, waterSettings);
+	meshRock = _assets->LoadMesh("rockBorder.obj", false, packedSettings);
+	meshSky = _assets->LoadMesh("skyboxSphere.obj", false, packedSettings);
+
+	textureBoat = _assets->LoadTexture("mainPlayerBoatTex.dds");
+	textureWater = _assets->LoadTexture("oceanTex.dds");
+	textureRock = _assets->LoadTexture("rock.dds");
+	textureSky = _assets->LoadTexture("sky.dds");
+
+	//
+	// Create the sample state - Texturing
+	//
 
 	D3D11_SAMPLER_DESC sampDesc;
 	ZeroMemory(&sampDesc, sizeof(sampDesc));
@@ -568,9 +780,12 @@ HRESULT Application::InitDevice()
 void Application::Cleanup()
 {
 	if (_pImmediateContext) _pImmediateContext->ClearState();
+	if (_assets) delete _assets;
 	if (_pConstantBuffer) _pConstantBuffer->Release();
 	if (_pVertexLayout) _pVertexLayout->Release();
 	if (_pVertexShader) _pVertexShader->Release();
+	if (_pVertexLayoutPacked) _pVertexLayoutPacked->Release();
+	if (_pVertexShaderPacked) _pVertexShaderPacked->Release();
 	if (_pPixelShader) _pPixelShader->Release();
 	if (_pRenderTargetView) _pRenderTargetView->Release();
 	if (_pSwapChain) _pSwapChain->Release();
@@ -605,6 +820,12 @@ void Application::Update()
 		
 		cb.gTime = t;
 	}
+
+	//
+	// Create GPU resources for any assets that finished loading since last frame
+	//
+
+	_assets->Update();
 	//
 	// User Inputted Controls
 	//
@@ -905,39 +1126,15 @@ void Application::Update()
 	XMStoreFloat4x4(&_world, playerBoat);
 
 	// Water Update Values
-	XMStoreFloat4x4(&_world2, XMMatrixTranslation(0.0f, -1.5f, 0.0f));
+	XMStoreFloat4x4(&_world2, XMMatrixTranslation(SceneLayout::WaterPosition.x, SceneLayout::WaterPosition.y, SceneLayout::WaterPosition.z));
 
 	// Rock Update Values
-	XMStoreFloat4x4(&_rocks[0], XMMatrixTranslation(-50.0f, -6.0f, 67.0f));
-	XMStoreFloat4x4(&_rocks[1], XMMatrixTranslation(-25.0f, -6.0f, 67.0f));
-	XMStoreFloat4x4(&_rocks[2], XMMatrixTranslation(0.0f, -6.0f, 67.0f));
-	XMStoreFloat4x4(&_rocks[3], XMMatrixTranslation(25.0f, -6.0f, 67.0f));
-	XMStoreFloat4x4(&_rocks[4], XMMatrixTranslation(50.0f, -6.0f, 67.0f));
-	XMStoreFloat4x4(&_rocks[5], XMMatrixTranslation(-50.0f, -7.0f, -67.0f));
-	XMStoreFloat4x4(&_rocks[6], XMMatrixTranslation(-25.0f, -7.0f, -67.0f));
-	XMStoreFloat4x4(&_rocks[7], XMMatrixTranslation(0.0f, -7.0f, -67.0f));
-	XMStoreFloat4x4(&_rocks[8], XMMatrixTranslation(25.0f, -7.0f, -67.0f));
-	XMStoreFloat4x4(&_rocks[9], XMMatrixTranslation(50.0f, -7.0f, -67.0f));
-	XMStoreFloat4x4(&_rocks[10], XMMatrixTranslation(-70.0f, -7.0f, 55.0f));
-	XMStoreFloat4x4(&_rocks[11], XMMatrixTranslation(-70.0f, -7.0f, 40.0f));
-	XMStoreFloat4x4(&_rocks[12], XMMatrixTranslation(-70.0f, -7.0f, 25.0f));
-	XMStoreFloat4x4(&_rocks[13], XMMatrixTranslation(-70.0f, -7.0f, 10.0f));
-	XMStoreFloat4x4(&_rocks[14], XMMatrixTranslation(-70.0f, -7.0f, -5.0f));
-	XMStoreFloat4x4(&_rocks[15], XMMatrixTranslation(-70.0f, -7.0f, -20.0f));
-	XMStoreFloat4x4(&_rocks[16], XMMatrixTranslation(-70.0f, -7.0f, -35.0f));
-	XMStoreFloat4x4(&_rocks[17], XMMatrixTranslation(-70.0f, -7.0f, -50.0f));
-	XMStoreFloat4x4(&_rocks[18], XMMatrixTranslation(-70.0f, -7.0f, -65.0f));
-	XMStoreFloat4x4(&_rocks[19], XMMatrixTranslation(70.0f, -7.0f, 55.0f));
-	XMStoreFloat4x4(&_rocks[20], XMMatrixTranslation(70.0f, -7.0f, 40.0f));
-	XMStoreFloat4x4(&_rocks[21], XMMatrixTranslation(70.0f, -7.0f, 25.0f));
-	XMStoreFloat4x4(&_rocks[22], XMMatrixTranslation(70.0f, -7.0f, 10.0f));
-	XMStoreFloat4x4(&_rocks[23], XMMatrixTranslation(70.0f, -7.0f, -5.0f));
-	XMStoreFloat4x4(&_rocks[24], XMMatrixTranslation(70.0f, -7.0f, -20.0f));
-	XMStoreFloat4x4(&_rocks[25], XMMatrixTranslation(70.0f, -7.0f, -35.0f));
-	XMStoreFloat4x4(&_rocks[26], XMMatrixTranslation(70.0f, -7.0f, -50.0f));
-	XMStoreFloat4x4(&_rocks[27], XMMatrixTranslation(70.0f, -7.0f, -65.0f));
+	for (unsigned int i = 0; i < SceneLayout::RockCount; i++)
+	{
+		XMStoreFloat4x4(&_rocks[i], XMMatrixTranslation(SceneLayout::Rocks[i].x, SceneLayout::Rocks[i].y, SceneLayout::Rocks[i].z));
+	}
 	
-	XMStoreFloat4x4(&_world3, XMMatrixScaling(120.0f, 120.0f, 120.0f)* XMMatrixTranslation(0.0f, 5.0f, 0.0f)* XMMatrixRotationY(-t / 10));
+	XMStoreFloat4x4(&_world3, XMMatrixScaling(SceneLayout::SkyScale, SceneLayout::SkyScale, SceneLayout::SkyScale)* XMMatrixTranslation(SceneLayout::SkyPosition.x, SceneLayout::SkyPosition.y, SceneLayout::SkyPosition.z)* XMMatrixRotationY(-t / 10));
 }
 
 
@@ -972,7 +1169,6 @@ void Application::Draw()
 	cb.SpecularPower = specularPower;
 	cb.EyePosW = eyePosW;
 
-	_pImmediateContext->UpdateSubresource(_pConstantBuffer, 0, nullptr, &cb, 0, 0);
 	_pImmediateContext->RSSetState(_currentState);
 
 	UINT stride = sizeof(SimpleVertex);
@@ -983,22 +1179,24 @@ void Application::Draw()
 	//
 
 	// Draw Boat
-	_pImmediateContext->IASetVertexBuffers(0, 1, &objMeshDataBoat.VertexBuffer, &objMeshDataBoat.VBStride, &objMeshDataBoat.VBOffset);
-	_pImmediateContext->IASetIndexBuffer(objMeshDataBoat.IndexBuffer, DXGI_FORMAT_R16_UINT, 0);
+	const MeshData& boatMesh = _assets->GetMesh(meshBoat);
+	ID3D11ShaderResourceView* boatTexture = _assets->GetTexture(textureBoat);
+	SetMeshBuffers(boatMesh, _pVertexShader);
+	_pImmediateContext->UpdateSubresource(_pConstantBuffer, 0, nullptr, &cb, 0, 0);
 
-	_pImmediateContext->VSSetShader(_pVertexShader, nullptr, 0);
 	_pImmediateContext->VSSetConstantBuffers(0, 1, &_pConstantBuffer);
 	_pImmediateContext->PSSetConstantBuffers(0, 1, &_pConstantBuffer);
 	_pImmediateContext->PSSetShader(_pPixelShader, nullptr, 0);
-	_pImmediateContext->PSSetShaderResources(0, 1, &_pTextureRV); //Textures
-	_pImmediateContext->DrawIndexed(objMeshDataBoat.IndexCount, 0, 0);
+	_pImmediateContext->PSSetShaderResources(0, 1, &boatTexture); //Textures
+	DrawSubmeshes(meshBoat, SelectLod(boatMesh, _world));
+	UseTextures(meshBoat, textureBoat, _world);
 
 	// Draw Water
-	_pImmediateContext->IASetVertexBuffers(0, 1, &objMeshDataWater.VertexBuffer, &objMeshDataWater.VBStride, &objMeshDataWater.VBOffset);
-	_pImmediateContext->IASetIndexBuffer(objMeshDataWater.IndexBuffer, DXGI_FORMAT_R16_UINT, 0);
-	_pImmediateContext->PSSetShaderResources(0, 1, &_pTextureRVWater); //Textures
+	const MeshData& waterMesh = _assets->GetMesh(meshWater);
+	ID3D11ShaderResourceView* waterTexture = _assets->GetTexture(textureWater);
+	SetMeshBuffers(waterMesh, _pVertexShaderWater);
+	_pImmediateContext->PSSetShaderResources(0, 1, &waterTexture); //Textures
 
-	_pImmediateContext->VSSetShader(_pVertexShaderWater, nullptr, 0);
 	_pImmediateContext->PSSetShader(_pPixelShaderWater, nullptr, 0);
 
 	world = XMLoadFloat4x4(&_world2);
@@ -1006,32 +1204,39 @@ void Application::Draw()
 	_pImmediateContext->UpdateSubresource(_pConstantBuffer, 0, nullptr, &cb, 0, 0);
 	_pImmediateContext->VSSetConstantBuffers(0, 1, &_pConstantBuffer);
 	_pImmediateContext->PSSetConstantBuffers(0, 1, &_pConstantBuffer);
-	_pImmediateContext->DrawIndexed(objMeshDataWater.IndexCount, 0, 0);
+
+	//The waves move vertices about in the vertex shader, so every cluster's sphere has to allow for them
+	MeshClusters::Frustum waterFrustum;
+	MakeClusterFrustum(_world2, SceneLayout::WaterWaveHeight * 1.414214f, MeshClusters::HiddenFacesBack, waterFrustum);
+	DrawSubmeshes(meshWater, 0, &waterFrustum);
+	UseTextures(meshWater, textureWater, _world2);
 
 	// Drawing Rocks
-	_pImmediateContext->IASetVertexBuffers(0, 1, &objMeshDataRock.VertexBuffer, &objMeshDataRock.VBStride, &objMeshDataRock.VBOffset);
-	_pImmediateContext->IASetIndexBuffer(objMeshDataRock.IndexBuffer, DXGI_FORMAT_R16_UINT, 0);
-	_pImmediateContext->PSSetShaderResources(0, 1, &_pTextureRVRock); //Textures
-	_pImmediateContext->VSSetShader(_pVertexShader, nullptr, 0);
+	const MeshData& rockMesh = _assets->GetMesh(meshRock);
+	ID3D11ShaderResourceView* rockTexture = _assets->GetTexture(textureRock);
+	SetMeshBuffers(rockMesh, _pVertexShader);
+	_pImmediateContext->PSSetShaderResources(0, 1, &rockTexture); //Textures
 	_pImmediateContext->PSSetShader(_pPixelShader, nullptr, 0);
 
-	for (int i = 0; i < 28; i++)
+	//Each rock gets the level of detail its distance calls for, the far ones only need a fraction of the triangles
+	for (unsigned int i = 0; i < SceneLayout::RockCount; i++)
 	{
 		world = XMLoadFloat4x4(&_rocks[i]);
 		cb.mWorld = XMMatrixTranspose(world);
 		_pImmediateContext->UpdateSubresource(_pConstantBuffer, 0, nullptr, &cb, 0, 0);
 		_pImmediateContext->VSSetConstantBuffers(0, 1, &_pConstantBuffer);
 		_pImmediateContext->PSSetConstantBuffers(0, 1, &_pConstantBuffer);
-		_pImmediateContext->DrawIndexed(objMeshDataRock.IndexCount, 0, 0);
+		DrawSubmeshes(meshRock, SelectLod(rockMesh, _rocks[i]));
+		UseTextures(meshRock, textureRock, _rocks[i]);
 	}
 
 
 	// Sky Box Values
-	_pImmediateContext->IASetVertexBuffers(0, 1, &objMeshDataSky.VertexBuffer, &objMeshDataSky.VBStride, &objMeshDataSky.VBOffset);
-	_pImmediateContext->IASetIndexBuffer(objMeshDataSky.IndexBuffer, DXGI_FORMAT_R16_UINT, 0);
-	_pImmediateContext->PSSetShaderResources(0, 1, &_pTextureRVSky); //Textures
+	const MeshData& skyMesh = _assets->GetMesh(meshSky);
+	ID3D11ShaderResourceView* skyTexture = _assets->GetTexture(textureSky);
+	SetMeshBuffers(skyMesh, _pVertexShader);
+	_pImmediateContext->PSSetShaderResources(0, 1, &skyTexture); //Textures
 
-	_pImmediateContext->VSSetShader(_pVertexShader, nullptr, 0);
 	_pImmediateContext->PSSetShader(_pPixelShader, nullptr, 0);
 
 	world = XMLoadFloat4x4(&_world3);
@@ -1039,7 +1244,12 @@ void Application::Draw()
 	_pImmediateContext->UpdateSubresource(_pConstantBuffer, 0, nullptr, &cb, 0, 0);
 	_pImmediateContext->VSSetConstantBuffers(0, 1, &_pConstantBuffer);
 	_pImmediateContext->PSSetConstantBuffers(0, 1, &_pConstantBuffer);
-	_pImmediateContext->DrawIndexed(objMeshDataSky.IndexCount, 0, 0);
+
+	//Seen from inside, so it's the outward facing clusters that can't be seen
+	MeshClusters::Frustum skyFrustum;
+	MakeClusterFrustum(_world3, 0.0f, MeshClusters::HiddenFacesFront, skyFrustum);
+	DrawSubmeshes(meshSky, SelectLod(skyMesh, _world3), &skyFrustum);
+	UseTextures(meshSky, textureSky, _world3);
 
 	//
 	// Present our back buffer to our front buffer
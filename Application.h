@@ -7,8 +7,12 @@
 #include "resource.h"
 #include "DDSTextureLoader.h"
 #include "OBJLoader.h"
+#include "AssetManager.h"
 #include "Structures.h"
 #include "Camera.h"
+#include "SceneLayout.h"
+#include "MeshClusters.h"
+#include "Benchmarks.h"
 #include <stdlib.h>     /* srand, rand */
 
 using namespace DirectX;
@@ -35,10 +39,13 @@ private:
 	ID3D11DepthStencilView* _depthStencilView;
 	ID3D11Texture2D*		_depthStencilBuffer;
 	XMFLOAT4X4              _world, _world2, _world3;
-	XMFLOAT4X4				_rocks[28];
+	XMFLOAT4X4				_rocks[SceneLayout::RockCount];
 	XMFLOAT4X4              _view;
 	XMFLOAT4X4              _projection;
 
+	//Scratch for the cluster ranges left of a submesh after culling, kept so drawing doesn't allocate
+	std::vector<MeshCache::Submesh> _visibleRanges;
+
 	//Render States
 	ID3D11RasterizerState* _wireFrame;
 	ID3D11RasterizerState* _solidFrame; 
@@ -62,17 +69,18 @@ private:
 	XMFLOAT3 eyePosW;
 
 	//Added for Texutring Process
-	ID3D11ShaderResourceView* _pTextureRV;
-	ID3D11ShaderResourceView* _pTextureRVWater;
-	ID3D11ShaderResourceView* _pTextureRVRock;
-	ID3D11ShaderResourceView* _pTextureRVSky;
+	AssetManager::TextureHandle textureBoat;
+	AssetManager::TextureHandle textureWater;
+	AssetManager::TextureHandle textureRock;
+	AssetManager::TextureHandle textureSky;
 	ID3D11SamplerState* _pSamplerLinear;
 
-	//Added for OBJLoader Process
-	MeshData objMeshDataBoat;
-	MeshData objMeshDataWater;
-	MeshData objMeshDataRock;
-	MeshData objMeshDataSky;
+	//Added for OBJLoader Process - meshes and textures stream in, drawn as placeholders until they arrive
+	AssetManager* _assets;
+	AssetManager::MeshHandle meshBoat;
+	AssetManager::MeshHandle meshWater;
+	AssetManager::MeshHandle meshRock;
+	AssetManager::MeshHandle meshSky;
 
 	Camera* freeMoveCamera;
 	Camera* firstPersonCamera;
@@ -80,9 +88,6 @@ private:
 	Camera* thirdPersonCamera;
 	Camera* staticPerspectiveCamera;
 	float cameraActive;
-	XMFLOAT3 eye;
-	XMFLOAT3 at;
-	XMFLOAT3 up;
 
 	//Boat Values
 	
@@ -100,6 +105,10 @@ private:
 	ID3D11PixelShader* _pPixelShaderWater;
 	ID3D11InputLayout* _pVertexLayoutWater;
 
+	//Created for Packed Vertices (see VertexPacking.h)
+	ID3D11VertexShader* _pVertexShaderPacked;
+	ID3D11InputLayout* _pVertexLayoutPacked;
+
 	
 private:
 	HRESULT InitWindow(HINSTANCE hInstance, int nCmdShow);
@@ -109,6 +118,14 @@ private:
 	HRESULT InitShadersAndInputLayout();
 	HRESULT InitVertexBuffer();
 	HRESULT InitIndexBuffer();
+	void SetMeshBuffers(const MeshData& mesh, ID3D11VertexShader* vertexShader);
+	float SphereDistance(const MeshData& mesh, const XMFLOAT4X4& world);
+	float PixelScale() const;
+	unsigned int SelectLod(const MeshData& mesh, const XMFLOAT4X4& world);
+	void UseTextures(AssetManager::MeshHandle handle, AssetManager::TextureHandle texture, const XMFLOAT4X4& world);
+	void MakeClusterFrustum(const XMFLOAT4X4& world, float padding, MeshClusters::HiddenFaces hidden, MeshClusters::Frustum& outFrustum);
+	void DrawRange(const MeshData& mesh, const MeshCache::Submesh& submesh, const MeshClusters::Frustum* frustum);
+	void DrawSubmeshes(AssetManager::MeshHandle handle, unsigned int lod = 0, const MeshClusters::Frustum* frustum = nullptr);
 
 	UINT _WindowHeight;
 	UINT _WindowWidth;
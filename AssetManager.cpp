@@ -0,0 +1,978 @@
+#include "AssetManager.h"
+#include "BlockDecoder.h"
+#include "DDSFile.h"
+#include "DDSTextureLoader.h"
+#include "DebugLog.h"
+#include "Hash.h"
+#include "VertexPacking.h"
+#include <stdio.h>
+
+namespace
+{
+	//Frames a streamed texture holds on to mips it no longer needs before giving them up, unless the budget wants the
+	//room sooner, so a camera going back and forth across the distance where a mip is needed doesn't read it over and over
+	const unsigned int StreamKeepFrames = 120;
+
+	//Streamed textures are keyed by a hash of their whole file as textures loaded whole are, but seeded differently so
+	//one of each with the same file can't share: the same bytes give a texture with all its mips or one that streams them
+	const uint64_t StreamHashSeed = 0x53545245414D4544ull;
+
+	//Everything that decides what loading a mesh gives, so requests that would load the same thing can share one load
+	uint64_t MeshRequestKey(const std::string& filename, bool invertTexCoords, const OBJLoader::ImportSettings& settings)
+	{
+		return HashBytes(filename.data(), filename.size(), OBJLoader::SettingsHash(settings, invertTexCoords));
+	}
+
+	//A streamed texture and the whole of the same file are different resources
+	uint64_t TextureRequestKey(const std::string& filename, bool streamed)
+	{
+		return HashBytes(filename.data(), filename.size(), streamed ? 1 : 0);
+	}
+
+	double SecondsSince(std::chrono::high_resolution_clock::time_point start)
+	{
+		return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+
+	void ReleaseBuffers(MeshData& mesh)
+	{
+		if (mesh.VertexBuffer) mesh.VertexBuffer->Release();
+		if (mesh.IndexBuffer) mesh.IndexBuffer->Release();
+		if (mesh.TangentBuffer) mesh.TangentBuffer->Release();
+		mesh = MeshData();
+	}
+
+	//The texture loader only reads DDS, so a material's "map_Kd rock.png" is looked for as rock.dds
+	std::string DDSName(const std::string& filename)
+	{
+		size_t dot = filename.find_last_of('.');
+		size_t slash = filename.find_last_of("/\\");
+		if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+		{
+			return filename + ".dds";
+		}
+
+		return filename.substr(0, dot) + ".dds";
+	}
+	//An immutable 2D texture (array or cube, as texture is) in 'format' of texture's mips from 'mip' down, with a view of all
+	//of it. Null if it can't be created
+	ID3D11ShaderResourceView* CreateView(ID3D11Device* device, const DDSFile::Texture& texture, DXGI_FORMAT format, uint32_t mip,
+		const D3D11_SUBRESOURCE_DATA* initData)
+	{
+		uint32_t mipLevels = texture.MipCount - mip;
+
+		D3D11_TEXTURE2D_DESC textureDesc;
+		ZeroMemory(&textureDesc, sizeof(textureDesc));
+		textureDesc.Width = DDSFile::MipSize(texture.Width, mip);
+		textureDesc.Height = DDSFile::MipSize(texture.Height, mip);
+		textureDesc.MipLevels = mipLevels;
+		textureDesc.ArraySize = texture.ArraySize;
+		textureDesc.Format = format;
+		textureDesc.SampleDesc.Count = 1;
+		textureDesc.Usage = D3D11_USAGE_IMMUTABLE;
+		textureDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+		textureDesc.MiscFlags = texture.Cubemap ? D3D11_RESOURCE_MISC_TEXTURECUBE : 0;
+
+		D3D11_SHADER_RESOURCE_VIEW_DESC viewDesc;
+		ZeroMemory(&viewDesc, sizeof(viewDesc));
+		viewDesc.Format = format;
+		if (texture.Cubemap && texture.ArraySize > 6)
+		{
+			viewDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURECUBEARRAY;
+			viewDesc.TextureCubeArray.MipLevels = mipLevels;
+			viewDesc.TextureCubeArray.NumCubes = texture.ArraySize / 6;
+		}
+		else if (texture.Cubemap)
+		{
+			viewDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURECUBE;
+			viewDesc.TextureCube.MipLevels = mipLevels;
+		}
+		else if (texture.ArraySize > 1)
+		{
+			viewDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2DARRAY;
+			viewDesc.Texture2DArray.MipLevels = mipLevels;
+			viewDesc.Texture2DArray.ArraySize = texture.ArraySize;
+		}
+		else
+		{
+			viewDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+			viewDesc.Texture2D.MipLevels = mipLevels;
+		}
+
+		ID3D11Texture2D* created = nullptr;
+		ID3D11ShaderResourceView* view = nullptr;
+		if (SUCCEEDED(device->CreateTexture2D(&textureDesc, initData, &created)) && created)
+		{
+			device->CreateShaderResourceView(created, &viewDesc, &view);
+			created->Release();
+		}
+		return view;
+	}
+
+	//For a device that can't sample a BC format: every surface decoded on the pool into the uncompressed format sampling it
+	//would give. 2D textures, arrays and cubes only. Null if it isn't BC1-BC7 or can't be created
+	ID3D11ShaderResourceView* CreateDecodedTexture(ID3D11Device* device, const void* data, size_t size, ThreadPool& pool)
+	{
+		DDSFile::Texture texture;
+		if (!DDSFile::Parse(data, size, texture) || BlockDecoder::DecodedPixelSize(texture.Format) == 0 || texture.Depth > 1)
+		{
+			return nullptr;
+		}
+
+		size_t pixelSize = BlockDecoder::DecodedPixelSize(texture.Format);
+		std::vector<std::vector<unsigned char>> surfaces(texture.ArraySize * texture.MipCount);
+		std::vector<D3D11_SUBRESOURCE_DATA> initData(surfaces.size());
+		for (uint32_t item = 0; item < texture.ArraySize; ++item)
+		{
+			for (uint32_t mip = 0; mip < texture.MipCount; ++mip)
+			{
+				size_t index = item * texture.MipCount + mip;
+				BlockDecoder::Decode(texture, item, mip, surfaces[index], &pool);
+				initData[index].pSysMem = surfaces[index].data();
+				initData[index].SysMemPitch = (UINT)(DDSFile::MipSize(texture.Width, mip) * pixelSize);
+				initData[index].SysMemSlicePitch = (UINT)surfaces[index].size();
+			}
+		}
+
+		return CreateView(device, texture, BlockDecoder::DecodedFormat(texture.Format), 0, initData.data());
+	}
+
+	//The mips of texture from 'mip' down, straight out of the mapped file. Null if the device can't create it
+	ID3D11ShaderResourceView* CreateMipRange(ID3D11Device* device, const DDSFile::Texture& texture, uint32_t mip)
+	{
+		uint32_t mipLevels = texture.MipCount - mip;
+		std::vector<D3D11_SUBRESOURCE_DATA> initData(texture.ArraySize * mipLevels);
+		for (uint32_t item = 0; item < texture.ArraySize; ++item)
+		{
+			for (uint32_t level = 0; level < mipLevels; ++level)
+			{
+				size_t rowBytes = 0;
+				D3D11_SUBRESOURCE_DATA& data = initData[item * mipLevels + level];
+				data.pSysMem = DDSFile::Surface(texture, item, mip + level);
+				data.SysMemSlicePitch = (UINT)DDSFile::SurfaceSize(texture.Format, DDSFile::MipSize(texture.Width, mip + level),
+					DDSFile::MipSize(texture.Height, mip + level), &rowBytes);
+				data.SysMemPitch = (UINT)rowBytes;
+			}
+		}
+
+		return CreateView(device, texture, texture.Format, mip, initData.data());
+	}
+}
+
+AssetManager::AssetManager(ID3D11Device* device, unsigned int threadCount)
+	: _device(device), _pool(threadCount), _pendingCount(0), _textureBudget(0), _placeholderMesh(), _placeholderTexture(nullptr), _batchCount(0)
+{
+	memset(&_stats, 0, sizeof(_stats));
+	CreatePlaceholders();
+}
+
+AssetManager::~AssetManager()
+{
+	//Don't let workers write into jobs that are about to be freed
+	_pool.WaitIdle();
+
+	//Whatever handles are still held, the resources go with us
+	for (auto it = _sharedMeshes.begin(); it != _sharedMeshes.end(); ++it)
+	{
+		ReleaseBuffers(it->second->Data);
+	}
+
+	for (auto it = _sharedTextures.begin(); it != _sharedTextures.end(); ++it)
+	{
+		if (it->second->View) it->second->View->Release();
+	}
+
+	ReleaseBuffers(_placeholderMesh);
+	if (_placeholderTexture) _placeholderTexture->Release();
+}
+
+void AssetManager::CreatePlaceholders()
+{
+	//Unit cube, one quad per face so each face gets its own normal
+	SimpleVertex vertices[24];
+	unsigned short indices[36];
+
+	for (int face = 0; face < 6; ++face)
+	{
+		int axis = face / 2;
+		float sign = (face & 1) ? -1.0f : 1.0f;
+
+		float normal[3] = { 0.0f, 0.0f, 0.0f };
+		normal[axis] = sign;
+
+		for (int corner = 0; corner < 4; ++corner)
+		{
+			float u = (corner & 1) ? 1.0f : -1.0f;
+			float v = (corner & 2) ? 1.0f : -1.0f;
+
+			float position[3];
+			position[axis] = sign;
+			position[(axis + 1) % 3] = u * sign;
+			position[(axis + 2) % 3] = v;
+
+			SimpleVertex& vertex = vertices[face * 4 + corner];
+			vertex.Pos = XMFLOAT3(position[0], position[1], position[2]);
+			vertex.Normal = XMFLOAT3(normal[0], normal[1], normal[2]);
+			vertex.TexC = XMFLOAT2((u + 1.0f) * 0.5f, (v + 1.0f) * 0.5f);
+		}
+
+		unsigned short base = (unsigned short)(face * 4);
+		unsigned short quad[6] = { base, (unsigned short)(base + 2), (unsigned short)(base + 1), (unsigned short)(base + 1), (unsigned short)(base + 2), (unsigned short)(base + 3) };
+		memcpy(&indices[face * 6], quad, sizeof(quad));
+	}
+
+	_placeholderMesh = OBJLoader::CreateBuffers(_device, vertices, 24, sizeof(SimpleVertex), indices, 36, DXGI_FORMAT_R16_UINT);
+
+	//2x2 magenta/grey checkerboard, hard to mistake for a real texture
+	const unsigned int texels[4] = { 0xFFFF00FF, 0xFF808080, 0xFF808080, 0xFFFF00FF };
+
+	D3D11_TEXTURE2D_DESC textureDesc;
+	ZeroMemory(&textureDesc, sizeof(textureDesc));
+	textureDesc.Width = 2;
+	textureDesc.Height = 2;
+	textureDesc.MipLevels = 1;
+	textureDesc.ArraySize = 1;
+	textureDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+	textureDesc.SampleDesc.Count = 1;
+	textureDesc.Usage = D3D11_USAGE_IMMUTABLE;
+	textureDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+	D3D11_SUBRESOURCE_DATA initData;
+	ZeroMemory(&initData, sizeof(initData));
+	initData.pSysMem = texels;
+	initData.SysMemPitch = 2 * sizeof(unsigned int);
+
+	ID3D11Texture2D* texture = nullptr;
+	if (SUCCEEDED(_device->CreateTexture2D(&textureDesc, &initData, &texture)) && texture)
+	{
+		_device->CreateShaderResourceView(texture, nullptr, &_placeholderTexture);
+		texture->Release();
+	}
+}
+
+void AssetManager::StartTiming()
+{
+	if (_pendingCount == 0)
+	{
+		_batchCount = 0;
+		_batchStart = std::chrono::high_resolution_clock::now();
+	}
+
+	++_pendingCount;
+	++_batchCount;
+}
+
+void AssetManager::FinishTiming()
+{
+	--_pendingCount;
+
+	if (_pendingCount == 0)
+	{
+		DebugLog("[AssetManager] %u assets resident %.2f ms after being requested (%u worker threads)\n",
+			_batchCount, SecondsSince(_batchStart) * 1000.0, _pool.ThreadCount());
+		DebugLog("[AssetManager] shared cache: %u loads, %u hits, %u unique resources, %.1f KB created, %.1f KB saved\n",
+			_stats.Requests, _stats.Hits, _stats.UniqueResources, _stats.BytesCreated / 1024.0, _stats.BytesSaved / 1024.0);
+	}
+}
+
+AssetManager::MeshHandle AssetManager::LoadMesh(const char* filename, bool invertTexCoords, const OBJLoader::ImportSettings& settings)
+{
+	std::unique_ptr<MeshJob> job(new MeshJob());
+	job->Filename = filename;
+	job->InvertTexCoords = invertTexCoords;
+	job->Settings = settings;
+	job->RequestKey = MeshRequestKey(job->Filename, invertTexCoords, settings);
+	job->ContentHash = 0;
+	job->UvDensity = 0.0f;
+	job->PrepareSeconds = 0.0;
+	job->Prepared = false;
+	job->Resident = false;
+	job->Released = false;
+	job->Shared = nullptr;
+
+	MeshHandle handle = (MeshHandle)_meshes.size();
+	MeshJob* pending = job.get();
+	_meshes.push_back(std::move(job));
+
+	//Asked for before, so there's no need to read and prepare the file again
+	auto resident = _meshRequests.find(pending->RequestKey);
+	if (resident != _meshRequests.end())
+	{
+		pending->Resident = true;
+		ShareMesh(*pending, *resident->second, true);
+		DebugLog("[AssetManager] %s: shared, already resident\n", filename);
+		return handle;
+	}
+
+	StartTiming();
+
+	auto loading = _meshLoads.find(pending->RequestKey);
+	if (loading != _meshLoads.end())
+	{
+		_meshes[loading->second]->Waiting.push_back(handle);
+		return handle;
+	}
+
+	_meshLoads[pending->RequestKey] = handle;
+	_pool.Submit([pending] { PrepareMesh(pending); });
+
+	return handle;
+}
+
+AssetManager::TextureHandle AssetManager::LoadTexture(const char* filename)
+{
+	std::unique_ptr<TextureJob> job(new TextureJob());
+	job->Filename = filename;
+	job->Streamed = _textureBudget > 0;
+	job->RequestKey = TextureRequestKey(job->Filename, job->Streamed);
+	job->ContentHash = 0;
+	job->ReadSeconds = 0.0;
+	job->Prepared = false;
+	job->Resident = false;
+	job->Released = false;
+	job->Shared = nullptr;
+
+	TextureHandle handle = (TextureHandle)_textures.size();
+	TextureJob* pending = job.get();
+	_textures.push_back(std::move(job));
+
+	auto resident = _textureRequests.find(pending->RequestKey);
+	if (resident != _textureRequests.end())
+	{
+		pending->Resident = true;
+		ShareTexture(*pending, *resident->second, true);
+		DebugLog("[AssetManager] %s: shared, already resident\n", filename);
+		return handle;
+	}
+
+	StartTiming();
+
+	auto loading = _textureLoads.find(pending->RequestKey);
+	if (loading != _textureLoads.end())
+	{
+		_textures[loading->second]->Waiting.push_back(handle);
+		return handle;
+	}
+
+	_textureLoads[pending->RequestKey] = handle;
+	_pool.Submit([pending] { ReadTexture(pending); });
+
+	return handle;
+}
+
+const MeshData& AssetManager::GetMesh(MeshHandle handle) const
+{
+	const MeshJob& job = *_meshes[handle];
+	return (job.Shared && job.Shared->Data.VertexBuffer) ? job.Shared->Data : _placeholderMesh;
+}
+
+ID3D11ShaderResourceView* AssetManager::GetTexture(TextureHandle handle) const
+{
+	const TextureJob& job = *_textures[handle];
+	return (job.Shared && job.Shared->View) ? job.Shared->View : _placeholderTexture;
+}
+
+ID3D11ShaderResourceView* AssetManager::GetMaterialTexture(MeshHandle handle, unsigned int materialId) const
+{
+	const MeshJob& job = *_meshes[handle];
+	if (!job.Shared || materialId >= job.Shared->MaterialTextures.size() || job.Shared->MaterialTextures[materialId] == NoTexture)
+	{
+		return nullptr;
+	}
+
+	return GetTexture(job.Shared->MaterialTextures[materialId]);
+}
+
+void AssetManager::UseTexture(TextureHandle handle, float pixelsPerUv)
+{
+	const TextureJob& job = *_textures[handle];
+	if (!job.Shared || !job.Shared->Stream)
+	{
+		return;
+	}
+
+	TextureStream& stream = *job.Shared->Stream;
+	uint32_t size = (stream.Texture.Width > stream.Texture.Height) ? stream.Texture.Width : stream.Texture.Height;
+	uint32_t mip = TextureStreaming::WantedMip(size, pixelsPerUv);
+	if (mip < stream.AskedMip)
+	{
+		stream.AskedMip = mip;
+	}
+}
+
+void AssetManager::UseMaterialTextures(MeshHandle handle, float pixelsPerUv)
+{
+	const MeshJob& job = *_meshes[handle];
+	if (!job.Shared)
+	{
+		return;
+	}
+
+	for (size_t i = 0; i < job.Shared->MaterialTextures.size(); ++i)
+	{
+		if (job.Shared->MaterialTextures[i] != NoTexture) UseTexture(job.Shared->MaterialTextures[i], pixelsPerUv);
+	}
+}
+
+void AssetManager::ReleaseMesh(MeshHandle handle)
+{
+	MeshJob& job = *_meshes[handle];
+	job.Released = true;
+
+	if (job.Shared && --job.Shared->RefCount == 0)
+	{
+		for (size_t i = 0; i < job.Shared->MaterialTextures.size(); ++i)
+		{
+			if (job.Shared->MaterialTextures[i] != NoTexture) ReleaseTexture(job.Shared->MaterialTextures[i]);
+		}
+
+		for (size_t i = 0; i < job.Shared->RequestKeys.size(); ++i)
+		{
+			_meshRequests.erase(job.Shared->RequestKeys[i]);
+		}
+
+		ReleaseBuffers(job.Shared->Data);
+		_sharedMeshes.erase(job.Shared->Hash);
+		--_stats.UniqueResources;
+	}
+	job.Shared = nullptr;
+}
+
+void AssetManager::ReleaseTexture(TextureHandle handle)
+{
+	TextureJob& job = *_textures[handle];
+	job.Released = true;
+
+	if (job.Shared && --job.Shared->RefCount == 0)
+	{
+		if (job.Shared->View) job.Shared->View->Release();
+		if (job.Shared->Stream) _stats.StreamedBytes -= job.Shared->Stream->ResidentBytes;
+		for (size_t i = 0; i < job.Shared->RequestKeys.size(); ++i)
+		{
+			_textureRequests.erase(job.Shared->RequestKeys[i]);
+		}
+		_sharedTextures.erase(job.Shared->Hash);
+		--_stats.UniqueResources;
+	}
+	job.Shared = nullptr;
+}
+
+void AssetManager::PrepareMesh(MeshJob* job)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+	OBJLoader::Prepare(job->Filename.c_str(), job->InvertTexCoords, job->Settings, job->Mesh);
+
+	//Key on exactly what would go to the GPU, so identical meshes match whichever file (or cache format) they came from
+	const OBJLoader::PreparedMesh& mesh = job->Mesh;
+	if (mesh.Valid)
+	{
+		uint64_t hash = HashBytes(mesh.Vertices, (size_t)mesh.VertexCount * mesh.VertexStride, mesh.VertexStride);
+		hash = HashBytes(mesh.Indices, (size_t)mesh.IndexCount * MeshCache::IndexSize(mesh.IndexFormat), hash);
+		if (mesh.Format == VertexFormatPacked)
+		{
+			hash = HashBytes(mesh.BoundsMin, sizeof(mesh.BoundsMin), hash);
+			hash = HashBytes(mesh.BoundsMax, sizeof(mesh.BoundsMax), hash);
+		}
+
+		//The same triangles drawn with different materials aren't the same mesh
+		hash = HashBytes(mesh.Submeshes, mesh.SubmeshCount * sizeof(MeshCache::Submesh), hash);
+		hash = HashBytes(mesh.Lods, mesh.LodCount * sizeof(MeshCache::MeshLod), hash);
+		hash = HashBytes(mesh.Clusters, mesh.ClusterCount * sizeof(MeshCache::MeshCluster), hash);
+		if (mesh.Tangents != nullptr)
+		{
+			hash = HashBytes(mesh.Tangents, (size_t)mesh.VertexCount * sizeof(PackedTangent), hash);
+		}
+		for (size_t i = 0; i < mesh.Materials.size(); ++i)
+		{
+			const MTLParser::Material& material = mesh.Materials[i];
+			const float values[] =
+			{
+				material.Ambient.x, material.Ambient.y, material.Ambient.z, material.Diffuse.x, material.Diffuse.y, material.Diffuse.z,
+				material.Specular.x, material.Specular.y, material.Specular.z, material.SpecularPower, material.Opacity, material.Defined ? 1.0f : 0.0f
+			};
+			hash = HashBytes(material.Name.data(), material.Name.size(), hash);
+			hash = HashBytes(values, sizeof(values), hash);
+			hash = HashBytes(material.DiffuseMap.data(), material.DiffuseMap.size(), hash);
+		}
+		job->ContentHash = hash;
+
+		//How much texture each mesh unit gets, for streaming texture mips. Over the full detail triangles only, as
+		//simplified levels stretch their texture coordinates
+		std::vector<SimpleVertex> unpacked;
+		const SimpleVertex* vertices = (const SimpleVertex*)mesh.Vertices;
+		if (mesh.Format == VertexFormatPacked)
+		{
+			unpacked.resize(mesh.VertexCount);
+			VertexPacking::Unpack((const PackedVertex*)mesh.Vertices, mesh.VertexCount, mesh.BoundsMin, mesh.BoundsMax, unpacked.data());
+			vertices = unpacked.data();
+		}
+
+		TextureStreaming::SurfaceArea area;
+		if (mesh.SubmeshCount == 0)
+		{
+			TextureStreaming::AddArea(vertices, mesh.Indices, mesh.IndexFormat, 0, mesh.IndexCount, area);
+		}
+		else
+		{
+			//Without a LOD table every submesh is part of the full mesh
+			unsigned int first = (mesh.LodCount > 0) ? mesh.Lods[0].SubmeshStart : 0;
+			unsigned int count = (mesh.LodCount > 0) ? mesh.Lods[0].SubmeshCount : mesh.SubmeshCount;
+			for (unsigned int i = first; i < first + count; ++i)
+			{
+				TextureStreaming::AddArea(vertices, mesh.Indices, mesh.IndexFormat, mesh.Submeshes[i].IndexStart, mesh.Submeshes[i].IndexCount, area);
+			}
+		}
+		job->UvDensity = TextureStreaming::UvDensity(area);
+	}
+
+	job->PrepareSeconds = SecondsSince(start);
+
+	job->Prepared.store(true, std::memory_order_release);
+}
+
+void AssetManager::ReadTexture(TextureJob* job)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+
+	//A streamed texture only reads its tail now, the rest waits until it's asked for
+	if (job->Streamed)
+	{
+		std::shared_ptr<TextureStream> stream(new TextureStream());
+		if (DDSFile::Open(job->Filename.c_str(), stream->File, stream->Texture) && stream->Texture.Depth == 1 && TextureStreaming::TailMip(stream->Texture) > 0)
+		{
+			stream->Filename = job->Filename;
+			stream->TailMip = TextureStreaming::TailMip(stream->Texture);
+			stream->ResidentMip = stream->Texture.MipCount;
+			stream->ResidentBytes = 0;
+			stream->AskedMip = stream->Texture.MipCount;
+			stream->WantedMip = stream->TailMip;
+			stream->SurplusFrames = 0;
+			stream->Reading = false;
+			stream->ReadingMip = stream->Texture.MipCount;
+			stream->ReadSeconds = 0.0;
+			stream->ReadDone = false;
+			ReadMips(stream.get(), stream->TailMip, stream->Texture.MipCount);
+
+			//Keyed by the whole file like any other texture, as two files alike in all but their finer mips mustn't share.
+			//That reads through mips that haven't been asked for yet, but only into the page cache and off the main thread
+			job->Stream = stream;
+			job->ContentHash = HashBytes(stream->File.Data(), stream->File.Size(), StreamHashSeed);
+		}
+	}
+
+	//Mapping is all the reading there is. Hashing touches every page, which also pulls the file in off the main thread
+	if (!job->Stream && job->File.Open(job->Filename.c_str()))
+	{
+		job->ContentHash = HashBytes(job->File.Data(), job->File.Size());
+	}
+	job->ReadSeconds = SecondsSince(start);
+
+	job->Prepared.store(true, std::memory_order_release);
+}
+
+void AssetManager::ReadMips(TextureStream* stream, uint32_t mip, uint32_t endMip)
+{
+	//Touching a byte of every page of mips [mip, endMip) is what pulls them off disk, so creating the texture from
+	//them on the main thread doesn't wait on it. Each item's mips sit together in the file, largest first
+	auto start = std::chrono::high_resolution_clock::now();
+	const DDSFile::Texture& texture = stream->Texture;
+	unsigned char touched = 0;
+	for (uint32_t item = 0; item < texture.ArraySize; ++item)
+	{
+		size_t lastSize = 0;
+		const unsigned char* first = DDSFile::Surface(texture, item, mip);
+		const unsigned char* last = DDSFile::Surface(texture, item, endMip - 1, &lastSize);
+		for (const unsigned char* page = first; page < last + lastSize; page += 4096)
+		{
+			touched ^= *page;
+		}
+	}
+
+	//Somewhere the compiler can't see the reads aren't needed
+	volatile unsigned char sink = touched;
+	(void)sink;
+
+	stream->ReadSeconds = SecondsSince(start);
+	stream->ReadDone.store(true, std::memory_order_release);
+}
+
+void AssetManager::ShareMesh(MeshJob& job, SharedMesh& shared, bool hit)
+{
+	job.Shared = &shared;
+	++shared.RefCount;
+
+	++_stats.Requests;
+	if (hit)
+	{
+		++_stats.Hits;
+		_stats.BytesSaved += shared.Bytes;
+	}
+}
+
+void AssetManager::ShareTexture(TextureJob& job, SharedTexture& shared, bool hit)
+{
+	job.Shared = &shared;
+	++shared.RefCount;
+
+	++_stats.Requests;
+	if (hit)
+	{
+		++_stats.Hits;
+		_stats.BytesSaved += shared.Stream ? shared.Stream->ResidentBytes : shared.Bytes;
+	}
+}
+
+void AssetManager::CreateMesh(MeshJob& job)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+	job.Resident = true;
+	_meshLoads.erase(job.RequestKey);
+
+	//Worth creating as long as one of the requests that asked for it still wants it
+	bool wanted = !job.Released;
+	for (size_t i = 0; i < job.Waiting.size(); ++i)
+	{
+		wanted = wanted || !_meshes[job.Waiting[i]]->Released;
+	}
+
+	const OBJLoader::PreparedMesh& mesh = job.Mesh;
+	size_t bytes = (size_t)mesh.VertexCount * mesh.VertexStride + (size_t)mesh.IndexCount * MeshCache::IndexSize(mesh.IndexFormat);
+	SharedMesh* shared = nullptr;
+	bool created = false;
+
+	//Nobody wants it any more (or it didn't load), there's nothing to create
+	if (mesh.Valid && wanted)
+	{
+		auto existing = _sharedMeshes.find(job.ContentHash);
+		if (existing != _sharedMeshes.end())
+		{
+			shared = existing->second.get();
+		}
+		else
+		{
+			std::unique_ptr<SharedMesh> made(new SharedMesh());
+			made->Hash = job.ContentHash;
+			made->RefCount = 0;
+			made->Bytes = bytes;
+			made->Data = OBJLoader::CreateBuffers(_device, mesh);
+			made->Data.UvDensity = job.UvDensity;
+
+			//Material textures stream in like any other, owned by the mesh
+			for (size_t i = 0; i < mesh.Materials.size(); ++i)
+			{
+				const std::string& map = mesh.Materials[i].DiffuseMap;
+				made->MaterialTextures.push_back(map.empty() ? NoTexture : LoadTexture(DDSName(map).c_str()));
+			}
+
+			shared = made.get();
+			_sharedMeshes[job.ContentHash] = std::move(made);
+
+			++_stats.UniqueResources;
+			_stats.BytesCreated += bytes;
+			created = true;
+		}
+
+		//Requests for the same file and settings from now on go straight to it
+		if (_meshRequests.insert(std::make_pair(job.RequestKey, shared)).second)
+		{
+			shared->RequestKeys.push_back(job.RequestKey);
+		}
+	}
+
+	//The first to take a new resource made it, everyone after shares it
+	bool hit = !created;
+	if (shared && !job.Released)
+	{
+		ShareMesh(job, *shared, hit);
+		hit = true;
+	}
+
+	const char* result = job.Released ? "released before it arrived" : !shared ? "FAILED" : created ? "ok" : "shared";
+	DebugLog("[AssetManager] %s: %s, prepare %.2f ms, create %.2f ms\n", job.Filename.c_str(),
+		result, job.PrepareSeconds * 1000.0, SecondsSince(start) * 1000.0);
+
+	for (size_t i = 0; i < job.Waiting.size(); ++i)
+	{
+		MeshJob& waiting = *_meshes[job.Waiting[i]];
+		waiting.Resident = true;
+		if (shared && !waiting.Released)
+		{
+			ShareMesh(waiting, *shared, hit);
+			hit = true;
+		}
+
+		DebugLog("[AssetManager] %s: %s, waited on the same request\n", waiting.Filename.c_str(),
+			waiting.Released ? "released before it arrived" : shared ? "shared" : "FAILED");
+		FinishTiming();
+	}
+	std::vector<MeshHandle>().swap(job.Waiting);
+
+	//The GPU has its own copy now
+	job.Mesh.File.Close();
+	std::vector<unsigned char>().swap(job.Mesh.Built);
+	job.Mesh.Valid = false;
+
+	FinishTiming();
+}
+
+void AssetManager::CreateTexture(TextureJob& job)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+	job.Resident = true;
+	_textureLoads.erase(job.RequestKey);
+
+	bool wanted = !job.Released;
+	for (size_t i = 0; i < job.Waiting.size(); ++i)
+	{
+		wanted = wanted || !_textures[job.Waiting[i]]->Released;
+	}
+
+	//A streamed texture's file stays mapped in its stream for the mips still to come
+	const MappedFile& file = job.Stream ? job.Stream->File : job.File;
+	size_t bytes = file.Size();
+	SharedTexture* shared = nullptr;
+	bool created = false;
+	bool decoded = false;
+	char streamed[64] = "";
+
+	if (file.Data() != nullptr && wanted)
+	{
+		auto existing = _sharedTextures.find(job.ContentHash);
+		if (existing != _sharedTextures.end())
+		{
+			shared = existing->second.get();
+		}
+		else
+		{
+			ID3D11ShaderResourceView* view = nullptr;
+			std::shared_ptr<TextureStream> stream = job.Stream;
+			if (stream)
+			{
+				//Just the tail to start with. If the device can't take the format, it's loaded whole like any other
+				view = CreateMipRange(_device, stream->Texture, stream->TailMip);
+				if (view != nullptr)
+				{
+					stream->ResidentMip = stream->TailMip;
+					stream->ResidentBytes = TextureStreaming::ResidentBytes(stream->Texture, stream->TailMip);
+					bytes = (size_t)stream->ResidentBytes;
+					_stats.StreamedBytes += stream->ResidentBytes;
+					snprintf(streamed, sizeof(streamed), ", streaming from mip %u (%ux%u)", stream->TailMip,
+						DDSFile::MipSize(stream->Texture.Width, stream->TailMip), DDSFile::MipSize(stream->Texture.Height, stream->TailMip));
+				}
+				else
+				{
+					stream.reset();
+				}
+			}
+
+			if (view == nullptr && FAILED(CreateDDSTextureFromMemory(_device, file.Data(), file.Size(), nullptr, &view)))
+			{
+				view = CreateDecodedTexture(_device, file.Data(), file.Size(), _pool);
+				decoded = view != nullptr;
+			}
+
+			if (view != nullptr)
+			{
+				std::unique_ptr<SharedTexture> made(new SharedTexture());
+				made->Hash = job.ContentHash;
+				made->RefCount = 0;
+				made->Bytes = bytes;
+				made->View = view;
+				made->Stream = stream;
+
+				shared = made.get();
+				_sharedTextures[job.ContentHash] = std::move(made);
+
+				++_stats.UniqueResources;
+				_stats.BytesCreated += bytes;
+				created = true;
+			}
+		}
+
+		if (shared && _textureRequests.insert(std::make_pair(job.RequestKey, shared)).second)
+		{
+			shared->RequestKeys.push_back(job.RequestKey);
+		}
+	}
+
+	bool hit = !created;
+	if (shared && !job.Released)
+	{
+		ShareTexture(job, *shared, hit);
+		hit = true;
+	}
+
+	const char* result = job.Released ? "released before it arrived" : !shared ? "FAILED" : !created ? "shared" : decoded ? "ok, decoded on the CPU" : "ok";
+	DebugLog("[AssetManager] %s: %s%s, read %.2f ms, create %.2f ms\n", job.Filename.c_str(),
+		result, streamed, job.ReadSeconds * 1000.0, SecondsSince(start) * 1000.0);
+
+	for (size_t i = 0; i < job.Waiting.size(); ++i)
+	{
+		TextureJob& waiting = *_textures[job.Waiting[i]];
+		waiting.Resident = true;
+		if (shared && !waiting.Released)
+		{
+			ShareTexture(waiting, *shared, hit);
+			hit = true;
+		}
+
+		DebugLog("[AssetManager] %s: %s, waited on the same request\n", waiting.Filename.c_str(),
+			waiting.Released ? "released before it arrived" : shared ? "shared" : "FAILED");
+		FinishTiming();
+	}
+	std::vector<TextureHandle>().swap(job.Waiting);
+
+	//The shared texture holds on to the stream if it's using it
+	job.File.Close();
+	job.Stream.reset();
+
+	FinishTiming();
+}
+
+void AssetManager::StreamMips(SharedTexture& shared, uint32_t mip)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+	TextureStream& stream = *shared.Stream;
+
+	//Out of memory or the like, keep what it has and try again next frame
+	ID3D11ShaderResourceView* view = CreateMipRange(_device, stream.Texture, mip);
+	if (view == nullptr)
+	{
+		return;
+	}
+
+	//Anything still bound holds its own reference to the old one
+	if (shared.View) shared.View->Release();
+	shared.View = view;
+
+	bool finer = mip < stream.ResidentMip;
+	uint64_t bytes = TextureStreaming::ResidentBytes(stream.Texture, mip);
+	_stats.StreamedBytes = _stats.StreamedBytes - stream.ResidentBytes + bytes;
+	if (finer)
+	{
+		++_stats.MipLoads;
+		_stats.BytesCreated += bytes;
+	}
+
+	stream.ResidentMip = mip;
+	stream.ResidentBytes = bytes;
+	stream.SurplusFrames = 0;
+
+	DebugLog("[AssetManager] %s: mips from %u (%ux%u) resident, %.1f KB, read %.2f ms, create %.2f ms, streamed textures %.1f KB of %.1f KB\n",
+		stream.Filename.c_str(), mip, DDSFile::MipSize(stream.Texture.Width, mip), DDSFile::MipSize(stream.Texture.Height, mip), bytes / 1024.0,
+		finer ? stream.ReadSeconds * 1000.0 : 0.0, SecondsSince(start) * 1000.0, _stats.StreamedBytes / 1024.0, _textureBudget / 1024.0);
+}
+
+void AssetManager::UpdateStreaming()
+{
+	//What each streamed texture asked for over the last frame. Nothing asking means it's not being drawn, so it only
+	//needs its tail
+	_streamed.clear();
+	_streamRequests.clear();
+	for (auto it = _sharedTextures.begin(); it != _sharedTextures.end(); ++it)
+	{
+		SharedTexture& shared = *it->second;
+		if (!shared.Stream)
+		{
+			continue;
+		}
+
+		TextureStream& stream = *shared.Stream;
+		stream.WantedMip = (stream.AskedMip < stream.TailMip) ? stream.AskedMip : stream.TailMip;
+		stream.AskedMip = stream.Texture.MipCount;
+
+		TextureStreaming::Request request = { &stream.Texture, stream.WantedMip };
+		_streamed.push_back(&shared);
+		_streamRequests.push_back(request);
+	}
+
+	if (_streamed.empty())
+	{
+		return;
+	}
+
+	_streamMips.resize(_streamed.size());
+	TextureStreaming::FitBudget(_streamRequests.data(), _streamRequests.size(), _textureBudget, _streamMips.data());
+
+	for (size_t i = 0; i < _streamed.size(); ++i)
+	{
+		SharedTexture& shared = *_streamed[i];
+		TextureStream& stream = *shared.Stream;
+		uint32_t target = _streamMips[i];
+
+		//One read at a time. When it's in it's used, and next frame moves on from there if the target has changed since
+		if (stream.Reading)
+		{
+			if (stream.ReadDone.load(std::memory_order_acquire))
+			{
+				stream.Reading = false;
+				StreamMips(shared, stream.ReadingMip);
+			}
+			continue;
+		}
+
+		if (target < stream.ResidentMip)
+		{
+			stream.Reading = true;
+			stream.ReadingMip = target;
+			stream.ReadDone = false;
+			std::shared_ptr<TextureStream> reading = shared.Stream;
+			uint32_t endMip = stream.ResidentMip;
+			_pool.Submit([reading, target, endMip] { ReadMips(reading.get(), target, endMip); });
+		}
+		else if (target > stream.ResidentMip)
+		{
+			//Straight away if the budget needs the room, otherwise only once it's gone a while without needing them
+			if (target > stream.WantedMip || ++stream.SurplusFrames > StreamKeepFrames)
+			{
+				StreamMips(shared, target);
+			}
+		}
+		else
+		{
+			stream.SurplusFrames = 0;
+		}
+	}
+}
+
+unsigned int AssetManager::Update()
+{
+	unsigned int created = 0;
+
+	if (_pendingCount > 0)
+	{
+		for (size_t i = 0; i < _meshes.size(); ++i)
+		{
+			MeshJob& job = *_meshes[i];
+			if (!job.Resident && job.Prepared.load(std::memory_order_acquire))
+			{
+				CreateMesh(job);
+				++created;
+			}
+		}
+
+		for (size_t i = 0; i < _textures.size(); ++i)
+		{
+			TextureJob& job = *_textures[i];
+			if (!job.Resident && job.Prepared.load(std::memory_order_acquire))
+			{
+				CreateTexture(job);
+				++created;
+			}
+		}
+	}
+
+	UpdateStreaming();
+
+	return created;
+}
+
+void AssetManager::Finish()
+{
+	//Meshes can request their material textures as they become resident, so go round until nothing new turns up
+	while (_pendingCount > 0)
+	{
+		_pool.WaitIdle();
+		Update();
+	}
+}
@@ -0,0 +1,231 @@
+#pragma once
+#include <windows.h>
+#include <d3d11_1.h>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "OBJLoader.h"
+#include "DDSFile.h"
+#include "MappedFile.h"
+#include "TextureStreaming.h"
+#include "ThreadPool.h"
+
+//Streams meshes and DDS textures in the background. LoadMesh/LoadTexture return a handle straight away and hand
+//the file work (mapping, cache validation, rebuilding stale caches) to a worker. Until Update() sees the work is
+//done and creates the GPU resource, GetMesh/GetTexture return a placeholder (a small cube and a checkerboard),
+//so the scene can be drawn from the first frame. All device calls happen on the thread calling Update/Finish.
+//
+//A request for a file already requested with the same settings doesn't read it again: it shares the resident asset
+//straight away, or waits on the load already under way and shares what that creates.
+//
+//GPU resources are also shared by content: the worker hashes what it loaded, and if a resident asset already has that
+//hash (the same file loaded twice, or two files with the same bytes) the new handle shares its buffers/view
+//instead of creating another copy. Shared resources are reference counted and freed when the last handle is released
+//
+//With a texture budget set, textures stream by mip (see TextureStreaming.h): each arrives with only its smallest mips,
+//and the finer ones UseTexture calls for are read from the still mapped .dds by a worker, then a new texture is created
+//from them and swapped in for the old on the next Update. Streamed textures are shared by content too, by a hash of
+//the whole file taken on the worker, though never with a texture of the same file loaded whole
+class AssetManager
+{
+public:
+	typedef unsigned int MeshHandle;
+	typedef unsigned int TextureHandle;
+
+	//threadCount as for ThreadPool
+	explicit AssetManager(ID3D11Device* device, unsigned int threadCount = 0);
+
+	//Releases every resource it created
+	~AssetManager();
+
+	MeshHandle LoadMesh(const char* filename, bool invertTexCoords = true, const OBJLoader::ImportSettings& settings = OBJLoader::ImportSettings());
+	TextureHandle LoadTexture(const char* filename);
+
+	//The loaded resource, or the placeholder if it isn't resident yet (or failed to load)
+	const MeshData& GetMesh(MeshHandle handle) const;
+	ID3D11ShaderResourceView* GetTexture(TextureHandle handle) const;
+
+	//Diffuse map of one of a mesh's materials (MeshCache::Submesh::MaterialId), loaded along with the mesh. nullptr if the
+	//material has none, so the caller can fall back to its own texture. Placeholder until it's resident, like GetTexture
+	ID3D11ShaderResourceView* GetMaterialTexture(MeshHandle handle, unsigned int materialId) const;
+
+	bool IsResident(MeshHandle handle) const { return _meshes[handle]->Resident; }
+	bool IsTextureResident(TextureHandle handle) const { return _textures[handle]->Resident; }
+
+	//Textures loaded after this keep their mips within 'bytes' of GPU memory between them, streaming finer mips in as
+	//UseTexture asks for them and giving them up when the budget needs the room or nothing has asked for a while.
+	//0, the default, loads every texture whole. Volume textures and ones with only small mips always load whole
+	void SetTextureBudget(unsigned long long bytes) { _textureBudget = bytes; }
+
+	//Call each frame for each texture drawn, with the screen pixels a unit of texture coordinates covers where it's
+	//nearest the camera (TextureStreaming::PixelsPerUv). The most any call asks for in a frame is what the texture wants
+	void UseTexture(TextureHandle handle, float pixelsPerUv);
+
+	//UseTexture for every diffuse map of the mesh's materials
+	void UseMaterialTextures(MeshHandle handle, float pixelsPerUv);
+
+	//Drops the handle's reference, the GPU resource goes when nothing else uses it. The handle then gives the placeholder
+	void ReleaseMesh(MeshHandle handle);
+	void ReleaseTexture(TextureHandle handle);
+
+	struct Stats
+	{
+		unsigned int Requests;			//Assets that have finished loading
+		unsigned int Hits;				//...of which shared an existing GPU resource
+		unsigned int UniqueResources;	//GPU resources currently alive
+		unsigned long long BytesCreated;	//Vertex, index and texture file bytes handed to the device
+		unsigned long long BytesSaved;	//...and the bytes that sharing meant we didn't have to
+		unsigned long long StreamedBytes;	//Mips of streamed textures on the GPU now
+		unsigned int MipLoads;			//Times a streamed texture was given finer mips
+	};
+
+	const Stats& GetStats() const { return _stats; }
+
+	//Call once per frame. Creates the GPU resources for whatever the workers have finished since the last call,
+	//never waits on them, and moves streamed textures toward the mips last frame's UseTexture calls asked for.
+	//Returns how many assets became resident
+	unsigned int Update();
+
+	//Blocks until everything requested so far is resident
+	void Finish();
+
+	unsigned int PendingCount() const { return _pendingCount; }
+
+private:
+	AssetManager(const AssetManager&);
+	AssetManager& operator=(const AssetManager&);
+
+	struct SharedMesh
+	{
+		uint64_t Hash;
+		unsigned int RefCount;
+		size_t Bytes;				//Vertices and indices on the GPU
+		MeshData Data;
+		std::vector<TextureHandle> MaterialTextures;	//Per material, NoTexture if it has no diffuse map
+		std::vector<uint64_t> RequestKeys;	//Its entries in _meshRequests
+	};
+
+	static const TextureHandle NoTexture = 0xFFFFFFFF;
+
+	//A streamed texture's .dds stays mapped while it's resident, so finer mips can be read out of it at any time
+	struct TextureStream
+	{
+		std::string Filename;
+		MappedFile File;
+		DDSFile::Texture Texture;
+		uint32_t TailMip;			//TextureStreaming::TailMip, never given up
+		uint32_t ResidentMip;		//Finest mip in the view
+		uint64_t ResidentBytes;
+
+		//Main thread only
+		uint32_t AskedMip;			//Finest UseTexture asked for this frame, MipCount if nothing did
+		uint32_t WantedMip;			//AskedMip when the frame started, TailMip if nothing asked
+		unsigned int SurplusFrames;	//Frames in a row it's had finer mips than the budget fit gives it
+		bool Reading;				//A worker is reading the mips from ReadingMip to ResidentMip
+		uint32_t ReadingMip;
+
+		//Filled in by the worker, then it sets ReadDone
+		double ReadSeconds;
+		std::atomic<bool> ReadDone;
+	};
+
+	struct SharedTexture
+	{
+		uint64_t Hash;
+		unsigned int RefCount;
+		size_t Bytes;				//File bytes handed to the device, for textures that aren't streamed
+		ID3D11ShaderResourceView* View;
+		std::shared_ptr<TextureStream> Stream;	//Null unless it's streamed
+		std::vector<uint64_t> RequestKeys;	//Its entries in _textureRequests
+	};
+
+	struct MeshJob
+	{
+		std::string Filename;
+		bool InvertTexCoords;
+		OBJLoader::ImportSettings Settings;
+		uint64_t RequestKey;		//Filename and everything that changes what's loaded from it
+
+		//Written by the worker, then Prepared is set
+		OBJLoader::PreparedMesh Mesh;
+		uint64_t ContentHash;
+		float UvDensity;
+		double PrepareSeconds;
+		std::atomic<bool> Prepared;
+
+		//Main thread only
+		bool Resident;
+		bool Released;
+		SharedMesh* Shared;
+		std::vector<MeshHandle> Waiting;	//Later requests with the same RequestKey, given what this one loads
+	};
+
+	struct TextureJob
+	{
+		std::string Filename;
+
+		bool Streamed;
+		uint64_t RequestKey;
+
+		//Streamed textures map into Stream instead of File
+		MappedFile File;
+		std::shared_ptr<TextureStream> Stream;
+		uint64_t ContentHash;
+		double ReadSeconds;
+		std::atomic<bool> Prepared;
+
+		bool Resident;
+		bool Released;
+		SharedTexture* Shared;
+		std::vector<TextureHandle> Waiting;
+	};
+
+	static void PrepareMesh(MeshJob* job);
+	static void ReadTexture(TextureJob* job);
+	static void ReadMips(TextureStream* stream, uint32_t mip, uint32_t endMip);
+
+	void CreatePlaceholders();
+	void CreateMesh(MeshJob& job);
+	void CreateTexture(TextureJob& job);
+	void ShareMesh(MeshJob& job, SharedMesh& shared, bool hit);
+	void ShareTexture(TextureJob& job, SharedTexture& shared, bool hit);
+	void UpdateStreaming();
+	void StreamMips(SharedTexture& shared, uint32_t mip);
+	void StartTiming();
+	void FinishTiming();
+
+	ID3D11Device* _device;
+	ThreadPool _pool;
+
+	//Jobs live at a fixed address while the workers fill them in, handles are indices
+	std::vector<std::unique_ptr<MeshJob>> _meshes;
+	std::vector<std::unique_ptr<TextureJob>> _textures;
+	unsigned int _pendingCount;
+
+	//Resident resources by content hash
+	std::unordered_map<uint64_t, std::unique_ptr<SharedMesh>> _sharedMeshes;
+	std::unordered_map<uint64_t, std::unique_ptr<SharedTexture>> _sharedTextures;
+
+	//The same by request key, and the jobs loading ones that aren't resident yet
+	std::unordered_map<uint64_t, SharedMesh*> _meshRequests;
+	std::unordered_map<uint64_t, SharedTexture*> _textureRequests;
+	std::unordered_map<uint64_t, MeshHandle> _meshLoads;
+	std::unordered_map<uint64_t, TextureHandle> _textureLoads;
+	Stats _stats;
+
+	//Streaming, see SetTextureBudget. Kept between frames so Update doesn't allocate
+	unsigned long long _textureBudget;
+	std::vector<SharedTexture*> _streamed;
+	std::vector<TextureStreaming::Request> _streamRequests;
+	std::vector<uint32_t> _streamMips;
+
+	MeshData _placeholderMesh;
+	ID3D11ShaderResourceView* _placeholderTexture;
+
+	//From the first request after everything was resident, to everything being resident again
+	unsigned int _batchCount;
+	std::chrono::high_resolution_clock::time_point _batchStart;
+};
@@ -0,0 +1,1691 @@
+#include "Benchmarks.h"
+#include "DebugLog.h"
+#include "OBJParser.h"
+#include "VertexWelder.h"
+#include "MeshOptimiser.h"
+#include "MeshCache.h"
+#include "MappedFile.h"
+#include "OBJImport.h"
+#include "VertexPacking.h"
+#include "ThreadPool.h"
+#include "FloatParser.h"
+#include "MeshSimplifier.h"
+#include "MeshClusters.h"
+#include "MeshTangents.h"
+#include "MeshBounds.h"
+#include "MeshBvh.h"
+#include "DDSFile.h"
+#include "BlockDecoder.h"
+#include "BlockEncoder.h"
+#include "MipGenerator.h"
+#include "TextureStreaming.h"
+#include "Hash.h"
+#include <algorithm>
+#include <chrono>
+#include <float.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+namespace
+{
+	//The models that ship with the boat scene
+	const char* sceneModels[] =
+	{
+		"mainPlayerBoat.obj",
+		"water.obj",
+		"rockBorder.obj",
+		"skyboxSphere.obj",
+	};
+
+	//What Application loads each scene model with: the water stays full precision and full detail for its waves
+	OBJLoader::ImportSettings SceneSettings(const char* filename)
+	{
+		OBJLoader::ImportSettings settings;
+		if (strcmp(filename, "water.obj") == 0)
+		{
+			settings.LodLevels = 0;
+		}
+		else
+		{
+			settings.Format = VertexFormatPacked;
+		}
+		return settings;
+	}
+
+	//Every face corner of an OBJ as a vertex, one per corner before any welding. Corners of v, v/vt and v//vn faces have no
+	//normal or texture coordinate to look up, so they get zeroes as OBJLoader gives missing texture coordinates. Without the
+	//OBJ, the corners of the shipped headerless .objBinary, which was written with a vertex per corner in the same way
+	bool ReadCorners(const char* filename, std::vector<SimpleVertex>& outCorners)
+	{
+		std::vector<char> buffer;
+		OBJParser::ParsedOBJ obj;
+		if (!OBJParser::ReadFile(filename, buffer))
+		{
+			std::string binaryFilename = filename;
+			binaryFilename.append("Binary");
+
+			OBJLoader::PreparedMesh legacy;
+			if (!OBJParser::ReadFile(binaryFilename.c_str(), buffer) || MeshCache::IsContainer(buffer.data(), buffer.size()) ||
+				!OBJLoader::PrepareLegacyBinary(buffer.data(), buffer.size(), legacy))
+			{
+				return false;
+			}
+
+			const SimpleVertex* vertices = (const SimpleVertex*)legacy.Vertices;
+			outCorners.resize(legacy.IndexCount);
+			for (unsigned int corner = 0; corner < legacy.IndexCount; ++corner)
+			{
+				outCorners[corner] = vertices[(legacy.IndexFormat == DXGI_FORMAT_R32_UINT) ? ((const uint32_t*)legacy.Indices)[corner] : ((const uint16_t*)legacy.Indices)[corner]];
+			}
+			return true;
+		}
+
+		if (!OBJParser::Parse(buffer.data(), buffer.size(), obj, false))
+		{
+			return false;
+		}
+
+		const XMFLOAT3 noNormal(0.0f, 0.0f, 0.0f);
+		const XMFLOAT2 noTexCoord(0.0f, 0.0f);
+		outCorners.resize(obj.VertIndices.size());
+		for (size_t corner = 0; corner < obj.VertIndices.size(); ++corner)
+		{
+			SimpleVertex& vertex = outCorners[corner];
+			vertex.Pos = obj.Vertices[obj.VertIndices[corner]];
+			vertex.Normal = (obj.NormalIndices[corner] != OBJParser::NoIndex) ? obj.Normals[obj.NormalIndices[corner]] : noNormal;
+			vertex.TexC = (obj.TextureIndices[corner] != OBJParser::NoIndex) ? obj.TexCoords[obj.TextureIndices[corner]] : noTexCoord;
+		}
+		return true;
+	}
+
+	//A scene model built in memory as Application would get it with 'settings', writing nothing: from the OBJ if it's there,
+	//otherwise from the shipped headerless .objBinary (see OBJLoader::BuildLegacyMesh). outSource gets the file it was built
+	//from, which is what its cache would be checked against. False if there's neither
+	bool BuildSceneModel(const char* filename, const OBJLoader::ImportSettings& settings, MeshCache::MeshContent& outMesh, std::vector<char>& outSource)
+	{
+		if (OBJParser::ReadFile(filename, outSource))
+		{
+			return OBJLoader::BuildMesh(filename, outSource.data(), outSource.size(), false, settings, outMesh);
+		}
+
+		std::string binaryFilename = filename;
+		binaryFilename.append("Binary");
+
+		OBJLoader::PreparedMesh legacy;
+		return OBJParser::ReadFile(binaryFilename.c_str(), outSource) && !MeshCache::IsContainer(outSource.data(), outSource.size()) &&
+			OBJLoader::PrepareLegacyBinary(outSource.data(), outSource.size(), legacy) && OBJLoader::BuildLegacyMesh(filename, legacy, false, settings, outMesh);
+	}
+
+	//Somewhere outside the working tree for a benchmark to write 'name' to, so nothing shipped is ever overwritten
+	std::string TempPath(const char* name)
+	{
+		const char* directory = getenv("TMPDIR");
+		if (!directory)
+		{
+			directory = getenv("TEMP");
+		}
+		if (!directory)
+		{
+			directory = getenv("TMP");
+		}
+
+		std::string path = directory ? directory : "/tmp";
+		if (path.back() != '/' && path.back() != '\\')
+		{
+			path.push_back('/');
+		}
+		return path.append(name);
+	}
+
+	double SecondsSince(std::chrono::high_resolution_clock::time_point start)
+	{
+		return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+
+	//Bitwise, so -0 vs +0 or differently rounded floats show up
+	template<typename T>
+	bool SameContents(const std::vector<T>& a, const std::vector<T>& b)
+	{
+		return a.size() == b.size() && (a.empty() || memcmp(a.data(), b.data(), a.size() * sizeof(T)) == 0);
+	}
+
+	//One model's worth of LodSelection: the LOD table, how many triangles each level has, and its bounding sphere
+	struct LodModel
+	{
+		std::vector<MeshCache::MeshLod> Lods;
+		std::vector<unsigned int> Triangles;
+		float SphereCentre[3];
+		float SphereRadius;
+	};
+
+	//Where one copy of a model sits in the scene, by its placement and uniform scale
+	struct LodInstance
+	{
+		const LodModel* Model;
+		XMFLOAT3 Position;
+		float Scale;
+	};
+
+	//One model's worth of ClusterCulling: where the scene puts it, how Application culls it, and its full detail submeshes
+	struct ClusterModel
+	{
+		const char* Filename;
+		XMFLOAT3 Position;
+		float Scale;
+		float Padding;
+		MeshClusters::HiddenFaces Hidden;
+		std::vector<MeshCache::Submesh> Submeshes;
+		std::vector<MeshCache::MeshCluster> Clusters;
+		std::vector<XMFLOAT3> Corners;		//Three per triangle
+		unsigned int Triangles;
+	};
+
+	//Row-vector view * projection of a camera preset, the same matrices Camera builds with XMMatrixLookAtLH/LookToLH and
+	//XMMatrixPerspectiveFovLH
+	void CameraViewProjection(const SceneLayout::CameraPreset& camera, float outMatrix[4][4])
+	{
+		float eye[3] = { camera.Eye.x, camera.Eye.y, camera.Eye.z };
+		float z[3] = { camera.At.x, camera.At.y, camera.At.z };
+		if (camera.LookAt)
+		{
+			for (int k = 0; k < 3; ++k) z[k] -= eye[k];
+		}
+
+		float length = sqrtf(z[0] * z[0] + z[1] * z[1] + z[2] * z[2]);
+		for (int k = 0; k < 3; ++k) z[k] /= length;
+
+		const float up[3] = { camera.Up.x, camera.Up.y, camera.Up.z };
+		float x[3] = { up[1] * z[2] - up[2] * z[1], up[2] * z[0] - up[0] * z[2], up[0] * z[1] - up[1] * z[0] };
+		length = sqrtf(x[0] * x[0] + x[1] * x[1] + x[2] * x[2]);
+		for (int k = 0; k < 3; ++k) x[k] /= length;
+		float y[3] = { z[1] * x[2] - z[2] * x[1], z[2] * x[0] - z[0] * x[2], z[0] * x[1] - z[1] * x[0] };
+
+		float view[4][4] =
+		{
+			{ x[0], y[0], z[0], 0.0f },
+			{ x[1], y[1], z[1], 0.0f },
+			{ x[2], y[2], z[2], 0.0f },
+			{ -(x[0] * eye[0] + x[1] * eye[1] + x[2] * eye[2]), -(y[0] * eye[0] + y[1] * eye[1] + y[2] * eye[2]), -(z[0] * eye[0] + z[1] * eye[1] + z[2] * eye[2]), 1.0f },
+		};
+
+		float height = 1.0f / tanf(SceneLayout::FieldOfView * 0.5f);
+		float width = height * SceneLayout::WindowHeight / SceneLayout::WindowWidth;
+		float range = camera.FarDepth / (camera.FarDepth - camera.NearDepth);
+
+		//The projection only has four entries that aren't 0, so multiply by it column by column
+		for (int i = 0; i < 4; ++i)
+		{
+			outMatrix[i][0] = view[i][0] * width;
+			outMatrix[i][1] = view[i][1] * height;
+			outMatrix[i][2] = view[i][2] * range - view[i][3] * range * camera.NearDepth;
+			outMatrix[i][3] = view[i][2];
+		}
+	}
+
+	//xorshift64, so the generated numbers are the same on every run and platform
+	uint64_t NextRandom(uint64_t& state)
+	{
+		state ^= state << 13;
+		state ^= state >> 7;
+		state ^= state << 17;
+		return state;
+	}
+
+	//Space separated numbers in the forms FloatParse tests, null terminated so strtof can walk the same text
+	void GenerateNumbers(int count, std::vector<char>& outText)
+	{
+		uint64_t state = 0x9E3779B97F4A7C15ull;
+		char number[64];
+
+		outText.clear();
+		for (int i = 0; i < count; ++i)
+		{
+			uint64_t random = NextRandom(state);
+
+			//Any finite float, by bit pattern
+			uint32_t bits = (uint32_t)(random >> 32);
+			if (((bits >> 23) & 0xFF) == 0xFF) bits &= ~(1u << 30);
+			float value;
+			memcpy(&value, &bits, sizeof(value));
+
+			//Typical OBJ magnitude
+			float modelValue = (float)((double)(random & 0xFFFFFF) / 0x1000000 * 200.0 - 100.0);
+
+			switch (i % 6)
+			{
+			case 0: snprintf(number, sizeof(number), "%.6f", modelValue); break;
+			case 1: snprintf(number, sizeof(number), "%.9g", value); break;
+			case 2: snprintf(number, sizeof(number), "%e", value); break;
+			case 3: snprintf(number, sizeof(number), "%.4f", modelValue * 0.01f); break;
+			case 4:
+			{
+				//Up to 25 random digits with a point somewhere and an exponent up to +-45, often right on a rounding boundary
+				int digits = 1 + (int)(NextRandom(state) % 25);
+				int point = (int)(NextRandom(state) % (digits + 1));
+				int length = 0;
+				for (int digit = 0; digit < digits; ++digit)
+				{
+					if (digit == point) number[length++] = '.';
+					number[length++] = (char)('0' + NextRandom(state) % 10);
+				}
+				length += snprintf(number + length, sizeof(number) - length, "e%d", (int)(NextRandom(state) % 91) - 45);
+				break;
+			}
+			default:
+				snprintf(number, sizeof(number), "-000%.3f", (double)(random % 100000) / 1000.0);
+				break;
+			}
+
+			outText.insert(outText.end(), number, number + strlen(number));
+			outText.push_back(' ');
+		}
+		outText.push_back('\0');
+	}
+}
+
+void Benchmarks::OBJParse(const char* const* filenames, int fileCount, int iterations)
+{
+	double totalBytes = 0.0;
+	double totalSeconds = 0.0;
+
+	for (int i = 0; i < fileCount; ++i)
+	{
+		std::vector<char> buffer;
+		if (!OBJParser::ReadFile(filenames[i], buffer))
+		{
+			DebugLog("[OBJParse] %s: not found, skipped\n", filenames[i]);
+			continue;
+		}
+
+		double seconds = 0.0;
+		size_t vertexCount = 0;
+
+		for (int iteration = 0; iteration < iterations; ++iteration)
+		{
+			OBJParser::ParsedOBJ obj;
+
+			auto start = std::chrono::high_resolution_clock::now();
+			OBJParser::Parse(buffer.data(), buffer.size(), obj, false);
+			seconds += SecondsSince(start);
+
+			vertexCount = obj.Vertices.size();
+		}
+
+		double megabytes = (double)buffer.size() * iterations / (1024.0 * 1024.0);
+		DebugLog("[OBJParse] %s: %.2f MB, %u positions, %.3f ms/parse, %.1f MB/s\n", filenames[i],
+			buffer.size() / (1024.0 * 1024.0), (unsigned int)vertexCount, seconds * 1000.0 / iterations, megabytes / seconds);
+
+		totalBytes += megabytes;
+		totalSeconds += seconds;
+	}
+
+	if (totalSeconds > 0.0)
+	{
+		DebugLog("[OBJParse] total: %.1f MB/s\n", totalBytes / totalSeconds);
+	}
+}
+
+void Benchmarks::Weld(const char* const* filenames, int fileCount, float epsilon)
+{
+	for (int i = 0; i < fileCount; ++i)
+	{
+		std::vector<SimpleVertex> corners;
+		if (!ReadCorners(filenames[i], corners))
+		{
+			DebugLog("[Weld] %s: no OBJ or shipped .objBinary, skipped\n", filenames[i]);
+			continue;
+		}
+
+		auto start = std::chrono::high_resolution_clock::now();
+
+		size_t cornerCount = corners.size();
+		VertexWelder welder(epsilon, cornerCount);
+		for (size_t corner = 0; corner < cornerCount; ++corner)
+		{
+			welder.Add(corners[corner]);
+		}
+
+		double seconds = SecondsSince(start);
+		size_t uniqueCount = welder.Vertices().size();
+
+		DebugLog("[Weld] %s: %u -> %u vertices (%.1f%%), %u -> %u vertex bytes, %.3f ms\n", filenames[i],
+			(unsigned int)cornerCount, (unsigned int)uniqueCount, 100.0 * uniqueCount / (cornerCount ? cornerCount : 1),
+			(unsigned int)(cornerCount * sizeof(SimpleVertex)), (unsigned int)(uniqueCount * sizeof(SimpleVertex)), seconds * 1000.0);
+	}
+}
+
+void Benchmarks::VertexCache(const char* const* filenames, int fileCount)
+{
+	for (int i = 0; i < fileCount; ++i)
+	{
+		std::vector<SimpleVertex> corners;
+		if (!ReadCorners(filenames[i], corners))
+		{
+			DebugLog("[VertexCache] %s: no OBJ or shipped .objBinary, skipped\n", filenames[i]);
+			continue;
+		}
+
+		size_t cornerCount = corners.size();
+		VertexWelder welder(0.0f, cornerCount);
+		std::vector<unsigned int> indices;
+		indices.reserve(cornerCount);
+		for (size_t corner = 0; corner < cornerCount; ++corner)
+		{
+			indices.push_back(welder.Add(corners[corner]));
+		}
+		std::vector<SimpleVertex>& vertices = welder.Vertices();
+		unsigned int vertexCount = (unsigned int)vertices.size();
+
+		//Report for a small (older GPU) and a large cache
+		MeshOptimiser::CacheStats before16 = MeshOptimiser::AnalyseVertexCache(indices, vertexCount, 16);
+		MeshOptimiser::CacheStats before32 = MeshOptimiser::AnalyseVertexCache(indices, vertexCount, 32);
+
+		auto start = std::chrono::high_resolution_clock::now();
+		MeshOptimiser::OptimiseVertexCache(indices, vertexCount);
+		double cacheSeconds = SecondsSince(start);
+
+		MeshOptimiser::CacheStats cache16 = MeshOptimiser::AnalyseVertexCache(indices, vertexCount, 16);
+
+		start = std::chrono::high_resolution_clock::now();
+		MeshOptimiser::OptimiseOverdraw(indices, vertices);
+		MeshOptimiser::OptimiseVertexFetch(vertices, indices);
+		double restSeconds = SecondsSince(start);
+
+		MeshOptimiser::CacheStats after16 = MeshOptimiser::AnalyseVertexCache(indices, vertexCount, 16);
+		MeshOptimiser::CacheStats after32 = MeshOptimiser::AnalyseVertexCache(indices, vertexCount, 32);
+
+		//The importer keeps the order the mesh came in when that's better, see OBJLoader's Optimise
+		DebugLog("[VertexCache] %s: %u tris, cache16 ACMR %.3f -> %.3f (%.3f before overdraw pass) ATVR %.3f -> %.3f, cache32 ACMR %.3f -> %.3f ATVR %.3f -> %.3f, %.3f + %.3f ms%s\n",
+			filenames[i], (unsigned int)(indices.size() / 3),
+			before16.ACMR, after16.ACMR, cache16.ACMR, before16.ATVR, after16.ATVR,
+			before32.ACMR, after32.ACMR, before32.ATVR, after32.ATVR,
+			cacheSeconds * 1000.0, restSeconds * 1000.0, (after16.ACMR > before16.ACMR) ? ", worse than the input order so that's kept" : "");
+	}
+}
+
+void Benchmarks::CacheLoad(const char* const* filenames, int fileCount, int iterations)
+{
+	for (int i = 0; i < fileCount; ++i)
+	{
+		//The cache Application would have for this model, written somewhere of its own rather than over the shipped one
+		std::vector<char> source;
+		MeshCache::MeshContent mesh;
+		if (!BuildSceneModel(filenames[i], SceneSettings(filenames[i]), mesh, source))
+		{
+			DebugLog("[CacheLoad] %s: no OBJ or shipped .objBinary, skipped\n", filenames[i]);
+			continue;
+		}
+
+		std::string binaryFilename = TempPath(filenames[i]);
+		binaryFilename.append("Binary");
+
+		std::vector<unsigned char> cacheFile;
+		MeshCache::Serialise(mesh, source.data(), source.size(), cacheFile);
+		if (!MeshCache::WriteFile(binaryFilename.c_str(), cacheFile))
+		{
+			DebugLog("[CacheLoad] %s: couldn't write, skipped\n", binaryFilename.c_str());
+			continue;
+		}
+
+		double readSeconds = 0.0;
+		double mapSeconds = 0.0;
+		size_t fileSize = 0;
+		bool valid = true;
+
+		for (int iteration = 0; iteration < iterations; ++iteration)
+		{
+			MeshCache::MeshView view;
+
+			auto start = std::chrono::high_resolution_clock::now();
+			std::vector<char> buffer;
+			valid &= OBJParser::ReadFile(binaryFilename.c_str(), buffer) && MeshCache::Open(buffer.data(), buffer.size(), view);
+			readSeconds += SecondsSince(start);
+			fileSize = buffer.size();
+
+			start = std::chrono::high_resolution_clock::now();
+			MappedFile file;
+			valid &= file.Open(binaryFilename.c_str()) && MeshCache::Open(file.Data(), file.Size(), view);
+			mapSeconds += SecondsSince(start);
+		}
+
+		remove(binaryFilename.c_str());
+
+		if (!valid)
+		{
+			DebugLog("[CacheLoad] %s: no valid cache, skipped\n", binaryFilename.c_str());
+			continue;
+		}
+
+		DebugLog("[CacheLoad] %s: %u bytes, read %.3f ms (%u heap bytes), mapped %.3f ms (0 heap bytes)\n", binaryFilename.c_str(),
+			(unsigned int)fileSize, readSeconds * 1000.0 / iterations, (unsigned int)fileSize, mapSeconds * 1000.0 / iterations);
+	}
+}
+
+bool Benchmarks::VertexPacking(const char* const* filenames, int fileCount)
+{
+	bool allPassed = true;
+	for (int i = 0; i < fileCount; ++i)
+	{
+		std::vector<char> source;
+		MeshCache::MeshContent mesh;
+		if (!BuildSceneModel(filenames[i], OBJLoader::ImportSettings(), mesh, source))
+		{
+			DebugLog("[VertexPacking] %s: no OBJ or shipped .objBinary, skipped\n", filenames[i]);
+			continue;
+		}
+
+		float boundsMin[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+		float boundsMax[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+		float largestTexCoord = 0.0f;
+		for (size_t v = 0; v < mesh.Vertices.size(); ++v)
+		{
+			const SimpleVertex& vertex = mesh.Vertices[v];
+			const float p[3] = { vertex.Pos.x, vertex.Pos.y, vertex.Pos.z };
+			for (int k = 0; k < 3; ++k)
+			{
+				boundsMin[k] = fminf(boundsMin[k], p[k]);
+				boundsMax[k] = fmaxf(boundsMax[k], p[k]);
+			}
+			largestTexCoord = fmaxf(largestTexCoord, fmaxf(fabsf(vertex.TexC.x), fabsf(vertex.TexC.y)));
+		}
+
+		auto start = std::chrono::high_resolution_clock::now();
+		VertexPacking::PackingError error = VertexPacking::MeasureError(mesh.Vertices, boundsMin, boundsMax);
+		double seconds = SecondsSince(start);
+
+		//Half a quantisation step along each axis, half a half-float ULP at the largest UV, and the octahedral worst case
+		float step[3];
+		for (int k = 0; k < 3; ++k)
+		{
+			step[k] = (boundsMax[k] - boundsMin[k]) * 0.5f / 65535.0f;
+		}
+		float positionLimit = sqrtf(step[0] * step[0] + step[1] * step[1] + step[2] * step[2]) * 1.01f + 1e-6f;
+		float texCoordLimit = fmaxf(largestTexCoord, 1.0f) / 2048.0f;
+		float normalLimit = 0.05f;
+
+		bool passed = error.Position <= positionLimit && error.NormalDegrees <= normalLimit && error.TexCoord <= texCoordLimit;
+		allPassed &= passed;
+
+		DebugLog("[VertexPacking] %s: %u -> %u vertex bytes, max error position %g (limit %g) normal %.4f deg (limit %.2f) uv %g (limit %g), %.3f ms round trip, %s\n",
+			filenames[i], (unsigned int)(mesh.Vertices.size() * sizeof(SimpleVertex)), (unsigned int)(mesh.Vertices.size() * sizeof(PackedVertex)),
+			error.Position, positionLimit, error.NormalDegrees, normalLimit, error.TexCoord, texCoordLimit, seconds * 1000.0, passed ? "PASSED" : "FAILED");
+	}
+	return allPassed;
+}
+
+void Benchmarks::StreamingParse(const char* const* filenames, int fileCount, size_t windowSize)
+{
+	OBJLoader::ImportSettings settings;
+	settings.OptimiseMesh = false;
+
+	for (int i = 0; i < fileCount; ++i)
+	{
+		std::vector<char> source;
+		MeshCache::MeshContent whole;
+		if (!OBJParser::ReadFile(filenames[i], source))
+		{
+			DebugLog("[StreamingParse] %s: not found, skipped\n", filenames[i]);
+			continue;
+		}
+
+		auto start = std::chrono::high_resolution_clock::now();
+		bool valid = OBJLoader::BuildMesh(filenames[i], source.data(), source.size(), true, settings, whole);
+		double wholeSeconds = SecondsSince(start);
+
+		MeshCache::MeshContent streamed;
+		start = std::chrono::high_resolution_clock::now();
+		valid &= OBJLoader::BuildMeshStreaming(filenames[i], windowSize, true, settings, streamed);
+		double streamedSeconds = SecondsSince(start);
+
+		bool identical = valid && whole.Vertices.size() == streamed.Vertices.size() && whole.Indices == streamed.Indices &&
+			memcmp(whole.Vertices.data(), streamed.Vertices.data(), whole.Vertices.size() * sizeof(SimpleVertex)) == 0;
+
+		//Text plus per-corner indices held at once. The v/vt/vn arrays and the welded mesh are the same either way
+		size_t cornerCount = whole.Indices.size();
+		size_t largestWindow = 0;
+		OBJParser::ParsedOBJ obj;
+		OBJParser::ParseStream(filenames[i], windowSize, true, obj, [&largestWindow](const OBJParser::ParsedOBJ& window)
+		{
+			largestWindow = (window.VertIndices.size() > largestWindow) ? window.VertIndices.size() : largestWindow;
+			return true;
+		});
+
+		size_t wholeBytes = source.size() + cornerCount * 3 * sizeof(unsigned int);
+		size_t streamedBytes = windowSize + largestWindow * 3 * sizeof(unsigned int);
+
+		DebugLog("[StreamingParse] %s: whole file %.3f ms holding %u KB, %u KB windows %.3f ms holding %u KB, output %s\n", filenames[i],
+			wholeSeconds * 1000.0, (unsigned int)(wholeBytes / 1024), (unsigned int)(windowSize / 1024),
+			streamedSeconds * 1000.0, (unsigned int)(streamedBytes / 1024), identical ? "identical" : "DIFFERENT");
+	}
+}
+
+void Benchmarks::ParallelParse(const char* const* filenames, int fileCount, int copies, int iterations)
+{
+	const unsigned int threadCounts[] = { 1, 2, 4, 8, 16 };
+
+	for (int i = 0; i < fileCount; ++i)
+	{
+		std::vector<char> source;
+		if (!OBJParser::ReadFile(filenames[i], source))
+		{
+			DebugLog("[ParallelParse] %s: not found, skipped\n", filenames[i]);
+			continue;
+		}
+
+		//OBJ indices are absolute, so every copy's faces just reuse the first copy's vertices - still a valid file
+		std::vector<char> text;
+		text.reserve(source.size() * copies + copies);
+		for (int copy = 0; copy < copies; ++copy)
+		{
+			text.insert(text.end(), source.begin(), source.end());
+			text.push_back('\n');
+		}
+
+		OBJParser::ParsedOBJ serial;
+		OBJParser::Parse(text.data(), text.size(), serial, true);
+
+		double megabytes = text.size() / (1024.0 * 1024.0);
+		double oneThreadSeconds = 0.0;
+
+		for (int t = 0; t < (int)(sizeof(threadCounts) / sizeof(threadCounts[0])); ++t)
+		{
+			unsigned int threads = threadCounts[t];
+			ThreadPool* pool = (threads > 1) ? new ThreadPool(threads - 1) : nullptr;
+
+			double best = DBL_MAX;
+			bool identical = true;
+			for (int iteration = 0; iteration < iterations; ++iteration)
+			{
+				OBJParser::ParsedOBJ obj;
+
+				auto start = std::chrono::high_resolution_clock::now();
+				bool parsed = pool ? OBJParser::ParseParallel(text.data(), text.size(), obj, true, *pool) : OBJParser::Parse(text.data(), text.size(), obj, true);
+				double seconds = SecondsSince(start);
+
+				best = (seconds < best) ? seconds : best;
+				identical &= parsed && SameContents(obj.Vertices, serial.Vertices) && SameContents(obj.TexCoords, serial.TexCoords) &&
+					SameContents(obj.Normals, serial.Normals) && obj.VertIndices == serial.VertIndices &&
+					obj.TextureIndices == serial.TextureIndices && obj.NormalIndices == serial.NormalIndices;
+			}
+
+			delete pool;
+
+			if (threads == 1) oneThreadSeconds = best;
+
+			DebugLog("[ParallelParse] %s x%d (%.1f MB): %2u threads %.2f ms, %.0f MB/s, x%.2f, %s\n", filenames[i], copies, megabytes, threads,
+				best * 1000.0, megabytes / best, oneThreadSeconds / best, identical ? "identical" : "DIFFERENT");
+		}
+	}
+}
+
+void Benchmarks::FloatParse(int count, int iterations)
+{
+	std::vector<char> text;
+	GenerateNumbers(count, text);
+
+	const char* end = text.data() + text.size() - 1;
+
+	//Correctness first, every number against strtof
+	int mismatches = 0;
+	const char* cursor = text.data();
+	char* expectedEnd = text.data();
+	for (int i = 0; i < count; ++i)
+	{
+		const char* start = cursor;
+		float parsed = FloatParser::Parse(cursor, end);
+		float expected = strtof(expectedEnd, &expectedEnd);
+
+		if (memcmp(&parsed, &expected, sizeof(float)) != 0 || cursor != expectedEnd)
+		{
+			if (mismatches < 10)
+			{
+				DebugLog("[FloatParse] mismatch: '%.*s' gave %.9g, strtof %.9g\n", (int)(expectedEnd - start), start, parsed, expected);
+			}
+			++mismatches;
+			cursor = expectedEnd;
+		}
+	}
+
+	double fastBest = DBL_MAX;
+	double strtofBest = DBL_MAX;
+	float sum = 0.0f;
+	for (int iteration = 0; iteration < iterations; ++iteration)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+		cursor = text.data();
+		for (int i = 0; i < count; ++i) sum += FloatParser::Parse(cursor, end);
+		double seconds = SecondsSince(start);
+		fastBest = (seconds < fastBest) ? seconds : fastBest;
+
+		start = std::chrono::high_resolution_clock::now();
+		char* strtofCursor = text.data();
+		for (int i = 0; i < count; ++i) sum += strtof(strtofCursor, &strtofCursor);
+		seconds = SecondsSince(start);
+		strtofBest = (seconds < strtofBest) ? seconds : strtofBest;
+	}
+
+	//Keeps the optimiser from dropping the timed loops
+	volatile float keep = sum;
+	(void)keep;
+
+	double megabytes = (text.size() - 1) / (1024.0 * 1024.0);
+	DebugLog("[FloatParse] %d numbers (%.2f MB): FloatParser %.0f MB/s, strtof %.0f MB/s, x%.2f, %d mismatches\n", count, megabytes,
+		megabytes / fastBest, megabytes / strtofBest, strtofBest / fastBest, mismatches);
+}
+
+void Benchmarks::LodSelection(float maxPixelError)
+{
+	const char* models[] = { "mainPlayerBoat.obj", "water.obj", "rockBorder.obj", "skyboxSphere.obj" };
+	const int modelCount = sizeof(models) / sizeof(models[0]);
+	LodModel built[modelCount];
+
+	int found = 0;
+
+	for (int i = 0; i < modelCount; ++i)
+	{
+		//Built as Application would load it, so this runs on the shipped .objBinary files when the OBJs aren't there
+		std::vector<char> source;
+		MeshCache::MeshContent mesh;
+		auto start = std::chrono::high_resolution_clock::now();
+		bool valid = BuildSceneModel(models[i], SceneSettings(models[i]), mesh, source);
+		double seconds = SecondsSince(start);
+
+		//The bounding sphere comes from the cache header, as it does when the app loads the mesh. Serialised in memory only
+		std::vector<unsigned char> cacheFile;
+		MeshCache::MeshView view;
+		if (!valid || (MeshCache::Serialise(mesh, source.data(), source.size(), cacheFile), !MeshCache::Open(cacheFile.data(), cacheFile.size(), view)))
+		{
+			DebugLog("[LodSelection] %s: no OBJ or shipped .objBinary, skipped\n", models[i]);
+			continue;
+		}
+		++found;
+
+		std::vector<MeshCache::Submesh>& submeshes = mesh.Submeshes;
+		if (submeshes.empty())
+		{
+			MeshCache::Submesh wholeMesh = { 0, (uint32_t)mesh.Indices.size(), 0, 0 };
+			submeshes.push_back(wholeMesh);
+		}
+
+		LodModel& model = built[i];
+		model.Lods = mesh.Lods;
+		if (model.Lods.empty())
+		{
+			MeshCache::MeshLod fullDetail = { 0, (uint32_t)submeshes.size(), 0.0f, 0 };
+			model.Lods.push_back(fullDetail);
+		}
+		memcpy(model.SphereCentre, view.Header->SphereCentre, sizeof(model.SphereCentre));
+		model.SphereRadius = view.Header->SphereRadius;
+
+		std::string levels;
+		for (size_t lod = 0; lod < model.Lods.size(); ++lod)
+		{
+			unsigned int indices = 0;
+			for (unsigned int submesh = 0; submesh < model.Lods[lod].SubmeshCount; ++submesh)
+			{
+				indices += submeshes[model.Lods[lod].SubmeshStart + submesh].IndexCount;
+			}
+			model.Triangles.push_back(indices / 3);
+
+			char level[64];
+			snprintf(level, sizeof(level), "%s%u (error %.3g)", lod ? ", " : "", indices / 3, model.Lods[lod].Error);
+			levels += level;
+		}
+
+		DebugLog("[LodSelection] %s: %s triangles, built in %.2f ms\n", models[i], levels.c_str(), seconds * 1000.0);
+	}
+
+	if (found == 0)
+	{
+		DebugLog("[LodSelection] none of the scene models were found, nothing to measure\n");
+		return;
+	}
+
+	//The scene as Application lays it out. The sky's slow turn is about its own centre's axis, so it doesn't move it
+	std::vector<LodInstance> instances;
+	LodInstance boat = { &built[0], XMFLOAT3(0.0f, 0.0f, 0.0f), SceneLayout::BoatScale };
+	LodInstance water = { &built[1], SceneLayout::WaterPosition, 1.0f };
+	LodInstance sky = { &built[3], SceneLayout::SkyPosition, SceneLayout::SkyScale };
+	instances.push_back(boat);
+	instances.push_back(water);
+	for (unsigned int i = 0; i < SceneLayout::RockCount; ++i)
+	{
+		LodInstance rock = { &built[2], SceneLayout::Rocks[i], 1.0f };
+		instances.push_back(rock);
+	}
+	instances.push_back(sky);
+
+	float pixelScale = SceneLayout::WindowHeight * 0.5f / tanf(SceneLayout::FieldOfView * 0.5f);
+
+	for (unsigned int c = 0; c < SceneLayout::CameraCount; ++c)
+	{
+		const SceneLayout::CameraPreset& camera = SceneLayout::Cameras[c];
+		unsigned int fullTriangles = 0;
+		unsigned int lodTriangles = 0;
+		unsigned int rocksAtLevel[4] = { 0, 0, 0, 0 };
+
+		for (size_t i = 0; i < instances.size(); ++i)
+		{
+			const LodInstance& instance = instances[i];
+			const LodModel& model = *instance.Model;
+			if (model.Lods.empty())
+			{
+				continue;
+			}
+
+			//Same as Application::SelectLod: distance to the nearest point of the bounding sphere, in mesh units
+			float centre[3] =
+			{
+				instance.Position.x + model.SphereCentre[0] * instance.Scale,
+				instance.Position.y + model.SphereCentre[1] * instance.Scale,
+				instance.Position.z + model.SphereCentre[2] * instance.Scale,
+			};
+			float offset[3] = { centre[0] - camera.Eye.x, centre[1] - camera.Eye.y, centre[2] - camera.Eye.z };
+			float distance = sqrtf(offset[0] * offset[0] + offset[1] * offset[1] + offset[2] * offset[2]) / instance.Scale - model.SphereRadius;
+
+			unsigned int lod = (distance > 0.0f) ? MeshSimplifier::SelectLod(model.Lods.data(), (unsigned int)model.Lods.size(), distance, pixelScale, maxPixelError) : 0;
+
+			fullTriangles += model.Triangles[0];
+			lodTriangles += model.Triangles[lod];
+			if (instance.Model == &built[2] && lod < 4)
+			{
+				++rocksAtLevel[lod];
+			}
+		}
+
+		DebugLog("[LodSelection] %s camera: %u -> %u triangles (%.1f%%) at %.1f pixel error, rocks at LOD 0/1/2/3: %u/%u/%u/%u\n", camera.Name,
+			fullTriangles, lodTriangles, 100.0 * lodTriangles / (fullTriangles ? fullTriangles : 1), maxPixelError,
+			rocksAtLevel[0], rocksAtLevel[1], rocksAtLevel[2], rocksAtLevel[3]);
+	}
+}
+
+void Benchmarks::ClusterCulling(int iterations)
+{
+	//As Application draws them: the sky is seen from inside, the water from above with waves the vertex shader adds
+	ClusterModel models[2] = {};
+	models[0].Filename = "skyboxSphere.obj";
+	models[0].Position = SceneLayout::SkyPosition;
+	models[0].Scale = SceneLayout::SkyScale;
+	models[0].Hidden = MeshClusters::HiddenFacesFront;
+	models[1].Filename = "water.obj";
+	models[1].Position = SceneLayout::WaterPosition;
+	models[1].Scale = 1.0f;
+	models[1].Padding = SceneLayout::WaterWaveHeight * 1.414214f;
+	models[1].Hidden = MeshClusters::HiddenFacesBack;
+	const int modelCount = sizeof(models) / sizeof(models[0]);
+	int found = 0;
+
+	for (int i = 0; i < modelCount; ++i)
+	{
+		ClusterModel& model = models[i];
+
+		//Built in memory as Application would load it, see LodSelection
+		std::vector<char> source;
+		MeshCache::MeshContent mesh;
+		auto start = std::chrono::high_resolution_clock::now();
+		bool valid = BuildSceneModel(model.Filename, SceneSettings(model.Filename), mesh, source);
+		double seconds = SecondsSince(start);
+
+		if (!valid)
+		{
+			DebugLog("[ClusterCulling] %s: no OBJ or shipped .objBinary, skipped\n", model.Filename);
+			continue;
+		}
+		++found;
+
+		//The full detail level's submeshes, the same ones Application culls when it draws the mesh close up
+		MeshCache::Submesh wholeMesh = { 0, (uint32_t)mesh.Indices.size(), 0, 0 };
+		size_t first = mesh.Lods.empty() ? 0 : mesh.Lods[0].SubmeshStart;
+		size_t count = mesh.Lods.empty() ? mesh.Submeshes.size() : mesh.Lods[0].SubmeshCount;
+		model.Submeshes.assign(mesh.Submeshes.begin() + first, mesh.Submeshes.begin() + first + count);
+		if (model.Submeshes.empty())
+		{
+			model.Submeshes.push_back(wholeMesh);
+		}
+		model.Clusters = mesh.Clusters;
+
+		for (size_t submesh = 0; submesh < model.Submeshes.size(); ++submesh)
+		{
+			const MeshCache::Submesh& range = model.Submeshes[submesh];
+			for (uint32_t corner = range.IndexStart; corner < range.IndexStart + range.IndexCount; ++corner)
+			{
+				model.Corners.push_back(mesh.Vertices[mesh.Indices[corner]].Pos);
+			}
+		}
+		model.Triangles = (unsigned int)(model.Corners.size() / 3);
+
+		DebugLog("[ClusterCulling] %s: %u triangles in %u clusters, built in %.2f ms\n", model.Filename, model.Triangles,
+			(unsigned int)model.Clusters.size(), seconds * 1000.0);
+	}
+
+	if (found == 0)
+	{
+		DebugLog("[ClusterCulling] none of the scene models were found, nothing to measure\n");
+		return;
+	}
+
+	std::vector<MeshCache::Submesh> ranges;
+
+	for (unsigned int c = 0; c < SceneLayout::CameraCount; ++c)
+	{
+		const SceneLayout::CameraPreset& camera = SceneLayout::Cameras[c];
+		float viewProjection[4][4];
+		CameraViewProjection(camera, viewProjection);
+
+		unsigned int totalTriangles = 0;
+		unsigned int totalCulled = 0;
+		unsigned int totalOffScreen = 0;
+		std::string perModel;
+		double seconds = 0.0;
+
+		for (int i = 0; i < modelCount; ++i)
+		{
+			const ClusterModel& model = models[i];
+			if (model.Triangles == 0)
+			{
+				continue;
+			}
+
+			//Scale then move, so world * view * projection is the scaled rows plus the moved origin
+			float worldViewProjection[4][4];
+			for (int column = 0; column < 4; ++column)
+			{
+				for (int row = 0; row < 3; ++row)
+				{
+					worldViewProjection[row][column] = viewProjection[row][column] * model.Scale;
+				}
+				worldViewProjection[3][column] = model.Position.x * viewProjection[0][column] + model.Position.y * viewProjection[1][column] +
+					model.Position.z * viewProjection[2][column] + viewProjection[3][column];
+			}
+			const float eye[3] =
+			{
+				(camera.Eye.x - model.Position.x) / model.Scale,
+				(camera.Eye.y - model.Position.y) / model.Scale,
+				(camera.Eye.z - model.Position.z) / model.Scale,
+			};
+
+			size_t culled = 0;
+			size_t draws = 0;
+			auto start = std::chrono::high_resolution_clock::now();
+			for (int iteration = 0; iteration < iterations; ++iteration)
+			{
+				MeshClusters::Frustum frustum;
+				MeshClusters::MakeFrustum(worldViewProjection, eye, model.Padding, model.Hidden, frustum);
+
+				culled = 0;
+				ranges.clear();
+				for (size_t submesh = 0; submesh < model.Submeshes.size(); ++submesh)
+				{
+					culled += MeshClusters::Cull(model.Clusters.data(), model.Clusters.size(), model.Submeshes[submesh], frustum, ranges);
+				}
+				draws = ranges.size();
+			}
+			seconds += SecondsSince(start);
+
+			//What culling every triangle on its own would get for comparison, counting only those off screen
+			MeshClusters::Frustum frustum;
+			MeshClusters::MakeFrustum(worldViewProjection, eye, model.Padding, model.Hidden, frustum);
+			for (size_t corner = 0; corner < model.Corners.size(); corner += 3)
+			{
+				for (int plane = 0; plane < 6; ++plane)
+				{
+					const float* p = frustum.Planes[plane];
+					bool outside = true;
+					for (int k = 0; k < 3; ++k)
+					{
+						const XMFLOAT3& position = model.Corners[corner + k];
+						outside = outside && p[0] * position.x + p[1] * position.y + p[2] * position.z + p[3] < -model.Padding;
+					}
+					if (outside)
+					{
+						++totalOffScreen;
+						break;
+					}
+				}
+			}
+
+			char line[128];
+			snprintf(line, sizeof(line), "%s%s %u/%u culled in %u draws", perModel.empty() ? "" : ", ", model.Filename, (unsigned int)culled, model.Triangles, (unsigned int)draws);
+			perModel += line;
+
+			totalTriangles += model.Triangles;
+			totalCulled += (unsigned int)culled;
+		}
+
+		DebugLog("[ClusterCulling] %s camera: %.1f%% of triangles culled (%s), %.2f us per frame. %.1f%% are off screen\n", camera.Name,
+			100.0 * totalCulled / (totalTriangles ? totalTriangles : 1), perModel.c_str(), seconds * 1000000.0 / iterations,
+			100.0 * totalOffScreen / (totalTriangles ? totalTriangles : 1));
+	}
+}
+
+void Benchmarks::Tangents(const char* const* filenames, int fileCount, int copies, int iterations)
+{
+	const unsigned int threadCounts[] = { 1, 2, 4, 8, 16 };
+
+	for (int i = 0; i < fileCount; ++i)
+	{
+		OBJLoader::ImportSettings settings;
+		settings.LodLevels = 0;
+		settings.BuildClusters = false;
+
+		std::vector<char> source;
+		MeshCache::MeshContent mesh;
+		if (!OBJParser::ReadFile(filenames[i], source) || !OBJLoader::BuildMesh(filenames[i], source.data(), source.size(), true, settings, mesh))
+		{
+			DebugLog("[Tangents] %s: not found, skipped\n", filenames[i]);
+			continue;
+		}
+
+		//Copies are separate meshes sharing nothing, so the work is just the one mesh's many times over
+		std::vector<SimpleVertex> vertices;
+		std::vector<unsigned int> indices;
+		vertices.reserve(mesh.Vertices.size() * copies);
+		indices.reserve(mesh.Indices.size() * copies);
+		for (int copy = 0; copy < copies; ++copy)
+		{
+			unsigned int base = (unsigned int)vertices.size();
+			vertices.insert(vertices.end(), mesh.Vertices.begin(), mesh.Vertices.end());
+			for (size_t corner = 0; corner < mesh.Indices.size(); ++corner)
+			{
+				indices.push_back(mesh.Indices[corner] + base);
+			}
+		}
+
+		std::vector<SimpleVertex> serialVertices = vertices;
+		std::vector<unsigned int> serialIndices = indices;
+		std::vector<XMFLOAT4> serialTangents;
+		size_t split = MeshTangents::Generate(serialVertices, serialIndices, serialIndices.size(), serialTangents, nullptr);
+
+		//A tangent should be a unit vector at right angles to its normal, with w = +-1
+		float worstDot = 0.0f;
+		float worstLength = 0.0f;
+		for (size_t v = 0; v < serialTangents.size(); ++v)
+		{
+			const XMFLOAT4& t = serialTangents[v];
+			const XMFLOAT3& n = serialVertices[v].Normal;
+			float normalLength = sqrtf(n.x * n.x + n.y * n.y + n.z * n.z);
+			float dot = normalLength > 0.0f ? fabsf(t.x * n.x + t.y * n.y + t.z * n.z) / normalLength : 0.0f;
+			float lengthError = (fabsf(t.w) == 1.0f) ? fabsf(sqrtf(t.x * t.x + t.y * t.y + t.z * t.z) - 1.0f) : 1.0f;
+			worstDot = (dot > worstDot) ? dot : worstDot;
+			worstLength = (lengthError > worstLength) ? lengthError : worstLength;
+		}
+
+		DebugLog("[Tangents] %s x%d: %u triangles, %u vertices split on mirrored UVs (%.2f%%), worst |t.n| %.2e, worst |t| error %.2e\n", filenames[i],
+			copies, (unsigned int)(indices.size() / 3), (unsigned int)split, 100.0 * split / (vertices.empty() ? 1 : vertices.size()), worstDot, worstLength);
+
+		double oneThreadSeconds = 0.0;
+		for (int t = 0; t < (int)(sizeof(threadCounts) / sizeof(threadCounts[0])); ++t)
+		{
+			unsigned int threads = threadCounts[t];
+			ThreadPool* pool = (threads > 1) ? new ThreadPool(threads - 1) : nullptr;
+
+			double best = DBL_MAX;
+			bool identical = true;
+			for (int iteration = 0; iteration < iterations; ++iteration)
+			{
+				std::vector<SimpleVertex> runVertices = vertices;
+				std::vector<unsigned int> runIndices = indices;
+				std::vector<XMFLOAT4> runTangents;
+
+				auto start = std::chrono::high_resolution_clock::now();
+				MeshTangents::Generate(runVertices, runIndices, runIndices.size(), runTangents, pool);
+				double seconds = SecondsSince(start);
+
+				best = (seconds < best) ? seconds : best;
+				identical &= SameContents(runVertices, serialVertices) && runIndices == serialIndices && SameContents(runTangents, serialTangents);
+			}
+
+			delete pool;
+
+			if (threads == 1) oneThreadSeconds = best;
+
+			DebugLog("[Tangents] %s x%d: %2u threads %.2f ms, %.1f M triangles/s, x%.2f, %s\n", filenames[i], copies, threads, best * 1000.0,
+				indices.size() / 3 / best / 1e6, oneThreadSeconds / best, identical ? "identical" : "DIFFERENT");
+		}
+	}
+}
+
+void Benchmarks::Bvh(const char* const* filenames, int fileCount, int rays, int iterations)
+{
+	const unsigned int threadCounts[] = { 1, 2, 4, 8, 16 };
+
+	for (int i = 0; i < fileCount; ++i)
+	{
+		OBJLoader::ImportSettings settings;
+		settings.LodLevels = 0;
+		settings.BuildBvh = false;
+
+		std::vector<char> source;
+		MeshCache::MeshContent mesh;
+		if (!OBJParser::ReadFile(filenames[i], source) || !OBJLoader::BuildMesh(filenames[i], source.data(), source.size(), true, settings, mesh) ||
+			mesh.Indices.empty())
+		{
+			DebugLog("[Bvh] %s: not found, skipped\n", filenames[i]);
+			continue;
+		}
+
+		std::vector<XMFLOAT3> positions(mesh.Vertices.size());
+		for (size_t v = 0; v < positions.size(); ++v)
+		{
+			positions[v] = mesh.Vertices[v].Pos;
+		}
+
+		float ritterCentre[3], ritterRadius, centre[3], radius;
+		auto start = std::chrono::high_resolution_clock::now();
+		MeshBounds::ComputeRitterSphere(positions.data(), positions.size(), ritterCentre, ritterRadius);
+		double ritterSeconds = SecondsSince(start);
+		start = std::chrono::high_resolution_clock::now();
+		MeshBounds::ComputeSphere(positions.data(), positions.size(), centre, radius);
+		double welzlSeconds = SecondsSince(start);
+
+		float boxMin[3], boxMax[3];
+		MeshBounds::ComputeBox(positions.data(), positions.size(), boxMin, boxMax);
+
+		DebugLog("[Bvh] %s: sphere radius %.4f (%.3f ms), Ritter's %.4f (%.3f ms, %.1f%% bigger)\n", filenames[i], radius, welzlSeconds * 1000.0,
+			ritterRadius, ritterSeconds * 1000.0, 100.0 * (ritterRadius / radius - 1.0));
+
+		std::vector<MeshCache::BvhNode> serialNodes;
+		std::vector<uint32_t> serialTriangles;
+		MeshBvh::Build(mesh.Vertices, mesh.Indices, mesh.Indices.size(), nullptr, serialNodes, serialTriangles);
+
+		double oneThreadSeconds = 0.0;
+		for (int t = 0; t < (int)(sizeof(threadCounts) / sizeof(threadCounts[0])); ++t)
+		{
+			unsigned int threads = threadCounts[t];
+			ThreadPool* pool = (threads > 1) ? new ThreadPool(threads - 1) : nullptr;
+
+			double best = DBL_MAX;
+			bool identical = true;
+			for (int iteration = 0; iteration < iterations; ++iteration)
+			{
+				std::vector<MeshCache::BvhNode> nodes;
+				std::vector<uint32_t> triangles;
+
+				start = std::chrono::high_resolution_clock::now();
+				MeshBvh::Build(mesh.Vertices, mesh.Indices, mesh.Indices.size(), pool, nodes, triangles);
+				double seconds = SecondsSince(start);
+
+				best = (seconds < best) ? seconds : best;
+				identical &= SameContents(nodes, serialNodes) && triangles == serialTriangles;
+			}
+
+			delete pool;
+
+			if (threads == 1) oneThreadSeconds = best;
+
+			DebugLog("[Bvh] %s: %u triangles, %u nodes, SAH cost %.2f, %2u threads %.2f ms, x%.2f, %s\n", filenames[i], (unsigned int)(mesh.Indices.size() / 3),
+				(unsigned int)serialNodes.size(), MeshBvh::Cost(serialNodes.data(), serialNodes.size()), threads, best * 1000.0, oneThreadSeconds / best,
+				identical ? "identical" : "DIFFERENT");
+		}
+
+		MeshBvh::Tree tree;
+		tree.Nodes = serialNodes;
+		tree.Triangles = serialTriangles;
+		tree.Positions = positions;
+		for (size_t t = 0; t < serialTriangles.size(); ++t)
+		{
+			for (int k = 0; k < 3; ++k)
+			{
+				tree.Corners.push_back(mesh.Indices[serialTriangles[t] * 3 + k]);
+			}
+		}
+
+		//Rays from outside the sphere towards random points in the box, and boxes a tenth of the mesh's size dotted about it
+		uint64_t state = 0x2545F4914F6CDD1Dull;
+		auto random = [&state]() { return (float)((NextRandom(state) >> 40) / (double)(1ull << 24)); };
+		std::vector<float> queries(rays * 6);
+		for (int r = 0; r < rays; ++r)
+		{
+			float* query = &queries[r * 6];
+			float z = random() * 2.0f - 1.0f, angle = random() * 6.2831853f, ring = sqrtf(1.0f - z * z);
+			float direction[3] = { ring * cosf(angle), ring * sinf(angle), z };
+			for (int k = 0; k < 3; ++k)
+			{
+				query[k] = centre[k] + direction[k] * radius * 1.5f;
+				query[3 + k] = boxMin[k] + random() * (boxMax[k] - boxMin[k]) - query[k];
+			}
+		}
+
+		std::vector<MeshBvh::RayHit> bvhHits(rays);
+		std::vector<bool> bvhFound(rays);
+		start = std::chrono::high_resolution_clock::now();
+		for (int r = 0; r < rays; ++r)
+		{
+			bvhFound[r] = MeshBvh::Raycast(tree, &queries[r * 6], &queries[r * 6 + 3], FLT_MAX, bvhHits[r]);
+		}
+		double bvhSeconds = SecondsSince(start);
+
+		//Every triangle with the same test the BVH uses, so the two should agree exactly on the nearest distance
+		MeshBvh::Tree flat;
+		MeshCache::BvhNode root = serialNodes[0];
+		root.First = 0;
+		root.TriangleCount = (uint32_t)serialTriangles.size();
+		flat.Nodes.assign(1, root);
+		flat.Triangles = tree.Triangles;
+		flat.Corners = tree.Corners;
+		flat.Positions = positions;
+
+		int mismatches = 0;
+		start = std::chrono::high_resolution_clock::now();
+		for (int r = 0; r < rays; ++r)
+		{
+			MeshBvh::RayHit hit;
+			bool found = MeshBvh::Raycast(flat, &queries[r * 6], &queries[r * 6 + 3], FLT_MAX, hit);
+			mismatches += (found != bvhFound[r]) || (found && hit.Distance != bvhHits[r].Distance);
+		}
+		double bruteSeconds = SecondsSince(start);
+
+		int boxMismatches = 0;
+		size_t boxTriangles = 0;
+		std::vector<uint32_t> bvhBox, bruteBox;
+		double boxSeconds = 0.0;
+		for (int r = 0; r < rays; ++r)
+		{
+			float queryMin[3], queryMax[3];
+			for (int k = 0; k < 3; ++k)
+			{
+				float size = (boxMax[k] - boxMin[k]) * 0.05f;
+				float middle = queries[r * 6 + k] + queries[r * 6 + 3 + k];
+				queryMin[k] = middle - size;
+				queryMax[k] = middle + size;
+			}
+
+			bvhBox.clear();
+			bruteBox.clear();
+			start = std::chrono::high_resolution_clock::now();
+			MeshBvh::QueryBox(tree, queryMin, queryMax, bvhBox);
+			boxSeconds += SecondsSince(start);
+			MeshBvh::QueryBox(flat, queryMin, queryMax, bruteBox);
+
+			std::sort(bvhBox.begin(), bvhBox.end());
+			std::sort(bruteBox.begin(), bruteBox.end());
+			boxMismatches += bvhBox != bruteBox;
+			boxTriangles += bvhBox.size();
+		}
+
+		DebugLog("[Bvh] %s: %d rays %.0f k/s with the BVH, %.0f k/s testing every triangle (x%.1f), %d different. %d boxes %.0f k/s, %.1f triangles each, %d different\n",
+			filenames[i], rays, rays / bvhSeconds / 1000.0, rays / bruteSeconds / 1000.0, bruteSeconds / bvhSeconds, mismatches,
+			rays, rays / boxSeconds / 1000.0, (double)boxTriangles / rays, boxMismatches);
+	}
+}
+
+void Benchmarks::TextureLoad(const char* const* filenames, int fileCount, int iterations)
+{
+	//Hashing every surface stands in for the driver copying it, and is what shows the two paths read the same bytes
+	auto readSurfaces = [](const DDSFile::Texture& texture)
+	{
+		uint64_t hash = 0;
+		for (uint32_t item = 0; item < texture.ArraySize; ++item)
+		{
+			for (uint32_t mip = 0; mip < texture.MipCount; ++mip)
+			{
+				size_t size;
+				const unsigned char* surface = DDSFile::Surface(texture, item, mip, &size);
+				hash = HashBytes(surface, size, hash);
+			}
+		}
+		return hash;
+	};
+
+	for (int i = 0; i < fileCount; ++i)
+	{
+		double readSeconds = 0.0;
+		double mapSeconds = 0.0;
+		size_t fileSize = 0;
+		bool valid = true;
+		bool same = true;
+		DDSFile::Texture texture = {};
+
+		for (int iteration = 0; iteration < iterations; ++iteration)
+		{
+			auto start = std::chrono::high_resolution_clock::now();
+			std::vector<char> buffer;
+			valid &= OBJParser::ReadFile(filenames[i], buffer) && DDSFile::Parse(buffer.data(), buffer.size(), texture);
+			uint64_t readHash = valid ? readSurfaces(texture) : 0;
+			readSeconds += SecondsSince(start);
+			fileSize = buffer.size();
+
+			start = std::chrono::high_resolution_clock::now();
+			MappedFile file;
+			valid &= DDSFile::Open(filenames[i], file, texture);
+			uint64_t mapHash = valid ? readSurfaces(texture) : 0;
+			mapSeconds += SecondsSince(start);
+
+			same &= readHash == mapHash;
+		}
+
+		if (!valid)
+		{
+			DebugLog("[TextureLoad] %s: not found or not a DDS this reads, skipped\n", filenames[i]);
+			continue;
+		}
+
+		DebugLog("[TextureLoad] %s: %ux%u, %u mips, %u bytes, read %.3f ms (%u heap bytes), mapped %.3f ms (0 heap bytes), %s\n", filenames[i],
+			texture.Width, texture.Height, texture.MipCount, (unsigned int)fileSize, readSeconds * 1000.0 / iterations, (unsigned int)fileSize,
+			mapSeconds * 1000.0 / iterations, same ? "same surfaces" : "DIFFERENT SURFACES");
+	}
+}
+
+void Benchmarks::BlockDecode(const char* const* filenames, int fileCount, unsigned int size, int iterations)
+{
+	struct FormatName
+	{
+		DXGI_FORMAT Format;
+		const char* Name;
+	};
+	const FormatName formats[] =
+	{
+		{ DXGI_FORMAT_BC1_UNORM, "BC1" },
+		{ DXGI_FORMAT_BC2_UNORM, "BC2" },
+		{ DXGI_FORMAT_BC3_UNORM, "BC3" },
+		{ DXGI_FORMAT_BC4_UNORM, "BC4" },
+		{ DXGI_FORMAT_BC4_SNORM, "BC4 snorm" },
+		{ DXGI_FORMAT_BC5_UNORM, "BC5" },
+		{ DXGI_FORMAT_BC5_SNORM, "BC5 snorm" },
+		{ DXGI_FORMAT_BC6H_UF16, "BC6H" },
+		{ DXGI_FORMAT_BC6H_SF16, "BC6H signed" },
+		{ DXGI_FORMAT_BC7_UNORM, "BC7" },
+	};
+
+	ThreadPool pool;
+	double megapixels = (double)size * size / 1000000.0;
+
+	//Best of 'iterations', in megapixels a second
+	auto time = [&](DXGI_FORMAT format, const unsigned char* blocks, uint32_t width, uint32_t height, std::vector<unsigned char>& pixels,
+		ThreadPool* threads, bool simd)
+	{
+		size_t pitch = width * BlockDecoder::DecodedPixelSize(format);
+		pixels.resize(pitch * height);
+		double best = DBL_MAX;
+		for (int iteration = 0; iteration < iterations; ++iteration)
+		{
+			auto start = std::chrono::high_resolution_clock::now();
+			BlockDecoder::DecodeSurface(format, blocks, width, height, pixels.data(), pitch, threads, simd);
+			best = std::min(best, SecondsSince(start));
+		}
+		return (double)width * height / 1000000.0 / best;
+	};
+
+	//Random bits make every mode, partition and index of each format turn up, reserved ones included
+	uint64_t seed = 0x9E3779B97F4A7C15ull;
+	for (const FormatName& format : formats)
+	{
+		std::vector<unsigned char> blocks(DDSFile::SurfaceSize(format.Format, size, size));
+		for (unsigned char& byte : blocks) byte = (unsigned char)(NextRandom(seed) >> 24);
+
+		std::vector<unsigned char> scalar, simd, threaded;
+		double scalarRate = time(format.Format, blocks.data(), size, size, scalar, nullptr, false);
+		double simdRate = time(format.Format, blocks.data(), size, size, simd, nullptr, true);
+		double threadedRate = time(format.Format, blocks.data(), size, size, threaded, &pool, true);
+
+		size_t pixelSize = BlockDecoder::DecodedPixelSize(format.Format);
+		size_t different = 0;
+		for (size_t offset = 0; offset < scalar.size(); offset += pixelSize)
+		{
+			different += memcmp(&scalar[offset], &simd[offset], pixelSize) != 0 || memcmp(&scalar[offset], &threaded[offset], pixelSize) != 0;
+		}
+
+		DebugLog("[BlockDecode] %s %ux%u (%.1f MP): scalar %.1f MP/s, SIMD %.1f MP/s (x%.1f), SIMD on %u threads %.1f MP/s, %u pixels different\n",
+			format.Name, size, size, megapixels, scalarRate, simdRate, simdRate / scalarRate, pool.ThreadCount() + 1, threadedRate, (unsigned int)different);
+	}
+
+	for (int i = 0; i < fileCount; ++i)
+	{
+		MappedFile file;
+		DDSFile::Texture texture;
+		if (!DDSFile::Open(filenames[i], file, texture) || BlockDecoder::DecodedPixelSize(texture.Format) == 0)
+		{
+			DebugLog("[BlockDecode] %s: not found or not BC1-BC7, skipped\n", filenames[i]);
+			continue;
+		}
+
+		//Every surface decoded in turn, as the fallback in AssetManager does it
+		uint64_t pixels = 0;
+		std::vector<unsigned char> decoded;
+		auto start = std::chrono::high_resolution_clock::now();
+		for (uint32_t item = 0; item < texture.ArraySize; ++item)
+		{
+			for (uint32_t mip = 0; mip < texture.MipCount; ++mip)
+			{
+				BlockDecoder::Decode(texture, item, mip, decoded, &pool);
+				pixels += decoded.size() / BlockDecoder::DecodedPixelSize(texture.Format);
+			}
+		}
+		double seconds = SecondsSince(start);
+
+		DebugLog("[BlockDecode] %s: %ux%u, %u mips, %.2f MP decoded in %.3f ms, %.1f MP/s\n", filenames[i], texture.Width, texture.Height,
+			texture.MipCount, pixels / 1000000.0, seconds * 1000.0, pixels / 1000000.0 / seconds);
+	}
+}
+
+void Benchmarks::BlockEncode(const char* const* filenames, int fileCount)
+{
+	struct FormatName
+	{
+		DXGI_FORMAT Format;
+		const char* Name;
+		int Channels;		//Compared for PSNR: BC1's alpha is only a cutout, BC5 keeps red and green
+	};
+	const FormatName formats[] =
+	{
+		{ DXGI_FORMAT_BC1_UNORM, "BC1", 3 },
+		{ DXGI_FORMAT_BC3_UNORM, "BC3", 4 },
+		{ DXGI_FORMAT_BC5_UNORM, "BC5", 2 },
+		{ DXGI_FORMAT_BC7_UNORM, "BC7", 4 },
+	};
+	const char* qualities[] = { "fast", "normal", "high" };
+
+	ThreadPool pool;
+	for (int i = 0; i < fileCount; ++i)
+	{
+		MappedFile file;
+		DDSFile::Texture texture;
+		if (!DDSFile::Open(filenames[i], file, texture))
+		{
+			DebugLog("[BlockEncode] %s: not found, skipped\n", filenames[i]);
+			continue;
+		}
+
+		bool rgba = texture.Format == DXGI_FORMAT_R8G8B8A8_UNORM || texture.Format == DXGI_FORMAT_R8G8B8A8_UNORM_SRGB ||
+			texture.Format == DXGI_FORMAT_R8G8B8A8_TYPELESS;
+		bool bgra = texture.Format == DXGI_FORMAT_B8G8R8A8_UNORM || texture.Format == DXGI_FORMAT_B8G8R8A8_UNORM_SRGB ||
+			texture.Format == DXGI_FORMAT_B8G8R8A8_TYPELESS;
+		if (!rgba && !bgra)
+		{
+			DebugLog("[BlockEncode] %s: not 8 bit RGBA/BGRA, skipped\n", filenames[i]);
+			continue;
+		}
+		const unsigned char* source = DDSFile::Surface(texture, 0, 0);
+
+		for (const FormatName& format : formats)
+		{
+			for (int quality = BlockEncoder::QualityFast; quality <= BlockEncoder::QualityHigh; ++quality)
+			{
+				std::vector<unsigned char> bits;
+				DDSFile::Texture encoded;
+				auto start = std::chrono::high_resolution_clock::now();
+				BlockEncoder::Encode(texture, format.Format, (BlockEncoder::Quality)quality, bits, encoded, &pool);
+				double seconds = SecondsSince(start);
+
+				std::vector<unsigned char> decoded;
+				BlockDecoder::Decode(encoded, 0, 0, decoded, &pool);
+				double squaredError = 0.0;
+				for (size_t pixel = 0; pixel < decoded.size(); pixel += 4)
+				{
+					for (int c = 0; c < format.Channels; ++c)
+					{
+						double difference = (double)decoded[pixel + c] - source[pixel + ((bgra && c != 3) ? 2 - c : c)];
+						squaredError += difference * difference;
+					}
+				}
+				double meanSquaredError = squaredError / ((double)(decoded.size() / 4) * format.Channels);
+
+				uint64_t pixels = 0;
+				for (uint32_t mip = 0; mip < texture.MipCount; ++mip)
+				{
+					pixels += (uint64_t)DDSFile::MipSize(texture.Width, mip) * DDSFile::MipSize(texture.Height, mip) * DDSFile::MipSize(texture.Depth, mip);
+				}
+				pixels *= texture.ArraySize;
+
+				DebugLog("[BlockEncode] %s to %s (%s): %.1f MP/s on %u threads, PSNR %.2f dB\n", filenames[i], format.Name, qualities[quality],
+					pixels / 1000000.0 / seconds, pool.ThreadCount() + 1, (meanSquaredError > 0.0) ? 10.0 * log10(255.0 * 255.0 / meanSquaredError) : 99.0);
+			}
+		}
+	}
+}
+
+void Benchmarks::MipGeneration(const char* const* filenames, int fileCount, int iterations)
+{
+	ThreadPool pool;
+	for (int i = 0; i < fileCount; ++i)
+	{
+		MappedFile file;
+		DDSFile::Texture texture;
+		if (!DDSFile::Open(filenames[i], file, texture) || !MipGenerator::CanGenerate(texture.Format) || texture.Depth != 1)
+		{
+			DebugLog("[MipGeneration] %s: not found or not 8 bit RGBA/BGRA, skipped\n", filenames[i]);
+			continue;
+		}
+
+		double megapixels = (double)texture.Width * texture.Height * texture.ArraySize / 1000000.0;
+		for (int filter = MipGenerator::MipFilterBox; filter <= MipGenerator::MipFilterKaiser; ++filter)
+		{
+			for (int gammaCorrect = 0; gammaCorrect < 2; ++gammaCorrect)
+			{
+				MipGenerator::Settings settings;
+				settings.Filter = (MipGenerator::MipFilter)filter;
+				settings.GammaCorrect = gammaCorrect != 0;
+
+				//Best of 'iterations', in megapixels of top level a second
+				DDSFile::Texture mipped;
+				auto time = [&](std::vector<unsigned char>& bits, ThreadPool* threads, bool simd)
+				{
+					double best = DBL_MAX;
+					for (int iteration = 0; iteration < iterations; ++iteration)
+					{
+						auto start = std::chrono::high_resolution_clock::now();
+						MipGenerator::Generate(texture, settings, bits, mipped, threads, simd);
+						best = std::min(best, SecondsSince(start));
+					}
+					return megapixels / best;
+				};
+
+				std::vector<unsigned char> scalar, simd, threaded;
+				double scalarRate = time(scalar, nullptr, false);
+				double simdRate = time(simd, nullptr, true);
+				double threadedRate = time(threaded, &pool, true);
+
+				size_t different = 0;
+				for (size_t byte = 0; byte < scalar.size(); ++byte) different += scalar[byte] != simd[byte] || scalar[byte] != threaded[byte];
+
+				DebugLog("[MipGeneration] %s, %s%s: %u mips, scalar %.1f MP/s, SIMD %.1f MP/s (x%.1f), SIMD on %u threads %.1f MP/s, %u bytes different\n",
+					filenames[i], (filter == MipGenerator::MipFilterBox) ? "box" : "Kaiser", gammaCorrect ? " gamma correct" : "", mipped.MipCount,
+					scalarRate, simdRate, simdRate / scalarRate, pool.ThreadCount() + 1, threadedRate, (unsigned int)different);
+			}
+		}
+	}
+}
+
+void Benchmarks::TextureResidency(unsigned long long budgetBytes, int iterations)
+{
+	//Each scene model with the texture Application draws it with
+	const char* models[] = { "mainPlayerBoat.obj", "water.obj", "rockBorder.obj", "skyboxSphere.obj" };
+	const char* textureNames[] = { "mainPlayerBoatTex.dds", "oceanTex.dds", "rock.dds", "sky.dds" };
+	const int modelCount = sizeof(models) / sizeof(models[0]);
+
+	MappedFile files[modelCount];
+	DDSFile::Texture textures[modelCount];
+	float uvDensity[modelCount];
+	float sphereCentre[modelCount][3];
+	float sphereRadius[modelCount];
+	bool found[modelCount];
+
+	for (int i = 0; i < modelCount; ++i)
+	{
+		OBJLoader::ImportSettings settings;
+		settings.LodLevels = (i == 1) ? 0 : settings.LodLevels;
+
+		std::vector<char> source;
+		MeshCache::MeshContent mesh;
+		found[i] = OBJParser::ReadFile(models[i], source) && OBJLoader::BuildMesh(models[i], source.data(), source.size(), true, settings, mesh) &&
+			DDSFile::Open(textureNames[i], files[i], textures[i]);
+		if (!found[i])
+		{
+			DebugLog("[TextureResidency] %s or %s: not found, skipped\n", models[i], textureNames[i]);
+			continue;
+		}
+
+		//As AssetManager measures it, over the full detail submeshes
+		TextureStreaming::SurfaceArea area;
+		if (mesh.Submeshes.empty())
+		{
+			TextureStreaming::AddArea(mesh.Vertices.data(), mesh.Indices.data(), DXGI_FORMAT_R32_UINT, 0, (uint32_t)mesh.Indices.size(), area);
+		}
+		else
+		{
+			size_t first = mesh.Lods.empty() ? 0 : mesh.Lods[0].SubmeshStart;
+			size_t count = mesh.Lods.empty() ? mesh.Submeshes.size() : mesh.Lods[0].SubmeshCount;
+			for (size_t submesh = first; submesh < first + count; ++submesh)
+			{
+				TextureStreaming::AddArea(mesh.Vertices.data(), mesh.Indices.data(), DXGI_FORMAT_R32_UINT, mesh.Submeshes[submesh].IndexStart,
+					mesh.Submeshes[submesh].IndexCount, area);
+			}
+		}
+		uvDensity[i] = TextureStreaming::UvDensity(area);
+
+		std::vector<XMFLOAT3> positions(mesh.Vertices.size());
+		for (size_t v = 0; v < mesh.Vertices.size(); ++v)
+		{
+			positions[v] = mesh.Vertices[v].Pos;
+		}
+		MeshBounds::ComputeSphere(positions.data(), positions.size(), sphereCentre[i], sphereRadius[i]);
+
+		const DDSFile::Texture& texture = textures[i];
+		DebugLog("[TextureResidency] %s: %.3g texture units per mesh unit; %s: %ux%u, %u mips, streams down to mip %u\n", models[i], uvDensity[i],
+			textureNames[i], texture.Width, texture.Height, texture.MipCount, TextureStreaming::TailMip(texture));
+	}
+
+	if (std::find(found, found + modelCount, true) == found + modelCount)
+	{
+		return;
+	}
+
+	//The scene as Application lays it out, by model: position and uniform scale of each copy
+	struct Instance
+	{
+		int Model;
+		XMFLOAT3 Position;
+		float Scale;
+	};
+
+	std::vector<Instance> instances;
+	Instance boat = { 0, XMFLOAT3(0.0f, 0.0f, 0.0f), SceneLayout::BoatScale };
+	Instance water = { 1, SceneLayout::WaterPosition, 1.0f };
+	Instance sky = { 3, SceneLayout::SkyPosition, SceneLayout::SkyScale };
+	instances.push_back(boat);
+	instances.push_back(water);
+	for (unsigned int i = 0; i < SceneLayout::RockCount; ++i)
+	{
+		Instance rock = { 2, SceneLayout::Rocks[i], 1.0f };
+		instances.push_back(rock);
+	}
+	instances.push_back(sky);
+
+	float pixelScale = SceneLayout::WindowHeight * 0.5f / tanf(SceneLayout::FieldOfView * 0.5f);
+
+	for (unsigned int c = 0; c < SceneLayout::CameraCount; ++c)
+	{
+		const SceneLayout::CameraPreset& camera = SceneLayout::Cameras[c];
+
+		//Like AssetManager::UseTexture, the finest any copy of a model asks for
+		uint32_t wanted[modelCount];
+		for (int i = 0; i < modelCount; ++i)
+		{
+			wanted[i] = found[i] ? TextureStreaming::TailMip(textures[i]) : 0;
+		}
+
+		for (size_t i = 0; i < instances.size(); ++i)
+		{
+			const Instance& instance = instances[i];
+			int model = instance.Model;
+			if (!found[model])
+			{
+				continue;
+			}
+
+			//Same as Application::SphereDistance
+			float offset[3] =
+			{
+				instance.Position.x + sphereCentre[model][0] * instance.Scale - camera.Eye.x,
+				instance.Position.y + sphereCentre[model][1] * instance.Scale - camera.Eye.y,
+				instance.Position.z + sphereCentre[model][2] * instance.Scale - camera.Eye.z,
+			};
+			float distance = sqrtf(offset[0] * offset[0] + offset[1] * offset[1] + offset[2] * offset[2]) / instance.Scale - sphereRadius[model];
+
+			const DDSFile::Texture& texture = textures[model];
+			uint32_t size = (texture.Width > texture.Height) ? texture.Width : texture.Height;
+			uint32_t mip = TextureStreaming::WantedMip(size, TextureStreaming::PixelsPerUv(uvDensity[model], distance, pixelScale));
+			wanted[model] = (mip < wanted[model]) ? mip : wanted[model];
+		}
+
+		uint64_t wholeBytes = 0;
+		uint64_t wholeOnly = 0;
+		std::vector<TextureStreaming::Request> requests;
+		std::vector<int> requestModels;
+		for (int i = 0; i < modelCount; ++i)
+		{
+			if (!found[i])
+			{
+				continue;
+			}
+
+			wholeBytes += TextureStreaming::ResidentBytes(textures[i], 0);
+			if (TextureStreaming::TailMip(textures[i]) == 0)
+			{
+				wholeOnly += TextureStreaming::ResidentBytes(textures[i], 0);
+				continue;
+			}
+
+			TextureStreaming::Request request = { &textures[i], wanted[i] };
+			requests.push_back(request);
+			requestModels.push_back(i);
+		}
+
+		std::vector<uint32_t> fitted(requests.size());
+		uint64_t streamedBytes = 0;
+		double bestSeconds = DBL_MAX;
+		for (int iteration = 0; iteration < iterations; ++iteration)
+		{
+			auto start = std::chrono::high_resolution_clock::now();
+			streamedBytes = TextureStreaming::FitBudget(requests.data(), requests.size(), budgetBytes, fitted.data());
+			bestSeconds = std::min(bestSeconds, SecondsSince(start));
+		}
+
+		std::string mips;
+		for (size_t i = 0; i < requests.size(); ++i)
+		{
+			char mip[96];
+			snprintf(mip, sizeof(mip), "%s%s mip %u", i ? ", " : "", textureNames[requestModels[i]], fitted[i]);
+			mips += mip;
+		}
+
+		uint64_t residentBytes = wholeOnly + streamedBytes;
+		DebugLog("[TextureResidency] %s camera: %.1f KB whole -> %.1f KB resident (%.1f%%) in a %.1f KB budget, fit in %.2f us%s%s\n", camera.Name,
+			wholeBytes / 1024.0, residentBytes / 1024.0, 100.0 * residentBytes / (wholeBytes ? wholeBytes : 1), budgetBytes / 1024.0, bestSeconds * 1e6,
+			mips.empty() ? "" : ": ", mips.c_str());
+	}
+}
+
+bool Benchmarks::RunAll()
+{
+	const int modelCount = sizeof(sceneModels) / sizeof(sceneModels[0]);
+
+	OBJParse(sceneModels, modelCount);
+	FloatParse();
+	Weld(sceneModels, modelCount);
+
+	const char* cacheModels[] = { "mainPlayerBoat.obj", "rockBorder.obj", "skyboxSphere.obj" };
+	VertexCache(sceneModels, modelCount);
+
+	CacheLoad(sceneModels, modelCount);
+	bool passed = VertexPacking(sceneModels, modelCount);
+	StreamingParse(sceneModels, modelCount);
+	ParallelParse(cacheModels, 3);
+	LodSelection();
+	ClusterCulling();
+	Tangents(cacheModels, 3);
+	Bvh(cacheModels, 3);
+
+	const char* textures[] = { "oceanTex.dds", "sky.dds" };
+	TextureLoad(textures, 2);
+	BlockDecode(textures, 2);
+	BlockEncode(textures, 2);
+	MipGeneration(textures, 2);
+	TextureResidency();
+
+	return passed;
+}
@@ -0,0 +1,89 @@
+#pragma once
+#include <stddef.h>
+#include "SceneLayout.h"
+
+//Timing harnesses for the asset pipeline so regressions show up as numbers rather than "startup feels slow".
+//Results are written with DebugLog. Build with ASSET_BENCHMARKS defined to have the app run them at start up
+namespace Benchmarks
+{
+	//Parse throughput (MB/s) of OBJParser over the given text OBJ files. Each file is read once and parsed
+	//'iterations' times so disk speed doesn't pollute the numbers. Missing files are reported and skipped
+	void OBJParse(const char* const* filenames, int fileCount, int iterations = 10);
+
+	//Vertex counts before/after VertexWelder (one vertex per face corner -> unique vertices) and the time it took. Uses the
+	//shipped .objBinary, which has a vertex per corner too, for any OBJ that isn't there
+	void Weld(const char* const* filenames, int fileCount, float epsilon = 0.0f);
+
+	//ACMR/ATVR of each mesh's welded index buffer before and after the MeshOptimiser passes, plus their cost. From the OBJ or
+	//the shipped .objBinary, as Weld
+	void VertexCache(const char* const* filenames, int fileCount);
+
+	//Time to get each mesh's .objBinary cache validated and ready to upload, reading it into a heap buffer vs
+	//mapping it with MappedFile, plus the heap memory the read path needed. The cache is built with the settings Application
+	//uses into a temporary file that's removed afterwards, so the shipped .objBinary files are never touched
+	void CacheLoad(const char* const* filenames, int fileCount, int iterations = 10);
+
+	//Vertex bytes saved by VertexFormatPacked and the worst position/normal/UV error of a pack/unpack round trip,
+	//checked against what 16-bit positions, 16-bit octahedral normals and half UVs should manage. False if any mesh is
+	//over those limits
+	bool VertexPacking(const char* const* filenames, int fileCount);
+
+	//BuildMesh on the whole file vs BuildMeshStreaming in windowSize windows: time, how much text and face index data each
+	//holds at once, and whether they produced the same mesh (they should)
+	void StreamingParse(const char* const* filenames, int fileCount, size_t windowSize = 16 * 1024);
+
+	//OBJParser::Parse vs ParseParallel on 1, 2, 4, 8 and 16 threads (best of 'iterations'), checking every run gives exactly
+	//what the serial parse did. Each file is repeated 'copies' times over so there's enough text to split up
+	void ParallelParse(const char* const* filenames, int fileCount, int copies = 200, int iterations = 5);
+
+	//FloatParser::Parse vs strtof over 'count' generated numbers (OBJ style fixed point, %g and %e output of random floats, long
+	//digit strings, extreme exponents, leading zeros): MB/s of each, and how many results weren't bit for bit what strtof gave
+	void FloatParse(int count = 200000, int iterations = 5);
+
+	//Builds the scene models' LOD chains (see MeshSimplifier.h) in memory as Application would load them, from the OBJs or else
+	//the shipped .objBinary files without writing to either, then for each of the five camera presets in SceneLayout.h counts the triangles the scene draws at full detail and
+	//with every object at the level SelectLod picks for it. Skipped if none of the models are there
+	void LodSelection(float maxPixelError = SceneLayout::LodPixelError);
+
+	//Builds the sky and water clusters (see MeshClusters.h) in memory as LodSelection does, then for each of the five camera presets in
+	//SceneLayout.h culls them the way Application does: triangles culled out of each mesh's full detail level, the draws left
+	//and the time Cull takes. Skipped if neither model is there
+	void ClusterCulling(int iterations = 1000);
+
+	//MeshTangents::Generate on the calling thread vs 2, 4, 8 and 16 threads (best of 'iterations'), checking every run gives exactly
+	//what the serial one did, plus how many vertices were split on mirrored UVs and how far the tangents stray from perpendicular
+	//to their normals. Each welded mesh is repeated 'copies' times over so there's enough to split up
+	void Tangents(const char* const* filenames, int fileCount, int copies = 50, int iterations = 5);
+
+	//Bounds and BVH of each mesh: Welzl's sphere against Ritter's, MeshBvh::Build on the calling thread vs 2, 4, 8 and 16 threads
+	//(best of 'iterations', checking every run gives exactly what the serial one did) and its SAH cost, then 'rays' random rays
+	//and boxes through the mesh answered with the BVH vs testing every triangle, counting any answers that differ
+	void Bvh(const char* const* filenames, int fileCount, int rays = 10000, int iterations = 5);
+
+	//Time to get each .dds parsed with DDSFile and every surface read once (as the upload would), reading the file into a heap
+	//buffer first vs mapping it, plus the heap memory the read path needed. Both should see exactly the same bytes
+	void TextureLoad(const char* const* filenames, int fileCount, int iterations = 10);
+
+	//BlockDecoder::DecodeSurface on a size x size surface of random blocks of each BC format, in megapixels a second (best of
+	//'iterations'): scalar, SIMD, and SIMD spread over a pool, counting pixels where those three disagree. Then every surface
+	//of each .dds that's BC1-BC7 decoded through the pool
+	void BlockDecode(const char* const* filenames, int fileCount, unsigned int size = 1024, int iterations = 5);
+
+	//BlockEncoder::Encode of each .dds that's 8 bit RGBA/BGRA to BC1, BC3, BC5 and BC7 at each quality, through a pool: megapixels
+	//a second and the PSNR of the top mip decoded again with BlockDecoder, over the channels the format keeps
+	void BlockEncode(const char* const* filenames, int fileCount);
+
+	//MipGenerator::Generate over each .dds that's 8 bit RGBA/BGRA with the box and Kaiser filters, gamma correct or not, in
+	//megapixels of top level a second (best of 'iterations'): scalar, SIMD, and SIMD spread over a pool, counting the bytes
+	//where those disagree
+	void MipGeneration(const char* const* filenames, int fileCount, int iterations = 5);
+
+	//For each of the five camera presets in SceneLayout.h, the mips of each scene texture that TextureStreaming says its models
+	//need, going by their texture coordinate density and distance as Application measures it, and what fitting those into
+	//budgetBytes leaves resident next to loading every texture whole. Textures with only small mips always load whole
+	void TextureResidency(unsigned long long budgetBytes = SceneLayout::TextureBudget, int iterations = 1000);
+
+	//Runs every benchmark above over the models that ship with the scene. False if any of their checks failed, so far
+	//only VertexPacking's error limits
+	bool RunAll();
+};
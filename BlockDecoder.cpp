@@ -0,0 +1,835 @@
+#include "BlockDecoder.h"
+#include "BlockTables.h"
+#include "Simd.h"
+#include "ThreadPool.h"
+#include <string.h>
+
+namespace
+{
+	//Reads a 128 bit block from bit 0 up, as every BC6H/BC7 field is laid out. Little endian hosts only, like the caches
+	struct BitReader
+	{
+		uint64_t Low;
+		uint64_t High;
+		unsigned int Position;
+
+		explicit BitReader(const unsigned char* block) : Position(0)
+		{
+			memcpy(&Low, block, 8);
+			memcpy(&High, block + 8, 8);
+		}
+
+		unsigned int Read(unsigned int count)
+		{
+			uint64_t bits;
+			if (Position >= 64) bits = High >> (Position - 64);
+			else if (Position == 0) bits = Low;
+			else bits = (Low >> Position) | (High << (64 - Position));
+
+			Position += count;
+			return (unsigned int)bits & ((1u << count) - 1);
+		}
+	};
+
+	enum BlockKind
+	{
+		KindBC1,
+		KindBC2,
+		KindBC3,
+		KindBC4,
+		KindBC5,
+		KindBC6,
+		KindBC7,
+		KindNone,
+	};
+
+	BlockKind Kind(DXGI_FORMAT format, bool& outSigned)
+	{
+		outSigned = format == DXGI_FORMAT_BC4_SNORM || format == DXGI_FORMAT_BC5_SNORM || format == DXGI_FORMAT_BC6H_SF16;
+
+		switch (format)
+		{
+		case DXGI_FORMAT_BC1_TYPELESS: case DXGI_FORMAT_BC1_UNORM: case DXGI_FORMAT_BC1_UNORM_SRGB: return KindBC1;
+		case DXGI_FORMAT_BC2_TYPELESS: case DXGI_FORMAT_BC2_UNORM: case DXGI_FORMAT_BC2_UNORM_SRGB: return KindBC2;
+		case DXGI_FORMAT_BC3_TYPELESS: case DXGI_FORMAT_BC3_UNORM: case DXGI_FORMAT_BC3_UNORM_SRGB: return KindBC3;
+		case DXGI_FORMAT_BC4_TYPELESS: case DXGI_FORMAT_BC4_UNORM: case DXGI_FORMAT_BC4_SNORM: return KindBC4;
+		case DXGI_FORMAT_BC5_TYPELESS: case DXGI_FORMAT_BC5_UNORM: case DXGI_FORMAT_BC5_SNORM: return KindBC5;
+		case DXGI_FORMAT_BC6H_TYPELESS: case DXGI_FORMAT_BC6H_UF16: case DXGI_FORMAT_BC6H_SF16: return KindBC6;
+		case DXGI_FORMAT_BC7_TYPELESS: case DXGI_FORMAT_BC7_UNORM: case DXGI_FORMAT_BC7_UNORM_SRGB: return KindBC7;
+		default: return KindNone;
+		}
+	}
+
+	inline uint32_t PackRGBA(unsigned int r, unsigned int g, unsigned int b, unsigned int a)
+	{
+		return r | (g << 8) | (b << 16) | (a << 24);
+	}
+
+	//Division rounded to nearest, halves away from zero, for the signed BC4/BC5 palettes
+	inline int RoundedDivide(int numerator, int denominator)
+	{
+		return (numerator >= 0) ? (numerator + denominator / 2) / denominator : -((-numerator + denominator / 2) / denominator);
+	}
+
+	//The four colours of a BC1-BC3 colour block. A BC1 block with colour0 <= colour1 has three and transparent black,
+	//BC2 and BC3 blocks always have four
+	void ColourPalette(const unsigned char* block, bool allowTransparent, uint32_t palette[4])
+	{
+		unsigned int colour0 = block[0] | (block[1] << 8);
+		unsigned int colour1 = block[2] | (block[3] << 8);
+
+		//5:6:5 to 8:8:8 by repeating the top bits into the bottom
+		unsigned int a[3] = { (colour0 >> 11) & 31, (colour0 >> 5) & 63, colour0 & 31 };
+		unsigned int b[3] = { (colour1 >> 11) & 31, (colour1 >> 5) & 63, colour1 & 31 };
+		for (int c = 0; c < 3; ++c)
+		{
+			unsigned int shift = (c == 1) ? 2 : 3;
+			a[c] = (a[c] << shift) | (a[c] >> (8 - 2 * shift));
+			b[c] = (b[c] << shift) | (b[c] >> (8 - 2 * shift));
+		}
+
+		palette[0] = PackRGBA(a[0], a[1], a[2], 255);
+		palette[1] = PackRGBA(b[0], b[1], b[2], 255);
+		if (colour0 > colour1 || !allowTransparent)
+		{
+			palette[2] = PackRGBA((2 * a[0] + b[0] + 1) / 3, (2 * a[1] + b[1] + 1) / 3, (2 * a[2] + b[2] + 1) / 3, 255);
+			palette[3] = PackRGBA((a[0] + 2 * b[0] + 1) / 3, (a[1] + 2 * b[1] + 1) / 3, (a[2] + 2 * b[2] + 1) / 3, 255);
+		}
+		else
+		{
+			palette[2] = PackRGBA((a[0] + b[0] + 1) / 2, (a[1] + b[1] + 1) / 2, (a[2] + b[2] + 1) / 2, 255);
+			palette[3] = 0;
+		}
+	}
+
+	//The eight values of a BC4 block (BC3's alpha, each of BC5's channels), as the bytes they're written out as. With
+	//value0 > value1 six are interpolated, otherwise four plus the two ends of the range
+	void ChannelPalette(const unsigned char* block, bool isSigned, unsigned char palette[8])
+	{
+		int a, b, low, high;
+		if (isSigned)
+		{
+			a = (signed char)block[0];
+			b = (signed char)block[1];
+			low = -127;
+			high = 127;
+		}
+		else
+		{
+			a = block[0];
+			b = block[1];
+			low = 0;
+			high = 255;
+		}
+
+		//Which palette is picked by the values as stored, then -128 becomes -127 like every snorm
+		bool sixInterpolated = a > b;
+		a = (a < low) ? low : a;
+		b = (b < low) ? low : b;
+
+		int values[8] = { a, b };
+		if (sixInterpolated)
+		{
+			for (int i = 1; i < 7; ++i) values[i + 1] = RoundedDivide((7 - i) * a + i * b, 7);
+		}
+		else
+		{
+			for (int i = 1; i < 5; ++i) values[i + 1] = RoundedDivide((5 - i) * a + i * b, 5);
+			values[6] = low;
+			values[7] = high;
+		}
+
+		for (int i = 0; i < 8; ++i) palette[i] = (unsigned char)values[i];
+	}
+
+	//48 bits of 3 bit indices after a BC4 block's two values
+	inline uint64_t ChannelIndices(const unsigned char* block)
+	{
+		uint64_t indices = 0;
+		memcpy(&indices, block + 2, 6);
+		return indices;
+	}
+
+	inline uint32_t ColourIndices(const unsigned char* block)
+	{
+		return block[4] | (block[5] << 8) | (block[6] << 16) | ((uint32_t)block[7] << 24);
+	}
+
+	void WriteColours(const uint32_t palette[4], uint32_t indices, unsigned char* out, size_t pitch)
+	{
+		for (int i = 0; i < 16; ++i)
+		{
+			memcpy(out + (i >> 2) * pitch + (i & 3) * 4, &palette[(indices >> (2 * i)) & 3], 4);
+		}
+	}
+
+	void WriteChannel(const unsigned char palette[8], uint64_t indices, unsigned char* out, size_t pitch, int channel)
+	{
+		for (int i = 0; i < 16; ++i)
+		{
+			out[(i >> 2) * pitch + (i & 3) * 4 + channel] = palette[(indices >> (3 * i)) & 7];
+		}
+	}
+
+	//Everything about a BC7 block but the interpolation, which the scalar and SSE2 paths then do the same way
+	struct Bc7Block
+	{
+		uint32_t Endpoints[3][2];		//RGBA8 packed like PackRGBA, per subset
+		unsigned char Subset[16];
+		unsigned char ColourWeight[16];
+		unsigned char AlphaWeight[16];
+		unsigned int Rotation;			//0, or 1-3 to swap alpha with red, green or blue after interpolating
+	};
+
+	//False for the reserved mode (no mode bit set in the first byte)
+	bool UnpackBc7(const unsigned char* block, Bc7Block& out)
+	{
+		unsigned int mode = 0;
+		while (mode < 8 && !(block[0] & (1 << mode))) ++mode;
+		if (mode == 8)
+		{
+			return false;
+		}
+
+		const BlockTables::Bc7Mode& info = BlockTables::Bc7Modes[mode];
+		BitReader bits(block);
+		bits.Read(mode + 1);
+
+		unsigned int partition = bits.Read(info.PartitionBits);
+		out.Rotation = bits.Read(info.RotationBits);
+		unsigned int indexSelection = bits.Read(info.IndexSelectionBits);
+
+		unsigned int endpointCount = info.Subsets * 2u;
+		unsigned int values[6][4];
+		for (unsigned int c = 0; c < 4; ++c)
+		{
+			for (unsigned int e = 0; e < endpointCount; ++e)
+			{
+				values[e][c] = (c < 3) ? bits.Read(info.ColourBits) : bits.Read(info.AlphaBits);
+			}
+		}
+
+		unsigned int pBits[6] = {};
+		for (unsigned int e = 0; e < endpointCount; ++e)
+		{
+			if (info.EndpointPBits) pBits[e] = bits.Read(1);
+			else if (info.SharedPBits && (e & 1) == 0) pBits[e] = pBits[e + 1] = bits.Read(1);
+		}
+
+		//With a p-bit below it, then the top bits repeated below that to make 8
+		bool hasPBits = info.EndpointPBits || info.SharedPBits;
+		for (unsigned int e = 0; e < endpointCount; ++e)
+		{
+			unsigned int channels[4];
+			for (unsigned int c = 0; c < 4; ++c)
+			{
+				unsigned int precision = (c < 3) ? info.ColourBits : info.AlphaBits;
+				unsigned int value = values[e][c];
+				if (precision == 0)
+				{
+					channels[c] = 255;
+					continue;
+				}
+
+				if (hasPBits)
+				{
+					value = (value << 1) | pBits[e];
+					++precision;
+				}
+				channels[c] = (value << (8 - precision)) | (value >> (2 * precision - 8));
+			}
+			out.Endpoints[e >> 1][e & 1] = PackRGBA(channels[0], channels[1], channels[2], channels[3]);
+		}
+
+		unsigned int anchors[3] = { 0, 0, 0 };
+		for (unsigned int i = 0; i < 16; ++i)
+		{
+			if (info.Subsets == 2) out.Subset[i] = (BlockTables::Partitions2[partition] >> i) & 1;
+			else if (info.Subsets == 3) out.Subset[i] = (BlockTables::Partitions3[partition] >> (2 * i)) & 3;
+			else out.Subset[i] = 0;
+		}
+		if (info.Subsets == 2)
+		{
+			anchors[1] = BlockTables::Anchors2[partition];
+		}
+		else if (info.Subsets == 3)
+		{
+			anchors[1] = BlockTables::Anchors3Second[partition];
+			anchors[2] = BlockTables::Anchors3Third[partition];
+		}
+
+		//Each subset's anchor pixel has its index's top bit left out
+		unsigned int primary[16];
+		for (unsigned int i = 0; i < 16; ++i)
+		{
+			primary[i] = bits.Read(info.IndexBits - (i == anchors[out.Subset[i]] ? 1 : 0));
+		}
+
+		const uint8_t* primaryWeights = BlockTables::Weights(info.IndexBits);
+		if (info.SecondaryIndexBits == 0)
+		{
+			for (unsigned int i = 0; i < 16; ++i)
+			{
+				out.ColourWeight[i] = out.AlphaWeight[i] = primaryWeights[primary[i]];
+			}
+			return true;
+		}
+
+		const uint8_t* secondaryWeights = BlockTables::Weights(info.SecondaryIndexBits);
+		for (unsigned int i = 0; i < 16; ++i)
+		{
+			unsigned int secondary = bits.Read(info.SecondaryIndexBits - (i == 0 ? 1 : 0));
+			out.ColourWeight[i] = indexSelection ? secondaryWeights[secondary] : primaryWeights[primary[i]];
+			out.AlphaWeight[i] = indexSelection ? primaryWeights[primary[i]] : secondaryWeights[secondary];
+		}
+		return true;
+	}
+
+	inline unsigned int Interpolate(unsigned int a, unsigned int b, unsigned int weight)
+	{
+		return (a * (64 - weight) + b * weight + 32) >> 6;
+	}
+
+	void RotateBc7(const Bc7Block& unpacked, unsigned char* out, size_t pitch)
+	{
+		if (unpacked.Rotation == 0)
+		{
+			return;
+		}
+
+		for (int i = 0; i < 16; ++i)
+		{
+			unsigned char* pixel = out + (i >> 2) * pitch + (i & 3) * 4;
+			unsigned char swap = pixel[unpacked.Rotation - 1];
+			pixel[unpacked.Rotation - 1] = pixel[3];
+			pixel[3] = swap;
+		}
+	}
+
+	void WriteBc7(const Bc7Block& unpacked, unsigned char* out, size_t pitch)
+	{
+		for (int i = 0; i < 16; ++i)
+		{
+			uint32_t a = unpacked.Endpoints[unpacked.Subset[i]][0];
+			uint32_t b = unpacked.Endpoints[unpacked.Subset[i]][1];
+			unsigned char* pixel = out + (i >> 2) * pitch + (i & 3) * 4;
+			for (int c = 0; c < 4; ++c)
+			{
+				unsigned int weight = (c < 3) ? unpacked.ColourWeight[i] : unpacked.AlphaWeight[i];
+				pixel[c] = (unsigned char)Interpolate((a >> (8 * c)) & 255, (b >> (8 * c)) & 255, weight);
+			}
+		}
+		RotateBc7(unpacked, out, pitch);
+	}
+
+	//BC6H's fourteen modes. Each lists where its fields' bits come from after the mode bits, in order: Count bits in turn
+	//go to bits First, First + 1, ... of Field. Endpoints are w, x (region 0) and y, z (region 1) per channel
+	enum Bc6Field
+	{
+		RW, RX, RY, RZ,
+		GW, GX, GY, GZ,
+		BW, BX, BY, BZ,
+		D,
+	};
+
+	struct Bc6Run
+	{
+		unsigned char Field;
+		unsigned char First;
+		unsigned char Count;
+	};
+
+	struct Bc6Mode
+	{
+		bool Transformed;				//x, y and z are stored as differences from w
+		unsigned char Regions;
+		unsigned char EndpointBits;
+		unsigned char DeltaBits[3];		//Of x, y and z per channel, when transformed
+		Bc6Run Runs[28];				//Ends at the first with Count 0
+	};
+
+	const Bc6Mode Bc6Modes[14] =
+	{
+		{ true, 2, 10, { 5, 5, 5 }, { { GY, 4, 1 }, { BY, 4, 1 }, { BZ, 4, 1 }, { RW, 0, 10 }, { GW, 0, 10 }, { BW, 0, 10 }, { RX, 0, 5 }, { GZ, 4, 1 },
+			{ GY, 0, 4 }, { GX, 0, 5 }, { BZ, 0, 1 }, { GZ, 0, 4 }, { BX, 0, 5 }, { BZ, 1, 1 }, { BY, 0, 4 }, { RY, 0, 5 }, { BZ, 2, 1 }, { RZ, 0, 5 },
+			{ BZ, 3, 1 }, { D, 0, 5 } } },
+		{ true, 2, 7, { 6, 6, 6 }, { { GY, 5, 1 }, { GZ, 4, 2 }, { RW, 0, 7 }, { BZ, 0, 2 }, { BY, 4, 1 }, { GW, 0, 7 }, { BY, 5, 1 }, { BZ, 2, 1 },
+			{ GY, 4, 1 }, { BW, 0, 7 }, { BZ, 3, 1 }, { BZ, 5, 1 }, { BZ, 4, 1 }, { RX, 0, 6 }, { GY, 0, 4 }, { GX, 0, 6 }, { GZ, 0, 4 }, { BX, 0, 6 },
+			{ BY, 0, 4 }, { RY, 0, 6 }, { RZ, 0, 6 }, { D, 0, 5 } } },
+		{ true, 2, 11, { 5, 4, 4 }, { { RW, 0, 10 }, { GW, 0, 10 }, { BW, 0, 10 }, { RX, 0, 5 }, { RW, 10, 1 }, { GY, 0, 4 }, { GX, 0, 4 }, { GW, 10, 1 },
+			{ BZ, 0, 1 }, { GZ, 0, 4 }, { BX, 0, 4 }, { BW, 10, 1 }, { BZ, 1, 1 }, { BY, 0, 4 }, { RY, 0, 5 }, { BZ, 2, 1 }, { RZ, 0, 5 }, { BZ, 3, 1 },
+			{ D, 0, 5 } } },
+		{ true, 2, 11, { 4, 5, 4 }, { { RW, 0, 10 }, { GW, 0, 10 }, { BW, 0, 10 }, { RX, 0, 4 }, { RW, 10, 1 }, { GZ, 4, 1 }, { GY, 0, 4 }, { GX, 0, 5 },
+			{ GW, 10, 1 }, { GZ, 0, 4 }, { BX, 0, 4 }, { BW, 10, 1 }, { BZ, 1, 1 }, { BY, 0, 4 }, { RY, 0, 4 }, { BZ, 0, 1 }, { BZ, 2, 1 }, { RZ, 0, 4 },
+			{ GY, 4, 1 }, { BZ, 3, 1 }, { D, 0, 5 } } },
+		{ true, 2, 11, { 4, 4, 5 }, { { RW, 0, 10 }, { GW, 0, 10 }, { BW, 0, 10 }, { RX, 0, 4 }, { RW, 10, 1 }, { BY, 4, 1 }, { GY, 0, 4 }, { GX, 0, 4 },
+			{ GW, 10, 1 }, { BZ, 0, 1 }, { GZ, 0, 4 }, { BX, 0, 5 }, { BW, 10, 1 }, { BY, 0, 4 }, { RY, 0, 4 }, { BZ, 1, 2 }, { RZ, 0, 4 }, { BZ, 4, 1 },
+			{ BZ, 3, 1 }, { D, 0, 5 } } },
+		{ true, 2, 9, { 5, 5, 5 }, { { RW, 0, 9 }, { BY, 4, 1 }, { GW, 0, 9 }, { GY, 4, 1 }, { BW, 0, 9 }, { BZ, 4, 1 }, { RX, 0, 5 }, { GZ, 4, 1 },
+			{ GY, 0, 4 }, { GX, 0, 5 }, { BZ, 0, 1 }, { GZ, 0, 4 }, { BX, 0, 5 }, { BZ, 1, 1 }, { BY, 0, 4 }, { RY, 0, 5 }, { BZ, 2, 1 }, { RZ, 0, 5 },
+			{ BZ, 3, 1 }, { D, 0, 5 } } },
+		{ true, 2, 8, { 6, 5, 5 }, { { RW, 0, 8 }, { GZ, 4, 1 }, { BY, 4, 1 }, { GW, 0, 8 }, { BZ, 2, 1 }, { GY, 4, 1 }, { BW, 0, 8 }, { BZ, 3, 2 },
+			{ RX, 0, 6 }, { GY, 0, 4 }, { GX, 0, 5 }, { BZ, 0, 1 }, { GZ, 0, 4 }, { BX, 0, 5 }, { BZ, 1, 1 }, { BY, 0, 4 }, { RY, 0, 6 }, { RZ, 0, 6 },
+			{ D, 0, 5 } } },
+		{ true, 2, 8, { 5, 6, 5 }, { { RW, 0, 8 }, { BZ, 0, 1 }, { BY, 4, 1 }, { GW, 0, 8 }, { GY, 5, 1 }, { GY, 4, 1 }, { BW, 0, 8 }, { GZ, 5, 1 },
+			{ BZ, 4, 1 }, { RX, 0, 5 }, { GZ, 4, 1 }, { GY, 0, 4 }, { GX, 0, 6 }, { GZ, 0, 4 }, { BX, 0, 5 }, { BZ, 1, 1 }, { BY, 0, 4 }, { RY, 0, 5 },
+			{ BZ, 2, 1 }, { RZ, 0, 5 }, { BZ, 3, 1 }, { D, 0, 5 } } },
+		{ true, 2, 8, { 5, 5, 6 }, { { RW, 0, 8 }, { BZ, 1, 1 }, { BY, 4, 1 }, { GW, 0, 8 }, { BY, 5, 1 }, { GY, 4, 1 }, { BW, 0, 8 }, { BZ, 5, 1 },
+			{ BZ, 4, 1 }, { RX, 0, 5 }, { GZ, 4, 1 }, { GY, 0, 4 }, { GX, 0, 5 }, { BZ, 0, 1 }, { GZ, 0, 4 }, { BX, 0, 6 }, { BY, 0, 4 }, { RY, 0, 5 },
+			{ BZ, 2, 1 }, { RZ, 0, 5 }, { BZ, 3, 1 }, { D, 0, 5 } } },
+		{ false, 2, 6, { 6, 6, 6 }, { { RW, 0, 6 }, { GZ, 4, 1 }, { BZ, 0, 2 }, { BY, 4, 1 }, { GW, 0, 6 }, { GY, 5, 1 }, { BY, 5, 1 }, { BZ, 2, 1 },
+			{ GY, 4, 1 }, { BW, 0, 6 }, { GZ, 5, 1 }, { BZ, 3, 1 }, { BZ, 5, 1 }, { BZ, 4, 1 }, { RX, 0, 6 }, { GY, 0, 4 }, { GX, 0, 6 }, { GZ, 0, 4 },
+			{ BX, 0, 6 }, { BY, 0, 4 }, { RY, 0, 6 }, { RZ, 0, 6 }, { D, 0, 5 } } },
+		{ false, 1, 10, { 10, 10, 10 }, { { RW, 0, 10 }, { GW, 0, 10 }, { BW, 0, 10 }, { RX, 0, 10 }, { GX, 0, 10 }, { BX, 0, 10 } } },
+		{ true, 1, 11, { 9, 9, 9 }, { { RW, 0, 10 }, { GW, 0, 10 }, { BW, 0, 10 }, { RX, 0, 9 }, { RW, 10, 1 }, { GX, 0, 9 }, { GW, 10, 1 }, { BX, 0, 9 },
+			{ BW, 10, 1 } } },
+		{ true, 1, 12, { 8, 8, 8 }, { { RW, 0, 10 }, { GW, 0, 10 }, { BW, 0, 10 }, { RX, 0, 8 }, { RW, 11, 1 }, { RW, 10, 1 }, { GX, 0, 8 }, { GW, 11, 1 },
+			{ GW, 10, 1 }, { BX, 0, 8 }, { BW, 11, 1 }, { BW, 10, 1 } } },
+		{ true, 1, 16, { 4, 4, 4 }, { { RW, 0, 10 }, { GW, 0, 10 }, { BW, 0, 10 }, { RX, 0, 4 }, { RW, 15, 1 }, { RW, 14, 1 }, { RW, 13, 1 }, { RW, 12, 1 },
+			{ RW, 11, 1 }, { RW, 10, 1 }, { GX, 0, 4 }, { GW, 15, 1 }, { GW, 14, 1 }, { GW, 13, 1 }, { GW, 12, 1 }, { GW, 11, 1 }, { GW, 10, 1 },
+			{ BX, 0, 4 }, { BW, 15, 1 }, { BW, 14, 1 }, { BW, 13, 1 }, { BW, 12, 1 }, { BW, 11, 1 }, { BW, 10, 1 } } },
+	};
+
+	//Mode from the first 5 bits of a block, for those whose first two bits are 10 or 11. -1 is reserved
+	const signed char Bc6ModeFromBits[32] =
+	{
+		-1, -1, 2, 10, -1, -1, 3, 11, -1, -1, 4, 12, -1, -1, 5, 13,
+		-1, -1, 6, -1, -1, -1, 7, -1, -1, -1, 8, -1, -1, -1, 9, -1,
+	};
+
+	inline int SignExtend(int value, unsigned int bits)
+	{
+		return (int)((unsigned int)value << (32 - bits)) >> (32 - bits);
+	}
+
+	//Stored endpoint to the 16 (unsigned) or 15 bit plus sign range interpolation works in
+	int Unquantize(int value, unsigned int bits, bool isSigned)
+	{
+		if (!isSigned)
+		{
+			if (bits >= 15 || value == 0) return value;
+			if (value == (1 << bits) - 1) return 0xFFFF;
+			return ((value << 16) + 0x8000) >> bits;
+		}
+
+		if (bits >= 16)
+		{
+			return value;
+		}
+
+		bool negative = value < 0;
+		int magnitude = negative ? -value : value;
+		int unquantized;
+		if (magnitude == 0) unquantized = 0;
+		else if (magnitude >= (1 << (bits - 1)) - 1) unquantized = 0x7FFF;
+		else unquantized = ((magnitude << 15) + 0x4000) >> (bits - 1);
+		return negative ? -unquantized : unquantized;
+	}
+
+	//Interpolated value to the bits of a half float: scaled by 31/32 (31/64 unsigned) so the largest becomes the largest
+	//finite half, and negatives to sign and magnitude
+	inline uint16_t FinishUnquantize(int value, bool isSigned)
+	{
+		if (!isSigned)
+		{
+			return (uint16_t)((value * 31) >> 6);
+		}
+		return (value < 0) ? (uint16_t)(0x8000 | (((-value) * 31) >> 5)) : (uint16_t)((value * 31) >> 5);
+	}
+
+	void DecodeBc6(const unsigned char* block, bool isSigned, unsigned char* out, size_t pitch)
+	{
+		const uint16_t one = 0x3C00;
+
+		BitReader bits(block);
+		unsigned int modeBits = bits.Read(2);
+		int mode = (int)modeBits;
+		if (modeBits >= 2)
+		{
+			modeBits |= bits.Read(3) << 2;
+			mode = Bc6ModeFromBits[modeBits];
+		}
+
+		if (mode < 0)
+		{
+			for (int i = 0; i < 16; ++i)
+			{
+				uint16_t pixel[4] = { 0, 0, 0, one };
+				memcpy(out + (i >> 2) * pitch + (i & 3) * 8, pixel, 8);
+			}
+			return;
+		}
+
+		const Bc6Mode& info = Bc6Modes[mode];
+		int fields[13] = {};
+		for (const Bc6Run* run = info.Runs; run->Count != 0; ++run)
+		{
+			fields[run->Field] |= (int)bits.Read(run->Count) << run->First;
+		}
+
+		//w stays as stored, x, y and z are either stored the same way or as differences from w that wrap at the endpoint size
+		unsigned int endpointCount = info.Regions * 2u;
+		int endpoints[4][3];
+		for (unsigned int c = 0; c < 3; ++c)
+		{
+			int w = fields[c * 4];
+			if (isSigned) w = SignExtend(w, info.EndpointBits);
+			endpoints[0][c] = w;
+
+			for (unsigned int e = 1; e < endpointCount; ++e)
+			{
+				int value = fields[c * 4 + e];
+				if (info.Transformed)
+				{
+					value = (w + SignExtend(value, info.DeltaBits[c])) & ((1 << info.EndpointBits) - 1);
+				}
+				endpoints[e][c] = isSigned ? SignExtend(value, info.EndpointBits) : value;
+			}
+
+			for (unsigned int e = 0; e < endpointCount; ++e)
+			{
+				endpoints[e][c] = Unquantize(endpoints[e][c], info.EndpointBits, isSigned);
+			}
+		}
+
+		unsigned int partition = fields[D];
+		unsigned int indexBits = (info.Regions == 2) ? 3 : 4;
+		const uint8_t* weights = BlockTables::Weights(indexBits);
+		for (unsigned int i = 0; i < 16; ++i)
+		{
+			unsigned int region = (info.Regions == 2) ? (BlockTables::Partitions2[partition] >> i) & 1 : 0;
+			bool anchor = i == 0 || (info.Regions == 2 && i == BlockTables::Anchors2[partition]);
+			int weight = weights[bits.Read(indexBits - (anchor ? 1 : 0))];
+
+			uint16_t pixel[4];
+			for (unsigned int c = 0; c < 3; ++c)
+			{
+				int a = endpoints[region * 2][c], b = endpoints[region * 2 + 1][c];
+				pixel[c] = FinishUnquantize((a * (64 - weight) + b * weight + 32) >> 6, isSigned);
+			}
+			pixel[3] = one;
+			memcpy(out + (i >> 2) * pitch + (i & 3) * 8, pixel, 8);
+		}
+	}
+
+#ifdef SIMD_SSE2
+	inline __m128i Select(__m128i mask, __m128i a, __m128i b)
+	{
+		return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+	}
+
+	//Four colour lookup a row of four pixels at a time: each pixel's two index bits are tested where they sit in the
+	//32 bit index word, then pick between the palette entries in two rounds
+	void WriteColoursSSE2(const uint32_t palette[4], uint32_t indices, unsigned char* out, size_t pitch)
+	{
+		const __m128i colour0 = _mm_set1_epi32((int)palette[0]);
+		const __m128i colour1 = _mm_set1_epi32((int)palette[1]);
+		const __m128i colour2 = _mm_set1_epi32((int)palette[2]);
+		const __m128i colour3 = _mm_set1_epi32((int)palette[3]);
+		const __m128i all = _mm_set1_epi32((int)indices);
+
+		for (int row = 0; row < 4; ++row)
+		{
+			int shift = row * 8;
+			__m128i lowBit = _mm_setr_epi32(1 << shift, 1 << (shift + 2), 1 << (shift + 4), 1 << (shift + 6));
+			__m128i highBit = _mm_add_epi32(lowBit, lowBit);
+			__m128i low = _mm_cmpeq_epi32(_mm_and_si128(all, lowBit), lowBit);
+			__m128i high = _mm_cmpeq_epi32(_mm_and_si128(all, highBit), highBit);
+
+			__m128i colours = Select(high, Select(low, colour3, colour2), Select(low, colour1, colour0));
+			_mm_storeu_si128((__m128i*)(out + row * pitch), colours);
+		}
+	}
+
+	//BC2's explicit 4 bit alphas, a byte per pixel, each scaled to 8 bits by repeating it
+	__m128i ExplicitAlphaSSE2(const unsigned char* block)
+	{
+		__m128i packed = _mm_loadl_epi64((const __m128i*)block);
+		__m128i nibbleMask = _mm_set1_epi8(0x0F);
+		__m128i alphas = _mm_unpacklo_epi8(_mm_and_si128(packed, nibbleMask), _mm_and_si128(_mm_srli_epi16(packed, 4), nibbleMask));
+		return _mm_or_si128(alphas, _mm_slli_epi16(alphas, 4));
+	}
+
+	//Puts 16 bytes, one per pixel, into the alpha of rows of pixels already written out
+	void MergeAlphaSSE2(__m128i alphas, unsigned char* out, size_t pitch)
+	{
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i colourMask = _mm_set1_epi32(0x00FFFFFF);
+		__m128i halves[2] = { _mm_unpacklo_epi8(zero, alphas), _mm_unpackhi_epi8(zero, alphas) };
+		for (int row = 0; row < 4; ++row)
+		{
+			__m128i shifted = (row & 1) ? _mm_unpackhi_epi16(zero, halves[row >> 1]) : _mm_unpacklo_epi16(zero, halves[row >> 1]);
+			__m128i* pixels = (__m128i*)(out + row * pitch);
+			_mm_storeu_si128(pixels, _mm_or_si128(_mm_and_si128(_mm_loadu_si128(pixels), colourMask), shifted));
+		}
+	}
+
+	//Two pixels per register as eight 16 bit channels, (a * (64 - w) + b * w + 32) >> 6 staying under 2^15 throughout
+	void WriteBc7SSE2(const Bc7Block& unpacked, unsigned char* out, size_t pitch)
+	{
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i full = _mm_set1_epi16(64);
+		const __m128i round = _mm_set1_epi16(32);
+
+		for (int row = 0; row < 4; ++row)
+		{
+			__m128i pairs[2];
+			for (int half = 0; half < 2; ++half)
+			{
+				int i = row * 4 + half * 2;
+				__m128i a = _mm_unpacklo_epi32(_mm_cvtsi32_si128((int)unpacked.Endpoints[unpacked.Subset[i]][0]),
+					_mm_cvtsi32_si128((int)unpacked.Endpoints[unpacked.Subset[i + 1]][0]));
+				__m128i b = _mm_unpacklo_epi32(_mm_cvtsi32_si128((int)unpacked.Endpoints[unpacked.Subset[i]][1]),
+					_mm_cvtsi32_si128((int)unpacked.Endpoints[unpacked.Subset[i + 1]][1]));
+				a = _mm_unpacklo_epi8(a, zero);
+				b = _mm_unpacklo_epi8(b, zero);
+
+				short colour0 = unpacked.ColourWeight[i], alpha0 = unpacked.AlphaWeight[i];
+				short colour1 = unpacked.ColourWeight[i + 1], alpha1 = unpacked.AlphaWeight[i + 1];
+				__m128i weight = _mm_setr_epi16(colour0, colour0, colour0, alpha0, colour1, colour1, colour1, alpha1);
+
+				__m128i sum = _mm_add_epi16(_mm_mullo_epi16(a, _mm_sub_epi16(full, weight)), _mm_mullo_epi16(b, weight));
+				pairs[half] = _mm_srli_epi16(_mm_add_epi16(sum, round), 6);
+			}
+			_mm_storeu_si128((__m128i*)(out + row * pitch), _mm_packus_epi16(pairs[0], pairs[1]));
+		}
+		RotateBc7(unpacked, out, pitch);
+	}
+#endif
+
+	void DecodeBlockScalar(BlockKind kind, bool isSigned, const unsigned char* block, unsigned char* out, size_t pitch)
+	{
+		uint32_t colours[4];
+		unsigned char channel[8];
+		unsigned char one = isSigned ? 127 : 255;
+
+		switch (kind)
+		{
+		case KindBC1:
+			ColourPalette(block, true, colours);
+			WriteColours(colours, ColourIndices(block), out, pitch);
+			break;
+
+		case KindBC2:
+			ColourPalette(block + 8, false, colours);
+			WriteColours(colours, ColourIndices(block + 8), out, pitch);
+			for (int i = 0; i < 16; ++i)
+			{
+				unsigned int alpha = (block[i >> 1] >> ((i & 1) * 4)) & 15;
+				out[(i >> 2) * pitch + (i & 3) * 4 + 3] = (unsigned char)(alpha * 17);
+			}
+			break;
+
+		case KindBC3:
+			ColourPalette(block + 8, false, colours);
+			WriteColours(colours, ColourIndices(block + 8), out, pitch);
+			ChannelPalette(block, false, channel);
+			WriteChannel(channel, ChannelIndices(block), out, pitch, 3);
+			break;
+
+		case KindBC4:
+		case KindBC5:
+			colours[0] = PackRGBA(0, 0, 0, one);
+			for (int row = 0; row < 4; ++row)
+			{
+				for (int x = 0; x < 4; ++x) memcpy(out + row * pitch + x * 4, &colours[0], 4);
+			}
+			ChannelPalette(block, isSigned, channel);
+			WriteChannel(channel, ChannelIndices(block), out, pitch, 0);
+			if (kind == KindBC5)
+			{
+				ChannelPalette(block + 8, isSigned, channel);
+				WriteChannel(channel, ChannelIndices(block + 8), out, pitch, 1);
+			}
+			break;
+
+		case KindBC6:
+			DecodeBc6(block, isSigned, out, pitch);
+			break;
+
+		case KindBC7:
+		{
+			Bc7Block unpacked;
+			if (UnpackBc7(block, unpacked))
+			{
+				WriteBc7(unpacked, out, pitch);
+			}
+			else
+			{
+				for (int row = 0; row < 4; ++row) memset(out + row * pitch, 0, 16);
+			}
+			break;
+		}
+
+		default:
+			break;
+		}
+	}
+
+	void DecodeBlockSimd(BlockKind kind, bool isSigned, const unsigned char* block, unsigned char* out, size_t pitch)
+	{
+#ifdef SIMD_SSE2
+		uint32_t colours[4];
+		unsigned char channel[8];
+
+		switch (kind)
+		{
+		case KindBC1:
+			ColourPalette(block, true, colours);
+			WriteColoursSSE2(colours, ColourIndices(block), out, pitch);
+			return;
+
+		case KindBC2:
+			ColourPalette(block + 8, false, colours);
+			WriteColoursSSE2(colours, ColourIndices(block + 8), out, pitch);
+			MergeAlphaSSE2(ExplicitAlphaSSE2(block), out, pitch);
+			return;
+
+		case KindBC3:
+			//The alpha stays scalar: an eight entry byte lookup costs more in SSE2 shuffles and selects than it saves
+			ColourPalette(block + 8, false, colours);
+			WriteColoursSSE2(colours, ColourIndices(block + 8), out, pitch);
+			ChannelPalette(block, false, channel);
+			WriteChannel(channel, ChannelIndices(block), out, pitch, 3);
+			return;
+
+		case KindBC7:
+		{
+			Bc7Block unpacked;
+			if (UnpackBc7(block, unpacked))
+			{
+				WriteBc7SSE2(unpacked, out, pitch);
+				return;
+			}
+			break;
+		}
+
+		default:
+			break;
+		}
+#endif
+		DecodeBlockScalar(kind, isSigned, block, out, pitch);
+	}
+}
+
+DXGI_FORMAT BlockDecoder::DecodedFormat(DXGI_FORMAT format)
+{
+	bool isSigned;
+	switch (Kind(format, isSigned))
+	{
+	case KindBC1:
+	case KindBC2:
+	case KindBC3:
+	case KindBC7:
+		return (format == DXGI_FORMAT_BC1_UNORM_SRGB || format == DXGI_FORMAT_BC2_UNORM_SRGB || format == DXGI_FORMAT_BC3_UNORM_SRGB ||
+			format == DXGI_FORMAT_BC7_UNORM_SRGB) ? DXGI_FORMAT_R8G8B8A8_UNORM_SRGB : DXGI_FORMAT_R8G8B8A8_UNORM;
+
+	case KindBC4:
+	case KindBC5:
+		return isSigned ? DXGI_FORMAT_R8G8B8A8_SNORM : DXGI_FORMAT_R8G8B8A8_UNORM;
+
+	case KindBC6:
+		return DXGI_FORMAT_R16G16B16A16_FLOAT;
+
+	default:
+		return DXGI_FORMAT_UNKNOWN;
+	}
+}
+
+size_t BlockDecoder::DecodedPixelSize(DXGI_FORMAT format)
+{
+	bool isSigned;
+	BlockKind kind = Kind(format, isSigned);
+	return (kind == KindNone) ? 0 : (kind == KindBC6) ? 8 : 4;
+}
+
+void BlockDecoder::DecodeBlock(DXGI_FORMAT format, const unsigned char* block, unsigned char* outPixels, size_t outPitch, bool simd)
+{
+	bool isSigned;
+	BlockKind kind = Kind(format, isSigned);
+	if (simd)
+	{
+		DecodeBlockSimd(kind, isSigned, block, outPixels, outPitch);
+	}
+	else
+	{
+		DecodeBlockScalar(kind, isSigned, block, outPixels, outPitch);
+	}
+}
+
+bool BlockDecoder::DecodeSurface(DXGI_FORMAT format, const unsigned char* blocks, uint32_t width, uint32_t height, unsigned char* outPixels,
+	size_t outPitch, ThreadPool* pool, bool simd)
+{
+	size_t pixelSize = DecodedPixelSize(format);
+	if (pixelSize == 0)
+	{
+		return false;
+	}
+
+	size_t blockSize = DDSFile::BytesPerElement(format);
+	unsigned int blocksWide = (width + 3) / 4;
+	unsigned int blocksHigh = (height + 3) / 4;
+
+	auto decodeRows = [&](unsigned int firstRow, unsigned int rowCount)
+	{
+		for (unsigned int by = firstRow; by < firstRow + rowCount && by < blocksHigh; ++by)
+		{
+			const unsigned char* block = blocks + (size_t)by * blocksWide * blockSize;
+			for (unsigned int bx = 0; bx < blocksWide; ++bx, block += blockSize)
+			{
+				unsigned int x = bx * 4, y = by * 4;
+				unsigned char* out = outPixels + y * outPitch + x * pixelSize;
+				if (x + 4 <= width && y + 4 <= height)
+				{
+					DecodeBlock(format, block, out, outPitch, simd);
+					continue;
+				}
+
+				//Past the right or bottom edge: decode the whole block aside and copy the part that's on the surface
+				unsigned char whole[4 * 4 * 8];
+				DecodeBlock(format, block, whole, 4 * pixelSize, simd);
+				unsigned int columns = (width - x < 4) ? width - x : 4;
+				unsigned int rows = (height - y < 4) ? height - y : 4;
+				for (unsigned int row = 0; row < rows; ++row)
+				{
+					memcpy(out + row * outPitch, whole + row * 4 * pixelSize, columns * pixelSize);
+				}
+			}
+		}
+	};
+
+	unsigned int rowsPerBatch = (blocksWide >= BatchBlocks) ? 1 : BatchBlocks / blocksWide;
+	unsigned int batchCount = (blocksHigh + rowsPerBatch - 1) / rowsPerBatch;
+	if (pool != nullptr && batchCount > 1)
+	{
+		pool->ParallelFor(batchCount, [&](unsigned int batch) { decodeRows(batch * rowsPerBatch, rowsPerBatch); });
+	}
+	else
+	{
+		decodeRows(0, blocksHigh);
+	}
+	return true;
+}
+
+bool BlockDecoder::Decode(const DDSFile::Texture& texture, uint32_t item, uint32_t mip, std::vector<unsigned char>& outPixels, ThreadPool* pool)
+{
+	size_t pixelSize = DecodedPixelSize(texture.Format);
+	if (pixelSize == 0 || item >= texture.ArraySize || mip >= texture.MipCount)
+	{
+		return false;
+	}
+
+	uint32_t width = DDSFile::MipSize(texture.Width, mip);
+	uint32_t height = DDSFile::MipSize(texture.Height, mip);
+	uint32_t depth = DDSFile::MipSize(texture.Depth, mip);
+	size_t sliceSize = DDSFile::SurfaceSize(texture.Format, width, height);
+	size_t decodedSliceSize = (size_t)width * height * pixelSize;
+
+	outPixels.resize(decodedSliceSize * depth);
+	const unsigned char* surface = DDSFile::Surface(texture, item, mip);
+	for (uint32_t slice = 0; slice < depth; ++slice)
+	{
+		DecodeSurface(texture.Format, surface + slice * sliceSize, width, height, outPixels.data() + slice * decodedSliceSize, width * pixelSize, pool);
+	}
+	return true;
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include "MeshTypes.h"
+#include "DDSFile.h"
+
+class ThreadPool;
+
+//Decompresses BC1-BC7 on the CPU, for devices that can't sample a format and for tools that need to look at or diff what's
+//in a texture. Each format decodes to the uncompressed format sampling it would give (DecodedFormat):
+//  BC1, BC2, BC3, BC7   R8G8B8A8_UNORM, or _SRGB for the sRGB ones (left encoded, the GPU converts when it samples)
+//  BC4, BC5             R8G8B8A8_UNORM or _SNORM, with the channels the block doesn't store as 0 and alpha as 1
+//  BC6H                 R16G16B16A16_FLOAT, alpha 1
+//Interpolated BC1-BC5 values are rounded to nearest, as the Direct3D spec describes them (hardware only promises to be
+//within 1 of that). BC6H and BC7 are exact. Reserved BC6H/BC7 modes decode to black, as they do on the GPU.
+//
+//BC1-BC3's colour lookups, BC2's alpha and BC7's interpolation are done a row at a time with SSE2. BC3's alpha, BC4 and BC5
+//are scalar: their eight entry lookups need SSSE3's byte shuffle to beat it. BC6H is scalar only, its interpolation needs
+//32 bit multiplies that SSE2 doesn't have
+namespace BlockDecoder
+{
+	//Surfaces of more blocks than this are decoded this many blocks' worth of rows at a time on the pool
+	const unsigned int BatchBlocks = 4096;
+
+	//What format gives to sampling, the format decoded pixels are in. DXGI_FORMAT_UNKNOWN if it isn't BC1-BC7
+	DXGI_FORMAT DecodedFormat(DXGI_FORMAT format);
+
+	//Bytes per decoded pixel: 4, or 8 for BC6H. 0 if it isn't BC1-BC7
+	size_t DecodedPixelSize(DXGI_FORMAT format);
+
+	//One block (DDSFile::BytesPerElement bytes) to 4 rows of 4 pixels, outPitch bytes apart. simd = false runs the scalar
+	//code, which the SIMD code must match bit for bit; it makes no difference without SSE2
+	void DecodeBlock(DXGI_FORMAT format, const unsigned char* block, unsigned char* outPixels, size_t outPitch, bool simd = true);
+
+	//A width x height surface of blocks, as DDSFile::Surface gives, to rows outPitch bytes apart. The pixels past the
+	//edge of partial blocks are left out. pool may be null to decode on the calling thread only. False if the format
+	//isn't BC1-BC7
+	bool DecodeSurface(DXGI_FORMAT format, const unsigned char* blocks, uint32_t width, uint32_t height, unsigned char* outPixels,
+		size_t outPitch, ThreadPool* pool, bool simd = true);
+
+	//One mip of one array item of a texture (every slice, for a volume), into a tightly packed outPixels
+	bool Decode(const DDSFile::Texture& texture, uint32_t item, uint32_t mip, std::vector<unsigned char>& outPixels, ThreadPool* pool);
+};
@@ -0,0 +1,1285 @@
+#include "BlockEncoder.h"
+#include "BlockTables.h"
+#include "ThreadPool.h"
+#include <limits.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace
+{
+	//Writes a 128 bit block from bit 0 up, the mirror of BlockDecoder's reader
+	struct BitWriter
+	{
+		uint64_t Low;
+		uint64_t High;
+		unsigned int Position;
+
+		BitWriter() : Low(0), High(0), Position(0) {}
+
+		void Write(unsigned int value, unsigned int count)
+		{
+			if (count == 0)
+			{
+				return;
+			}
+
+			uint64_t bits = value & ((1u << count) - 1);
+			if (Position >= 64)
+			{
+				High |= bits << (Position - 64);
+			}
+			else
+			{
+				Low |= bits << Position;
+				if (Position + count > 64) High |= bits >> (64 - Position);
+			}
+			Position += count;
+		}
+
+		void Store(unsigned char* out) const
+		{
+			memcpy(out, &Low, 8);
+			memcpy(out + 8, &High, 8);
+		}
+	};
+
+	enum BlockKind
+	{
+		KindBC1,
+		KindBC3,
+		KindBC5,
+		KindBC7,
+		KindNone,
+	};
+
+	BlockKind Kind(DXGI_FORMAT format)
+	{
+		switch (format)
+		{
+		case DXGI_FORMAT_BC1_TYPELESS: case DXGI_FORMAT_BC1_UNORM: case DXGI_FORMAT_BC1_UNORM_SRGB: return KindBC1;
+		case DXGI_FORMAT_BC3_TYPELESS: case DXGI_FORMAT_BC3_UNORM: case DXGI_FORMAT_BC3_UNORM_SRGB: return KindBC3;
+		case DXGI_FORMAT_BC5_TYPELESS: case DXGI_FORMAT_BC5_UNORM: return KindBC5;
+		case DXGI_FORMAT_BC7_TYPELESS: case DXGI_FORMAT_BC7_UNORM: case DXGI_FORMAT_BC7_UNORM_SRGB: return KindBC7;
+		default: return KindNone;
+		}
+	}
+
+	inline float Clamp255(float value)
+	{
+		return (value < 0.0f) ? 0.0f : (value > 255.0f) ? 255.0f : value;
+	}
+
+	inline int Square(int value)
+	{
+		return value * value;
+	}
+
+	//The largest eigenvalue of a covariance matrix and its eigenvector, by power iteration. Starting from the row of the
+	//channel that varies most keeps it clear of the axis' orthogonal complement. One iteration is plenty to compare how
+	//well lines fit, the axis itself takes more to settle
+	float PrincipalAxis(const float covariance[4][4], int channels, int iterations, float outAxis[4])
+	{
+		int widest = 0;
+		for (int c = 0; c < channels; ++c)
+		{
+			if (covariance[c][c] > covariance[widest][widest]) widest = c;
+		}
+		float start = 0.0f;
+		for (int c = 0; c < channels; ++c) start += covariance[widest][c] * covariance[widest][c];
+		start = (start > 1e-12f) ? 1.0f / sqrtf(start) : 0.0f;
+		for (int c = 0; c < channels; ++c) outAxis[c] = covariance[widest][c] * start;
+
+		float eigenvalue = 0.0f;
+		for (int iteration = 0; iteration < iterations; ++iteration)
+		{
+			float next[4] = {};
+			for (int r = 0; r < channels; ++r)
+			{
+				for (int c = 0; c < channels; ++c) next[r] += covariance[r][c] * outAxis[c];
+			}
+
+			float length = 0.0f;
+			for (int c = 0; c < channels; ++c) length += next[c] * next[c];
+			if (length < 1e-12f)
+			{
+				break;
+			}
+
+			//With the axis kept at unit length, how much the covariance stretches it converges on the eigenvalue
+			length = sqrtf(length);
+			for (int c = 0; c < channels; ++c) outAxis[c] = next[c] / length;
+			eigenvalue = length;
+		}
+		return eigenvalue;
+	}
+
+	//The best straight line through some points: their mean and the direction they spread furthest in
+	struct Line
+	{
+		float Mean[4];
+		float Axis[4];
+	};
+
+	Line FitLine(const float points[][4], int count, int channels)
+	{
+		Line line = {};
+		for (int i = 0; i < count; ++i)
+		{
+			for (int c = 0; c < channels; ++c) line.Mean[c] += points[i][c];
+		}
+		for (int c = 0; c < channels; ++c) line.Mean[c] /= (float)count;
+
+		float covariance[4][4] = {};
+		for (int i = 0; i < count; ++i)
+		{
+			float offset[4];
+			for (int c = 0; c < channels; ++c) offset[c] = points[i][c] - line.Mean[c];
+			for (int r = 0; r < channels; ++r)
+			{
+				for (int c = 0; c < channels; ++c) covariance[r][c] += offset[r] * offset[c];
+			}
+		}
+
+		PrincipalAxis(covariance, channels, 8, line.Axis);
+		return line;
+	}
+
+	//Sums of some pixels and of their products, which give their covariance without going back over them. Partitions
+	//are ranked by adding up the moments of the pixels in each subset rather than refitting every one from scratch.
+	//Integers, so taking one subset's from the block's leaves exactly the others'
+	struct Moments
+	{
+		int Count;
+		int Sum[4];
+		int Products[10];		//Upper triangle, row by row
+	};
+
+	void AddMoments(Moments& to, const Moments& from)
+	{
+		to.Count += from.Count;
+		for (int c = 0; c < 4; ++c) to.Sum[c] += from.Sum[c];
+		for (int c = 0; c < 10; ++c) to.Products[c] += from.Products[c];
+	}
+
+	void SubtractMoments(Moments& to, const Moments& from)
+	{
+		to.Count -= from.Count;
+		for (int c = 0; c < 4; ++c) to.Sum[c] -= from.Sum[c];
+		for (int c = 0; c < 10; ++c) to.Products[c] -= from.Products[c];
+	}
+
+	//How much of the pixels' spread a line leaves unexplained: 0 if they're all on it
+	float LineResidual(const Moments& moments, int channels)
+	{
+		if (moments.Count <= 1)
+		{
+			return 0.0f;
+		}
+
+		float covariance[4][4];
+		float trace = 0.0f;
+		for (int r = 0, product = 0; r < 4; ++r)
+		{
+			for (int c = r; c < 4; ++c, ++product)
+			{
+				if (c >= channels) continue;
+				covariance[r][c] = covariance[c][r] = moments.Products[product] - (float)moments.Sum[r] * moments.Sum[c] / moments.Count;
+			}
+			if (r < channels) trace += covariance[r][r];
+		}
+
+		float axis[4];
+		float eigenvalue = PrincipalAxis(covariance, channels, 1, axis);
+		return (trace > eigenvalue) ? trace - eigenvalue : 0.0f;
+	}
+
+	//Where the points start and end along the line
+	void LineEnds(const Line& line, const float points[][4], int count, int channels, float outStart[4], float outEnd[4])
+	{
+		float low = 0.0f, high = 0.0f;
+		for (int i = 0; i < count; ++i)
+		{
+			float t = 0.0f;
+			for (int c = 0; c < channels; ++c) t += (points[i][c] - line.Mean[c]) * line.Axis[c];
+			low = (t < low) ? t : low;
+			high = (t > high) ? t : high;
+		}
+
+		for (int c = 0; c < channels; ++c)
+		{
+			outStart[c] = Clamp255(line.Mean[c] + low * line.Axis[c]);
+			outEnd[c] = Clamp255(line.Mean[c] + high * line.Axis[c]);
+		}
+	}
+
+	//Endpoints that minimise the squared error of the points when point i is weights[i] of the way from start to end.
+	//False if every weight is the same, which leaves them undetermined
+	bool SolveEndpoints(const float points[][4], const float* weights, int count, int channels, float outStart[4], float outEnd[4])
+	{
+		float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+		float ax[4] = {}, bx[4] = {};
+		for (int i = 0; i < count; ++i)
+		{
+			float t = weights[i], s = 1.0f - t;
+			aa += s * s;
+			ab += s * t;
+			bb += t * t;
+			for (int c = 0; c < channels; ++c)
+			{
+				ax[c] += s * points[i][c];
+				bx[c] += t * points[i][c];
+			}
+		}
+
+		float determinant = aa * bb - ab * ab;
+		if (fabsf(determinant) < 1e-6f)
+		{
+			return false;
+		}
+
+		for (int c = 0; c < channels; ++c)
+		{
+			outStart[c] = Clamp255((ax[c] * bb - bx[c] * ab) / determinant);
+			outEnd[c] = Clamp255((bx[c] * aa - ax[c] * ab) / determinant);
+		}
+		return true;
+	}
+
+	//BC1-BC3 colour blocks
+
+	struct ColourResult
+	{
+		unsigned int Colour0;
+		unsigned int Colour1;
+		uint32_t Indices;
+		int Error;
+	};
+
+	inline void Expand565(unsigned int colour, int out[3])
+	{
+		int r = (colour >> 11) & 31, g = (colour >> 5) & 63, b = colour & 31;
+		out[0] = (r << 3) | (r >> 2);
+		out[1] = (g << 2) | (g >> 4);
+		out[2] = (b << 3) | (b >> 2);
+	}
+
+	inline unsigned int Pack565(const float colour[3])
+	{
+		unsigned int r = (unsigned int)(colour[0] * 31.0f / 255.0f + 0.5f);
+		unsigned int g = (unsigned int)(colour[1] * 63.0f / 255.0f + 0.5f);
+		unsigned int b = (unsigned int)(colour[2] * 31.0f / 255.0f + 0.5f);
+		return (r << 11) | (g << 5) | b;
+	}
+
+	//Indices and error for a pair of endpoints, against the palette the decoder makes of them. Transparent pixels (BC1
+	//only) need the black of a three colour block, opaque ones can't have it
+	ColourResult EvaluateColours(const int pixels[16][4], uint16_t transparent, bool bc1, unsigned int colour0, unsigned int colour1)
+	{
+		ColourResult result = { colour0, colour1, 0, 0 };
+		bool four = colour0 > colour1 || !bc1;
+		if (transparent != 0 && four)
+		{
+			result.Error = INT_MAX;
+			return result;
+		}
+
+		int a[3], b[3], palette[3][3];
+		Expand565(colour0, a);
+		Expand565(colour1, b);
+		for (int c = 0; c < 3; ++c)
+		{
+			palette[0][c] = a[c];
+			palette[1][c] = b[c];
+			palette[2][c] = four ? (2 * a[c] + b[c] + 1) / 3 : (a[c] + b[c] + 1) / 2;
+		}
+		int colourCount = four ? 4 : 3;
+		int fourth[3] = { (a[0] + 2 * b[0] + 1) / 3, (a[1] + 2 * b[1] + 1) / 3, (a[2] + 2 * b[2] + 1) / 3 };
+
+		for (int i = 0; i < 16; ++i)
+		{
+			if (transparent & (1 << i))
+			{
+				result.Indices |= 3u << (2 * i);
+				continue;
+			}
+
+			int bestIndex = 0, bestError = INT_MAX;
+			for (int k = 0; k < colourCount; ++k)
+			{
+				const int* entry = (k < 3) ? palette[k] : fourth;
+				int error = Square(entry[0] - pixels[i][0]) + Square(entry[1] - pixels[i][1]) + Square(entry[2] - pixels[i][2]);
+				if (error < bestError)
+				{
+					bestError = error;
+					bestIndex = k;
+				}
+			}
+			result.Indices |= (uint32_t)bestIndex << (2 * i);
+			result.Error += bestError;
+		}
+		return result;
+	}
+
+	//For each 8 bit value, the 5 (or 6) bit endpoints whose 2:1 mix, entry 2 of a four colour palette, comes closest to
+	//it. A block of one colour is then only ever off by what that mix can't reach, rather than by rounding to 5:6:5
+	struct SingleColourTables
+	{
+		uint8_t Five[256][2];
+		uint8_t Six[256][2];
+
+		SingleColourTables()
+		{
+			Build(5, Five);
+			Build(6, Six);
+		}
+
+		static void Build(int bits, uint8_t table[256][2])
+		{
+			int levels = 1 << bits;
+			for (int value = 0; value < 256; ++value)
+			{
+				int bestError = INT_MAX;
+				for (int a = 0; a < levels; ++a)
+				{
+					for (int b = 0; b < levels; ++b)
+					{
+						int expandedA = (a << (8 - bits)) | (a >> (2 * bits - 8));
+						int expandedB = (b << (8 - bits)) | (b >> (2 * bits - 8));
+						int error = abs((2 * expandedA + expandedB + 1) / 3 - value);
+						if (error < bestError)
+						{
+							bestError = error;
+							table[value][0] = (uint8_t)a;
+							table[value][1] = (uint8_t)b;
+						}
+					}
+				}
+			}
+		}
+	};
+
+	const SingleColourTables& SingleColour()
+	{
+		static const SingleColourTables tables;
+		return tables;
+	}
+
+	void StoreColours(const ColourResult& result, unsigned char* out)
+	{
+		out[0] = (unsigned char)result.Colour0;
+		out[1] = (unsigned char)(result.Colour0 >> 8);
+		out[2] = (unsigned char)result.Colour1;
+		out[3] = (unsigned char)(result.Colour1 >> 8);
+		memcpy(out + 4, &result.Indices, 4);
+	}
+
+	void EncodeColours(const int pixels[16][4], bool bc1, BlockEncoder::Quality quality, unsigned char* out)
+	{
+		uint16_t transparent = 0;
+		float points[16][4];
+		int count = 0;
+		bool solid = true;
+		for (int i = 0; i < 16; ++i)
+		{
+			if (bc1 && pixels[i][3] < 128)
+			{
+				transparent |= 1 << i;
+				continue;
+			}
+
+			for (int c = 0; c < 3; ++c)
+			{
+				points[count][c] = (float)pixels[i][c];
+				solid &= pixels[i][c] == (int)points[0][c];
+			}
+			++count;
+		}
+
+		if (count == 0)
+		{
+			ColourResult empty = { 0, 0, 0xFFFFFFFF, 0 };
+			StoreColours(empty, out);
+			return;
+		}
+
+		//Keeps the better of each candidate. Four colour blocks need colour0 > colour1 (BC1 only) and transparency
+		//needs the opposite; as the indices are picked afresh either order of a pair gives the same palette
+		ColourResult best = { 0, 0, 0, INT_MAX };
+		auto tryPair = [&](unsigned int colour0, unsigned int colour1, bool threeColours)
+		{
+			bool ascending = bc1 && (transparent != 0 || threeColours);
+			if ((colour0 < colour1) != ascending && colour0 != colour1)
+			{
+				unsigned int swap = colour0;
+				colour0 = colour1;
+				colour1 = swap;
+			}
+
+			ColourResult result = EvaluateColours(pixels, transparent, bc1, colour0, colour1);
+			if (result.Error < best.Error)
+			{
+				best = result;
+				return true;
+			}
+			return false;
+		};
+
+		if (solid && transparent == 0 && quality != BlockEncoder::QualityFast)
+		{
+			const SingleColourTables& tables = SingleColour();
+			int r = pixels[0][0], g = pixels[0][1], b = pixels[0][2];
+			tryPair((tables.Five[r][0] << 11) | (tables.Six[g][0] << 5) | tables.Five[b][0],
+				(tables.Five[r][1] << 11) | (tables.Six[g][1] << 5) | tables.Five[b][1], false);
+		}
+
+		float start[4], end[4];
+		Line line = FitLine(points, count, 3);
+		LineEnds(line, points, count, 3, start, end);
+		tryPair(Pack565(start), Pack565(end), false);
+		if (bc1 && transparent == 0 && quality == BlockEncoder::QualityHigh)
+		{
+			tryPair(Pack565(start), Pack565(end), true);
+		}
+
+		//Least squares endpoints for the indices the last best pair got, for as long as that keeps helping
+		int refinements = (quality == BlockEncoder::QualityFast) ? 0 : (quality == BlockEncoder::QualityNormal) ? 2 : 8;
+		for (int iteration = 0; iteration < refinements; ++iteration)
+		{
+			bool four = best.Colour0 > best.Colour1 || !bc1;
+			float weights[16];
+			for (int i = 0, point = 0; i < 16; ++i)
+			{
+				if (transparent & (1 << i)) continue;
+				unsigned int index = (best.Indices >> (2 * i)) & 3;
+				weights[point++] = (index < 2) ? (float)index : four ? (index == 2 ? 1.0f / 3.0f : 2.0f / 3.0f) : 0.5f;
+			}
+
+			if (!SolveEndpoints(points, weights, count, 3, start, end) || !tryPair(Pack565(start), Pack565(end), !four))
+			{
+				break;
+			}
+		}
+
+		//A step of one in any channel of either endpoint, while any of them helps
+		if (quality == BlockEncoder::QualityHigh)
+		{
+			static const unsigned int steps[3] = { 1u << 11, 1u << 5, 1u };
+			static const unsigned int masks[3] = { 31u << 11, 63u << 5, 31u };
+			for (int pass = 0; pass < 4; ++pass)
+			{
+				bool improved = false;
+				for (int endpoint = 0; endpoint < 2; ++endpoint)
+				{
+					for (int c = 0; c < 3; ++c)
+					{
+						for (int direction = 0; direction < 2; ++direction)
+						{
+							unsigned int colour = endpoint ? best.Colour1 : best.Colour0;
+							unsigned int field = colour & masks[c];
+							if ((direction == 0 && field == 0) || (direction == 1 && field == masks[c])) continue;
+
+							colour = direction ? colour + steps[c] : colour - steps[c];
+							bool three = bc1 && best.Colour0 <= best.Colour1;
+							improved |= endpoint ? tryPair(best.Colour0, colour, three) : tryPair(colour, best.Colour1, three);
+						}
+					}
+				}
+				if (!improved) break;
+			}
+		}
+
+		StoreColours(best, out);
+	}
+
+	//BC4 channels: BC3's alpha and each of BC5's
+
+	int EvaluateChannel(const int values[16], int a, int b, uint64_t& outIndices)
+	{
+		int palette[8] = { a, b };
+		if (a > b)
+		{
+			for (int i = 1; i < 7; ++i) palette[i + 1] = ((7 - i) * a + i * b + 3) / 7;
+		}
+		else
+		{
+			for (int i = 1; i < 5; ++i) palette[i + 1] = ((5 - i) * a + i * b + 2) / 5;
+			palette[6] = 0;
+			palette[7] = 255;
+		}
+
+		int total = 0;
+		outIndices = 0;
+		for (int i = 0; i < 16; ++i)
+		{
+			int bestIndex = 0, bestError = INT_MAX;
+			for (int k = 0; k < 8; ++k)
+			{
+				int error = Square(palette[k] - values[i]);
+				if (error < bestError)
+				{
+					bestError = error;
+					bestIndex = k;
+				}
+			}
+			outIndices |= (uint64_t)bestIndex << (3 * i);
+			total += bestError;
+		}
+		return total;
+	}
+
+	void EncodeChannel(const int values[16], BlockEncoder::Quality quality, unsigned char* out)
+	{
+		int low = 255, high = 0, innerLow = 255, innerHigh = 0;
+		for (int i = 0; i < 16; ++i)
+		{
+			low = (values[i] < low) ? values[i] : low;
+			high = (values[i] > high) ? values[i] : high;
+			if (values[i] != 0 && values[i] != 255)
+			{
+				innerLow = (values[i] < innerLow) ? values[i] : innerLow;
+				innerHigh = (values[i] > innerHigh) ? values[i] : innerHigh;
+			}
+		}
+
+		int bestA = low, bestB = low;
+		uint64_t bestIndices = 0;
+		int bestError = 0;
+		if (low != high)
+		{
+			auto tryPair = [&](int a, int b)
+			{
+				uint64_t indices;
+				int error = EvaluateChannel(values, a, b, indices);
+				if (error < bestError)
+				{
+					bestError = error;
+					bestA = a;
+					bestB = b;
+					bestIndices = indices;
+				}
+			};
+
+			//Eight values spanning the block, then six inside it with 0 and 255 exact when the block has either
+			bestError = INT_MAX;
+			tryPair(high, low);
+			if (quality != BlockEncoder::QualityFast && (low == 0 || high == 255))
+			{
+				tryPair(innerLow <= innerHigh ? innerLow : 0, innerLow <= innerHigh ? innerHigh : 0);
+			}
+
+			if (quality == BlockEncoder::QualityHigh)
+			{
+				int centreA = bestA, centreB = bestB;
+				for (int da = -2; da <= 2; ++da)
+				{
+					for (int db = -2; db <= 2; ++db)
+					{
+						int a = centreA + da, b = centreB + db;
+						if (a < 0 || a > 255 || b < 0 || b > 255 || ((a > b) != (centreA > centreB))) continue;
+						tryPair(a, b);
+					}
+				}
+			}
+		}
+
+		out[0] = (unsigned char)bestA;
+		out[1] = (unsigned char)bestB;
+		for (int i = 0; i < 6; ++i) out[2 + i] = (unsigned char)(bestIndices >> (8 * i));
+	}
+
+	//BC7
+
+	//Some of a block's channels, fitted to a pair of endpoints and indexed together: every stored channel for most modes,
+	//colour and alpha apart for modes 4 and 5
+	struct Bc7Part
+	{
+		int First;
+		int Count;
+		int Precision[4];
+		int PBits;				//0, 1 for each endpoint's own or 2 for one shared by both
+		int IndexBits;
+	};
+
+	struct Bc7PartFit
+	{
+		int Endpoints[2][4];
+		int PBits[2];
+		uint8_t Indices[16];
+		int Error;
+	};
+
+	struct Bc7Encoding
+	{
+		int Mode;
+		int Partition;
+		int Rotation;
+		int IndexSelection;
+		int Endpoints[6][4];
+		int PBits[6];
+		uint8_t ColourIndices[16];
+		uint8_t AlphaIndices[16];
+		int Error;
+	};
+
+	inline int Unquantize(int value, int precision, bool hasPBit, int pBit)
+	{
+		if (hasPBit)
+		{
+			value = (value << 1) | pBit;
+			++precision;
+		}
+		return (value << (8 - precision)) | (value >> (2 * precision - 8));
+	}
+
+	//The stored value, for a precision and p-bit, that expands closest to value
+	int Quantize(float value, int precision, bool hasPBit, int pBit)
+	{
+		int total = precision + (hasPBit ? 1 : 0);
+		float scaled = value * (float)((1 << total) - 1) / 255.0f;
+		int guess = hasPBit ? (int)floorf((scaled - pBit) * 0.5f + 0.5f) : (int)floorf(scaled + 0.5f);
+
+		int max = (1 << precision) - 1;
+		int best = 0;
+		float bestError = 1e30f;
+		for (int candidate = guess - 1; candidate <= guess + 1; ++candidate)
+		{
+			if (candidate < 0 || candidate > max) continue;
+			float error = fabsf((float)Unquantize(candidate, precision, hasPBit, pBit) - value);
+			if (error < bestError)
+			{
+				bestError = error;
+				best = candidate;
+			}
+		}
+		return best;
+	}
+
+	//Indices and error of members' pixels for endpoints already quantised into fit
+	void AssignIndices(const int pixels[16][4], const uint8_t* members, int count, const Bc7Part& part, Bc7PartFit& fit)
+	{
+		int ends[2][4];
+		for (int e = 0; e < 2; ++e)
+		{
+			for (int c = 0; c < part.Count; ++c)
+			{
+				ends[e][c] = Unquantize(fit.Endpoints[e][c], part.Precision[c], part.PBits != 0, fit.PBits[e]);
+			}
+		}
+
+		const uint8_t* weights = BlockTables::Weights(part.IndexBits);
+		int entries = 1 << part.IndexBits;
+		int palette[16][4];
+		for (int k = 0; k < entries; ++k)
+		{
+			for (int c = 0; c < part.Count; ++c)
+			{
+				palette[k][c] = (ends[0][c] * (64 - weights[k]) + ends[1][c] * weights[k] + 32) >> 6;
+			}
+		}
+
+		//The palette is (all but rounding) a line, so where a pixel projects onto it is within one entry of the nearest
+		float direction[4];
+		float lengthSquared = 0.0f;
+		for (int c = 0; c < part.Count; ++c)
+		{
+			direction[c] = (float)(ends[1][c] - ends[0][c]);
+			lengthSquared += direction[c] * direction[c];
+		}
+		float scale = (lengthSquared > 0.0f) ? (entries - 1) / lengthSquared : 0.0f;
+
+		fit.Error = 0;
+		for (int m = 0; m < count; ++m)
+		{
+			const int* pixel = pixels[members[m]] + part.First;
+			float t = 0.0f;
+			for (int c = 0; c < part.Count; ++c) t += (pixel[c] - ends[0][c]) * direction[c];
+			float position = t * scale;
+			int guess = (position <= 0.0f) ? 0 : (position >= entries - 1) ? entries - 1 : (int)(position + 0.5f);
+			int first = (guess > 0) ? guess - 1 : 0;
+			int last = (guess < entries - 1) ? guess + 1 : entries - 1;
+
+			int bestIndex = 0, bestError = INT_MAX;
+			for (int k = first; k <= last; ++k)
+			{
+				int error = 0;
+				for (int c = 0; c < part.Count; ++c) error += Square(palette[k][c] - pixel[c]);
+				if (error < bestError)
+				{
+					bestError = error;
+					bestIndex = k;
+				}
+			}
+			fit.Indices[members[m]] = (uint8_t)bestIndex;
+			fit.Error += bestError;
+		}
+	}
+
+	//How far the channels of an endpoint end up from where they should be once stored with a p-bit
+	float PBitError(const float end[4], const Bc7Part& part, int pBit)
+	{
+		float error = 0.0f;
+		for (int c = 0; c < part.Count; ++c)
+		{
+			int value = Unquantize(Quantize(end[c], part.Precision[c], true, pBit), part.Precision[c], true, pBit);
+			error += (value - end[c]) * (value - end[c]);
+		}
+		return error;
+	}
+
+	//Fits one subset (or the colour or alpha of a whole block, for modes 4 and 5). With everyPBit each choice of p-bits
+	//is tried against the pixels, otherwise each endpoint takes whichever rounds it closest
+	void FitPart(const int pixels[16][4], const uint8_t* members, int count, const Bc7Part& part, int refinements, bool everyPBit, Bc7PartFit& best)
+	{
+		float points[16][4];
+		for (int m = 0; m < count; ++m)
+		{
+			for (int c = 0; c < part.Count; ++c) points[m][c] = (float)pixels[members[m]][part.First + c];
+		}
+
+		float ends[2][4];
+		Line line = FitLine(points, count, part.Count);
+		LineEnds(line, points, count, part.Count, ends[0], ends[1]);
+
+		best.Error = INT_MAX;
+		int combinations = !everyPBit ? 1 : (part.PBits == 1) ? 4 : (part.PBits == 2) ? 2 : 1;
+		for (int iteration = 0; iteration <= refinements; ++iteration)
+		{
+			//Each p-bit choice the mode allows, with the endpoints rounded to what that choice can reach
+			bool improved = false;
+			for (int combination = 0; combination < combinations; ++combination)
+			{
+				Bc7PartFit candidate;
+				if (everyPBit || part.PBits == 0)
+				{
+					candidate.PBits[0] = combination & 1;
+					candidate.PBits[1] = (part.PBits == 1) ? combination >> 1 : candidate.PBits[0];
+				}
+				else if (part.PBits == 1)
+				{
+					for (int e = 0; e < 2; ++e) candidate.PBits[e] = (PBitError(ends[e], part, 1) < PBitError(ends[e], part, 0)) ? 1 : 0;
+				}
+				else
+				{
+					float errors[2];
+					for (int pBit = 0; pBit < 2; ++pBit) errors[pBit] = PBitError(ends[0], part, pBit) + PBitError(ends[1], part, pBit);
+					candidate.PBits[0] = candidate.PBits[1] = (errors[1] < errors[0]) ? 1 : 0;
+				}
+				for (int e = 0; e < 2; ++e)
+				{
+					for (int c = 0; c < part.Count; ++c)
+					{
+						candidate.Endpoints[e][c] = Quantize(ends[e][c], part.Precision[c], part.PBits != 0, candidate.PBits[e]);
+					}
+				}
+
+				AssignIndices(pixels, members, count, part, candidate);
+				if (candidate.Error < best.Error)
+				{
+					best = candidate;
+					improved = true;
+				}
+			}
+
+			if (!improved || best.Error == 0 || iteration == refinements)
+			{
+				break;
+			}
+
+			float weights[16];
+			const uint8_t* table = BlockTables::Weights(part.IndexBits);
+			for (int m = 0; m < count; ++m) weights[m] = table[best.Indices[members[m]]] / 64.0f;
+			if (!SolveEndpoints(points, weights, count, part.Count, ends[0], ends[1]))
+			{
+				break;
+			}
+		}
+	}
+
+	inline unsigned int SubsetOf(int subsets, int partition, int pixel)
+	{
+		if (subsets == 2) return (BlockTables::Partitions2[partition] >> pixel) & 1;
+		if (subsets == 3) return (BlockTables::Partitions3[partition] >> (2 * pixel)) & 3;
+		return 0;
+	}
+
+	inline int AnchorOf(int subsets, int partition, int subset)
+	{
+		if (subset == 0) return 0;
+		if (subsets == 2) return BlockTables::Anchors2[partition];
+		return (subset == 1) ? BlockTables::Anchors3Second[partition] : BlockTables::Anchors3Third[partition];
+	}
+
+	void EncodeBc7Mode(const int source[16][4], int mode, int partition, int rotation, int indexSelection, int refinements, bool everyPBit,
+		Bc7Encoding& out)
+	{
+		const BlockTables::Bc7Mode& info = BlockTables::Bc7Modes[mode];
+		out.Mode = mode;
+		out.Partition = partition;
+		out.Rotation = rotation;
+		out.IndexSelection = indexSelection;
+		out.Error = 0;
+
+		//Rotated the way the decoder will rotate back, so the channel swapped into alpha gets alpha's precision
+		int pixels[16][4];
+		memcpy(pixels, source, sizeof(pixels));
+		if (rotation != 0)
+		{
+			for (int i = 0; i < 16; ++i)
+			{
+				int swap = pixels[i][rotation - 1];
+				pixels[i][rotation - 1] = pixels[i][3];
+				pixels[i][3] = swap;
+			}
+		}
+
+		Bc7PartFit fit;
+		if (info.SecondaryIndexBits == 0)
+		{
+			Bc7Part part = { 0, info.AlphaBits ? 4 : 3, { info.ColourBits, info.ColourBits, info.ColourBits, info.AlphaBits },
+				info.EndpointPBits ? 1 : info.SharedPBits ? 2 : 0, info.IndexBits };
+
+			for (int subset = 0; subset < info.Subsets; ++subset)
+			{
+				uint8_t members[16];
+				int count = 0;
+				for (int i = 0; i < 16; ++i)
+				{
+					if ((int)SubsetOf(info.Subsets, partition, i) == subset) members[count++] = (uint8_t)i;
+				}
+
+				FitPart(pixels, members, count, part, refinements, everyPBit, fit);
+				for (int e = 0; e < 2; ++e)
+				{
+					memcpy(out.Endpoints[subset * 2 + e], fit.Endpoints[e], sizeof(fit.Endpoints[e]));
+					out.PBits[subset * 2 + e] = fit.PBits[e];
+				}
+				for (int m = 0; m < count; ++m) out.ColourIndices[members[m]] = out.AlphaIndices[members[m]] = fit.Indices[members[m]];
+				out.Error += fit.Error;
+			}
+
+			//Modes without alpha decode it as 255
+			if (info.AlphaBits == 0)
+			{
+				for (int i = 0; i < 16; ++i) out.Error += Square(255 - pixels[i][3]);
+			}
+			return;
+		}
+
+		//Modes 4 and 5: colour and alpha fitted and indexed apart, index selection swapping which gets the wider indices
+		static const uint8_t all[16] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 };
+		Bc7Part colour = { 0, 3, { info.ColourBits, info.ColourBits, info.ColourBits }, 0, indexSelection ? info.SecondaryIndexBits : info.IndexBits };
+		Bc7Part alpha = { 3, 1, { info.AlphaBits }, 0, indexSelection ? info.IndexBits : info.SecondaryIndexBits };
+
+		FitPart(pixels, all, 16, colour, refinements, everyPBit, fit);
+		for (int e = 0; e < 2; ++e)
+		{
+			memcpy(out.Endpoints[e], fit.Endpoints[e], 3 * sizeof(int));
+			out.PBits[e] = 0;
+		}
+		memcpy(out.ColourIndices, fit.Indices, 16);
+		out.Error += fit.Error;
+
+		FitPart(pixels, all, 16, alpha, refinements, everyPBit, fit);
+		for (int e = 0; e < 2; ++e) out.Endpoints[e][3] = fit.Endpoints[e][0];
+		memcpy(out.AlphaIndices, fit.Indices, 16);
+		out.Error += fit.Error;
+	}
+
+	void PackBc7(const Bc7Encoding& source, unsigned char* out)
+	{
+		const BlockTables::Bc7Mode& info = BlockTables::Bc7Modes[source.Mode];
+		Bc7Encoding encoding = source;
+		bool separate = info.SecondaryIndexBits != 0;
+		int colourBits = (separate && encoding.IndexSelection) ? info.SecondaryIndexBits : info.IndexBits;
+		int alphaBits = separate ? (encoding.IndexSelection ? info.IndexBits : info.SecondaryIndexBits) : info.IndexBits;
+
+		//Each anchor pixel's top index bit isn't stored, it has to be 0: where it isn't, swap the endpoints and flip the
+		//indices, which gives exactly the same palette the other way round
+		for (int subset = 0; subset < info.Subsets; ++subset)
+		{
+			int anchor = AnchorOf(info.Subsets, encoding.Partition, subset);
+			int colourMax = (1 << colourBits) - 1;
+			if (encoding.ColourIndices[anchor] > colourMax / 2)
+			{
+				int channels = separate ? 3 : 4;
+				for (int c = 0; c < channels; ++c)
+				{
+					int swap = encoding.Endpoints[subset * 2][c];
+					encoding.Endpoints[subset * 2][c] = encoding.Endpoints[subset * 2 + 1][c];
+					encoding.Endpoints[subset * 2 + 1][c] = swap;
+				}
+				int swap = encoding.PBits[subset * 2];
+				encoding.PBits[subset * 2] = encoding.PBits[subset * 2 + 1];
+				encoding.PBits[subset * 2 + 1] = swap;
+
+				for (int i = 0; i < 16; ++i)
+				{
+					if ((int)SubsetOf(info.Subsets, encoding.Partition, i) != subset) continue;
+					encoding.ColourIndices[i] = (uint8_t)(colourMax - encoding.ColourIndices[i]);
+					if (!separate) encoding.AlphaIndices[i] = encoding.ColourIndices[i];
+				}
+			}
+		}
+
+		if (separate && encoding.AlphaIndices[0] > ((1 << alphaBits) - 1) / 2)
+		{
+			int swap = encoding.Endpoints[0][3];
+			encoding.Endpoints[0][3] = encoding.Endpoints[1][3];
+			encoding.Endpoints[1][3] = swap;
+			for (int i = 0; i < 16; ++i) encoding.AlphaIndices[i] = (uint8_t)((1 << alphaBits) - 1 - encoding.AlphaIndices[i]);
+		}
+
+		BitWriter bits;
+		bits.Write(1u << encoding.Mode, encoding.Mode + 1);
+		bits.Write(encoding.Partition, info.PartitionBits);
+		bits.Write(encoding.Rotation, info.RotationBits);
+		bits.Write(encoding.IndexSelection, info.IndexSelectionBits);
+
+		int endpointCount = info.Subsets * 2;
+		for (int c = 0; c < 4; ++c)
+		{
+			int precision = (c < 3) ? info.ColourBits : info.AlphaBits;
+			for (int e = 0; e < endpointCount; ++e) bits.Write(encoding.Endpoints[e][c], precision);
+		}
+
+		for (int e = 0; e < endpointCount; ++e)
+		{
+			if (info.EndpointPBits) bits.Write(encoding.PBits[e], 1);
+			else if (info.SharedPBits && (e & 1) == 0) bits.Write(encoding.PBits[e], 1);
+		}
+
+		const uint8_t* primary = (separate && encoding.IndexSelection) ? encoding.AlphaIndices : encoding.ColourIndices;
+		for (int i = 0; i < 16; ++i)
+		{
+			bool anchor = i == AnchorOf(info.Subsets, encoding.Partition, SubsetOf(info.Subsets, encoding.Partition, i));
+			bits.Write(primary[i], info.IndexBits - (anchor ? 1 : 0));
+		}
+
+		if (separate)
+		{
+			const uint8_t* secondary = encoding.IndexSelection ? encoding.ColourIndices : encoding.AlphaIndices;
+			for (int i = 0; i < 16; ++i) bits.Write(secondary[i], info.SecondaryIndexBits - (i == 0 ? 1 : 0));
+		}
+
+		bits.Store(out);
+	}
+
+	//The 'wanted' partitions of a 2 or 3 subset layout whose subsets each lie closest to a line, best first
+	int RankPartitions(const int pixels[16][4], int subsets, int partitionCount, int channels, int wanted, int* outPartitions)
+	{
+		Moments pixelMoments[16];
+		Moments total = {};
+		for (int i = 0; i < 16; ++i)
+		{
+			Moments& moments = pixelMoments[i];
+			moments.Count = 1;
+			for (int r = 0, product = 0; r < 4; ++r)
+			{
+				moments.Sum[r] = pixels[i][r];
+				for (int c = r; c < 4; ++c, ++product) moments.Products[product] = pixels[i][r] * pixels[i][c];
+			}
+			AddMoments(total, moments);
+		}
+
+		float residuals[64];
+		int ranked = 0;
+		for (int partition = 0; partition < partitionCount; ++partition)
+		{
+			//Subset 0 is whatever the others leave
+			Moments subsetMoments[3] = {};
+			for (int i = 0; i < 16; ++i)
+			{
+				unsigned int subset = SubsetOf(subsets, partition, i);
+				if (subset != 0) AddMoments(subsetMoments[subset], pixelMoments[i]);
+			}
+			subsetMoments[0] = total;
+			for (int subset = 1; subset < subsets; ++subset) SubtractMoments(subsetMoments[0], subsetMoments[subset]);
+
+			float residual = 0.0f;
+			for (int subset = 0; subset < subsets; ++subset) residual += LineResidual(subsetMoments[subset], channels);
+
+			//Insertion into the short sorted list so far
+			int position = (ranked < wanted) ? ranked++ : wanted;
+			while (position > 0 && residuals[position - 1] > residual)
+			{
+				if (position < wanted)
+				{
+					residuals[position] = residuals[position - 1];
+					outPartitions[position] = outPartitions[position - 1];
+				}
+				--position;
+			}
+			if (position < wanted)
+			{
+				residuals[position] = residual;
+				outPartitions[position] = partition;
+			}
+		}
+		return ranked;
+	}
+
+	void EncodeBc7(const int pixels[16][4], BlockEncoder::Quality quality, unsigned char* out)
+	{
+		//Every mode, partition and rotation tried gets a quick fit with no refinement, then only the best few of those are
+		//fitted properly
+		struct Effort
+		{
+			unsigned int Modes;
+			int Partitions;
+			int Finalists;
+			int Refinements;
+			bool Rotations;
+			bool EveryPBit;
+		};
+		static const Effort efforts[3] =
+		{
+			{ 1u << 6, 1, 1, 1, false, false },
+			{ (1u << 1) | (1u << 3) | (1u << 5) | (1u << 6) | (1u << 7), 2, 2, 2, false, false },
+			{ 0xFF, 8, 4, 4, true, true },
+		};
+		const Effort& effort = efforts[quality];
+
+		bool opaque = true;
+		for (int i = 0; i < 16; ++i) opaque &= pixels[i][3] == 255;
+		int channels = opaque ? 3 : 4;
+
+		int twoSubsets[8], threeSubsets[8], threeSubsetsMode0[8];
+		int twoCount = 0, threeCount = 0, threeMode0Count = 0;
+		if (effort.Modes & ((1u << 1) | (1u << 3) | (1u << 7))) twoCount = RankPartitions(pixels, 2, 64, channels, effort.Partitions, twoSubsets);
+		if (effort.Modes & (1u << 2)) threeCount = RankPartitions(pixels, 3, 64, channels, effort.Partitions, threeSubsets);
+		if (effort.Modes & (1u << 0)) threeMode0Count = RankPartitions(pixels, 3, 16, channels, effort.Partitions, threeSubsetsMode0);
+
+		Bc7Encoding best;
+		best.Error = INT_MAX;
+		Bc7Encoding candidate;
+		Bc7Encoding finalists[4];
+		int finalistCount = 0;
+		auto tryMode = [&](int mode, int partition, int rotation, int indexSelection)
+		{
+			if (best.Error == 0) return;
+			EncodeBc7Mode(pixels, mode, partition, rotation, indexSelection, (effort.Finalists > 1) ? 0 : effort.Refinements, false, candidate);
+			if (candidate.Error < best.Error) best = candidate;
+
+			//Kept in order, best first
+			int position = (finalistCount < effort.Finalists) ? finalistCount++ : effort.Finalists;
+			while (position > 0 && finalists[position - 1].Error > candidate.Error)
+			{
+				if (position < effort.Finalists) finalists[position] = finalists[position - 1];
+				--position;
+			}
+			if (position < effort.Finalists) finalists[position] = candidate;
+		};
+
+		for (int mode = 7; mode >= 0; --mode)
+		{
+			const BlockTables::Bc7Mode& info = BlockTables::Bc7Modes[mode];
+			if (!(effort.Modes & (1u << mode)) || (!opaque && info.AlphaBits == 0))
+			{
+				continue;
+			}
+
+			if (info.Subsets > 1)
+			{
+				const int* partitions = (info.Subsets == 2) ? twoSubsets : (mode == 0) ? threeSubsetsMode0 : threeSubsets;
+				int partitionCount = (info.Subsets == 2) ? twoCount : (mode == 0) ? threeMode0Count : threeCount;
+				for (int p = 0; p < partitionCount; ++p) tryMode(mode, partitions[p], 0, 0);
+			}
+			else
+			{
+				int rotations = (effort.Rotations && info.RotationBits) ? 4 : 1;
+				int selections = (effort.Rotations && info.IndexSelectionBits) ? 2 : 1;
+				for (int rotation = 0; rotation < rotations; ++rotation)
+				{
+					for (int selection = 0; selection < selections; ++selection) tryMode(mode, 0, rotation, selection);
+				}
+			}
+		}
+
+		if (effort.Finalists > 1)
+		{
+			for (int f = 0; f < finalistCount && best.Error != 0; ++f)
+			{
+				const Bc7Encoding& finalist = finalists[f];
+				EncodeBc7Mode(pixels, finalist.Mode, finalist.Partition, finalist.Rotation, finalist.IndexSelection, effort.Refinements, effort.EveryPBit,
+					candidate);
+				if (candidate.Error < best.Error) best = candidate;
+			}
+		}
+
+		PackBc7(best, out);
+	}
+}
+
+bool BlockEncoder::CanEncode(DXGI_FORMAT format)
+{
+	return Kind(format) != KindNone;
+}
+
+void BlockEncoder::EncodeBlock(DXGI_FORMAT format, const unsigned char* pixels, size_t pitch, unsigned char* outBlock, Quality quality)
+{
+	int block[16][4];
+	for (int i = 0; i < 16; ++i)
+	{
+		const unsigned char* pixel = pixels + (i >> 2) * pitch + (i & 3) * 4;
+		for (int c = 0; c < 4; ++c) block[i][c] = pixel[c];
+	}
+
+	int channel[16];
+	switch (Kind(format))
+	{
+	case KindBC1:
+		EncodeColours(block, true, quality, outBlock);
+		break;
+
+	case KindBC3:
+		for (int i = 0; i < 16; ++i) channel[i] = block[i][3];
+		EncodeChannel(channel, quality, outBlock);
+		EncodeColours(block, false, quality, outBlock + 8);
+		break;
+
+	case KindBC5:
+		for (int c = 0; c < 2; ++c)
+		{
+			for (int i = 0; i < 16; ++i) channel[i] = block[i][c];
+			EncodeChannel(channel, quality, outBlock + c * 8);
+		}
+		break;
+
+	case KindBC7:
+		EncodeBc7(block, quality, outBlock);
+		break;
+
+	default:
+		break;
+	}
+}
+
+bool BlockEncoder::EncodeSurface(DXGI_FORMAT format, const unsigned char* pixels, uint32_t width, uint32_t height, size_t pitch,
+	unsigned char* outBlocks, ThreadPool* pool, Quality quality)
+{
+	if (!CanEncode(format))
+	{
+		return false;
+	}
+
+	size_t blockSize = DDSFile::BytesPerElement(format);
+	unsigned int blocksWide = (width + 3) / 4;
+	unsigned int blocksHigh = (height + 3) / 4;
+
+	auto encodeRows = [&](unsigned int firstRow, unsigned int rowCount)
+	{
+		for (unsigned int by = firstRow; by < firstRow + rowCount && by < blocksHigh; ++by)
+		{
+			unsigned char* block = outBlocks + (size_t)by * blocksWide * blockSize;
+			for (unsigned int bx = 0; bx < blocksWide; ++bx, block += blockSize)
+			{
+				unsigned int x = bx * 4, y = by * 4;
+				if (x + 4 <= width && y + 4 <= height)
+				{
+					EncodeBlock(format, pixels + y * pitch + x * 4, pitch, block, quality);
+					continue;
+				}
+
+				//Past the right or bottom edge: the nearest pixel on the surface stands in, so it costs the rest nothing
+				unsigned char whole[4 * 4 * 4];
+				for (unsigned int row = 0; row < 4; ++row)
+				{
+					unsigned int sourceY = (y + row < height) ? y + row : height - 1;
+					for (unsigned int column = 0; column < 4; ++column)
+					{
+						unsigned int sourceX = (x + column < width) ? x + column : width - 1;
+						memcpy(whole + row * 16 + column * 4, pixels + sourceY * pitch + sourceX * 4, 4);
+					}
+				}
+				EncodeBlock(format, whole, 16, block, quality);
+			}
+		}
+	};
+
+	unsigned int rowsPerBatch = (blocksWide >= BatchBlocks) ? 1 : BatchBlocks / blocksWide;
+	unsigned int batchCount = (blocksHigh + rowsPerBatch - 1) / rowsPerBatch;
+	if (pool != nullptr && batchCount > 1)
+	{
+		pool->ParallelFor(batchCount, [&](unsigned int batch) { encodeRows(batch * rowsPerBatch, rowsPerBatch); });
+	}
+	else
+	{
+		encodeRows(0, blocksHigh);
+	}
+	return true;
+}
+
+bool BlockEncoder::Encode(const DDSFile::Texture& source, DXGI_FORMAT format, Quality quality, std::vector<unsigned char>& outBits,
+	DDSFile::Texture& outTexture, ThreadPool* pool)
+{
+	bool bgra = false, opaque = false;
+	switch (source.Format)
+	{
+	case DXGI_FORMAT_R8G8B8A8_TYPELESS: case DXGI_FORMAT_R8G8B8A8_UNORM: case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+		break;
+	case DXGI_FORMAT_B8G8R8A8_TYPELESS: case DXGI_FORMAT_B8G8R8A8_UNORM: case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+		bgra = true;
+		break;
+	case DXGI_FORMAT_B8G8R8X8_TYPELESS: case DXGI_FORMAT_B8G8R8X8_UNORM: case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:
+		bgra = opaque = true;
+		break;
+	default:
+		return false;
+	}
+
+	if (!CanEncode(format))
+	{
+		return false;
+	}
+
+	DDSFile::Texture texture = source;
+	texture.Format = format;
+	texture.BitSize = 0;
+	for (uint32_t mip = 0; mip < texture.MipCount; ++mip)
+	{
+		texture.BitSize += DDSFile::SurfaceSize(format, DDSFile::MipSize(texture.Width, mip), DDSFile::MipSize(texture.Height, mip)) *
+			DDSFile::MipSize(texture.Depth, mip);
+	}
+	texture.BitSize *= texture.ArraySize;
+	outBits.resize(texture.BitSize);
+	texture.Bits = outBits.data();
+
+	//Surfaces come out in the same order they go in, each array item's mips in turn
+	std::vector<unsigned char> rgba;
+	unsigned char* out = outBits.data();
+	for (uint32_t item = 0; item < source.ArraySize; ++item)
+	{
+		for (uint32_t mip = 0; mip < source.MipCount; ++mip)
+		{
+			uint32_t width = DDSFile::MipSize(source.Width, mip);
+			uint32_t height = DDSFile::MipSize(source.Height, mip);
+			uint32_t depth = DDSFile::MipSize(source.Depth, mip);
+			size_t sliceSize = (size_t)width * height * 4;
+			const unsigned char* pixels = DDSFile::Surface(source, item, mip);
+
+			for (uint32_t slice = 0; slice < depth; ++slice, pixels += sliceSize)
+			{
+				const unsigned char* slicePixels = pixels;
+				if (bgra)
+				{
+					rgba.assign(pixels, pixels + sliceSize);
+					for (size_t i = 0; i < sliceSize; i += 4)
+					{
+						unsigned char swap = rgba[i];
+						rgba[i] = rgba[i + 2];
+						rgba[i + 2] = swap;
+						if (opaque) rgba[i + 3] = 255;
+					}
+					slicePixels = rgba.data();
+				}
+
+				EncodeSurface(format, slicePixels, width, height, width * 4, out, pool, quality);
+				out += DDSFile::SurfaceSize(format, width, height);
+			}
+		}
+	}
+
+	outTexture = texture;
+	return true;
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include "MeshTypes.h"
+#include "DDSFile.h"
+
+class ThreadPool;
+
+//Compresses 8 bit RGBA to BC1, BC3, BC5 and BC7 for the texture cooking tool (TextureBuild). Every block is fitted the
+//same way: endpoints along the principal axis of its pixels, indices picked against the exact palette the decoder
+//(and the GPU) builds from them, then endpoints re-solved by least squares for those indices and rounded again. Quality
+//decides how far that goes:
+//  Fast     one fit, BC7 in mode 6 only
+//  Normal   a few refinements, BC1 solid colours looked up exactly, BC4 channels also try the 0/255 palette, BC7 in
+//           modes 1, 3, 5, 6 and 7 over the two partitions that look best
+//  High     refines until it stops helping then nudges each endpoint, BC1 also tries three colour blocks, BC7 tries
+//           every mode, rotation and index selection over the eight best partitions
+//BC7's Normal and High give every mode and partition they try a quick fit first, and only refine the best few of those.
+//Blocks are independent, so surfaces are spread over the pool a batch of block rows at a time. sRGB formats are encoded
+//as they're stored; the error being minimised is plain squared difference in those values
+namespace BlockEncoder
+{
+	enum Quality
+	{
+		QualityFast,
+		QualityNormal,
+		QualityHigh,
+	};
+
+	//Surfaces of more blocks than this are encoded this many blocks' worth of rows at a time on the pool
+	const unsigned int BatchBlocks = 256;
+
+	//BC1, BC3, BC5 (unsigned) and BC7, typeless and sRGB included
+	bool CanEncode(DXGI_FORMAT format);
+
+	//4 rows of 4 RGBA8 pixels, pitch bytes apart, to one block (DDSFile::BytesPerElement bytes). BC5 takes red and green.
+	//BC1 makes pixels with alpha under 128 transparent black, so only cutouts keep their alpha
+	void EncodeBlock(DXGI_FORMAT format, const unsigned char* pixels, size_t pitch, unsigned char* outBlock, Quality quality);
+
+	//A width x height RGBA8 surface with rows pitch bytes apart to DDSFile::SurfaceSize bytes of blocks. Blocks past the
+	//right or bottom edge repeat the edge pixels. pool may be null to encode on the calling thread only. False if the
+	//format can't be encoded
+	bool EncodeSurface(DXGI_FORMAT format, const unsigned char* pixels, uint32_t width, uint32_t height, size_t pitch, unsigned char* outBlocks,
+		ThreadPool* pool, Quality quality);
+
+	//Every surface of an 8 bit RGBA or BGRA texture to 'format'. outTexture describes the result, with its bits in outBits.
+	//False if the source isn't 8 bit RGBA/BGRA or the format can't be encoded
+	bool Encode(const DDSFile::Texture& source, DXGI_FORMAT format, Quality quality, std::vector<unsigned char>& outBits,
+		DDSFile::Texture& outTexture, ThreadPool* pool);
+};
@@ -0,0 +1,298 @@
+#include "DDSFile.h"
+#include "MappedFile.h"
+#include <fstream>
+#include <string.h>
+
+namespace
+{
+	inline uint32_t FourCC(char a, char b, char c, char d)
+	{
+		return (uint32_t)(uint8_t)a | ((uint32_t)(uint8_t)b << 8) | ((uint32_t)(uint8_t)c << 16) | ((uint32_t)(uint8_t)d << 24);
+	}
+
+	//Older files describe their format with a FourCC or channel masks rather than a DX10 header
+	DXGI_FORMAT LegacyFormat(const DDSFile::PixelFormat& format)
+	{
+		if (format.Flags & DDSFile::PixelFormatFourCC)
+		{
+			if (format.FourCC == FourCC('D', 'X', 'T', '1')) return DXGI_FORMAT_BC1_UNORM;
+			if (format.FourCC == FourCC('D', 'X', 'T', '2') || format.FourCC == FourCC('D', 'X', 'T', '3')) return DXGI_FORMAT_BC2_UNORM;
+			if (format.FourCC == FourCC('D', 'X', 'T', '4') || format.FourCC == FourCC('D', 'X', 'T', '5')) return DXGI_FORMAT_BC3_UNORM;
+			if (format.FourCC == FourCC('A', 'T', 'I', '1') || format.FourCC == FourCC('B', 'C', '4', 'U')) return DXGI_FORMAT_BC4_UNORM;
+			if (format.FourCC == FourCC('B', 'C', '4', 'S')) return DXGI_FORMAT_BC4_SNORM;
+			if (format.FourCC == FourCC('A', 'T', 'I', '2') || format.FourCC == FourCC('B', 'C', '5', 'U')) return DXGI_FORMAT_BC5_UNORM;
+			if (format.FourCC == FourCC('B', 'C', '5', 'S')) return DXGI_FORMAT_BC5_SNORM;
+		}
+		else if ((format.Flags & DDSFile::PixelFormatRGB) && format.RGBBitCount == 32)
+		{
+			if (format.RBitMask == 0x000000ff && format.GBitMask == 0x0000ff00 && format.BBitMask == 0x00ff0000 && format.ABitMask == 0xff000000)
+			{
+				return DXGI_FORMAT_R8G8B8A8_UNORM;
+			}
+			if (format.RBitMask == 0x00ff0000 && format.GBitMask == 0x0000ff00 && format.BBitMask == 0x000000ff && format.ABitMask == 0xff000000)
+			{
+				return DXGI_FORMAT_B8G8R8A8_UNORM;
+			}
+			if (format.RBitMask == 0x00ff0000 && format.GBitMask == 0x0000ff00 && format.BBitMask == 0x000000ff && format.ABitMask == 0)
+			{
+				return DXGI_FORMAT_B8G8R8X8_UNORM;
+			}
+		}
+
+		return DXGI_FORMAT_UNKNOWN;
+	}
+
+	//Direct3D 11's limits, which also keep the size sums below from overflowing on a corrupt header
+	const uint32_t MaxDimension = 16384;
+	const uint32_t MaxVolumeDimension = 2048;
+	const uint32_t MaxArraySize = 2048;
+}
+
+bool DDSFile::IsCompressed(DXGI_FORMAT format)
+{
+	return (format >= DXGI_FORMAT_BC1_TYPELESS && format <= DXGI_FORMAT_BC5_SNORM) ||
+		(format >= DXGI_FORMAT_BC6H_TYPELESS && format <= DXGI_FORMAT_BC7_UNORM_SRGB);
+}
+
+size_t DDSFile::BytesPerElement(DXGI_FORMAT format)
+{
+	switch (format)
+	{
+	case DXGI_FORMAT_BC1_TYPELESS:
+	case DXGI_FORMAT_BC1_UNORM:
+	case DXGI_FORMAT_BC1_UNORM_SRGB:
+	case DXGI_FORMAT_BC4_TYPELESS:
+	case DXGI_FORMAT_BC4_UNORM:
+	case DXGI_FORMAT_BC4_SNORM:
+		return 8;
+
+	case DXGI_FORMAT_BC2_TYPELESS:
+	case DXGI_FORMAT_BC2_UNORM:
+	case DXGI_FORMAT_BC2_UNORM_SRGB:
+	case DXGI_FORMAT_BC3_TYPELESS:
+	case DXGI_FORMAT_BC3_UNORM:
+	case DXGI_FORMAT_BC3_UNORM_SRGB:
+	case DXGI_FORMAT_BC5_TYPELESS:
+	case DXGI_FORMAT_BC5_UNORM:
+	case DXGI_FORMAT_BC5_SNORM:
+	case DXGI_FORMAT_BC6H_TYPELESS:
+	case DXGI_FORMAT_BC6H_UF16:
+	case DXGI_FORMAT_BC6H_SF16:
+	case DXGI_FORMAT_BC7_TYPELESS:
+	case DXGI_FORMAT_BC7_UNORM:
+	case DXGI_FORMAT_BC7_UNORM_SRGB:
+		return 16;
+
+	case DXGI_FORMAT_R8G8B8A8_TYPELESS:
+	case DXGI_FORMAT_R8G8B8A8_UNORM:
+	case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+	case DXGI_FORMAT_B8G8R8A8_UNORM:
+	case DXGI_FORMAT_B8G8R8X8_UNORM:
+	case DXGI_FORMAT_B8G8R8A8_TYPELESS:
+	case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+	case DXGI_FORMAT_B8G8R8X8_TYPELESS:
+	case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:
+		return 4;
+
+	default:
+		return 0;
+	}
+}
+
+size_t DDSFile::SurfaceSize(DXGI_FORMAT format, uint32_t width, uint32_t height, size_t* outRowBytes)
+{
+	size_t rowBytes, rows;
+	if (IsCompressed(format))
+	{
+		rowBytes = (size_t)((width + 3) / 4) * BytesPerElement(format);
+		rows = (height + 3) / 4;
+	}
+	else
+	{
+		rowBytes = (size_t)width * BytesPerElement(format);
+		rows = height;
+	}
+
+	if (outRowBytes != nullptr)
+	{
+		*outRowBytes = rowBytes;
+	}
+	return rowBytes * rows;
+}
+
+bool DDSFile::Parse(const void* data, size_t size, Texture& outTexture)
+{
+	const unsigned char* bytes = (const unsigned char*)data;
+	if (data == nullptr || size < sizeof(uint32_t) + sizeof(Header))
+	{
+		return false;
+	}
+
+	//memcpy'd out because nothing says the caller's data is aligned
+	uint32_t magic;
+	Header header;
+	memcpy(&magic, bytes, sizeof(magic));
+	memcpy(&header, bytes + sizeof(magic), sizeof(header));
+	if (magic != Magic || header.Size != sizeof(Header) || header.Format.Size != sizeof(PixelFormat))
+	{
+		return false;
+	}
+
+	size_t offset = sizeof(uint32_t) + sizeof(Header);
+	Texture texture;
+	texture.Width = header.Width;
+	texture.Height = header.Height;
+	texture.Depth = 1;
+	texture.MipCount = header.MipMapCount ? header.MipMapCount : 1;
+	texture.ArraySize = 1;
+	texture.Cubemap = false;
+
+	if ((header.Format.Flags & PixelFormatFourCC) && header.Format.FourCC == FourCC('D', 'X', '1', '0'))
+	{
+		HeaderDX10 extended;
+		if (size < offset + sizeof(HeaderDX10))
+		{
+			return false;
+		}
+		memcpy(&extended, bytes + offset, sizeof(extended));
+		offset += sizeof(HeaderDX10);
+
+		texture.Format = (DXGI_FORMAT)extended.Format;
+		texture.ArraySize = extended.ArraySize;
+		if (extended.ResourceDimension == DimensionTexture3D)
+		{
+			texture.Depth = header.Depth;
+		}
+		else if (extended.MiscFlag & MiscTextureCube)
+		{
+			texture.Cubemap = true;
+			texture.ArraySize *= 6;
+		}
+	}
+	else
+	{
+		texture.Format = LegacyFormat(header.Format);
+		if (header.Flags & HeaderFlagVolume)
+		{
+			texture.Depth = header.Depth;
+		}
+		else if (header.Caps2 & Caps2Cubemap)
+		{
+			//The old header can leave faces out, which Direct3D has no way to make a texture of
+			if ((header.Caps2 & Caps2CubemapAllFaces) != Caps2CubemapAllFaces)
+			{
+				return false;
+			}
+			texture.Cubemap = true;
+			texture.ArraySize = 6;
+		}
+	}
+
+	uint32_t largest = (texture.Width > texture.Height) ? texture.Width : texture.Height;
+	largest = (texture.Depth > largest) ? texture.Depth : largest;
+	uint32_t fullChain = 1;
+	while (largest >> fullChain) ++fullChain;
+
+	if (BytesPerElement(texture.Format) == 0 || texture.Width == 0 || texture.Height == 0 || texture.Depth == 0 || texture.ArraySize == 0 ||
+		texture.Width > MaxDimension || texture.Height > MaxDimension || texture.Depth > MaxVolumeDimension ||
+		texture.ArraySize > MaxArraySize * 6 || (texture.Depth > 1 && texture.ArraySize > 1) || texture.MipCount > fullChain)
+	{
+		return false;
+	}
+
+	texture.Bits = bytes + offset;
+	texture.BitSize = 0;
+	for (uint32_t mip = 0; mip < texture.MipCount; ++mip)
+	{
+		texture.BitSize += SurfaceSize(texture.Format, MipSize(texture.Width, mip), MipSize(texture.Height, mip)) * MipSize(texture.Depth, mip);
+	}
+	texture.BitSize *= texture.ArraySize;
+
+	if (size - offset < texture.BitSize)
+	{
+		return false;
+	}
+
+	outTexture = texture;
+	return true;
+}
+
+const unsigned char* DDSFile::Surface(const Texture& texture, uint32_t item, uint32_t mip, size_t* outSize)
+{
+	size_t itemSize = 0;
+	size_t mipOffset = 0;
+	for (uint32_t level = 0; level < texture.MipCount; ++level)
+	{
+		size_t levelSize = SurfaceSize(texture.Format, MipSize(texture.Width, level), MipSize(texture.Height, level)) * MipSize(texture.Depth, level);
+		if (level == mip)
+		{
+			mipOffset = itemSize;
+			if (outSize != nullptr) *outSize = levelSize;
+		}
+		itemSize += levelSize;
+	}
+
+	return texture.Bits + itemSize * item + mipOffset;
+}
+
+bool DDSFile::Open(const char* filename, MappedFile& outFile, Texture& outTexture)
+{
+	return outFile.Open(filename) && Parse(outFile.Data(), outFile.Size(), outTexture);
+}
+
+void DDSFile::Serialise(const Texture& texture, std::vector<unsigned char>& outFile)
+{
+	size_t rowBytes;
+	size_t topSize = SurfaceSize(texture.Format, texture.Width, texture.Height, &rowBytes);
+	bool volume = texture.Depth > 1;
+
+	Header header;
+	memset(&header, 0, sizeof(header));
+	header.Size = sizeof(Header);
+	header.Flags = HeaderFlagCaps | HeaderFlagHeight | HeaderFlagWidth | HeaderFlagPixelFormat;
+	header.Flags |= IsCompressed(texture.Format) ? HeaderFlagLinearSize : HeaderFlagPitch;
+	header.Flags |= (texture.MipCount > 1) ? HeaderFlagMipMapCount : 0;
+	header.Flags |= volume ? HeaderFlagVolume : 0;
+	header.Height = texture.Height;
+	header.Width = texture.Width;
+	header.PitchOrLinearSize = (uint32_t)(IsCompressed(texture.Format) ? topSize : rowBytes);
+	header.Depth = volume ? texture.Depth : 0;
+	header.MipMapCount = texture.MipCount;
+	header.Format.Size = sizeof(PixelFormat);
+	header.Format.Flags = PixelFormatFourCC;
+	header.Format.FourCC = FourCC('D', 'X', '1', '0');
+	header.Caps = CapsTexture;
+	header.Caps |= (texture.MipCount > 1) ? CapsComplex | CapsMipMap : 0;
+	header.Caps |= (texture.ArraySize > 1 || volume) ? CapsComplex : 0;
+	header.Caps2 = texture.Cubemap ? Caps2Cubemap | Caps2CubemapAllFaces : 0;
+
+	HeaderDX10 extended;
+	memset(&extended, 0, sizeof(extended));
+	extended.Format = (uint32_t)texture.Format;
+	extended.ResourceDimension = volume ? DimensionTexture3D : DimensionTexture2D;
+	extended.MiscFlag = texture.Cubemap ? MiscTextureCube : 0;
+	extended.ArraySize = texture.Cubemap ? texture.ArraySize / 6 : texture.ArraySize;
+
+	uint32_t magic = Magic;
+	outFile.resize(sizeof(magic) + sizeof(header) + sizeof(extended) + texture.BitSize);
+	unsigned char* out = outFile.data();
+	memcpy(out, &magic, sizeof(magic));
+	memcpy(out + sizeof(magic), &header, sizeof(header));
+	memcpy(out + sizeof(magic) + sizeof(header), &extended, sizeof(extended));
+	if (texture.BitSize != 0)
+	{
+		memcpy(out + sizeof(magic) + sizeof(header) + sizeof(extended), texture.Bits, texture.BitSize);
+	}
+}
+
+bool DDSFile::Save(const char* filename, const Texture& texture)
+{
+	std::vector<unsigned char> file;
+	Serialise(texture, file);
+
+	std::ofstream out(filename, std::ios::out | std::ios::binary);
+	out.write((const char*)file.data(), file.size());
+	out.close();
+
+	return !out.fail();
+}
@@ -0,0 +1,124 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include "MeshTypes.h"
+
+class MappedFile;
+
+//The CPU side of .dds textures: where a file's format, size and each of its surfaces are, read straight out of memory
+//without Direct3D so texture tools build and run headless like the mesh pipeline. DDSTextureLoader.cpp still does the
+//upload on Windows. Only the formats the tools work on are understood: 8 bit RGBA/BGRA and BC1-BC7
+namespace DDSFile
+{
+	const uint32_t Magic = 0x20534444;		//"DDS "
+
+#pragma pack(push, 1)
+	//Layouts as in DDS.h from DirectXTex
+	struct PixelFormat
+	{
+		uint32_t Size;
+		uint32_t Flags;
+		uint32_t FourCC;
+		uint32_t RGBBitCount;
+		uint32_t RBitMask;
+		uint32_t GBitMask;
+		uint32_t BBitMask;
+		uint32_t ABitMask;
+	};
+
+	struct Header
+	{
+		uint32_t Size;
+		uint32_t Flags;
+		uint32_t Height;
+		uint32_t Width;
+		uint32_t PitchOrLinearSize;
+		uint32_t Depth;				//Only if Flags has HeaderFlagVolume
+		uint32_t MipMapCount;
+		uint32_t Reserved1[11];
+		PixelFormat Format;
+		uint32_t Caps;
+		uint32_t Caps2;
+		uint32_t Caps3;
+		uint32_t Caps4;
+		uint32_t Reserved2;
+	};
+
+	//Follows Header when its FourCC is "DX10"
+	struct HeaderDX10
+	{
+		uint32_t Format;			//DXGI_FORMAT
+		uint32_t ResourceDimension;
+		uint32_t MiscFlag;
+		uint32_t ArraySize;
+		uint32_t MiscFlags2;
+	};
+#pragma pack(pop)
+
+	const uint32_t PixelFormatAlphaPixels = 0x1;
+	const uint32_t PixelFormatFourCC = 0x4;
+	const uint32_t PixelFormatRGB = 0x40;
+
+	const uint32_t HeaderFlagCaps = 0x1;
+	const uint32_t HeaderFlagHeight = 0x2;
+	const uint32_t HeaderFlagWidth = 0x4;
+	const uint32_t HeaderFlagPitch = 0x8;
+	const uint32_t HeaderFlagPixelFormat = 0x1000;
+	const uint32_t HeaderFlagMipMapCount = 0x20000;
+	const uint32_t HeaderFlagLinearSize = 0x80000;
+	const uint32_t HeaderFlagVolume = 0x800000;
+
+	const uint32_t CapsComplex = 0x8;
+	const uint32_t CapsTexture = 0x1000;
+	const uint32_t CapsMipMap = 0x400000;
+	const uint32_t Caps2Cubemap = 0x200;
+	const uint32_t Caps2CubemapAllFaces = 0xFC00;
+
+	const uint32_t DimensionTexture2D = 3;
+	const uint32_t DimensionTexture3D = 4;
+	const uint32_t MiscTextureCube = 0x4;
+
+	struct Texture
+	{
+		DXGI_FORMAT Format;
+		uint32_t Width;
+		uint32_t Height;
+		uint32_t Depth;				//1 unless it's a volume texture
+		uint32_t MipCount;
+		uint32_t ArraySize;			//Six per cube
+		bool Cubemap;
+		const unsigned char* Bits;	//Every surface: each array item's mips in turn, largest first
+		size_t BitSize;				//Of every surface, not counting anything after the last one
+	};
+
+	//BC1-BC7, stored as 4x4 blocks
+	bool IsCompressed(DXGI_FORMAT format);
+
+	//Bytes per 4x4 block for compressed formats and per pixel for the rest. 0 for a format this doesn't understand
+	size_t BytesPerElement(DXGI_FORMAT format);
+
+	//Bytes of one width x height surface (one slice of a volume), and of each row of pixels or blocks in it
+	size_t SurfaceSize(DXGI_FORMAT format, uint32_t width, uint32_t height, size_t* outRowBytes = nullptr);
+
+	//Size of mip level 'mip' of something 'size' across at the top
+	inline uint32_t MipSize(uint32_t size, uint32_t mip)
+	{
+		return (size >> mip) ? (size >> mip) : 1;
+	}
+
+	//Finds the format, size and surfaces of the .dds in data[0, size), which must stay alive as long as outTexture is
+	//used. False if it isn't a .dds, is in a format this doesn't understand or is too short for the surfaces it says it has
+	bool Parse(const void* data, size_t size, Texture& outTexture);
+
+	//Start of one mip of one array item (every slice of it, for a volume), with its size in bytes if outSize isn't null
+	const unsigned char* Surface(const Texture& texture, uint32_t item, uint32_t mip, size_t* outSize = nullptr);
+
+	//Maps filename into outFile and parses it in place, so nothing is copied off disk before the surfaces are used
+	bool Open(const char* filename, MappedFile& outFile, Texture& outTexture);
+
+	//The .dds file of texture's surfaces, always with a DX10 header so every format (sRGB and BC6H/BC7 included) says
+	//exactly what it is. Parse reads it back, as does CreateDDSTextureFromFile
+	void Serialise(const Texture& texture, std::vector<unsigned char>& outFile);
+	bool Save(const char* filename, const Texture& texture);
+};
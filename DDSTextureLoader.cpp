@@ -127,6 +127,10 @@ typedef public std::unique_ptr<void, handle_closer> ScopedHandle;
 
 inline HANDLE safe_handle( HANDLE h ) { return (h == INVALID_HANDLE_VALUE) ? 0 : h; }
 
+struct view_unmapper { void operator()(const void* p) { if (p) UnmapViewOfFile(p); } };
+
+typedef public std::unique_ptr<const void, view_unmapper> ScopedView;
+
 template<UINT TNameLength>
 inline void SetDebugObjectName(_In_ ID3D11DeviceChild* resource, _In_ const char (&name)[TNameLength])
 {
@@ -141,10 +145,14 @@ inline void SetDebugObjectName(_In_ ID3D11DeviceChild* resource, _In_ const char
 };
 
 //--------------------------------------------------------------------------------------
+// The file is mapped rather than read where possible, so the header and mip chain handed to FillInitData point
+// straight into the OS file cache and the texture is never held in a heap copy as well. ddsView owns the mapping
+// and ddsData the fallback copy (for files that can't be mapped); whichever is set must outlive the pointers
 static HRESULT LoadTextureDataFromFile( _In_z_ const wchar_t* fileName,
+                                        ScopedView& ddsView,
                                         std::unique_ptr<uint8_t[]>& ddsData,
-                                        DDS_HEADER** header,
-                                        uint8_t** bitData,
+                                        const DDS_HEADER** header,
+                                        const uint8_t** bitData,
                                         size_t* bitSize
                                       )
 {
@@ -201,38 +209,57 @@ static HRESULT LoadTextureDataFromFile( _In_z_ const wchar_t* fileName,
         return E_FAIL;
     }
 
-    // create enough space for the file data
-    ddsData.reset( new (std::nothrow) uint8_t[ FileSize.LowPart ] );
-    if (!ddsData)
+    // map the file in (the view keeps the mapping alive once the handle is closed)
+    const uint8_t* fileData = nullptr;
+    ScopedHandle hMapping( CreateFileMappingW( hFile.get(),
+                                              nullptr,
+                                              PAGE_READONLY,
+                                              0,
+                                              0,
+                                              nullptr ) );
+    if ( hMapping )
     {
-        return E_OUTOFMEMORY;
+        ddsView.reset( MapViewOfFile( hMapping.get(), FILE_MAP_READ, 0, 0, 0 ) );
+        fileData = static_cast<const uint8_t*>( ddsView.get() );
     }
 
-    // read the data in
-    DWORD BytesRead = 0;
-    if (!ReadFile( hFile.get(),
-                   ddsData.get(),
-                   FileSize.LowPart,
-                   &BytesRead,
-                   nullptr
-                 ))
+    if ( !fileData )
     {
-        return HRESULT_FROM_WIN32( GetLastError() );
-    }
+        // create enough space for the file data
+        ddsData.reset( new (std::nothrow) uint8_t[ FileSize.LowPart ] );
+        if (!ddsData)
+        {
+            return E_OUTOFMEMORY;
+        }
 
-    if (BytesRead < FileSize.LowPart)
-    {
-        return E_FAIL;
+        // read the data in
+        DWORD BytesRead = 0;
+        if (!ReadFile( hFile.get(),
+                       ddsData.get(),
+                       FileSize.LowPart,
+                       &BytesRead,
+                       nullptr
+                     ))
+        {
+            return HRESULT_FROM_WIN32( GetLastError() );
+        }
+
+        if (BytesRead < FileSize.LowPart)
+        {
+            return E_FAIL;
+        }
+
+        fileData = ddsData.get();
     }
 
     // DDS files always start with the same magic number ("DDS ")
-    uint32_t dwMagicNumber = *( const uint32_t* )( ddsData.get() );
+    uint32_t dwMagicNumber = *( const uint32_t* )( fileData );
     if (dwMagicNumber != DDS_MAGIC)
     {
         return E_FAIL;
     }
 
-    auto hdr = reinterpret_cast<DDS_HEADER*>( ddsData.get() + sizeof( uint32_t ) );
+    auto hdr = reinterpret_cast<const DDS_HEADER*>( fileData + sizeof( uint32_t ) );
 
     // Verify header to validate DDS file
     if (hdr->size != sizeof(DDS_HEADER) ||
@@ -259,7 +286,7 @@ static HRESULT LoadTextureDataFromFile( _In_z_ const wchar_t* fileName,
     *header = hdr;
     ptrdiff_t offset = sizeof( uint32_t ) + sizeof( DDS_HEADER )
                        + (bDXT10Header ? sizeof( DDS_HEADER_DXT10 ) : 0);
-    *bitData = ddsData.get() + offset;
+    *bitData = fileData + offset;
     *bitSize = FileSize.LowPart - offset;
 
     return S_OK;
@@ -1751,12 +1778,14 @@ HRESULT DirectX::CreateDDSTextureFromFileEx( ID3D11Device* d3dDevice,
         return E_INVALIDARG;
     }
 
-    DDS_HEADER* header = nullptr;
-    uint8_t* bitData = nullptr;
+    const DDS_HEADER* header = nullptr;
+    const uint8_t* bitData = nullptr;
     size_t bitSize = 0;
 
+    ScopedView ddsView;
     std::unique_ptr<uint8_t[]> ddsData;
     HRESULT hr = LoadTextureDataFromFile( fileName,
+                                          ddsView,
                                           ddsData,
                                           &header,
                                           &bitData,
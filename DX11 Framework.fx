@@ -33,7 +33,9 @@ cbuffer ConstantBuffer : register( b0 )
 	float SpecularPower;
 	float3 EyePosW;
 
-	
+	//Packed vertex position decode, see VertexPacking.h
+	float4 PosDecodeScale;
+	float4 PosDecodeOffset;
 }
 
 //--------------------------------------------------------------------------------------
@@ -89,6 +91,40 @@ VS_OUTPUT VS(float4 Pos : POSITION, float3 Normal : NORMAL, VS_INPUT input)
 	return output;
 }
 
+//--------------------------------------------------------------------------------------
+// Packed Vertex Shader
+//--------------------------------------------------------------------------------------
+//Unfolds an octahedral encoded normal (already converted from SNORM to -1..1 by the input assembler)
+float3 OctahedralDecode(float2 e)
+{
+	float3 n = float3(e.x, e.y, 1.0f - abs(e.x) - abs(e.y));
+	float t = saturate(-n.z);
+	n.x += n.x >= 0.0f ? -t : t;
+	n.y += n.y >= 0.0f ? -t : t;
+	return normalize(n);
+}
+
+//Same as VS, for meshes stored as PackedVertex. Position comes in as 0..1 inside the mesh's bounding box
+VS_OUTPUT VSPACKED(float4 Pos : POSITION, float2 Normal : NORMAL, VS_INPUT input)
+{
+	VS_OUTPUT output = (VS_OUTPUT)0;
+
+	Pos = float4(Pos.xyz * PosDecodeScale.xyz + PosDecodeOffset.xyz, 1.0f);
+	output.Pos = mul(Pos, World);
+
+	//Apply View and Projection transformations
+	output.Pos = mul(output.Pos, View);
+	output.Pos = mul(output.Pos, Projection);
+
+	//Convert from local space to world space. W component of vector is 0 as vectors cannot be translated
+	float3 normalW = mul(float4(OctahedralDecode(Normal), 0.0f), World).xyz;
+	normalW = normalize(normalW);
+
+	output.Tex = input.Tex;
+	output.norm = normalW;
+	return output;
+}
+
 //--------------------------------------------------------------------------------------
 // Pixel Shader
 //--------------------------------------------------------------------------------------
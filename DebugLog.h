@@ -0,0 +1,24 @@
+#pragma once
+#include <stdarg.h>
+#include <stdio.h>
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+//printf-style logging for the loaders and benchmarks. Goes to the debugger output window on Windows
+//(the app has no console) and to stderr everywhere else
+inline void DebugLog(const char* format, ...)
+{
+	char message[1024];
+
+	va_list args;
+	va_start(args, format);
+	vsnprintf(message, sizeof(message), format, args);
+	va_end(args);
+
+#ifdef _WIN32
+	OutputDebugStringA(message);
+#else
+	fputs(message, stderr);
+#endif
+}
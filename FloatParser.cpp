@@ -0,0 +1,195 @@
+#include "FloatParser.h"
+#include "Simd.h"
+#include <float.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+namespace
+{
+	//Exact powers of ten that a double can hold, used to scale the parsed mantissa with a single multiply/divide
+	const double powersOfTen[] =
+	{
+		1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+	};
+
+	const uint64_t integerPowersOfTen[] = { 1ull, 10ull, 100ull, 1000ull, 10000ull, 100000ull, 1000000ull, 10000000ull, 100000000ull };
+
+	//More significant digits than this and the mantissa could overflow 64 bits
+	const int MaxDigits = 19;
+
+	inline bool IsDigit(char c)
+	{
+		return (unsigned char)(c - '0') < 10;
+	}
+
+	//Value of the first 'count' (1 to 8) digits at 'digits', which must have 8 readable bytes. Combines neighbouring
+	//digits into 2-digit, then 4-digit, then 8-digit numbers inside one 64-bit register, so it's three multiplies
+	//however many digits there are
+	inline uint64_t EightDigits(const char* digits, int count)
+	{
+		uint64_t chunk;
+		memcpy(&chunk, digits, 8);
+
+		//Little endian puts the first digit in the low byte, shifting the unwanted ones out the top leaves leading zeros
+		chunk -= 0x3030303030303030ull;
+		chunk <<= 8 * (8 - count);
+
+		chunk = (chunk * 10 + (chunk >> 8)) & 0x00FF00FF00FF00FFull;
+		chunk = (chunk * 100 + (chunk >> 16)) & 0x0000FFFF0000FFFFull;
+		chunk = (chunk * 10000 + (chunk >> 32)) & 0x00000000FFFFFFFFull;
+		return chunk;
+	}
+
+#ifdef SIMD_SSE2
+	//The whole of a typical OBJ number ("-12.345678 ") from one 16 byte load: finds the digits either side of the point,
+	//then converts each run with EightDigits. Returns false, having read nothing, for anything longer or unusual,
+	//which the scalar loop below handles. Needs 24 readable bytes at cursor
+	inline bool ReadMantissa16(const char*& cursor, uint64_t& mantissa, int& exponent, int& digitCount)
+	{
+		__m128i characters = _mm_loadu_si128((const __m128i*)cursor);
+		__m128i values = _mm_sub_epi8(characters, _mm_set1_epi8('0'));
+
+		//Bytes minus '0' that are still <= 9 (unsigned) were digits
+		unsigned int digits = (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_min_epu8(values, _mm_set1_epi8(9)), values));
+		unsigned int points = (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(characters, _mm_set1_epi8('.')));
+
+		int integerDigits = (int)CountTrailingZeros(~digits);
+		int hasPoint = (points >> integerDigits) & 1;
+		int fractionDigits = hasPoint ? (int)CountTrailingZeros(~(digits >> (integerDigits + 1))) : 0;
+		int length = integerDigits + hasPoint + fractionDigits;
+
+		if (integerDigits > 8 || fractionDigits > 8 || length >= 16)
+		{
+			return false;
+		}
+
+		mantissa = integerDigits ? EightDigits(cursor, integerDigits) : 0;
+		if (fractionDigits)
+		{
+			mantissa = mantissa * integerPowersOfTen[fractionDigits] + EightDigits(cursor + integerDigits + 1, fractionDigits);
+		}
+
+		exponent = -fractionDigits;
+		digitCount = integerDigits + fractionDigits;
+		cursor += length;
+		return true;
+	}
+#endif
+
+	//Consumes a run of digits into the mantissa, returning how many there were. The mantissa is garbage past MaxDigits
+	int ReadDigits(const char*& cursor, const char* end, uint64_t& mantissa)
+	{
+		const char* start = cursor;
+		while (cursor < end && IsDigit(*cursor))
+		{
+			mantissa = mantissa * 10 + (uint64_t)(*cursor - '0');
+			++cursor;
+		}
+
+		return (int)(cursor - start);
+	}
+
+	int ReadExponent(const char*& cursor, const char* end)
+	{
+		bool negative = false;
+		if (cursor < end && (*cursor == '-' || *cursor == '+'))
+		{
+			negative = *cursor == '-';
+			++cursor;
+		}
+
+		//Clamped well past anything a float can reach, so silly exponents can't overflow
+		int value = 0;
+		while (cursor < end && IsDigit(*cursor))
+		{
+			if (value < 100000) value = value * 10 + (*cursor - '0');
+			++cursor;
+		}
+
+		return negative ? -value : value;
+	}
+
+	float Slow(const char* start, const char* end)
+	{
+		std::string text(start, end);
+		return strtof(text.c_str(), nullptr);
+	}
+}
+
+float FloatParser::Parse(const char*& cursor, const char* end)
+{
+	while (cursor < end && (*cursor == ' ' || *cursor == '\t'))
+		++cursor;
+
+	const char* start = cursor;
+
+	bool negative = false;
+	if (cursor < end && (*cursor == '-' || *cursor == '+'))
+	{
+		negative = *cursor == '-';
+		++cursor;
+	}
+
+	uint64_t mantissa = 0;
+	int exponent = 0;
+	int digitCount = 0;
+
+	bool read = false;
+#ifdef SIMD_SSE2
+	read = (end - cursor >= 24) && ReadMantissa16(cursor, mantissa, exponent, digitCount);
+#endif
+
+	if (!read)
+	{
+		digitCount = ReadDigits(cursor, end, mantissa);
+		if (cursor < end && *cursor == '.')
+		{
+			++cursor;
+			int fractionDigits = ReadDigits(cursor, end, mantissa);
+			exponent = -fractionDigits;
+			digitCount += fractionDigits;
+		}
+	}
+
+	if (digitCount == 0)
+	{
+		return 0.0f;
+	}
+
+	if (cursor < end && (*cursor == 'e' || *cursor == 'E'))
+	{
+		++cursor;
+		exponent += ReadExponent(cursor, end);
+	}
+
+	if (digitCount <= MaxDigits)
+	{
+		if (mantissa == 0)
+		{
+			return negative ? -0.0f : 0.0f;
+		}
+
+		//Mantissa and power of ten are both exact as doubles, so one correctly rounded divide/multiply gives the correctly
+		//rounded double. Rounding that to float again only goes wrong if it landed exactly halfway between two floats, so
+		//that case (and denormals, which have fewer bits) goes the slow way
+		if (mantissa <= (1ull << 53) && exponent >= -22 && exponent <= 22)
+		{
+			double value = (double)mantissa;
+			value = (exponent < 0) ? value / powersOfTen[-exponent] : value * powersOfTen[exponent];
+
+			uint64_t bits;
+			memcpy(&bits, &value, sizeof(bits));
+
+			if ((bits & 0x1FFFFFFF) != 0x10000000 && value >= FLT_MIN && value <= FLT_MAX)
+			{
+				float result = (float)value;
+				return negative ? -result : result;
+			}
+		}
+	}
+
+	return Slow(start, cursor);
+}
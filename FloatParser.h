@@ -0,0 +1,14 @@
+#pragma once
+#include <stddef.h>
+
+//Decimal text to float, correctly rounded (bit for bit what strtof gives in the C locale) but without strtof's
+//locale lookups, null terminator or errno. A typical OBJ number is classified with one 16 byte SSE2 compare,
+//its digit runs turned into integers 8 at a time with SWAR arithmetic, then scaled with a single exact divide.
+//The rare numbers that can't be done exactly that way (more than 19 significant digits, huge exponents,
+//denormals, results that land exactly halfway between two floats) are handed to strtof so they still round correctly
+namespace FloatParser
+{
+	//Reads [blanks][+|-]digits[.digits][e|E[+|-]digits] from cursor, stopping at 'end', and advances cursor past it.
+	//Anything without digits gives 0 and only skips the blanks and sign
+	float Parse(const char*& cursor, const char* end);
+};
@@ -0,0 +1,44 @@
+#pragma once
+#include <stdint.h>
+#include <string.h>
+
+//Fast non-cryptographic 64-bit hash for file contents (cache validation, content addressing).
+//Eats 8 bytes per step so hashing a source file costs a small fraction of reading it
+inline uint64_t HashBytes(const void* data, size_t size, uint64_t seed = 0)
+{
+	const uint64_t prime1 = 0x9E3779B185EBCA87ull;
+	const uint64_t prime2 = 0xC2B2AE3D27D4EB4Full;
+
+	const unsigned char* bytes = (const unsigned char*)data;
+	uint64_t hash = seed ^ (size * prime1);
+
+	while (size >= 8)
+	{
+		uint64_t word;
+		memcpy(&word, bytes, 8);
+
+		word *= prime2;
+		word = (word << 31) | (word >> 33);
+		hash ^= word * prime1;
+		hash = ((hash << 27) | (hash >> 37)) * prime1 + prime2;
+
+		bytes += 8;
+		size -= 8;
+	}
+
+	while (size > 0)
+	{
+		hash ^= (*bytes++) * prime1;
+		hash = ((hash << 11) | (hash >> 53)) * prime2;
+		--size;
+	}
+
+	//Final avalanche so nearby inputs don't give nearby hashes
+	hash ^= hash >> 33;
+	hash *= prime2;
+	hash ^= hash >> 29;
+	hash *= prime1;
+	hash ^= hash >> 32;
+
+	return hash;
+}
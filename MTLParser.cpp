@@ -0,0 +1,147 @@
+#include "MTLParser.h"
+#include "OBJParser.h"
+#include <string.h>
+
+namespace
+{
+	inline bool IsBlank(char c)
+	{
+		return c == ' ' || c == '\t';
+	}
+
+	//True if the line at cursor starts with keyword followed by a blank, moving cursor past the keyword if so
+	inline bool ReadKeyword(const char*& cursor, const char* end, const char* keyword)
+	{
+		size_t length = strlen(keyword);
+		if ((size_t)(end - cursor) > length && memcmp(cursor, keyword, length) == 0 && IsBlank(cursor[length]))
+		{
+			cursor += length;
+			return true;
+		}
+
+		return false;
+	}
+
+	XMFLOAT3 ReadColour(const char*& cursor, const char* end)
+	{
+		//"Kd r" on its own means grey. Spectral and XYZ colours aren't supported, they come out black
+		XMFLOAT3 colour;
+		colour.x = OBJParser::ParseFloat(cursor, end);
+
+		const char* next = cursor;
+		while (next < end && IsBlank(*next))
+			++next;
+
+		if (next < end && *next != '\r' && *next != '\n' && *next != '#')
+		{
+			colour.y = OBJParser::ParseFloat(cursor, end);
+			colour.z = OBJParser::ParseFloat(cursor, end);
+		}
+		else
+		{
+			colour.y = colour.x;
+			colour.z = colour.x;
+		}
+
+		return colour;
+	}
+}
+
+void MTLParser::Parse(const char* data, size_t size, std::vector<Material>& out)
+{
+	const char* cursor = data;
+	const char* end = data + size;
+
+	//Properties before the first "newmtl" have nothing to belong to
+	Material ignored;
+	Material* current = &ignored;
+
+	while (cursor < end)
+	{
+		while (cursor < end && (IsBlank(*cursor) || *cursor == '\r' || *cursor == '\n'))
+			++cursor;
+
+		if (cursor >= end)
+			break;
+
+		if (ReadKeyword(cursor, end, "newmtl"))
+		{
+			Material material;
+			material.Name = OBJParser::ParseName(cursor, end);
+			material.Defined = true;
+			out.push_back(material);
+			current = &out.back();
+		}
+		else if (ReadKeyword(cursor, end, "Ka"))
+		{
+			current->Ambient = ReadColour(cursor, end);
+		}
+		else if (ReadKeyword(cursor, end, "Kd"))
+		{
+			current->Diffuse = ReadColour(cursor, end);
+		}
+		else if (ReadKeyword(cursor, end, "Ks"))
+		{
+			current->Specular = ReadColour(cursor, end);
+		}
+		else if (ReadKeyword(cursor, end, "Ns"))
+		{
+			current->SpecularPower = OBJParser::ParseFloat(cursor, end);
+		}
+		else if (ReadKeyword(cursor, end, "d"))
+		{
+			current->Opacity = OBJParser::ParseFloat(cursor, end);
+		}
+		else if (ReadKeyword(cursor, end, "Tr"))
+		{
+			current->Opacity = 1.0f - OBJParser::ParseFloat(cursor, end);
+		}
+		else if (ReadKeyword(cursor, end, "map_Kd"))
+		{
+			//Options like "-s 1 1 1" can come first, the file is the last thing on the line
+			std::string arguments = OBJParser::ParseName(cursor, end);
+			size_t split = arguments.find_last_of(" \t");
+			current->DiffuseMap = (split == std::string::npos) ? arguments : arguments.substr(split + 1);
+		}
+
+		while (cursor < end && *cursor != '\n')
+			++cursor;
+	}
+}
+
+bool MTLParser::Load(const char* filename, std::vector<Material>& out)
+{
+	std::vector<char> buffer;
+	if (!OBJParser::ReadFile(filename, buffer))
+	{
+		return false;
+	}
+
+	size_t first = out.size();
+	Parse(buffer.data(), buffer.size(), out);
+
+	for (size_t i = first; i < out.size(); ++i)
+	{
+		if (!out[i].DiffuseMap.empty())
+		{
+			out[i].DiffuseMap = ResolvePath(filename, out[i].DiffuseMap);
+		}
+	}
+
+	return true;
+}
+
+std::string MTLParser::ResolvePath(const char* file, const std::string& path)
+{
+	bool absolute = !path.empty() && (path[0] == '/' || path[0] == '\\' || path.find(':') != std::string::npos);
+	if (absolute)
+	{
+		return path;
+	}
+
+	const char* lastSlash = strrchr(file, '/');
+	const char* lastBackslash = strrchr(file, '\\');
+	if (!lastSlash || (lastBackslash && lastBackslash > lastSlash)) lastSlash = lastBackslash;
+
+	return lastSlash ? std::string(file, lastSlash + 1) + path : path;
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "MeshTypes.h"
+
+//Reader for the .mtl material libraries OBJ files name with "mtllib". Only what the renderer can use is kept:
+//the Phong colours and exponent, opacity and the diffuse texture. Built on OBJParser's number parsing
+namespace MTLParser
+{
+	struct Material
+	{
+		std::string Name;
+		XMFLOAT3 Ambient;			//Ka
+		XMFLOAT3 Diffuse;			//Kd
+		XMFLOAT3 Specular;			//Ks
+		float SpecularPower;		//Ns
+		float Opacity;				//d, or 1 - Tr
+		std::string DiffuseMap;		//map_Kd, already made relative to the working directory by Load. Empty if there isn't one
+
+		//False for a material the OBJ used that no library defined, which should be drawn however the caller
+		//draws meshes without materials
+		bool Defined;
+
+		//The defaults the MTL format gives anything a material leaves out
+		Material() : Ambient(0.2f, 0.2f, 0.2f), Diffuse(0.8f, 0.8f, 0.8f), Specular(1.0f, 1.0f, 1.0f), SpecularPower(0.0f), Opacity(1.0f), Defined(false) {}
+	};
+
+	//Parses an in-memory .mtl file, appending each "newmtl" to out. Texture paths are left as written
+	void Parse(const char* data, size_t size, std::vector<Material>& out);
+
+	//Reads and parses a .mtl file, making texture paths relative to the working directory. Returns false if it can't be read
+	bool Load(const char* filename, std::vector<Material>& out);
+
+	//'path' as written in 'file' (absolute, or relative to the directory file is in) made usable from the working directory
+	std::string ResolvePath(const char* file, const std::string& path);
+};
@@ -0,0 +1,33 @@
+#pragma once
+#include <stddef.h>
+
+//Read-only view of a whole file mapped into the address space. Pages are only read from disk when they're touched
+//and come straight out of the OS file cache, so there's no heap copy to make (or free) before using the data.
+//The pointer stays valid until Close() or the MappedFile is destroyed
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+
+	//Returns false if the file doesn't exist or couldn't be mapped. An empty file opens with Data() == nullptr
+	bool Open(const char* filename);
+	void Close();
+
+	bool IsOpen() const { return _isOpen; }
+	const unsigned char* Data() const { return _data; }
+	size_t Size() const { return _size; }
+
+private:
+	MappedFile(const MappedFile&);
+	MappedFile& operator=(const MappedFile&);
+
+	const unsigned char* _data;
+	size_t _size;
+	bool _isOpen;
+
+#ifdef _WIN32
+	void* _file;
+	void* _mapping;
+#endif
+};
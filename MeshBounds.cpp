@@ -0,0 +1,255 @@
+#include "MeshBounds.h"
+#include <float.h>
+#include <math.h>
+#include <stdint.h>
+#include <utility>
+#include <vector>
+
+namespace
+{
+	struct Ball
+	{
+		double Centre[3];
+		double RadiusSquared;
+	};
+
+	inline double DistanceSquared(const double a[3], const double b[3])
+	{
+		double dx = a[0] - b[0], dy = a[1] - b[1], dz = a[2] - b[2];
+		return dx * dx + dy * dy + dz * dz;
+	}
+
+	//A little slack so a point that was used to build the ball never counts as outside it through rounding, which would
+	//have Welzl rebuild the ball from the same points over and over
+	inline bool Contains(const Ball& ball, const double p[3])
+	{
+		return DistanceSquared(ball.Centre, p) <= ball.RadiusSquared * (1.0 + 1e-10) + 1e-30;
+	}
+
+	Ball Diametral(const double a[3], const double b[3])
+	{
+		Ball ball;
+		for (int k = 0; k < 3; ++k) ball.Centre[k] = (a[k] + b[k]) * 0.5;
+		ball.RadiusSquared = DistanceSquared(a, b) * 0.25;
+		return ball;
+	}
+
+	//Circle through three points. Points in a line get the diametral ball of the two furthest apart
+	Ball Circumscribed(const double a[3], const double b[3], const double c[3])
+	{
+		double u[3] = { a[0] - c[0], a[1] - c[1], a[2] - c[2] };
+		double v[3] = { b[0] - c[0], b[1] - c[1], b[2] - c[2] };
+		double n[3] = { u[1] * v[2] - u[2] * v[1], u[2] * v[0] - u[0] * v[2], u[0] * v[1] - u[1] * v[0] };
+		double nn = n[0] * n[0] + n[1] * n[1] + n[2] * n[2];
+		double uu = u[0] * u[0] + u[1] * u[1] + u[2] * u[2];
+		double vv = v[0] * v[0] + v[1] * v[1] + v[2] * v[2];
+
+		if (nn <= 1e-24 * uu * vv)
+		{
+			Ball ab = Diametral(a, b), bc = Diametral(b, c), ca = Diametral(c, a);
+			Ball widest = (ab.RadiusSquared > bc.RadiusSquared) ? ab : bc;
+			return (ca.RadiusSquared > widest.RadiusSquared) ? ca : widest;
+		}
+
+		//centre = c + ((|u|^2 v - |v|^2 u) x n) / (2 |n|^2)
+		double w[3] = { uu * v[0] - vv * u[0], uu * v[1] - vv * u[1], uu * v[2] - vv * u[2] };
+		double offset[3] = { w[1] * n[2] - w[2] * n[1], w[2] * n[0] - w[0] * n[2], w[0] * n[1] - w[1] * n[0] };
+
+		Ball ball;
+		for (int k = 0; k < 3; ++k) ball.Centre[k] = c[k] + offset[k] / (2.0 * nn);
+		ball.RadiusSquared = DistanceSquared(ball.Centre, c);
+		return ball;
+	}
+
+	//Sphere through four points. Four points in a plane get the smallest of their circles that holds the fourth
+	Ball Circumscribed(const double a[3], const double b[3], const double c[3], const double d[3])
+	{
+		double u[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+		double v[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+		double w[3] = { d[0] - a[0], d[1] - a[1], d[2] - a[2] };
+		double uu = u[0] * u[0] + u[1] * u[1] + u[2] * u[2];
+		double vv = v[0] * v[0] + v[1] * v[1] + v[2] * v[2];
+		double ww = w[0] * w[0] + w[1] * w[1] + w[2] * w[2];
+
+		//Solve 2 [u; v; w] x = [uu; vv; ww] by Cramer's rule, with x the centre relative to a
+		double vw[3] = { v[1] * w[2] - v[2] * w[1], v[2] * w[0] - v[0] * w[2], v[0] * w[1] - v[1] * w[0] };
+		double wu[3] = { w[1] * u[2] - w[2] * u[1], w[2] * u[0] - w[0] * u[2], w[0] * u[1] - w[1] * u[0] };
+		double uv[3] = { u[1] * v[2] - u[2] * v[1], u[2] * v[0] - u[0] * v[2], u[0] * v[1] - u[1] * v[0] };
+		double determinant = u[0] * vw[0] + u[1] * vw[1] + u[2] * vw[2];
+
+		if (fabs(determinant) <= 1e-12 * sqrt(uu * vv * ww))
+		{
+			const double* points[4] = { a, b, c, d };
+			Ball best;
+			best.RadiusSquared = -1.0;
+			for (int skip = 0; skip < 4; ++skip)
+			{
+				const double* p[3];
+				for (int i = 0, n = 0; i < 4; ++i)
+				{
+					if (i != skip) p[n++] = points[i];
+				}
+
+				Ball ball = Circumscribed(p[0], p[1], p[2]);
+				if (Contains(ball, points[skip]) && (best.RadiusSquared < 0.0 || ball.RadiusSquared < best.RadiusSquared))
+				{
+					best = ball;
+				}
+			}
+			return (best.RadiusSquared >= 0.0) ? best : Circumscribed(a, b, c);
+		}
+
+		Ball ball;
+		for (int k = 0; k < 3; ++k)
+		{
+			ball.Centre[k] = a[k] + (uu * vw[k] + vv * wu[k] + ww * uv[k]) / (2.0 * determinant);
+		}
+		ball.RadiusSquared = DistanceSquared(ball.Centre, a);
+		return ball;
+	}
+
+	//Float radius from a float centre that every point passes a float inside test against
+	float CoveringRadius(const XMFLOAT3* points, size_t count, const float centre[3])
+	{
+		float radiusSquared = 0.0f;
+		for (size_t i = 0; i < count; ++i)
+		{
+			float dx = points[i].x - centre[0], dy = points[i].y - centre[1], dz = points[i].z - centre[2];
+			float distanceSquared = dx * dx + dy * dy + dz * dz;
+			radiusSquared = (distanceSquared > radiusSquared) ? distanceSquared : radiusSquared;
+		}
+		return sqrtf(radiusSquared) * (1.0f + 4.0f * FLT_EPSILON);
+	}
+}
+
+void MeshBounds::ComputeBox(const XMFLOAT3* points, size_t count, float outMin[3], float outMax[3])
+{
+	if (count == 0)
+	{
+		for (int k = 0; k < 3; ++k) outMin[k] = outMax[k] = 0.0f;
+		return;
+	}
+
+	outMin[0] = outMax[0] = points[0].x;
+	outMin[1] = outMax[1] = points[0].y;
+	outMin[2] = outMax[2] = points[0].z;
+	for (size_t i = 1; i < count; ++i)
+	{
+		const float p[3] = { points[i].x, points[i].y, points[i].z };
+		for (int k = 0; k < 3; ++k)
+		{
+			outMin[k] = (p[k] < outMin[k]) ? p[k] : outMin[k];
+			outMax[k] = (p[k] > outMax[k]) ? p[k] : outMax[k];
+		}
+	}
+}
+
+void MeshBounds::ComputeSphere(const XMFLOAT3* points, size_t count, float outCentre[3], float& outRadius)
+{
+	if (count == 0)
+	{
+		for (int k = 0; k < 3; ++k) outCentre[k] = 0.0f;
+		outRadius = 0.0f;
+		return;
+	}
+
+	//Welzl is only expected linear time for points in random order, and meshes come sorted by the vertex fetch pass.
+	//A fixed xorshift seed keeps the result the same every time
+	std::vector<double> p(count * 3);
+	for (size_t i = 0; i < count; ++i)
+	{
+		p[i * 3] = points[i].x;
+		p[i * 3 + 1] = points[i].y;
+		p[i * 3 + 2] = points[i].z;
+	}
+
+	uint64_t state = 0x9E3779B97F4A7C15ull;
+	for (size_t i = count - 1; i > 0; --i)
+	{
+		state ^= state << 13;
+		state ^= state >> 7;
+		state ^= state << 17;
+		size_t j = (size_t)(state % (i + 1));
+		for (int k = 0; k < 3; ++k) std::swap(p[i * 3 + k], p[j * 3 + k]);
+	}
+
+	//Each level fixes one more point on the boundary and rebuilds from the points before it that ended up outside
+	const double* q = p.data();
+	Ball ball = Diametral(q, q);
+	for (size_t i = 1; i < count; ++i)
+	{
+		if (Contains(ball, q + i * 3)) continue;
+
+		ball = Diametral(q + i * 3, q + i * 3);
+		for (size_t j = 0; j < i; ++j)
+		{
+			if (Contains(ball, q + j * 3)) continue;
+
+			ball = Diametral(q + i * 3, q + j * 3);
+			for (size_t k = 0; k < j; ++k)
+			{
+				if (Contains(ball, q + k * 3)) continue;
+
+				ball = Circumscribed(q + i * 3, q + j * 3, q + k * 3);
+				for (size_t l = 0; l < k; ++l)
+				{
+					if (Contains(ball, q + l * 3)) continue;
+
+					ball = Circumscribed(q + i * 3, q + j * 3, q + k * 3, q + l * 3);
+				}
+			}
+		}
+	}
+
+	for (int k = 0; k < 3; ++k) outCentre[k] = (float)ball.Centre[k];
+	outRadius = CoveringRadius(points, count, outCentre);
+}
+
+void MeshBounds::ComputeRitterSphere(const XMFLOAT3* points, size_t count, float outCentre[3], float& outRadius)
+{
+	if (count == 0)
+	{
+		for (int k = 0; k < 3; ++k) outCentre[k] = 0.0f;
+		outRadius = 0.0f;
+		return;
+	}
+
+	auto distanceSquared = [](const XMFLOAT3& a, const float b[3])
+	{
+		float dx = a.x - b[0], dy = a.y - b[1], dz = a.z - b[2];
+		return dx * dx + dy * dy + dz * dz;
+	};
+
+	float start[3] = { points[0].x, points[0].y, points[0].z };
+	size_t furthest = 0;
+	for (size_t i = 1; i < count; ++i)
+	{
+		if (distanceSquared(points[i], start) > distanceSquared(points[furthest], start)) furthest = i;
+	}
+
+	float a[3] = { points[furthest].x, points[furthest].y, points[furthest].z };
+	size_t opposite = furthest;
+	for (size_t i = 0; i < count; ++i)
+	{
+		if (distanceSquared(points[i], a) > distanceSquared(points[opposite], a)) opposite = i;
+	}
+
+	outCentre[0] = (a[0] + points[opposite].x) * 0.5f;
+	outCentre[1] = (a[1] + points[opposite].y) * 0.5f;
+	outCentre[2] = (a[2] + points[opposite].z) * 0.5f;
+	outRadius = sqrtf(distanceSquared(points[opposite], a)) * 0.5f;
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		float distance = sqrtf(distanceSquared(points[i], outCentre));
+		if (distance > outRadius)
+		{
+			//Move the centre towards the point just far enough to reach it, keeping the far side where it was
+			float grow = (distance - outRadius) * 0.5f;
+			outRadius += grow;
+			outCentre[0] += (points[i].x - outCentre[0]) * (grow / distance);
+			outCentre[1] += (points[i].y - outCentre[1]) * (grow / distance);
+			outCentre[2] += (points[i].z - outCentre[2]) * (grow / distance);
+		}
+	}
+}
@@ -0,0 +1,19 @@
+#pragma once
+#include <stddef.h>
+#include "MeshTypes.h"
+
+//Bounding volumes around sets of points, for whole meshes (MeshCache's header) and clusters of them (MeshClusters.h)
+namespace MeshBounds
+{
+	//Axis aligned box. An empty set gets a box of zero size at the origin
+	void ComputeBox(const XMFLOAT3* points, size_t count, float outMin[3], float outMax[3]);
+
+	//The smallest sphere holding every point, by Welzl's algorithm (the move-to-front form without recursion, in doubles) over
+	//the points in a fixed shuffled order, so the same points always give the same sphere. The radius is then measured back
+	//in floats and rounded up so every point passes a float inside test. An empty set gets a sphere of radius 0 at the origin
+	void ComputeSphere(const XMFLOAT3* points, size_t count, float outCentre[3], float& outRadius);
+
+	//Ritter's sphere: the two points furthest apart along one sweep, grown to take in any point left outside. One pass
+	//instead of Welzl's few, usually 5-20% bigger. Kept to measure the tight one against
+	void ComputeRitterSphere(const XMFLOAT3* points, size_t count, float outCentre[3], float& outRadius);
+};
@@ -0,0 +1,130 @@
+#include <stdlib.h>
+#include <string.h>
+#include "OBJImport.h"
+#include "Benchmarks.h"
+#include "DebugLog.h"
+
+//Command line front end to the CPU mesh pipeline (OBJImport.h) for build machines with no GPU:
+//
+//  MeshBuild [--packed] [--weld epsilon] [--no-optimise] [--keep-uvs] [--faceted] [--threads n] [--stream-window MB] [--lods n] [--no-clusters] [--tangents] [--no-bvh] file.obj...   build/refresh each .objBinary cache
+//  MeshBuild --bench                                                                                                                                                       run Benchmarks::RunAll in the current directory
+//
+//Caches are only rebuilt when they're out of date, exactly as they would be by the app at start up.
+//Exit code is the number of files that failed, plus one if --bench had a check fail
+int main(int argc, char** argv)
+{
+	OBJLoader::ImportSettings settings;
+	bool invertTexCoords = true;
+	int failed = 0;
+
+	if (argc < 2)
+	{
+		DebugLog("usage: MeshBuild [--packed] [--weld epsilon] [--no-optimise] [--keep-uvs] [--faceted] [--threads n] [--stream-window MB] [--lods n] [--no-clusters] [--tangents] [--no-bvh] file.obj... | --bench\n");
+		return -1;
+	}
+
+	for (int i = 1; i < argc; ++i)
+	{
+		const char* arg = argv[i];
+
+		if (strcmp(arg, "--packed") == 0)
+		{
+			settings.Format = VertexFormatPacked;
+		}
+		else if (strcmp(arg, "--weld") == 0 && i + 1 < argc)
+		{
+			settings.WeldEpsilon = (float)atof(argv[++i]);
+		}
+		else if (strcmp(arg, "--no-optimise") == 0)
+		{
+			settings.OptimiseMesh = false;
+		}
+		else if (strcmp(arg, "--stream-window") == 0 && i + 1 < argc)
+		{
+			settings.StreamWindow = (size_t)atof(argv[++i]) * 1024 * 1024;
+		}
+		else if (strcmp(arg, "--threads") == 0 && i + 1 < argc)
+		{
+			settings.ParseThreads = (unsigned int)atoi(argv[++i]);
+		}
+		else if (strcmp(arg, "--lods") == 0 && i + 1 < argc)
+		{
+			settings.LodLevels = (unsigned int)atoi(argv[++i]);
+		}
+		else if (strcmp(arg, "--no-clusters") == 0)
+		{
+			settings.BuildClusters = false;
+		}
+		else if (strcmp(arg, "--tangents") == 0)
+		{
+			settings.GenerateTangents = true;
+		}
+		else if (strcmp(arg, "--no-bvh") == 0)
+		{
+			settings.BuildBvh = false;
+		}
+		else if (strcmp(arg, "--faceted") == 0)
+		{
+			settings.MissingNormals = OBJLoader::NormalGenerationFaceted;
+		}
+		else if (strcmp(arg, "--keep-uvs") == 0)
+		{
+			invertTexCoords = false;
+		}
+		else if (strcmp(arg, "--bench") == 0)
+		{
+			if (!Benchmarks::RunAll())
+			{
+				++failed;
+			}
+		}
+		else if (arg[0] == '-')
+		{
+			DebugLog("MeshBuild: unknown option %s\n", arg);
+			return -1;
+		}
+		else
+		{
+			OBJLoader::PreparedMesh mesh;
+			if (OBJLoader::Prepare(arg, invertTexCoords, settings, mesh))
+			{
+				DebugLog("%s: %u vertices (%u bytes each), %u indices, %u submeshes\n", arg, mesh.VertexCount, mesh.VertexStride, mesh.IndexCount, mesh.SubmeshCount);
+				for (unsigned int submesh = 0; submesh < mesh.SubmeshCount && !mesh.Materials.empty(); ++submesh)
+				{
+					const MTLParser::Material& material = mesh.Materials[mesh.Submeshes[submesh].MaterialId];
+					DebugLog("  %u indices from %u: %s%s%s\n", mesh.Submeshes[submesh].IndexCount, mesh.Submeshes[submesh].IndexStart,
+						material.Name.empty() ? "(no material)" : material.Name.c_str(), material.Defined ? "" : " (undefined)",
+						material.DiffuseMap.empty() ? "" : (", " + material.DiffuseMap).c_str());
+				}
+				for (unsigned int lod = 0; lod < mesh.LodCount; ++lod)
+				{
+					unsigned int indices = 0;
+					for (unsigned int submesh = 0; submesh < mesh.Lods[lod].SubmeshCount; ++submesh)
+					{
+						indices += mesh.Submeshes[mesh.Lods[lod].SubmeshStart + submesh].IndexCount;
+					}
+					DebugLog("  LOD %u: %u triangles, error %g\n", lod, indices / 3, mesh.Lods[lod].Error);
+				}
+				if (mesh.ClusterCount > 0)
+				{
+					DebugLog("  %u clusters, %.1f triangles each\n", mesh.ClusterCount, mesh.IndexCount / 3.0 / mesh.ClusterCount);
+				}
+				if (mesh.Tangents != nullptr)
+				{
+					DebugLog("  tangent stream, %u bytes\n", mesh.VertexCount * (unsigned int)sizeof(PackedTangent));
+				}
+				if (mesh.BvhNodeCount > 0)
+				{
+					DebugLog("  BVH, %u nodes, SAH cost %.2f\n", mesh.BvhNodeCount, MeshBvh::Cost(mesh.BvhNodes, mesh.BvhNodeCount));
+				}
+			}
+			else
+			{
+				DebugLog("%s: FAILED\n", arg);
+				++failed;
+			}
+		}
+	}
+
+	return failed;
+}
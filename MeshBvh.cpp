@@ -0,0 +1,582 @@
+#include "MeshBvh.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <float.h>
+#include <functional>
+#include <math.h>
+
+namespace
+{
+	struct Box
+	{
+		float Min[3];
+		float Max[3];
+
+		void Clear()
+		{
+			for (int k = 0; k < 3; ++k)
+			{
+				Min[k] = FLT_MAX;
+				Max[k] = -FLT_MAX;
+			}
+		}
+
+		void Grow(const float p[3])
+		{
+			for (int k = 0; k < 3; ++k)
+			{
+				Min[k] = std::min(Min[k], p[k]);
+				Max[k] = std::max(Max[k], p[k]);
+			}
+		}
+
+		void Grow(const Box& box)
+		{
+			for (int k = 0; k < 3; ++k)
+			{
+				Min[k] = std::min(Min[k], box.Min[k]);
+				Max[k] = std::max(Max[k], box.Max[k]);
+			}
+		}
+
+		//Half the surface area, which is all the heuristic needs to compare boxes
+		float Area() const
+		{
+			float x = Max[0] - Min[0], y = Max[1] - Min[1], z = Max[2] - Min[2];
+			return (x < 0.0f) ? 0.0f : x * y + y * z + z * x;
+		}
+	};
+
+	struct TriangleBounds
+	{
+		Box Bounds;
+		float Centre[3];
+	};
+
+	struct Bin
+	{
+		Box Bounds;
+		unsigned int Count;
+	};
+
+	struct AxisBins
+	{
+		Bin Bins[3][MeshBvh::BinCount];
+	};
+
+	struct Builder
+	{
+		std::vector<TriangleBounds> Triangles;
+		uint32_t* Order;
+		ThreadPool* Pool;
+	};
+
+	//body(batch, begin, end) over [0, count) in batches of ParallelMinTriangles, spread over the pool if there is one
+	void ForBatches(ThreadPool* pool, size_t count, const std::function<void(unsigned int, size_t, size_t)>& body)
+	{
+		unsigned int batchCount = (unsigned int)((count + MeshBvh::ParallelMinTriangles - 1) / MeshBvh::ParallelMinTriangles);
+		if (pool == nullptr || batchCount <= 1)
+		{
+			body(0, 0, count);
+			return;
+		}
+
+		pool->ParallelFor(batchCount, [&](unsigned int batch)
+		{
+			size_t begin = (size_t)batch * MeshBvh::ParallelMinTriangles;
+			body(batch, begin, std::min(count, begin + MeshBvh::ParallelMinTriangles));
+		});
+	}
+
+	inline unsigned int BinIndex(float centre, float minimum, float scale)
+	{
+		int bin = (int)((centre - minimum) * scale);
+		return (unsigned int)std::max(0, std::min((int)MeshBvh::BinCount - 1, bin));
+	}
+
+	void MeasureBatch(const Builder& builder, size_t begin, size_t end, Box& outBounds, Box& outCentres)
+	{
+		outBounds.Clear();
+		outCentres.Clear();
+		for (size_t i = begin; i < end; ++i)
+		{
+			const TriangleBounds& triangle = builder.Triangles[builder.Order[i]];
+			outBounds.Grow(triangle.Bounds);
+			outCentres.Grow(triangle.Centre);
+		}
+	}
+
+	//Box of the triangles in Order[begin, end) and box of their centres. Min and max come out the same whatever order
+	//the batches are combined in
+	void MeasureRange(const Builder& builder, size_t begin, size_t end, Box& outBounds, Box& outCentres)
+	{
+		if (builder.Pool == nullptr || end - begin <= MeshBvh::ParallelMinTriangles)
+		{
+			MeasureBatch(builder, begin, end, outBounds, outCentres);
+			return;
+		}
+
+		std::vector<Box> bounds((end - begin + MeshBvh::ParallelMinTriangles - 1) / MeshBvh::ParallelMinTriangles);
+		std::vector<Box> centres(bounds.size());
+		ForBatches(builder.Pool, end - begin, [&](unsigned int batch, size_t first, size_t last)
+		{
+			MeasureBatch(builder, begin + first, begin + last, bounds[batch], centres[batch]);
+		});
+
+		outBounds.Clear();
+		outCentres.Clear();
+		for (size_t batch = 0; batch < bounds.size(); ++batch)
+		{
+			outBounds.Grow(bounds[batch]);
+			outCentres.Grow(centres[batch]);
+		}
+	}
+
+	void FillBins(const Builder& builder, size_t begin, size_t end, const Box& centres, const float scale[3], AxisBins& outBins)
+	{
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			for (unsigned int i = 0; i < MeshBvh::BinCount; ++i)
+			{
+				outBins.Bins[axis][i].Bounds.Clear();
+				outBins.Bins[axis][i].Count = 0;
+			}
+		}
+
+		for (size_t i = begin; i < end; ++i)
+		{
+			const TriangleBounds& triangle = builder.Triangles[builder.Order[i]];
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				Bin& bin = outBins.Bins[axis][BinIndex(triangle.Centre[axis], centres.Min[axis], scale[axis])];
+				bin.Bounds.Grow(triangle.Bounds);
+				bin.Count++;
+			}
+		}
+	}
+
+	//Cheapest of the BinCount - 1 planes between bins on each axis. False if the centres are all in one spot
+	bool FindSplit(const Builder& builder, size_t begin, size_t end, const Box& bounds, const Box& centres, int& outAxis, unsigned int& outBin, float& outCost)
+	{
+		float scale[3];
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			float extent = centres.Max[axis] - centres.Min[axis];
+			scale[axis] = (extent > 0.0f) ? MeshBvh::BinCount / extent : 0.0f;
+		}
+
+		//Big ranges are binned in batches and the batches' bins added up, in order so the counts and boxes are exact
+		AxisBins binned;
+		if (builder.Pool == nullptr || end - begin <= MeshBvh::ParallelMinTriangles)
+		{
+			FillBins(builder, begin, end, centres, scale, binned);
+		}
+		else
+		{
+			std::vector<AxisBins> batchBins((end - begin + MeshBvh::ParallelMinTriangles - 1) / MeshBvh::ParallelMinTriangles);
+			ForBatches(builder.Pool, end - begin, [&](unsigned int batch, size_t first, size_t last)
+			{
+				FillBins(builder, begin + first, begin + last, centres, scale, batchBins[batch]);
+			});
+
+			binned = batchBins[0];
+			for (size_t batch = 1; batch < batchBins.size(); ++batch)
+			{
+				for (int axis = 0; axis < 3; ++axis)
+				{
+					for (unsigned int i = 0; i < MeshBvh::BinCount; ++i)
+					{
+						binned.Bins[axis][i].Bounds.Grow(batchBins[batch].Bins[axis][i].Bounds);
+						binned.Bins[axis][i].Count += batchBins[batch].Bins[axis][i].Count;
+					}
+				}
+			}
+		}
+		const Bin (&bins)[3][MeshBvh::BinCount] = binned.Bins;
+
+		float best = FLT_MAX;
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			if (scale[axis] == 0.0f)
+			{
+				continue;
+			}
+
+			//Everything right of each plane first, then sweep left to right
+			float rightArea[MeshBvh::BinCount];
+			unsigned int rightCount[MeshBvh::BinCount];
+			Box side;
+			side.Clear();
+			unsigned int count = 0;
+			for (unsigned int i = MeshBvh::BinCount - 1; i > 0; --i)
+			{
+				side.Grow(bins[axis][i].Bounds);
+				count += bins[axis][i].Count;
+				rightArea[i] = side.Area();
+				rightCount[i] = count;
+			}
+
+			side.Clear();
+			count = 0;
+			for (unsigned int i = 0; i + 1 < MeshBvh::BinCount; ++i)
+			{
+				side.Grow(bins[axis][i].Bounds);
+				count += bins[axis][i].Count;
+				if (count == 0 || rightCount[i + 1] == 0)
+				{
+					continue;
+				}
+
+				float cost = side.Area() * count + rightArea[i + 1] * rightCount[i + 1];
+				if (cost < best)
+				{
+					best = cost;
+					outAxis = axis;
+					outBin = i;
+				}
+			}
+		}
+
+		if (best == FLT_MAX)
+		{
+			return false;
+		}
+
+		//One traversal step, then each half's triangles in proportion to how likely a ray through this box is to hit it
+		float area = bounds.Area();
+		outCost = (area > 0.0f) ? 1.0f + best / area : (float)(end - begin);
+		return true;
+	}
+
+	//Re-homes a subtree built on its own (root at 0) into nodes, its root at slot and the rest appended in the same
+	//order building it in place would have used
+	void Splice(std::vector<MeshCache::BvhNode>& nodes, size_t slot, const std::vector<MeshCache::BvhNode>& subtree)
+	{
+		const size_t base = nodes.size();
+		auto shift = [base](MeshCache::BvhNode node)
+		{
+			if (node.TriangleCount == 0)
+			{
+				node.First = (uint32_t)(base + node.First - 1);
+			}
+			return node;
+		};
+
+		nodes[slot] = shift(subtree[0]);
+		for (size_t i = 1; i < subtree.size(); ++i)
+		{
+			nodes.push_back(shift(subtree[i]));
+		}
+	}
+
+	//Fills in nodes[slot] for Order[begin, end), appending its children and everything under them
+	void BuildInto(const Builder& builder, std::vector<MeshCache::BvhNode>& nodes, size_t slot, size_t begin, size_t end)
+	{
+		Box bounds;
+		Box centres;
+		MeasureRange(builder, begin, end, bounds, centres);
+
+		const size_t count = end - begin;
+		MeshCache::BvhNode node =
+		{
+			{ bounds.Min[0], bounds.Min[1], bounds.Min[2] }, (uint32_t)begin,
+			{ bounds.Max[0], bounds.Max[1], bounds.Max[2] }, (uint32_t)count
+		};
+
+		size_t middle = begin;
+		if (count > MeshBvh::MinLeafTriangles)
+		{
+			int axis = 0;
+			unsigned int bin = 0;
+			float cost = 0.0f;
+			if (FindSplit(builder, begin, end, bounds, centres, axis, bin, cost))
+			{
+				if (count > MeshBvh::MaxLeafTriangles || cost < (float)count)
+				{
+					float scale = MeshBvh::BinCount / (centres.Max[axis] - centres.Min[axis]);
+					middle = std::partition(builder.Order + begin, builder.Order + end, [&](uint32_t triangle)
+					{
+						return BinIndex(builder.Triangles[triangle].Centre[axis], centres.Min[axis], scale) <= bin;
+					}) - builder.Order;
+				}
+			}
+			else if (count > MeshBvh::MaxLeafTriangles)
+			{
+				//Every centre in the same place, so no plane separates them. Halve the range to keep leaves small
+				middle = begin + count / 2;
+			}
+		}
+
+		if (middle == begin || middle == end)
+		{
+			nodes[slot] = node;
+			return;
+		}
+
+		const size_t first = nodes.size();
+		nodes.resize(first + 2);
+		node.First = (uint32_t)first;
+		node.TriangleCount = 0;
+		nodes[slot] = node;
+
+		if (builder.Pool != nullptr && count >= MeshBvh::ParallelMinTriangles)
+		{
+			std::vector<MeshCache::BvhNode> halves[2];
+			builder.Pool->ParallelFor(2, [&](unsigned int half)
+			{
+				halves[half].resize(1);
+				BuildInto(builder, halves[half], 0, half ? middle : begin, half ? end : middle);
+			});
+
+			Splice(nodes, first, halves[0]);
+			Splice(nodes, first + 1, halves[1]);
+		}
+		else
+		{
+			BuildInto(builder, nodes, first, begin, middle);
+			BuildInto(builder, nodes, first + 1, middle, end);
+		}
+	}
+
+	inline float NodeArea(const MeshCache::BvhNode& node)
+	{
+		Box box;
+		for (int k = 0; k < 3; ++k)
+		{
+			box.Min[k] = node.BoundsMin[k];
+			box.Max[k] = node.BoundsMax[k];
+		}
+		return box.Area();
+	}
+
+	//Slab test, with the distance the ray enters the box at. Rays parallel to a slab get NaNs from 0 * infinity, which
+	//fminf/fmaxf ignore
+	inline bool HitsBox(const MeshCache::BvhNode& node, const float origin[3], const float inverse[3], float maxDistance, float& outEntry)
+	{
+		float entry = 0.0f;
+		float exit = maxDistance;
+		for (int k = 0; k < 3; ++k)
+		{
+			float t1 = (node.BoundsMin[k] - origin[k]) * inverse[k];
+			float t2 = (node.BoundsMax[k] - origin[k]) * inverse[k];
+			entry = fmaxf(entry, fminf(t1, t2));
+			exit = fminf(exit, fmaxf(t1, t2));
+		}
+
+		outEntry = entry;
+		return entry <= exit;
+	}
+
+	//Moller-Trumbore, either side
+	inline bool HitsTriangle(const XMFLOAT3& a, const XMFLOAT3& b, const XMFLOAT3& c, const float origin[3], const float direction[3], float& outDistance, float& outU, float& outV)
+	{
+		float e1[3] = { b.x - a.x, b.y - a.y, b.z - a.z };
+		float e2[3] = { c.x - a.x, c.y - a.y, c.z - a.z };
+		float p[3] = { direction[1] * e2[2] - direction[2] * e2[1], direction[2] * e2[0] - direction[0] * e2[2], direction[0] * e2[1] - direction[1] * e2[0] };
+		float determinant = e1[0] * p[0] + e1[1] * p[1] + e1[2] * p[2];
+		if (determinant == 0.0f)
+		{
+			return false;
+		}
+
+		float inverse = 1.0f / determinant;
+		float s[3] = { origin[0] - a.x, origin[1] - a.y, origin[2] - a.z };
+		float u = (s[0] * p[0] + s[1] * p[1] + s[2] * p[2]) * inverse;
+		if (u < 0.0f || u > 1.0f)
+		{
+			return false;
+		}
+
+		float q[3] = { s[1] * e1[2] - s[2] * e1[1], s[2] * e1[0] - s[0] * e1[2], s[0] * e1[1] - s[1] * e1[0] };
+		float v = (direction[0] * q[0] + direction[1] * q[1] + direction[2] * q[2]) * inverse;
+		if (v < 0.0f || u + v > 1.0f)
+		{
+			return false;
+		}
+
+		outDistance = (e2[0] * q[0] + e2[1] * q[1] + e2[2] * q[2]) * inverse;
+		outU = u;
+		outV = v;
+		return true;
+	}
+}
+
+void MeshBvh::Build(const std::vector<SimpleVertex>& vertices, const std::vector<unsigned int>& indices, size_t indexCount, ThreadPool* pool,
+	std::vector<MeshCache::BvhNode>& outNodes, std::vector<uint32_t>& outTriangles)
+{
+	outNodes.clear();
+	outTriangles.clear();
+
+	const size_t triangleCount = std::min(indexCount, indices.size()) / 3;
+	if (triangleCount == 0)
+	{
+		return;
+	}
+
+	Builder builder;
+	builder.Triangles.resize(triangleCount);
+	builder.Pool = pool;
+	ForBatches(pool, triangleCount, [&](unsigned int, size_t begin, size_t end)
+	{
+		for (size_t t = begin; t < end; ++t)
+		{
+			TriangleBounds& triangle = builder.Triangles[t];
+			triangle.Bounds.Clear();
+			for (int k = 0; k < 3; ++k)
+			{
+				const XMFLOAT3& p = vertices[indices[t * 3 + k]].Pos;
+				const float corner[3] = { p.x, p.y, p.z };
+				triangle.Bounds.Grow(corner);
+			}
+			for (int k = 0; k < 3; ++k)
+			{
+				triangle.Centre[k] = (triangle.Bounds.Min[k] + triangle.Bounds.Max[k]) * 0.5f;
+			}
+		}
+	});
+
+	outTriangles.resize(triangleCount);
+	for (size_t t = 0; t < triangleCount; ++t)
+	{
+		outTriangles[t] = (uint32_t)t;
+	}
+	builder.Order = outTriangles.data();
+
+	outNodes.reserve(triangleCount / MinLeafTriangles * 2);
+	outNodes.resize(1);
+	BuildInto(builder, outNodes, 0, 0, triangleCount);
+}
+
+float MeshBvh::Cost(const MeshCache::BvhNode* nodes, size_t nodeCount)
+{
+	if (nodeCount == 0)
+	{
+		return 0.0f;
+	}
+
+	float rootArea = NodeArea(nodes[0]);
+	if (rootArea <= 0.0f)
+	{
+		return 0.0f;
+	}
+
+	double cost = 0.0;
+	for (size_t i = 0; i < nodeCount; ++i)
+	{
+		cost += NodeArea(nodes[i]) / rootArea * (nodes[i].TriangleCount == 0 ? 1.0 : nodes[i].TriangleCount);
+	}
+	return (float)cost;
+}
+
+bool MeshBvh::Raycast(const Tree& tree, const float origin[3], const float direction[3], float maxDistance, RayHit& outHit)
+{
+	if (tree.Nodes.empty())
+	{
+		return false;
+	}
+
+	const float inverse[3] = { 1.0f / direction[0], 1.0f / direction[1], 1.0f / direction[2] };
+	float nearest = maxDistance;
+	bool found = false;
+
+	std::vector<uint32_t> stack;
+	stack.reserve(64);
+	stack.push_back(0);
+	while (!stack.empty())
+	{
+		const MeshCache::BvhNode& node = tree.Nodes[stack.back()];
+		stack.pop_back();
+
+		float entry;
+		if (!HitsBox(node, origin, inverse, nearest, entry))
+		{
+			continue;
+		}
+
+		if (node.TriangleCount > 0)
+		{
+			for (uint32_t i = node.First; i < node.First + node.TriangleCount; ++i)
+			{
+				const unsigned int* corners = &tree.Corners[i * 3];
+				float distance, u, v;
+				if (HitsTriangle(tree.Positions[corners[0]], tree.Positions[corners[1]], tree.Positions[corners[2]], origin, direction, distance, u, v) &&
+					distance >= 0.0f && distance <= nearest)
+				{
+					nearest = distance;
+					outHit.Distance = distance;
+					outHit.Triangle = tree.Triangles[i];
+					outHit.U = u;
+					outHit.V = v;
+					found = true;
+				}
+			}
+			continue;
+		}
+
+		//Nearer child on top so it's visited first and shrinks the ray for the other
+		float entries[2];
+		bool hits[2];
+		for (int child = 0; child < 2; ++child)
+		{
+			hits[child] = HitsBox(tree.Nodes[node.First + child], origin, inverse, nearest, entries[child]);
+		}
+
+		int nearer = (hits[1] && (!hits[0] || entries[1] < entries[0])) ? 1 : 0;
+		if (hits[1 - nearer]) stack.push_back(node.First + 1 - nearer);
+		if (hits[nearer]) stack.push_back(node.First + nearer);
+	}
+
+	return found;
+}
+
+void MeshBvh::QueryBox(const Tree& tree, const float boxMin[3], const float boxMax[3], std::vector<uint32_t>& outTriangles)
+{
+	if (tree.Nodes.empty())
+	{
+		return;
+	}
+
+	auto overlaps = [boxMin, boxMax](const float minimum[3], const float maximum[3])
+	{
+		return minimum[0] <= boxMax[0] && maximum[0] >= boxMin[0] && minimum[1] <= boxMax[1] && maximum[1] >= boxMin[1] &&
+			minimum[2] <= boxMax[2] && maximum[2] >= boxMin[2];
+	};
+
+	std::vector<uint32_t> stack;
+	stack.reserve(64);
+	stack.push_back(0);
+	while (!stack.empty())
+	{
+		const MeshCache::BvhNode& node = tree.Nodes[stack.back()];
+		stack.pop_back();
+
+		if (!overlaps(node.BoundsMin, node.BoundsMax))
+		{
+			continue;
+		}
+
+		if (node.TriangleCount == 0)
+		{
+			stack.push_back(node.First + 1);
+			stack.push_back(node.First);
+			continue;
+		}
+
+		for (uint32_t i = node.First; i < node.First + node.TriangleCount; ++i)
+		{
+			Box triangle;
+			triangle.Clear();
+			for (int k = 0; k < 3; ++k)
+			{
+				const XMFLOAT3& p = tree.Positions[tree.Corners[i * 3 + k]];
+				const float corner[3] = { p.x, p.y, p.z };
+				triangle.Grow(corner);
+			}
+
+			if (overlaps(triangle.Min, triangle.Max))
+			{
+				outTriangles.push_back(tree.Triangles[i]);
+			}
+		}
+	}
+}
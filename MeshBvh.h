@@ -0,0 +1,56 @@
+#pragma once
+#include <stdint.h>
+#include <vector>
+#include "MeshTypes.h"
+#include "MeshCache.h"
+
+class ThreadPool;
+
+//Bounding volume hierarchy over a mesh's triangles, in the mesh's own space, for picking and collision queries on the CPU.
+//Built top down with the surface area heuristic: each range of triangles is split where the two halves' boxes, weighted
+//by how many triangles they hold, have the least surface area, out of BinCount evenly spaced planes along each axis
+//through the triangles' centres. Triangles are only reordered in the BVH's own list, never in the index buffer.
+namespace MeshBvh
+{
+	//Ranges this small are always leaves, and ranges up to MaxLeafTriangles are when splitting them doesn't pay
+	const unsigned int MinLeafTriangles = 2;
+	const unsigned int MaxLeafTriangles = 8;
+
+	//Split planes tried per axis
+	const unsigned int BinCount = 16;
+
+	//Ranges of at least this many triangles have their two halves built at the same time, and their bins filled in batches
+	//of this size, when there's a pool to do it on
+	const unsigned int ParallelMinTriangles = 8192;
+
+	//Builds the tree over the triangles in indices[0, indexCount). outNodes[0] is the root, and both outputs are empty if
+	//there are no triangles. pool may be null to build on the calling thread only; the result is the same either way
+	void Build(const std::vector<SimpleVertex>& vertices, const std::vector<unsigned int>& indices, size_t indexCount, ThreadPool* pool,
+		std::vector<MeshCache::BvhNode>& outNodes, std::vector<uint32_t>& outTriangles);
+
+	//Expected ray-box plus ray-triangle tests for a ray through the root's box, each test counted as 1. Lower is better
+	float Cost(const MeshCache::BvhNode* nodes, size_t nodeCount);
+
+	//What a query needs at run time: the nodes, and each triangle of the BVH's list with its corners' positions
+	struct Tree
+	{
+		std::vector<MeshCache::BvhNode> Nodes;
+		std::vector<uint32_t> Triangles;		//Triangle number in the index buffer, in leaf order
+		std::vector<unsigned int> Corners;		//Three indices into Positions per entry of Triangles
+		std::vector<XMFLOAT3> Positions;
+	};
+
+	struct RayHit
+	{
+		float Distance;			//Along the ray, in units of its direction's length
+		uint32_t Triangle;		//Triangle number in the index buffer
+		float U, V;				//Barycentric position of the hit, weights of the triangle's second and third corners
+	};
+
+	//Nearest triangle (either side) that origin + t * direction hits for 0 <= t <= maxDistance. False if there isn't one
+	bool Raycast(const Tree& tree, const float origin[3], const float direction[3], float maxDistance, RayHit& outHit);
+
+	//Appends the triangle numbers of every triangle whose own box overlaps [boxMin, boxMax] to outTriangles, which
+	//leaves an exact test on just those for a collision's narrow phase
+	void QueryBox(const Tree& tree, const float boxMin[3], const float boxMax[3], std::vector<uint32_t>& outTriangles);
+};
@@ -0,0 +1,457 @@
+#include "MeshCache.h"
+#include "Hash.h"
+#include "MeshBounds.h"
+#include "VertexPacking.h"
+#include <fstream>
+#include <string.h>
+
+static_assert(sizeof(MeshCache::MeshFileHeader) == 248, "MeshFileHeader layout is part of the file format");
+static_assert(sizeof(MeshCache::MeshFileSection) == 24, "MeshFileSection layout is part of the file format");
+static_assert(sizeof(SimpleVertex) == 32, "SimpleVertex layout is part of the file format");
+static_assert(sizeof(MeshCache::MeshLod) == 16, "MeshLod layout is part of the file format");
+static_assert(sizeof(MeshCache::MeshCluster) == 40, "MeshCluster layout is part of the file format");
+static_assert(sizeof(PackedVertex) == 16, "PackedVertex layout is part of the file format");
+static_assert(sizeof(PackedTangent) == 8, "PackedTangent layout is part of the file format");
+static_assert(sizeof(MeshCache::BvhNode) == 32, "BvhNode layout is part of the file format");
+
+namespace
+{
+	const size_t SectionAlignment = 16;
+
+	const MeshCache::VertexAttribute FullLayout[] =
+	{
+		{ MeshCache::SemanticPosition, 0, DXGI_FORMAT_R32G32B32_FLOAT, 0 },
+		{ MeshCache::SemanticNormal, 0, DXGI_FORMAT_R32G32B32_FLOAT, 12 },
+		{ MeshCache::SemanticTexCoord, 0, DXGI_FORMAT_R32G32_FLOAT, 24 },
+	};
+
+	const MeshCache::VertexAttribute PackedLayout[] =
+	{
+		{ MeshCache::SemanticPosition, 0, DXGI_FORMAT_R16G16B16A16_UNORM, 0 },
+		{ MeshCache::SemanticNormal, 0, DXGI_FORMAT_R16G16_SNORM, 8 },
+		{ MeshCache::SemanticTexCoord, 0, DXGI_FORMAT_R16G16_FLOAT, 12 },
+	};
+
+	inline size_t AlignUp(size_t value, size_t alignment)
+	{
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+
+	//Strings one after another, each with its null terminator
+	void WriteNames(const std::vector<std::string>& names, std::vector<char>& outBlock)
+	{
+		outBlock.clear();
+		for (size_t i = 0; i < names.size(); ++i)
+		{
+			outBlock.insert(outBlock.end(), names[i].begin(), names[i].end());
+			outBlock.push_back('\0');
+		}
+	}
+
+	//Axis aligned box plus the smallest bounding sphere
+	void ComputeBounds(const std::vector<SimpleVertex>& vertices, MeshCache::MeshFileHeader& header)
+	{
+		std::vector<XMFLOAT3> positions(vertices.size());
+		for (size_t i = 0; i < vertices.size(); ++i)
+		{
+			positions[i] = vertices[i].Pos;
+		}
+
+		MeshBounds::ComputeBox(positions.data(), positions.size(), header.BoundsMin, header.BoundsMax);
+		MeshBounds::ComputeSphere(positions.data(), positions.size(), header.SphereCentre, header.SphereRadius);
+	}
+}
+
+const MeshCache::VertexAttribute* MeshCache::GetVertexLayout(VertexFormat format, uint32_t& outCount)
+{
+	if (format == VertexFormatPacked)
+	{
+		outCount = sizeof(PackedLayout) / sizeof(PackedLayout[0]);
+		return PackedLayout;
+	}
+
+	outCount = sizeof(FullLayout) / sizeof(FullLayout[0]);
+	return FullLayout;
+}
+
+bool MeshCache::IsContainer(const void* data, size_t size)
+{
+	uint32_t magic;
+	if (size < sizeof(magic))
+	{
+		return false;
+	}
+
+	memcpy(&magic, data, sizeof(magic));
+	return magic == Magic;
+}
+
+bool MeshCache::Open(const void* data, size_t size, MeshView& view)
+{
+	const unsigned char* bytes = (const unsigned char*)data;
+	const MeshFileHeader* header = (const MeshFileHeader*)data;
+
+	if (size < sizeof(MeshFileHeader))
+	{
+		return false;
+	}
+
+	VertexFormat format = (header->Flags & FlagPackedVertices) ? VertexFormatPacked : VertexFormatFull;
+	size_t vertexStride = (format == VertexFormatPacked) ? sizeof(PackedVertex) : sizeof(SimpleVertex);
+
+	if (
+		header->Magic != Magic ||
+		header->Version != Version ||
+		header->EndianTag != EndianTag ||
+		header->HeaderSize != sizeof(MeshFileHeader) ||
+		header->FileSize != size ||
+		header->VertexStride != vertexStride ||
+		(header->IndexFormat != DXGI_FORMAT_R16_UINT && header->IndexFormat != DXGI_FORMAT_R32_UINT))
+	{
+		return false;
+	}
+
+	//Truncated or bit-rotted files get rebuilt rather than uploaded
+	if (HashBytes(bytes + sizeof(MeshFileHeader), size - sizeof(MeshFileHeader)) != header->ContentHash)
+	{
+		return false;
+	}
+
+	size_t tableEnd = sizeof(MeshFileHeader) + header->SectionCount * sizeof(MeshFileSection);
+	if (tableEnd > size)
+	{
+		return false;
+	}
+
+	view.Header = header;
+	view.Vertices = nullptr;
+	view.Indices = nullptr;
+	view.Submeshes = nullptr;
+	view.SubmeshCount = 0;
+	view.Materials = nullptr;
+	view.MaterialsSize = 0;
+	view.MaterialLibraries = nullptr;
+	view.MaterialLibrariesSize = 0;
+	view.Lods = nullptr;
+	view.LodCount = 0;
+	view.Clusters = nullptr;
+	view.ClusterCount = 0;
+	view.Tangents = nullptr;
+	view.BvhNodes = nullptr;
+	view.BvhNodeCount = 0;
+	view.BvhTriangles = nullptr;
+	view.BvhTriangleCount = 0;
+	view.Format = format;
+
+	const MeshFileSection* sections = (const MeshFileSection*)(bytes + sizeof(MeshFileHeader));
+	for (uint32_t i = 0; i < header->SectionCount; ++i)
+	{
+		const MeshFileSection& section = sections[i];
+		if (section.Offset < tableEnd || section.Offset > size || section.Size > size - section.Offset)
+		{
+			return false;
+		}
+
+		const void* sectionData = bytes + section.Offset;
+		switch (section.Id)
+		{
+		case SectionVertices:
+			if (section.Size != (uint64_t)header->VertexCount * header->VertexStride) return false;
+			view.Vertices = sectionData;
+			break;
+
+		case SectionIndices:
+			if (section.Size != (uint64_t)header->IndexCount * (header->IndexFormat == DXGI_FORMAT_R32_UINT ? 4 : 2)) return false;
+			view.Indices = sectionData;
+			break;
+
+		case SectionSubmeshes:
+			if (section.Size % sizeof(Submesh) != 0) return false;
+			view.Submeshes = (const Submesh*)sectionData;
+			view.SubmeshCount = (uint32_t)(section.Size / sizeof(Submesh));
+			break;
+
+		case SectionMaterials:
+		case SectionMaterialLibraries:
+			//Has to end with a terminator so the last name can't run off the end
+			if (section.Size == 0 || ((const char*)sectionData)[section.Size - 1] != '\0') return false;
+			if (section.Id == SectionMaterials)
+			{
+				view.Materials = (const char*)sectionData;
+				view.MaterialsSize = (size_t)section.Size;
+			}
+			else
+			{
+				view.MaterialLibraries = (const char*)sectionData;
+				view.MaterialLibrariesSize = (size_t)section.Size;
+			}
+			break;
+
+		case SectionLods:
+			if (section.Size == 0 || section.Size % sizeof(MeshLod) != 0) return false;
+			view.Lods = (const MeshLod*)sectionData;
+			view.LodCount = (uint32_t)(section.Size / sizeof(MeshLod));
+			break;
+
+		case SectionClusters:
+			if (section.Size == 0 || section.Size % sizeof(MeshCluster) != 0) return false;
+			view.Clusters = (const MeshCluster*)sectionData;
+			view.ClusterCount = (uint32_t)(section.Size / sizeof(MeshCluster));
+			break;
+
+		case SectionTangents:
+			if (section.Size != (uint64_t)header->VertexCount * sizeof(PackedTangent)) return false;
+			view.Tangents = (const PackedTangent*)sectionData;
+			break;
+
+		case SectionBvhNodes:
+			if (section.Size == 0 || section.Size % sizeof(BvhNode) != 0) return false;
+			view.BvhNodes = (const BvhNode*)sectionData;
+			view.BvhNodeCount = (uint32_t)(section.Size / sizeof(BvhNode));
+			break;
+
+		case SectionBvhTriangles:
+			if (section.Size == 0 || section.Size % sizeof(uint32_t) != 0) return false;
+			view.BvhTriangles = (const uint32_t*)sectionData;
+			view.BvhTriangleCount = (uint32_t)(section.Size / sizeof(uint32_t));
+			break;
+
+		default:
+			//Newer section we don't know about, skip it
+			break;
+		}
+	}
+
+	if (view.Vertices == nullptr || view.Indices == nullptr)
+	{
+		return false;
+	}
+
+	//Every index has to name a vertex, or drawing the mesh (or reading it on the CPU) runs off the end of the vertices
+	for (uint32_t i = 0; i < header->IndexCount; ++i)
+	{
+		uint32_t index = (header->IndexFormat == DXGI_FORMAT_R32_UINT) ? ((const uint32_t*)view.Indices)[i] : ((const uint16_t*)view.Indices)[i];
+		if (index >= header->VertexCount)
+		{
+			return false;
+		}
+	}
+
+	//Draw ranges have to stay inside the index buffer
+	for (uint32_t i = 0; i < view.SubmeshCount; ++i)
+	{
+		const Submesh& submesh = view.Submeshes[i];
+		if (submesh.IndexStart > header->IndexCount || submesh.IndexCount > header->IndexCount - submesh.IndexStart)
+		{
+			return false;
+		}
+	}
+
+	//And each level has to be made of whole submeshes
+	for (uint32_t i = 0; i < view.LodCount; ++i)
+	{
+		const MeshLod& lod = view.Lods[i];
+		if (lod.SubmeshStart > view.SubmeshCount || lod.SubmeshCount > view.SubmeshCount - lod.SubmeshStart)
+		{
+			return false;
+		}
+	}
+
+	//Clusters are drawn in place of their submesh's range, so they have to be inside the index buffer too
+	for (uint32_t i = 0; i < view.ClusterCount; ++i)
+	{
+		const MeshCluster& cluster = view.Clusters[i];
+		if (cluster.IndexStart > header->IndexCount || cluster.IndexCount > header->IndexCount - cluster.IndexStart)
+		{
+			return false;
+		}
+	}
+
+	//The BVH is walked without bounds checks, so every child has to come after its parent (no loops) and every leaf and
+	//triangle number has to be in range. Half of one is no use
+	if ((view.BvhNodes == nullptr) != (view.BvhTriangles == nullptr))
+	{
+		return false;
+	}
+	for (uint32_t i = 0; i < view.BvhNodeCount; ++i)
+	{
+		const BvhNode& node = view.BvhNodes[i];
+		if (node.TriangleCount == 0 ? (node.First <= i || node.First >= view.BvhNodeCount - 1) :
+			(node.First > view.BvhTriangleCount || node.TriangleCount > view.BvhTriangleCount - node.First))
+		{
+			return false;
+		}
+	}
+	for (uint32_t i = 0; i < view.BvhTriangleCount; ++i)
+	{
+		if (view.BvhTriangles[i] >= header->IndexCount / 3)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void MeshCache::ReadNames(const char* names, size_t size, std::vector<std::string>& outNames)
+{
+	outNames.clear();
+	for (size_t start = 0; start < size;)
+	{
+		size_t length = strlen(names + start);
+		outNames.push_back(std::string(names + start, length));
+		start += length + 1;
+	}
+}
+
+bool MeshCache::MatchesSource(const MeshView& view, const void* sourceData, size_t sourceSize)
+{
+	return view.Header->SourceSize == sourceSize && view.Header->SourceHash == HashBytes(sourceData, sourceSize);
+}
+
+void MeshCache::Serialise(const MeshContent& mesh, const void* sourceData, size_t sourceSize, std::vector<unsigned char>& file)
+{
+	uint32_t vertexCount = (uint32_t)mesh.Vertices.size();
+	uint32_t indexCount = (uint32_t)mesh.Indices.size();
+	DXGI_FORMAT indexFormat = ChooseIndexFormat(vertexCount);
+	bool index32 = indexFormat == DXGI_FORMAT_R32_UINT;
+	size_t indexSize = IndexSize(indexFormat);
+
+	//Lay out the sections
+	struct PendingSection
+	{
+		uint32_t Id;
+		const void* Data;
+		size_t Size;
+	};
+
+	std::vector<unsigned short> shortIndices;
+	if (!index32)
+	{
+		shortIndices.assign(mesh.Indices.begin(), mesh.Indices.end());
+	}
+
+	//The bounds go in the header either way, packed positions are stored relative to them
+	MeshFileHeader header;
+	memset(&header, 0, sizeof(header));
+	ComputeBounds(mesh.Vertices, header);
+
+	bool packed = mesh.Format == VertexFormatPacked;
+	size_t vertexStride = packed ? sizeof(PackedVertex) : sizeof(SimpleVertex);
+
+	std::vector<PackedVertex> packedVertices;
+	if (packed)
+	{
+		packedVertices.resize(vertexCount);
+		VertexPacking::Pack(mesh.Vertices.data(), vertexCount, header.BoundsMin, header.BoundsMax, packedVertices.data());
+	}
+
+	//A mesh without a submesh table is one range covering everything
+	Submesh wholeMesh = { 0, indexCount, 0, 0 };
+	const Submesh* submeshes = mesh.Submeshes.empty() ? &wholeMesh : mesh.Submeshes.data();
+	size_t submeshCount = mesh.Submeshes.empty() ? 1 : mesh.Submeshes.size();
+
+	std::vector<PendingSection> pending;
+	PendingSection vertexSection = { SectionVertices, packed ? (const void*)packedVertices.data() : (const void*)mesh.Vertices.data(), vertexCount * vertexStride };
+	PendingSection indexSection = { SectionIndices, index32 ? (const void*)mesh.Indices.data() : (const void*)shortIndices.data(), indexCount * indexSize };
+	PendingSection submeshSection = { SectionSubmeshes, submeshes, submeshCount * sizeof(Submesh) };
+	pending.push_back(vertexSection);
+	pending.push_back(indexSection);
+	pending.push_back(submeshSection);
+
+	//The material sections are only there for OBJs that had materials
+	std::vector<char> materials;
+	std::vector<char> materialLibraries;
+	WriteNames(mesh.Materials, materials);
+	WriteNames(mesh.MaterialLibraries, materialLibraries);
+	if (!materials.empty())
+	{
+		PendingSection materialSection = { SectionMaterials, materials.data(), materials.size() };
+		pending.push_back(materialSection);
+	}
+	if (!materialLibraries.empty())
+	{
+		PendingSection librarySection = { SectionMaterialLibraries, materialLibraries.data(), materialLibraries.size() };
+		pending.push_back(librarySection);
+	}
+	if (!mesh.Lods.empty())
+	{
+		PendingSection lodSection = { SectionLods, mesh.Lods.data(), mesh.Lods.size() * sizeof(MeshLod) };
+		pending.push_back(lodSection);
+	}
+	if (!mesh.Clusters.empty())
+	{
+		PendingSection clusterSection = { SectionClusters, mesh.Clusters.data(), mesh.Clusters.size() * sizeof(MeshCluster) };
+		pending.push_back(clusterSection);
+	}
+
+	std::vector<PackedTangent> packedTangents;
+	if (!mesh.Tangents.empty())
+	{
+		packedTangents.resize(vertexCount);
+		VertexPacking::PackTangents(mesh.Tangents.data(), vertexCount, packedTangents.data());
+		PendingSection tangentSection = { SectionTangents, packedTangents.data(), packedTangents.size() * sizeof(PackedTangent) };
+		pending.push_back(tangentSection);
+	}
+	if (!mesh.BvhNodes.empty())
+	{
+		PendingSection nodeSection = { SectionBvhNodes, mesh.BvhNodes.data(), mesh.BvhNodes.size() * sizeof(BvhNode) };
+		PendingSection triangleSection = { SectionBvhTriangles, mesh.BvhTriangles.data(), mesh.BvhTriangles.size() * sizeof(uint32_t) };
+		pending.push_back(nodeSection);
+		pending.push_back(triangleSection);
+	}
+
+	const uint32_t sectionCount = (uint32_t)pending.size();
+	size_t offset = sizeof(MeshFileHeader) + sectionCount * sizeof(MeshFileSection);
+	std::vector<MeshFileSection> sections(sectionCount);
+	for (uint32_t i = 0; i < sectionCount; ++i)
+	{
+		offset = AlignUp(offset, SectionAlignment);
+		sections[i].Id = pending[i].Id;
+		sections[i].Reserved = 0;
+		sections[i].Offset = offset;
+		sections[i].Size = pending[i].Size;
+		offset += pending[i].Size;
+	}
+
+	//Build the whole file in memory so it goes out in a single write
+	file.assign(offset, 0);
+	memcpy(&file[sizeof(MeshFileHeader)], sections.data(), sectionCount * sizeof(MeshFileSection));
+	for (uint32_t i = 0; i < sectionCount; ++i)
+	{
+		if (pending[i].Size > 0)
+		{
+			memcpy(&file[(size_t)sections[i].Offset], pending[i].Data, pending[i].Size);
+		}
+	}
+
+	header.Magic = Magic;
+	header.Version = Version;
+	header.EndianTag = EndianTag;
+	header.HeaderSize = sizeof(MeshFileHeader);
+	header.Flags = packed ? FlagPackedVertices : 0;
+	header.FileSize = file.size();
+	header.SourceSize = sourceSize;
+	header.SourceHash = HashBytes(sourceData, sourceSize);
+	header.SettingsHash = mesh.SettingsHash;
+	header.VertexCount = vertexCount;
+	header.IndexCount = indexCount;
+	header.IndexFormat = indexFormat;
+	header.VertexStride = (uint32_t)vertexStride;
+	header.SectionCount = sectionCount;
+
+	const VertexAttribute* layout = GetVertexLayout(mesh.Format, header.AttributeCount);
+	memcpy(header.Attributes, layout, header.AttributeCount * sizeof(VertexAttribute));
+
+	header.ContentHash = HashBytes(&file[sizeof(MeshFileHeader)], file.size() - sizeof(MeshFileHeader));
+	memcpy(&file[0], &header, sizeof(header));
+}
+
+bool MeshCache::WriteFile(const char* filename, const std::vector<unsigned char>& file)
+{
+	std::ofstream outbin(filename, std::ios::out | std::ios::binary);
+	outbin.write((const char*)file.data(), file.size());
+	outbin.close();
+
+	return !outbin.fail();
+}
@@ -0,0 +1,213 @@
+#pragma once
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "MeshTypes.h"
+
+//The .objBinary (version 2) mesh container written by OBJLoader.
+//
+//  MeshFileHeader        magic, version, endianness tag, sizes, vertex layout, index format, bounds, hashes
+//  MeshFileSection[]     table of contents, one entry per section below
+//  sections              each 16-byte aligned: vertices, indices, submeshes, then material names and .mtl files if the OBJ used any,
+//                        then the level of detail table if LODs were generated, then the cluster table if clusters were built,
+//                        then the tangent stream if tangents were generated, then the BVH's nodes and triangle list if one was built
+//
+//Everything is stored exactly as it is uploaded, so loading is one bulk read of the file followed by pointing
+//into it - there's nothing to parse. The header keeps the size and hash of the OBJ the cache was built from, and a
+//hash of the import settings it was built with, so OBJLoader can tell when either has changed, and a hash of everything after the header so truncated
+//or corrupted files are rejected rather than uploaded.
+//
+//Files from before version 2 (two counts then raw arrays, no header) are still readable by OBJLoader.
+namespace MeshCache
+{
+	const uint32_t Magic = 0x424A424F;		//"OBJB"
+	const uint16_t Version = 2;
+	const uint16_t EndianTag = 0xFEFF;		//Reads back as 0xFFFE on a machine with the other byte order
+	const uint32_t MaxAttributes = 8;
+
+	enum VertexSemantic
+	{
+		SemanticPosition = 0,
+		SemanticNormal = 1,
+		SemanticTexCoord = 2,
+		SemanticTangent = 3,		//Only ever in the tangent stream (SectionTangents), never in MeshFileHeader::Attributes
+	};
+
+	//Bits in MeshFileHeader::Flags
+	enum HeaderFlags
+	{
+		FlagPackedVertices = 1,		//Vertex section is PackedVertex rather than SimpleVertex
+	};
+
+	enum SectionId
+	{
+		SectionVertices = 1,
+		SectionIndices = 2,
+		SectionSubmeshes = 3,
+		SectionMaterials = 4,			//Names of the materials Submesh::MaterialId indexes, each null terminated
+		SectionMaterialLibraries = 5,	//The OBJ's "mtllib" files, relative to it, each null terminated
+		SectionLods = 6,				//MeshLod table. Without one every submesh is part of the full detail mesh
+		SectionClusters = 7,			//MeshCluster table, in index buffer order
+		SectionTangents = 8,			//PackedTangent per vertex, a second vertex buffer alongside SectionVertices
+		SectionBvhNodes = 9,			//BvhNode array, root first
+		SectionBvhTriangles = 10,		//Triangle numbers (first index / 3) of the full detail mesh, in the order BvhNode leaves refer to them
+	};
+
+	struct VertexAttribute
+	{
+		uint32_t Semantic;		//VertexSemantic
+		uint32_t SemanticIndex;
+		uint32_t Format;		//DXGI_FORMAT
+		uint32_t Offset;		//Byte offset inside one vertex
+	};
+
+	struct MeshFileHeader
+	{
+		uint32_t Magic;
+		uint16_t Version;
+		uint16_t EndianTag;
+		uint32_t HeaderSize;		//sizeof(MeshFileHeader), lets a reader skip fields it doesn't know about
+		uint32_t Flags;				//HeaderFlags
+
+		uint64_t FileSize;
+		uint64_t SourceSize;		//Size and HashBytes() of the OBJ this was built from
+		uint64_t SourceHash;
+		uint64_t SettingsHash;		//OBJLoader::SettingsHash of what it was imported with
+		uint64_t ContentHash;		//HashBytes() of everything after this header
+
+		uint32_t VertexCount;
+		uint32_t IndexCount;		//Every level of detail's indices, one after another
+		uint32_t IndexFormat;		//DXGI_FORMAT_R16_UINT or DXGI_FORMAT_R32_UINT
+		uint32_t VertexStride;
+
+		uint32_t AttributeCount;
+		uint32_t SectionCount;
+		VertexAttribute Attributes[MaxAttributes];
+
+		float BoundsMin[3];			//Axis aligned box, also what packed positions are relative to
+		float BoundsMax[3];
+		float SphereCentre[3];		//Bounding sphere
+		float SphereRadius;
+	};
+
+	struct MeshFileSection
+	{
+		uint32_t Id;			//SectionId
+		uint32_t Reserved;
+		uint64_t Offset;		//From the start of the file
+		uint64_t Size;			//In bytes
+	};
+
+	//One draw range inside the shared index buffer, all triangles of one material
+	struct Submesh
+	{
+		uint32_t IndexStart;
+		uint32_t IndexCount;
+		uint32_t MaterialId;
+		uint32_t Reserved;
+	};
+
+	//One level of detail, drawn with its own run of the submesh table instead of the full mesh's. All levels share the
+	//vertex buffer. Level 0 is the full mesh, each one after has fewer triangles
+	struct MeshLod
+	{
+		uint32_t SubmeshStart;
+		uint32_t SubmeshCount;
+		float Error;			//How far (in mesh units) the level strays from the full mesh's surface
+		uint32_t Reserved;
+	};
+
+	//A run of up to MeshClusters::MaxTriangles neighbouring triangles inside one submesh, with the bounds to cull it by
+	//(see MeshClusters.h). A submesh's clusters cover its index range exactly, one after another
+	struct MeshCluster
+	{
+		uint32_t IndexStart;
+		uint32_t IndexCount;
+		float Centre[3];		//Bounding sphere
+		float Radius;
+		float ConeAxis[3];		//Normal cone: every triangle's outside faces within the cone around this axis
+		float ConeCutoff;		//sin of the cone's half angle, 1 if it's too wide to ever be back facing
+	};
+
+	//One node of the bounding volume hierarchy over the full detail mesh's triangles (see MeshBvh.h). An inner node's two
+	//children are next to each other, after it
+	struct BvhNode
+	{
+		float BoundsMin[3];
+		uint32_t First;			//Inner node: index of its first child. Leaf: its first entry in SectionBvhTriangles
+		float BoundsMax[3];
+		uint32_t TriangleCount;	//0 for inner nodes
+	};
+
+	//CPU-side mesh as it comes out of the import pipeline. Indices are always 32-bit here, Serialise() narrows them
+	//and packs the vertices if Format asks for it
+	struct MeshContent
+	{
+		std::vector<SimpleVertex> Vertices;
+		std::vector<unsigned int> Indices;
+		std::vector<Submesh> Submeshes;
+		std::vector<std::string> Materials;
+		std::vector<std::string> MaterialLibraries;
+		std::vector<MeshLod> Lods;		//Empty if no LODs were generated
+		std::vector<MeshCluster> Clusters;	//Empty if no clusters were built
+		std::vector<XMFLOAT4> Tangents;		//One per vertex, or empty if no tangents were generated. Packed by Serialise()
+		std::vector<BvhNode> BvhNodes;		//Both empty if no BVH was built
+		std::vector<uint32_t> BvhTriangles;
+		VertexFormat Format;
+		uint64_t SettingsHash;		//Written to MeshFileHeader::SettingsHash
+
+		MeshContent() : Format(VertexFormatFull), SettingsHash(0) {}
+	};
+
+	//Pointers into a validated in-memory cache file
+	struct MeshView
+	{
+		const MeshFileHeader* Header;
+		const void* Vertices;
+		const void* Indices;
+		const Submesh* Submeshes;
+		uint32_t SubmeshCount;
+		const char* Materials;			//SectionMaterials, nullptr if there wasn't one
+		size_t MaterialsSize;
+		const char* MaterialLibraries;
+		size_t MaterialLibrariesSize;
+		const MeshLod* Lods;			//SectionLods, nullptr if there wasn't one
+		uint32_t LodCount;
+		const MeshCluster* Clusters;	//SectionClusters, nullptr if there wasn't one
+		uint32_t ClusterCount;
+		const PackedTangent* Tangents;	//SectionTangents, nullptr if there wasn't one
+		const BvhNode* BvhNodes;		//SectionBvhNodes and SectionBvhTriangles, nullptr unless there were both
+		uint32_t BvhNodeCount;
+		const uint32_t* BvhTriangles;
+		uint32_t BvhTriangleCount;
+		VertexFormat Format;
+	};
+
+	//Attribute layout of each vertex format, as stored in MeshFileHeader::Attributes
+	const VertexAttribute* GetVertexLayout(VertexFormat format, uint32_t& outCount);
+
+	//DXGI_FORMAT_R16_UINT if every vertex can be addressed with 16-bit indices, DXGI_FORMAT_R32_UINT otherwise
+	inline DXGI_FORMAT ChooseIndexFormat(size_t vertexCount) { return (vertexCount <= 0x10000) ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT; }
+
+	//Size in bytes of one index of the given format
+	inline unsigned int IndexSize(DXGI_FORMAT indexFormat) { return (indexFormat == DXGI_FORMAT_R32_UINT) ? 4 : 2; }
+
+	//True if the data starts with the version 2 magic number (so isn't an old headerless file)
+	bool IsContainer(const void* data, size_t size);
+
+	//Checks the header, section table and content hash and fills out view. Returns false for anything that
+	//isn't a complete, uncorrupted version 2 file written with this machine's byte order
+	bool Open(const void* data, size_t size, MeshView& view);
+
+	//True if the cache was built from exactly this source file
+	bool MatchesSource(const MeshView& view, const void* sourceData, size_t sourceSize);
+
+	//Splits a SectionMaterials/SectionMaterialLibraries block back into its strings
+	void ReadNames(const char* names, size_t size, std::vector<std::string>& outNames);
+
+	//Builds the complete container in memory. sourceData is the OBJ text the mesh was made from
+	void Serialise(const MeshContent& mesh, const void* sourceData, size_t sourceSize, std::vector<unsigned char>& outFile);
+
+	//Writes a serialised container out in one go. Returns false if the file couldn't be written
+	bool WriteFile(const char* filename, const std::vector<unsigned char>& file);
+};
@@ -0,0 +1,507 @@
+#include "MeshClusters.h"
+#include "MeshBounds.h"
+#include "MeshOptimiser.h"
+#include <algorithm>
+#include <float.h>
+#include <math.h>
+#include <stdint.h>
+
+namespace
+{
+	//Normal cones narrower than this (cosine of the half angle) can still be back facing, wider ones never are in practice
+	const float MinConeDot = 0.1f;
+
+	const unsigned int NoTriangle = ~0u;
+
+	//When a cluster runs out of connected triangles, how many of the next ones in the old order are looked at for one close by
+	const unsigned int NearbySearch = 32;
+
+	//Scratch space for one range, indexed by its own numbering of positions so every submesh costs only its own size
+	struct RangeAdjacency
+	{
+		std::vector<unsigned int> Position;		//Per corner, which distinct position it's at
+		std::vector<unsigned int> Vertex;		//Per corner, which of the range's vertices it uses
+		unsigned int VertexCount;
+		std::vector<unsigned int> Offsets;		//Per position, where its triangles start in Triangles
+		std::vector<unsigned int> Triangles;
+	};
+
+	//Corners at exactly the same place share a position even when a normal or UV seam splits the vertex, so clusters
+	//grow across seams
+	void BuildAdjacency(const std::vector<SimpleVertex>& vertices, const unsigned int* indices, size_t indexCount, RangeAdjacency& adjacency)
+	{
+		std::vector<unsigned int> corners(indexCount);
+		for (size_t i = 0; i < indexCount; ++i)
+		{
+			corners[i] = (unsigned int)i;
+		}
+
+		std::sort(corners.begin(), corners.end(), [&](unsigned int a, unsigned int b)
+		{
+			const XMFLOAT3& pa = vertices[indices[a]].Pos;
+			const XMFLOAT3& pb = vertices[indices[b]].Pos;
+			if (pa.x != pb.x) return pa.x < pb.x;
+			if (pa.y != pb.y) return pa.y < pb.y;
+			if (pa.z != pb.z) return pa.z < pb.z;
+			return indices[a] < indices[b];
+		});
+
+		//Corners of the same vertex end up next to each other, as do corners at the same position
+		adjacency.Position.assign(indexCount, 0);
+		adjacency.Vertex.assign(indexCount, 0);
+		unsigned int positionCount = 0;
+		unsigned int vertexCount = 0;
+		for (size_t i = 0; i < indexCount; ++i)
+		{
+			const XMFLOAT3& p = vertices[indices[corners[i]]].Pos;
+			if (i > 0)
+			{
+				const XMFLOAT3& previous = vertices[indices[corners[i - 1]]].Pos;
+				if (p.x != previous.x || p.y != previous.y || p.z != previous.z)
+				{
+					++positionCount;
+				}
+				if (indices[corners[i]] != indices[corners[i - 1]])
+				{
+					++vertexCount;
+				}
+			}
+			adjacency.Position[corners[i]] = positionCount;
+			adjacency.Vertex[corners[i]] = vertexCount;
+		}
+		positionCount += (indexCount > 0) ? 1 : 0;
+		adjacency.VertexCount = vertexCount + ((indexCount > 0) ? 1 : 0);
+
+		adjacency.Offsets.assign(positionCount + 1, 0);
+		for (size_t i = 0; i < indexCount; ++i)
+		{
+			++adjacency.Offsets[adjacency.Position[i] + 1];
+		}
+		for (unsigned int i = 0; i < positionCount; ++i)
+		{
+			adjacency.Offsets[i + 1] += adjacency.Offsets[i];
+		}
+
+		std::vector<unsigned int> fill(adjacency.Offsets.begin(), adjacency.Offsets.end() - 1);
+		adjacency.Triangles.resize(indexCount);
+		for (size_t i = 0; i < indexCount; ++i)
+		{
+			adjacency.Triangles[fill[adjacency.Position[i]]++] = (unsigned int)(i / 3);
+		}
+	}
+
+	//Sphere and normal cone of the triangles in indices[0, indexCount)
+	void ComputeBounds(const std::vector<SimpleVertex>& vertices, const unsigned int* indices, size_t indexCount, MeshCache::MeshCluster& cluster)
+	{
+		std::vector<XMFLOAT3> points(indexCount);
+		for (size_t i = 0; i < indexCount; ++i)
+		{
+			points[i] = vertices[indices[i]].Pos;
+		}
+		MeshBounds::ComputeSphere(points.data(), points.size(), cluster.Centre, cluster.Radius);
+
+		//Each triangle's face normal, turned to the side its vertex normals are on
+		std::vector<XMFLOAT3> normals;
+		float axis[3] = { 0.0f, 0.0f, 0.0f };
+		for (size_t i = 0; i < indexCount; i += 3)
+		{
+			const SimpleVertex& a = vertices[indices[i]];
+			const SimpleVertex& b = vertices[indices[i + 1]];
+			const SimpleVertex& c = vertices[indices[i + 2]];
+
+			float e1[3] = { b.Pos.x - a.Pos.x, b.Pos.y - a.Pos.y, b.Pos.z - a.Pos.z };
+			float e2[3] = { c.Pos.x - a.Pos.x, c.Pos.y - a.Pos.y, c.Pos.z - a.Pos.z };
+			float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+			float length = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+			if (length == 0.0f)
+			{
+				continue;
+			}
+
+			float side = n[0] * (a.Normal.x + b.Normal.x + c.Normal.x) + n[1] * (a.Normal.y + b.Normal.y + c.Normal.y) + n[2] * (a.Normal.z + b.Normal.z + c.Normal.z);
+			float scale = (side < 0.0f) ? -1.0f / length : 1.0f / length;
+			XMFLOAT3 unit(n[0] * scale, n[1] * scale, n[2] * scale);
+
+			normals.push_back(unit);
+			axis[0] += unit.x;
+			axis[1] += unit.y;
+			axis[2] += unit.z;
+		}
+
+		float axisLength = sqrtf(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+		float minDot = -1.0f;
+		if (axisLength > 0.0f)
+		{
+			for (int k = 0; k < 3; ++k)
+			{
+				axis[k] /= axisLength;
+			}
+
+			minDot = 1.0f;
+			for (size_t i = 0; i < normals.size(); ++i)
+			{
+				minDot = std::min(minDot, normals[i].x * axis[0] + normals[i].y * axis[1] + normals[i].z * axis[2]);
+			}
+		}
+
+		cluster.ConeAxis[0] = axis[0];
+		cluster.ConeAxis[1] = axis[1];
+		cluster.ConeAxis[2] = axis[2];
+
+		//Every triangle faces away from the eye when the direction to it is more than 90 degrees plus the cone's half
+		//angle from the axis, cos(90 + a) = -sin(a). 1 can never be met (see IsVisible)
+		cluster.ConeCutoff = (minDot > MinConeDot) ? sqrtf(1.0f - minDot * minDot) : 1.0f;
+	}
+}
+
+void MeshClusters::Build(const std::vector<SimpleVertex>& vertices, std::vector<unsigned int>& indices, size_t indexStart, size_t indexCount, std::vector<MeshCache::MeshCluster>& outClusters)
+{
+	const unsigned int* range = &indices[indexStart];
+	const size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0)
+	{
+		return;
+	}
+
+	RangeAdjacency adjacency;
+	BuildAdjacency(vertices, range, triangleCount * 3, adjacency);
+
+	//Stamped with the cluster being built, so nothing needs clearing between clusters
+	std::vector<unsigned int> vertexCluster(adjacency.VertexCount, NoTriangle);
+	std::vector<unsigned int> candidateCluster(triangleCount, NoTriangle);
+	std::vector<bool> assigned(triangleCount, false);
+	std::vector<unsigned int> localCluster(adjacency.VertexCount, NoTriangle);
+	std::vector<unsigned int> localIndex(adjacency.VertexCount);
+
+	std::vector<unsigned int> reordered;
+	reordered.reserve(triangleCount * 3);
+	std::vector<unsigned int> members;
+	std::vector<unsigned int> candidates;
+	std::vector<unsigned int> clusterIndices;
+	std::vector<unsigned int> clusterVertices;
+
+	unsigned int clusterId = 0;
+	size_t nextSeed = 0;
+
+	while (reordered.size() < triangleCount * 3)
+	{
+		//Start next to the last cluster where it has the fewest free neighbours, so clusters fill the surface in from
+		//one side rather than leaving scattered triangles to the end. Otherwise the first triangle left
+		unsigned int seed = NoTriangle;
+		unsigned int seedNeighbours = 0;
+		for (size_t i = 0; i < candidates.size(); ++i)
+		{
+			unsigned int triangle = candidates[i];
+			if (assigned[triangle])
+			{
+				continue;
+			}
+
+			unsigned int neighbours = 0;
+			for (int k = 0; k < 3; ++k)
+			{
+				unsigned int position = adjacency.Position[triangle * 3 + k];
+				for (unsigned int j = adjacency.Offsets[position]; j < adjacency.Offsets[position + 1]; ++j)
+				{
+					neighbours += assigned[adjacency.Triangles[j]] ? 0 : 1;
+				}
+			}
+
+			if (seed == NoTriangle || neighbours < seedNeighbours)
+			{
+				seed = triangle;
+				seedNeighbours = neighbours;
+			}
+		}
+
+		while (assigned[nextSeed])
+		{
+			++nextSeed;
+		}
+		if (seed == NoTriangle)
+		{
+			seed = (unsigned int)nextSeed;
+		}
+
+		members.clear();
+		candidates.clear();
+		unsigned int vertexCount = 0;
+		float centroid[3] = { 0.0f, 0.0f, 0.0f };
+		float boundsMin[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+		float boundsMax[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+
+		auto newVertices = [&](unsigned int triangle)
+		{
+			unsigned int count = 0;
+			for (int k = 0; k < 3; ++k)
+			{
+				count += (vertexCluster[adjacency.Vertex[triangle * 3 + k]] != clusterId) ? 1 : 0;
+			}
+			return count;
+		};
+
+		auto add = [&](unsigned int triangle)
+		{
+			assigned[triangle] = true;
+			members.push_back(triangle);
+			for (int k = 0; k < 3; ++k)
+			{
+				unsigned int vertex = adjacency.Vertex[triangle * 3 + k];
+				if (vertexCluster[vertex] != clusterId)
+				{
+					vertexCluster[vertex] = clusterId;
+					++vertexCount;
+				}
+
+				const XMFLOAT3& p = vertices[range[triangle * 3 + k]].Pos;
+				centroid[0] += p.x;
+				centroid[1] += p.y;
+				centroid[2] += p.z;
+				boundsMin[0] = std::min(boundsMin[0], p.x);
+				boundsMin[1] = std::min(boundsMin[1], p.y);
+				boundsMin[2] = std::min(boundsMin[2], p.z);
+				boundsMax[0] = std::max(boundsMax[0], p.x);
+				boundsMax[1] = std::max(boundsMax[1], p.y);
+				boundsMax[2] = std::max(boundsMax[2], p.z);
+
+				unsigned int position = adjacency.Position[triangle * 3 + k];
+				for (unsigned int j = adjacency.Offsets[position]; j < adjacency.Offsets[position + 1]; ++j)
+				{
+					unsigned int neighbour = adjacency.Triangles[j];
+					if (!assigned[neighbour] && candidateCluster[neighbour] != clusterId)
+					{
+						candidateCluster[neighbour] = clusterId;
+						candidates.push_back(neighbour);
+					}
+				}
+			}
+		};
+
+		add(seed);
+
+		while (members.size() < MaxTriangles)
+		{
+			//The neighbour nearest the middle so the cluster stays round, counted as further away for each vertex it adds
+			float scale = 1.0f / (members.size() * 3);
+			float middle[3] = { centroid[0] * scale, centroid[1] * scale, centroid[2] * scale };
+
+			unsigned int best = NoTriangle;
+			float bestDistance = 0.0f;
+			size_t kept = 0;
+			for (size_t i = 0; i < candidates.size(); ++i)
+			{
+				unsigned int triangle = candidates[i];
+				if (assigned[triangle])
+				{
+					continue;
+				}
+				candidates[kept++] = triangle;
+
+				unsigned int added = newVertices(triangle);
+				if (vertexCount + added > MaxVertices)
+				{
+					continue;
+				}
+
+				float distance = 0.0f;
+				for (int k = 0; k < 3; ++k)
+				{
+					const XMFLOAT3& p = vertices[range[triangle * 3 + k]].Pos;
+					float dx = p.x - middle[0], dy = p.y - middle[1], dz = p.z - middle[2];
+					distance += dx * dx + dy * dy + dz * dz;
+				}
+
+				distance *= 1.0f + added;
+				if (best == NoTriangle || distance < bestDistance)
+				{
+					best = triangle;
+					bestDistance = distance;
+				}
+			}
+			candidates.resize(kept);
+
+			//Nothing connected fits (an island, or a triangle soup), so try the next few triangles in the old order, which
+			//are often nearby. Only one that lands inside the cluster's box grown by half its size on each side will do,
+			//anything further would only stretch the bounds
+			if (best == NoTriangle)
+			{
+				unsigned int looked = 0;
+				for (size_t next = nextSeed; next < triangleCount && looked < NearbySearch; ++next)
+				{
+					if (assigned[next])
+					{
+						continue;
+					}
+					++looked;
+
+					if (vertexCount + newVertices((unsigned int)next) > MaxVertices)
+					{
+						continue;
+					}
+
+					bool inside = true;
+					float distance = 0.0f;
+					for (int k = 0; k < 3; ++k)
+					{
+						const XMFLOAT3& p = vertices[range[next * 3 + k]].Pos;
+						const float point[3] = { p.x, p.y, p.z };
+						for (int axis = 0; axis < 3; ++axis)
+						{
+							float margin = (boundsMax[axis] - boundsMin[axis]) * 0.5f;
+							inside = inside && point[axis] >= boundsMin[axis] - margin && point[axis] <= boundsMax[axis] + margin;
+							distance += (point[axis] - middle[axis]) * (point[axis] - middle[axis]);
+						}
+					}
+
+					if (inside && (best == NoTriangle || distance < bestDistance))
+					{
+						best = (unsigned int)next;
+						bestDistance = distance;
+					}
+				}
+
+				if (best == NoTriangle)
+				{
+					break;
+				}
+			}
+
+			add(best);
+		}
+
+		//A cluster's vertices nearly fit the post-transform cache, so order its triangles for the cache again on their own,
+		//numbered from 0 so it costs the size of the cluster rather than the mesh
+		clusterIndices.clear();
+		clusterVertices.clear();
+		for (size_t i = 0; i < members.size(); ++i)
+		{
+			for (int k = 0; k < 3; ++k)
+			{
+				unsigned int corner = members[i] * 3 + k;
+				unsigned int vertex = adjacency.Vertex[corner];
+				if (localCluster[vertex] != clusterId)
+				{
+					localCluster[vertex] = clusterId;
+					localIndex[vertex] = (unsigned int)clusterVertices.size();
+					clusterVertices.push_back(range[corner]);
+				}
+				clusterIndices.push_back(localIndex[vertex]);
+			}
+		}
+		MeshOptimiser::OptimiseVertexCache(clusterIndices, (unsigned int)clusterVertices.size());
+
+		MeshCache::MeshCluster cluster;
+		cluster.IndexStart = (uint32_t)(indexStart + reordered.size());
+		cluster.IndexCount = (uint32_t)(members.size() * 3);
+		for (size_t i = 0; i < clusterIndices.size(); ++i)
+		{
+			reordered.push_back(clusterVertices[clusterIndices[i]]);
+		}
+		ComputeBounds(vertices, &reordered[cluster.IndexStart - indexStart], cluster.IndexCount, cluster);
+		outClusters.push_back(cluster);
+
+		++clusterId;
+	}
+
+	std::copy(reordered.begin(), reordered.end(), indices.begin() + indexStart);
+}
+
+void MeshClusters::MakeFrustum(const float worldViewProjection[4][4], const float eye[3], float padding, HiddenFaces hidden, Frustum& outFrustum)
+{
+	//Gribb & Hartmann: each clip space bound is a plane made of the matrix's columns. -w <= x <= w, -w <= y <= w, 0 <= z <= w
+	const int column[6] = { 0, 0, 1, 1, 2, 2 };
+	const float sign[6] = { 1.0f, -1.0f, 1.0f, -1.0f, 1.0f, -1.0f };
+	const float withW[6] = { 1.0f, 1.0f, 1.0f, 1.0f, 0.0f, 1.0f };
+
+	for (int i = 0; i < 6; ++i)
+	{
+		float* plane = outFrustum.Planes[i];
+		for (int k = 0; k < 4; ++k)
+		{
+			plane[k] = withW[i] * worldViewProjection[k][3] + sign[i] * worldViewProjection[k][column[i]];
+		}
+
+		float length = sqrtf(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+		for (int k = 0; k < 4; ++k)
+		{
+			plane[k] = (length > 0.0f) ? plane[k] / length : 0.0f;
+		}
+	}
+
+	outFrustum.Eye[0] = eye[0];
+	outFrustum.Eye[1] = eye[1];
+	outFrustum.Eye[2] = eye[2];
+	outFrustum.Padding = padding;
+	outFrustum.Hidden = hidden;
+}
+
+bool MeshClusters::IsVisible(const MeshCache::MeshCluster& cluster, const Frustum& frustum)
+{
+	const float radius = cluster.Radius + frustum.Padding;
+
+	for (int i = 0; i < 6; ++i)
+	{
+		const float* plane = frustum.Planes[i];
+		if (plane[0] * cluster.Centre[0] + plane[1] * cluster.Centre[1] + plane[2] * cluster.Centre[2] + plane[3] < -radius)
+		{
+			return false;
+		}
+	}
+
+	if (frustum.Hidden == HiddenFacesNone)
+	{
+		return true;
+	}
+
+	//The whole sphere sees the cluster's triangles from their hidden side if the direction to it is far enough round
+	//from the cone's axis, allowing for the sphere's size
+	float toCluster[3] = { cluster.Centre[0] - frustum.Eye[0], cluster.Centre[1] - frustum.Eye[1], cluster.Centre[2] - frustum.Eye[2] };
+	float distance = sqrtf(toCluster[0] * toCluster[0] + toCluster[1] * toCluster[1] + toCluster[2] * toCluster[2]);
+	float along = toCluster[0] * cluster.ConeAxis[0] + toCluster[1] * cluster.ConeAxis[1] + toCluster[2] * cluster.ConeAxis[2];
+	if (frustum.Hidden == HiddenFacesFront)
+	{
+		along = -along;
+	}
+
+	return along < cluster.ConeCutoff * distance + radius;
+}
+
+size_t MeshClusters::Cull(const MeshCache::MeshCluster* clusters, size_t clusterCount, const MeshCache::Submesh& submesh, const Frustum& frustum, std::vector<MeshCache::Submesh>& outRanges)
+{
+	const uint32_t end = submesh.IndexStart + submesh.IndexCount;
+
+	//Clusters are in index buffer order, so the submesh's are one run of them
+	const MeshCache::MeshCluster* first = std::lower_bound(clusters, clusters + clusterCount, submesh.IndexStart,
+		[](const MeshCache::MeshCluster& cluster, uint32_t start) { return cluster.IndexStart < start; });
+
+	if (first == clusters + clusterCount || first->IndexStart != submesh.IndexStart)
+	{
+		outRanges.push_back(submesh);
+		return 0;
+	}
+
+	size_t culled = 0;
+	bool merging = false;
+	for (const MeshCache::MeshCluster* cluster = first; cluster != clusters + clusterCount && cluster->IndexStart < end; ++cluster)
+	{
+		if (!IsVisible(*cluster, frustum))
+		{
+			culled += cluster->IndexCount / 3;
+			merging = false;
+			continue;
+		}
+
+		if (merging)
+		{
+			outRanges.back().IndexCount += cluster->IndexCount;
+		}
+		else
+		{
+			MeshCache::Submesh visible = { cluster->IndexStart, cluster->IndexCount, submesh.MaterialId, 0 };
+			outRanges.push_back(visible);
+			merging = true;
+		}
+	}
+
+	return culled;
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include <vector>
+#include "MeshTypes.h"
+#include "MeshCache.h"
+
+//Splits meshes into clusters of up to a hundred or so neighbouring triangles, each with a bounding sphere and a cone
+//holding its normals, so the CPU can skip the parts of a mesh that are off screen or facing the wrong way instead of
+//only whole meshes. Clusters are runs of the existing index buffer, so a culled submesh is still drawn with a few
+//DrawIndexed calls from the same buffers.
+namespace MeshClusters
+{
+	//A cluster is cut off at whichever of these it reaches first
+	const unsigned int MaxTriangles = 128;
+	const unsigned int MaxVertices = 64;
+
+	//Reorders the triangles of indices[indexStart, indexStart + indexCount) into clusters and appends their bounds to
+	//outClusters. Each cluster grows out over shared edges from the first triangle left in the range, so clusters come
+	//out in roughly the order the range was in, and its own triangles are ordered for the vertex cache
+	void Build(const std::vector<SimpleVertex>& vertices, std::vector<unsigned int>& indices, size_t indexStart, size_t indexCount, std::vector<MeshCache::MeshCluster>& outClusters);
+
+	//Which side of a cluster's triangles can't be seen. The outside is the side the vertex normals point to
+	enum HiddenFaces
+	{
+		HiddenFacesNone = 0,	//Both sides can show, only cull what's off screen
+		HiddenFacesBack = 1,	//The inside, for closed meshes seen from outside and ground seen from above
+		HiddenFacesFront = 2,	//The outside, for closed meshes seen from inside like the sky
+	};
+
+	//What to cull against, all in the mesh's own space so clusters are tested as they're stored
+	struct Frustum
+	{
+		float Planes[6][4];		//ax + by + cz + d >= 0 on the inside, (a, b, c) unit length
+		float Eye[3];
+		float Padding;			//Added to every cluster's radius, for meshes the vertex shader moves about
+		HiddenFaces Hidden;
+	};
+
+	//The planes of a row-vector world * view * projection matrix (Direct3D clip space, 0 <= z <= w), as XMMATRIX stores it.
+	//eye is the camera position in mesh space. The cone test assumes the world matrix scales all three axes alike
+	void MakeFrustum(const float worldViewProjection[4][4], const float eye[3], float padding, HiddenFaces hidden, Frustum& outFrustum);
+
+	//False if the cluster is entirely off screen, or every one of its triangles has its hidden side to the eye
+	bool IsVisible(const MeshCache::MeshCluster& cluster, const Frustum& frustum);
+
+	//Appends the draw ranges of submesh's clusters that pass IsVisible to outRanges, neighbouring ones merged into one
+	//range with the submesh's material. A submesh without clusters is appended whole. Returns how many triangles were culled
+	size_t Cull(const MeshCache::MeshCluster* clusters, size_t clusterCount, const MeshCache::Submesh& submesh, const Frustum& frustum, std::vector<MeshCache::Submesh>& outRanges);
+};
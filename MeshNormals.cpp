@@ -0,0 +1,124 @@
+#include "MeshNormals.h"
+#include "Simd.h"
+#include <math.h>
+#include <string.h>
+
+namespace
+{
+	const XMFLOAT3 up(0.0f, 1.0f, 0.0f);
+
+	//(b - a) x (c - a), which faces the viewer for a clockwise triangle in D3D's left handed space
+	inline void Cross(const XMFLOAT3& a, const XMFLOAT3& b, const XMFLOAT3& c, float out[3])
+	{
+		float e1x = b.x - a.x, e1y = b.y - a.y, e1z = b.z - a.z;
+		float e2x = c.x - a.x, e2y = c.y - a.y, e2z = c.z - a.z;
+
+		out[0] = e1y * e2z - e1z * e2y;
+		out[1] = e1z * e2x - e1x * e2z;
+		out[2] = e1x * e2y - e1y * e2x;
+	}
+
+	inline XMFLOAT3 Normalise(float x, float y, float z)
+	{
+		float lengthSquared = x * x + y * y + z * z;
+		if (!(lengthSquared > 0.0f))
+		{
+			return up;
+		}
+
+		float inverseLength = 1.0f / sqrtf(lengthSquared);
+		return XMFLOAT3(x * inverseLength, y * inverseLength, z * inverseLength);
+	}
+}
+
+XMFLOAT3 MeshNormals::FaceNormal(const XMFLOAT3& a, const XMFLOAT3& b, const XMFLOAT3& c)
+{
+	float normal[3];
+	Cross(a, b, c, normal);
+	return Normalise(normal[0], normal[1], normal[2]);
+}
+
+void MeshNormals::AccumulateSmooth(const XMFLOAT3* positions, const unsigned int* triangles, size_t triangleCount, float* accumulated)
+{
+	for (size_t t = 0; t < triangleCount; ++t)
+	{
+		const unsigned int* corners = triangles + t * 3;
+		const XMFLOAT3& a = positions[corners[0]];
+		const XMFLOAT3& b = positions[corners[1]];
+		const XMFLOAT3& c = positions[corners[2]];
+
+#ifdef SIMD_SSE2
+		//Cross product with the usual yzx/zxy shuffles, then one 4-wide add per corner
+		__m128 pa = _mm_setr_ps(a.x, a.y, a.z, 0.0f);
+		__m128 e1 = _mm_sub_ps(_mm_setr_ps(b.x, b.y, b.z, 0.0f), pa);
+		__m128 e2 = _mm_sub_ps(_mm_setr_ps(c.x, c.y, c.z, 0.0f), pa);
+
+		__m128 e1yzx = _mm_shuffle_ps(e1, e1, _MM_SHUFFLE(3, 0, 2, 1));
+		__m128 e2yzx = _mm_shuffle_ps(e2, e2, _MM_SHUFFLE(3, 0, 2, 1));
+		__m128 e1zxy = _mm_shuffle_ps(e1, e1, _MM_SHUFFLE(3, 1, 0, 2));
+		__m128 e2zxy = _mm_shuffle_ps(e2, e2, _MM_SHUFFLE(3, 1, 0, 2));
+		__m128 normal = _mm_sub_ps(_mm_mul_ps(e1yzx, e2zxy), _mm_mul_ps(e1zxy, e2yzx));
+
+		for (int k = 0; k < 3; ++k)
+		{
+			float* sum = accumulated + corners[k] * 4;
+			_mm_storeu_ps(sum, _mm_add_ps(_mm_loadu_ps(sum), normal));
+		}
+#else
+		float normal[3];
+		Cross(a, b, c, normal);
+
+		for (int k = 0; k < 3; ++k)
+		{
+			float* sum = accumulated + corners[k] * 4;
+			sum[0] += normal[0];
+			sum[1] += normal[1];
+			sum[2] += normal[2];
+		}
+#endif
+	}
+}
+
+void MeshNormals::NormaliseSmooth(const float* accumulated, size_t count, XMFLOAT3* outNormals)
+{
+	size_t i = 0;
+
+#ifdef SIMD_SSE2
+	//Four at a time: transpose to x/y/z/w vectors, normalise, transpose back
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.0f);
+
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 x = _mm_loadu_ps(accumulated + i * 4);
+		__m128 y = _mm_loadu_ps(accumulated + i * 4 + 4);
+		__m128 z = _mm_loadu_ps(accumulated + i * 4 + 8);
+		__m128 w = _mm_loadu_ps(accumulated + i * 4 + 12);
+		_MM_TRANSPOSE4_PS(x, y, z, w);
+
+		__m128 lengthSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z));
+		__m128 inverseLength = _mm_div_ps(one, _mm_sqrt_ps(lengthSquared));
+		int valid = _mm_movemask_ps(_mm_cmpgt_ps(lengthSquared, zero));
+
+		x = _mm_mul_ps(x, inverseLength);
+		y = _mm_mul_ps(y, inverseLength);
+		z = _mm_mul_ps(z, inverseLength);
+		w = zero;
+		_MM_TRANSPOSE4_PS(x, y, z, w);
+
+		__m128 normals[4] = { x, y, z, w };
+		for (int k = 0; k < 4; ++k)
+		{
+			float lanes[4];
+			_mm_storeu_ps(lanes, normals[k]);
+			outNormals[i + k] = (valid & (1 << k)) ? XMFLOAT3(lanes[0], lanes[1], lanes[2]) : up;
+		}
+	}
+#endif
+
+	for (; i < count; ++i)
+	{
+		const float* sum = accumulated + i * 4;
+		outNormals[i] = Normalise(sum[0], sum[1], sum[2]);
+	}
+}
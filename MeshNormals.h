@@ -0,0 +1,19 @@
+#pragma once
+#include "MeshTypes.h"
+
+//Normals for meshes whose OBJ didn't come with any.
+//Smooth normals are the area weighted average of every triangle around a position: each triangle adds the
+//unnormalised cross product of its edges (whose length is twice its area) to its three positions, and the sums are
+//normalised once every triangle is in. Sums are kept as 4 floats per position so they can be added with SSE.
+namespace MeshNormals
+{
+	//Unit normal of a triangle, wound the D3D way (clockwise is the front). Degenerate triangles get +Y
+	XMFLOAT3 FaceNormal(const XMFLOAT3& a, const XMFLOAT3& b, const XMFLOAT3& c);
+
+	//Adds each triangle's area weighted normal to accumulated[4 * position] for its three positions.
+	//'triangles' holds 3 position indices per triangle
+	void AccumulateSmooth(const XMFLOAT3* positions, const unsigned int* triangles, size_t triangleCount, float* accumulated);
+
+	//Normalises count accumulated sums into outNormals. Positions no triangle touched get +Y
+	void NormaliseSmooth(const float* accumulated, size_t count, XMFLOAT3* outNormals);
+};
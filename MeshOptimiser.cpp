@@ -0,0 +1,352 @@
+#include "MeshOptimiser.h"
+#include <algorithm>
+#include <math.h>
+
+namespace
+{
+	//Forsyth's tuning values, see "Linear-Speed Vertex Cache Optimisation" (2006)
+	const int ForsythCacheSize = 32;
+	const float CacheDecayPower = 1.5f;
+	const float LastTriangleScore = 0.75f;
+	const float ValenceBoostScale = 2.0f;
+	const float ValenceBoostPower = 0.5f;
+
+	float VertexScore(int cachePosition, unsigned int remainingTriangles)
+	{
+		if (remainingTriangles == 0)
+		{
+			//No triangles left to draw with this vertex, so it's of no use to anyone
+			return -1.0f;
+		}
+
+		float score = 0.0f;
+		if (cachePosition >= 0)
+		{
+			if (cachePosition < 3)
+			{
+				//Used by the triangle we just added, deliberately a flat score so we don't favour strips too much
+				score = LastTriangleScore;
+			}
+			else
+			{
+				const float scaler = 1.0f / (ForsythCacheSize - 3);
+				score = powf(1.0f - (cachePosition - 3) * scaler, CacheDecayPower);
+			}
+		}
+
+		//Bonus for vertices with few triangles left, so we finish them off rather than leaving lone triangles for later
+		score += ValenceBoostScale * powf((float)remainingTriangles, -ValenceBoostPower);
+
+		return score;
+	}
+
+	//Runs a FIFO cache over triangles [first, last) and returns how many vertices missed
+	unsigned int CountCacheMisses(const unsigned int* indices, size_t first, size_t last, std::vector<unsigned int>& timestamps, unsigned int& time, unsigned int cacheSize)
+	{
+		unsigned int misses = 0;
+		for (size_t i = first * 3; i < last * 3; ++i)
+		{
+			unsigned int vertex = indices[i];
+			if (time - timestamps[vertex] > cacheSize)
+			{
+				timestamps[vertex] = time++;
+				++misses;
+			}
+		}
+		return misses;
+	}
+}
+
+MeshOptimiser::CacheStats MeshOptimiser::AnalyseVertexCache(const std::vector<unsigned int>& indices, unsigned int vertexCount, unsigned int cacheSize)
+{
+	return AnalyseVertexCache(indices.data(), indices.size(), vertexCount, cacheSize);
+}
+
+MeshOptimiser::CacheStats MeshOptimiser::AnalyseVertexCache(const unsigned int* indices, size_t indexCount, unsigned int vertexCount, unsigned int cacheSize)
+{
+	CacheStats stats = { 0.0f, 0.0f };
+
+	size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0 || vertexCount == 0)
+	{
+		return stats;
+	}
+
+	//A vertex is in the cache if fewer than cacheSize other vertices have been loaded since it was
+	std::vector<unsigned int> timestamps(vertexCount, 0);
+	unsigned int time = cacheSize + 1;
+	unsigned int misses = CountCacheMisses(indices, 0, triangleCount, timestamps, time, cacheSize);
+
+	std::vector<bool> used(vertexCount, false);
+	unsigned int uniqueVertices = 0;
+	for (size_t i = 0; i < indexCount; ++i)
+	{
+		if (!used[indices[i]])
+		{
+			used[indices[i]] = true;
+			++uniqueVertices;
+		}
+	}
+
+	stats.ACMR = (float)misses / triangleCount;
+	stats.ATVR = (float)misses / uniqueVertices;
+	return stats;
+}
+
+void MeshOptimiser::OptimiseVertexCache(std::vector<unsigned int>& indices, unsigned int vertexCount)
+{
+	unsigned int triangleCount = (unsigned int)(indices.size() / 3);
+	if (triangleCount == 0)
+	{
+		return;
+	}
+
+	//Build vertex -> triangle adjacency in one flat array
+	std::vector<unsigned int> triangleCounts(vertexCount, 0);
+	for (size_t i = 0; i < triangleCount * 3; ++i)
+	{
+		++triangleCounts[indices[i]];
+	}
+
+	std::vector<unsigned int> adjacencyOffsets(vertexCount + 1, 0);
+	for (unsigned int v = 0; v < vertexCount; ++v)
+	{
+		adjacencyOffsets[v + 1] = adjacencyOffsets[v] + triangleCounts[v];
+	}
+
+	std::vector<unsigned int> adjacency(triangleCount * 3);
+	std::vector<unsigned int> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+	for (unsigned int t = 0; t < triangleCount; ++t)
+	{
+		for (int k = 0; k < 3; ++k)
+		{
+			unsigned int v = indices[t * 3 + k];
+			adjacency[fill[v]++] = t;
+		}
+	}
+
+	//Triangles still to be emitted are kept at the front of each vertex's adjacency list
+	std::vector<unsigned int> remaining(triangleCounts);
+	std::vector<int> cachePosition(vertexCount, -1);
+	std::vector<float> vertexScores(vertexCount);
+	for (unsigned int v = 0; v < vertexCount; ++v)
+	{
+		vertexScores[v] = VertexScore(-1, remaining[v]);
+	}
+
+	std::vector<bool> emitted(triangleCount, false);
+
+	std::vector<unsigned int> output;
+	output.reserve(indices.size());
+
+	//LRU cache with room for the 3 vertices being pushed in on top
+	unsigned int cache[ForsythCacheSize + 3];
+	int cacheCount = 0;
+
+	unsigned int bestTriangle = 0;
+	unsigned int scanPosition = 0;	//Where the linear search for a fresh start triangle picks up from
+
+	for (unsigned int emittedCount = 0; emittedCount < triangleCount; ++emittedCount)
+	{
+		if (bestTriangle == ~0u)
+		{
+			//Nothing in the cache touches an unemitted triangle, find the next one that hasn't been drawn
+			while (emitted[scanPosition]) ++scanPosition;
+			bestTriangle = scanPosition;
+		}
+
+		const unsigned int* triangle = &indices[bestTriangle * 3];
+		output.push_back(triangle[0]);
+		output.push_back(triangle[1]);
+		output.push_back(triangle[2]);
+		emitted[bestTriangle] = true;
+
+		//Push the triangle's vertices to the front of the cache, dropping any older copies of them
+		unsigned int newCache[ForsythCacheSize + 3];
+		int newCount = 0;
+		for (int k = 0; k < 3; ++k)
+		{
+			newCache[newCount++] = triangle[k];
+		}
+		for (int i = 0; i < cacheCount; ++i)
+		{
+			unsigned int v = cache[i];
+			if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+			{
+				newCache[newCount++] = v;
+			}
+		}
+
+		//Take the triangle out of its vertices' adjacency lists
+		for (int k = 0; k < 3; ++k)
+		{
+			unsigned int v = triangle[k];
+			unsigned int* list = &adjacency[adjacencyOffsets[v]];
+			for (unsigned int i = 0; i < remaining[v]; ++i)
+			{
+				if (list[i] == bestTriangle)
+				{
+					list[i] = list[remaining[v] - 1];
+					break;
+				}
+			}
+			--remaining[v];
+		}
+
+		//Rescore everything that was in the cache (including anything that just fell out of it)
+		for (int i = 0; i < newCount; ++i)
+		{
+			unsigned int v = newCache[i];
+			cachePosition[v] = (i < ForsythCacheSize) ? i : -1;
+			vertexScores[v] = VertexScore(cachePosition[v], remaining[v]);
+		}
+
+		//Rescore the triangles touching cached vertices and pick the best one for the next round
+		float bestScore = -1.0f;
+		bestTriangle = ~0u;
+		for (int i = 0; i < newCount; ++i)
+		{
+			unsigned int v = newCache[i];
+			const unsigned int* list = &adjacency[adjacencyOffsets[v]];
+			for (unsigned int j = 0; j < remaining[v]; ++j)
+			{
+				unsigned int t = list[j];
+				float score = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+
+				if (score > bestScore)
+				{
+					bestScore = score;
+					bestTriangle = t;
+				}
+			}
+		}
+
+		cacheCount = std::min(newCount, ForsythCacheSize);
+		std::copy(newCache, newCache + cacheCount, cache);
+	}
+
+	indices.swap(output);
+}
+
+void MeshOptimiser::OptimiseOverdraw(std::vector<unsigned int>& indices, const std::vector<SimpleVertex>& vertices, float threshold)
+{
+	const unsigned int cacheSize = 16;
+
+	size_t triangleCount = indices.size() / 3;
+	if (triangleCount < 2)
+	{
+		return;
+	}
+
+	float targetACMR = AnalyseVertexCache(indices, (unsigned int)vertices.size(), cacheSize).ACMR * threshold;
+
+	//Split into clusters. A cluster can end wherever starting over with a cold cache keeps it within the ACMR budget
+	std::vector<size_t> clusterStarts;
+	std::vector<unsigned int> timestamps(vertices.size(), 0);
+	unsigned int time = cacheSize + 1;
+	unsigned int clusterMisses = 0;
+	size_t clusterStart = 0;
+
+	clusterStarts.push_back(0);
+	for (size_t t = 0; t < triangleCount; ++t)
+	{
+		clusterMisses += CountCacheMisses(indices.data(), t, t + 1, timestamps, time, cacheSize);
+
+		size_t clusterTriangles = t + 1 - clusterStart;
+		if (t + 1 < triangleCount && (float)clusterMisses / clusterTriangles <= targetACMR)
+		{
+			clusterStart = t + 1;
+			clusterStarts.push_back(clusterStart);
+			clusterMisses = 0;
+			time += cacheSize + 1; //Flush so the next cluster is measured from a cold cache
+		}
+	}
+	clusterStarts.push_back(triangleCount);
+
+	//Mesh centroid
+	float meshCentre[3] = { 0.0f, 0.0f, 0.0f };
+	for (size_t v = 0; v < vertices.size(); ++v)
+	{
+		meshCentre[0] += vertices[v].Pos.x;
+		meshCentre[1] += vertices[v].Pos.y;
+		meshCentre[2] += vertices[v].Pos.z;
+	}
+	for (int k = 0; k < 3; ++k) meshCentre[k] /= (float)vertices.size();
+
+	//Sort key per cluster: how much its area-weighted normal faces away from the centre of the mesh
+	size_t clusterCount = clusterStarts.size() - 1;
+	std::vector<float> sortKeys(clusterCount);
+	for (size_t c = 0; c < clusterCount; ++c)
+	{
+		float centre[3] = { 0.0f, 0.0f, 0.0f };
+		float normal[3] = { 0.0f, 0.0f, 0.0f };
+		float area = 0.0f;
+
+		for (size_t t = clusterStarts[c]; t < clusterStarts[c + 1]; ++t)
+		{
+			const XMFLOAT3& a = vertices[indices[t * 3]].Pos;
+			const XMFLOAT3& b = vertices[indices[t * 3 + 1]].Pos;
+			const XMFLOAT3& p = vertices[indices[t * 3 + 2]].Pos;
+
+			float e1[3] = { b.x - a.x, b.y - a.y, b.z - a.z };
+			float e2[3] = { p.x - a.x, p.y - a.y, p.z - a.z };
+			float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+			float triangleArea = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+			centre[0] += (a.x + b.x + p.x) * triangleArea;
+			centre[1] += (a.y + b.y + p.y) * triangleArea;
+			centre[2] += (a.z + b.z + p.z) * triangleArea;
+			normal[0] += n[0];
+			normal[1] += n[1];
+			normal[2] += n[2];
+			area += triangleArea;
+		}
+
+		float key = 0.0f;
+		if (area > 0.0f)
+		{
+			for (int k = 0; k < 3; ++k)
+			{
+				centre[k] = centre[k] / (3.0f * area) - meshCentre[k];
+			}
+			key = (centre[0] * normal[0] + centre[1] * normal[1] + centre[2] * normal[2]) / area;
+		}
+		sortKeys[c] = key;
+	}
+
+	std::vector<size_t> order(clusterCount);
+	for (size_t c = 0; c < clusterCount; ++c) order[c] = c;
+	std::stable_sort(order.begin(), order.end(), [&sortKeys](size_t a, size_t b) { return sortKeys[a] > sortKeys[b]; });
+
+	std::vector<unsigned int> output;
+	output.reserve(indices.size());
+	for (size_t i = 0; i < clusterCount; ++i)
+	{
+		size_t c = order[i];
+		output.insert(output.end(), indices.begin() + clusterStarts[c] * 3, indices.begin() + clusterStarts[c + 1] * 3);
+	}
+
+	indices.swap(output);
+}
+
+void MeshOptimiser::OptimiseVertexFetch(std::vector<SimpleVertex>& vertices, std::vector<unsigned int>& indices)
+{
+	const unsigned int unassigned = ~0u;
+	std::vector<unsigned int> remap(vertices.size(), unassigned);
+
+	std::vector<SimpleVertex> output;
+	output.reserve(vertices.size());
+
+	for (size_t i = 0; i < indices.size(); ++i)
+	{
+		unsigned int& newIndex = remap[indices[i]];
+		if (newIndex == unassigned)
+		{
+			newIndex = (unsigned int)output.size();
+			output.push_back(vertices[indices[i]]);
+		}
+		indices[i] = newIndex;
+	}
+
+	vertices.swap(output);
+}
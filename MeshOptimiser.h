@@ -0,0 +1,34 @@
+#pragma once
+#include <vector>
+#include "MeshTypes.h"
+
+//Offline reordering passes for triangle lists, run on the CPU before a mesh is written to its .objBinary cache.
+//Nothing here changes what gets drawn, only the order it's stored in.
+namespace MeshOptimiser
+{
+	//Post-transform cache statistics from simulating a FIFO vertex cache over an index buffer.
+	//ACMR = transformed vertices per triangle (0.5 is ideal for big grids, 3 is the worst case)
+	//ATVR = transformed vertices per unique vertex (1.0 is ideal)
+	struct CacheStats
+	{
+		float ACMR;
+		float ATVR;
+	};
+
+	CacheStats AnalyseVertexCache(const std::vector<unsigned int>& indices, unsigned int vertexCount, unsigned int cacheSize = 16);
+
+	//The same over indices[0, indexCount), so one level of detail of a buffer holding several can be measured on its own
+	CacheStats AnalyseVertexCache(const unsigned int* indices, size_t indexCount, unsigned int vertexCount, unsigned int cacheSize = 16);
+
+	//Reorders triangles for vertex reuse using Tom Forsyth's linear-speed vertex cache optimisation
+	void OptimiseVertexCache(std::vector<unsigned int>& indices, unsigned int vertexCount);
+
+	//Tipsify-style overdraw pass: cuts the (already cache optimised) triangle order into clusters wherever that
+	//costs little cache efficiency, then draws outward-facing clusters first so they occlude the rest.
+	//'threshold' is how much ACMR we're willing to give up, 1.05 = 5%
+	void OptimiseOverdraw(std::vector<unsigned int>& indices, const std::vector<SimpleVertex>& vertices, float threshold = 1.05f);
+
+	//Renumbers vertices in the order the index buffer first uses them so vertex data is fetched linearly.
+	//Unreferenced vertices are dropped
+	void OptimiseVertexFetch(std::vector<SimpleVertex>& vertices, std::vector<unsigned int>& indices);
+};
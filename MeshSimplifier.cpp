@@ -0,0 +1,552 @@
+#include "MeshSimplifier.h"
+#include <algorithm>
+#include <math.h>
+#include <stdint.h>
+
+namespace
+{
+	//Open borders count this much more than the surface, so the outline of open meshes (and the boundaries between
+	//submeshes, which are simplified separately) holds its shape
+	const double BorderWeight = 10.0;
+
+	//A collapse can't tip any triangle around it further over than this (cosine of the angle between old and new normals)
+	const double MinNormalDot = 0.25;
+
+	//Per position in a pass
+	enum PositionState
+	{
+		PositionFree = 0,
+		PositionPinned = 1,		//On a non-manifold edge, never moves
+		PositionTouched = 2,	//Its neighbourhood changed this pass, so its adjacency is out of date until the next
+	};
+
+	//Sum of squared distances to a set of weighted planes, Q(x) = xAx + 2bx + c, plus the total weight
+	struct Quadric
+	{
+		double A00, A01, A02, A11, A12, A22;
+		double B0, B1, B2;
+		double C;
+		double Weight;
+	};
+
+	//Plane nx + d = 0, n unit length
+	void AddPlane(Quadric& q, const double n[3], double d, double weight)
+	{
+		q.A00 += n[0] * n[0] * weight;
+		q.A01 += n[0] * n[1] * weight;
+		q.A02 += n[0] * n[2] * weight;
+		q.A11 += n[1] * n[1] * weight;
+		q.A12 += n[1] * n[2] * weight;
+		q.A22 += n[2] * n[2] * weight;
+		q.B0 += n[0] * d * weight;
+		q.B1 += n[1] * d * weight;
+		q.B2 += n[2] * d * weight;
+		q.C += d * d * weight;
+		q.Weight += weight;
+	}
+
+	void AddQuadric(Quadric& q, const Quadric& other)
+	{
+		q.A00 += other.A00;
+		q.A01 += other.A01;
+		q.A02 += other.A02;
+		q.A11 += other.A11;
+		q.A12 += other.A12;
+		q.A22 += other.A22;
+		q.B0 += other.B0;
+		q.B1 += other.B1;
+		q.B2 += other.B2;
+		q.C += other.C;
+		q.Weight += other.Weight;
+	}
+
+	double Evaluate(const Quadric& q, const XMFLOAT3& p)
+	{
+		double x = p.x, y = p.y, z = p.z;
+		double error = q.A00 * x * x + q.A11 * y * y + q.A22 * z * z + 2.0 * (q.A01 * x * y + q.A02 * x * z + q.A12 * y * z) +
+			2.0 * (q.B0 * x + q.B1 * y + q.B2 * z) + q.C;
+
+		//Rounding can take it just below zero
+		return (error > 0.0) ? error : 0.0;
+	}
+
+	//Error of moving 'from' onto p, per unit of weight so it reads as a mean squared distance whatever the triangle sizes
+	double CollapseCost(const Quadric& from, const Quadric& to, const XMFLOAT3& p)
+	{
+		double weight = from.Weight + to.Weight;
+		return (weight > 0.0) ? (Evaluate(from, p) + Evaluate(to, p)) / weight : 0.0;
+	}
+
+	//Unnormalised normal of triangle abc
+	void TriangleNormal(const XMFLOAT3& a, const XMFLOAT3& b, const XMFLOAT3& c, double out[3])
+	{
+		double e1[3] = { (double)b.x - a.x, (double)b.y - a.y, (double)b.z - a.z };
+		double e2[3] = { (double)c.x - a.x, (double)c.y - a.y, (double)c.z - a.z };
+		out[0] = e1[1] * e2[2] - e1[2] * e2[1];
+		out[1] = e1[2] * e2[0] - e1[0] * e2[2];
+		out[2] = e1[0] * e2[1] - e1[1] * e2[0];
+	}
+
+	double Length(const double v[3])
+	{
+		return sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+	}
+
+	struct Collapse
+	{
+		unsigned int From;		//Positions
+		unsigned int To;
+		double Cost;
+
+		//Ties broken by position so the order (and so the result) doesn't depend on the library's sort
+		bool operator<(const Collapse& other) const
+		{
+			if (Cost != other.Cost) return Cost < other.Cost;
+			return (From != other.From) ? From < other.From : To < other.To;
+		}
+	};
+
+	//Everything one pass over the current triangles knows about them
+	struct Pass
+	{
+		std::vector<unsigned int> AdjacencyStart;	//Per position, into Adjacency
+		std::vector<unsigned int> Adjacency;		//Triangles around each position
+		std::vector<unsigned char> Border;			//Per position, has an edge with only one triangle
+		std::vector<unsigned char> State;			//PositionState
+		std::vector<uint64_t> Edges;				//Every edge once, smaller position in the top half
+	};
+
+	//The same Pos means the same position, whatever the other attributes. Gives every vertex used by the triangles the
+	//index of the first vertex at its position
+	void GroupPositions(const std::vector<SimpleVertex>& vertices, const unsigned int* indices, size_t indexCount, std::vector<unsigned int>& outPosition)
+	{
+		std::vector<unsigned int> used;
+		outPosition.assign(vertices.size(), 0xFFFFFFFF);
+		for (size_t i = 0; i < indexCount; ++i)
+		{
+			if (outPosition[indices[i]] == 0xFFFFFFFF)
+			{
+				outPosition[indices[i]] = indices[i];
+				used.push_back(indices[i]);
+			}
+		}
+
+		std::sort(used.begin(), used.end(), [&vertices](unsigned int a, unsigned int b)
+		{
+			const XMFLOAT3& pa = vertices[a].Pos;
+			const XMFLOAT3& pb = vertices[b].Pos;
+			if (pa.x != pb.x) return pa.x < pb.x;
+			if (pa.y != pb.y) return pa.y < pb.y;
+			if (pa.z != pb.z) return pa.z < pb.z;
+			return a < b;
+		});
+
+		for (size_t i = 1; i < used.size(); ++i)
+		{
+			const XMFLOAT3& previous = vertices[used[i - 1]].Pos;
+			const XMFLOAT3& current = vertices[used[i]].Pos;
+			if (previous.x == current.x && previous.y == current.y && previous.z == current.z)
+			{
+				outPosition[used[i]] = outPosition[used[i - 1]];
+			}
+		}
+	}
+
+	//Fills in the adjacency, edges and border/pinned flags for the triangles as they are now
+	void BeginPass(size_t vertexCount, const std::vector<unsigned int>& triangles, const std::vector<unsigned int>& position, Pass& pass)
+	{
+		size_t triangleCount = triangles.size() / 3;
+
+		pass.AdjacencyStart.assign(vertexCount + 1, 0);
+		for (size_t i = 0; i < triangles.size(); ++i)
+		{
+			pass.AdjacencyStart[position[triangles[i]] + 1]++;
+		}
+		for (size_t i = 0; i < vertexCount; ++i)
+		{
+			pass.AdjacencyStart[i + 1] += pass.AdjacencyStart[i];
+		}
+
+		pass.Adjacency.resize(triangles.size());
+		std::vector<unsigned int> fill(pass.AdjacencyStart.begin(), pass.AdjacencyStart.end() - 1);
+		for (size_t i = 0; i < triangles.size(); ++i)
+		{
+			pass.Adjacency[fill[position[triangles[i]]]++] = (unsigned int)(i / 3);
+		}
+
+		//Equal edges sort together so they can be counted
+		std::vector<uint64_t> edges(triangleCount * 3);
+		for (size_t t = 0; t < triangleCount; ++t)
+		{
+			for (int k = 0; k < 3; ++k)
+			{
+				uint64_t a = position[triangles[t * 3 + k]];
+				uint64_t b = position[triangles[t * 3 + (k + 1) % 3]];
+				edges[t * 3 + k] = (a < b) ? (a << 32 | b) : (b << 32 | a);
+			}
+		}
+		std::sort(edges.begin(), edges.end());
+
+		pass.Border.assign(vertexCount, 0);
+		pass.State.assign(vertexCount, PositionFree);
+		pass.Edges.clear();
+
+		for (size_t i = 0; i < edges.size();)
+		{
+			size_t count = 1;
+			while (i + count < edges.size() && edges[i + count] == edges[i]) ++count;
+
+			unsigned int a = (unsigned int)(edges[i] >> 32);
+			unsigned int b = (unsigned int)(edges[i] & 0xFFFFFFFF);
+			if (count == 1)
+			{
+				pass.Border[a] = 1;
+				pass.Border[b] = 1;
+			}
+			else if (count > 2)
+			{
+				pass.State[a] = PositionPinned;
+				pass.State[b] = PositionPinned;
+			}
+
+			pass.Edges.push_back(edges[i]);
+			i += count;
+		}
+	}
+
+	//Every edge of the pass both ways round, cheapest first
+	void ListCollapses(const std::vector<SimpleVertex>& vertices, const std::vector<Quadric>& quadrics, const Pass& pass, std::vector<Collapse>& outCollapses)
+	{
+		outCollapses.clear();
+		for (size_t i = 0; i < pass.Edges.size(); ++i)
+		{
+			unsigned int a = (unsigned int)(pass.Edges[i] >> 32);
+			unsigned int b = (unsigned int)(pass.Edges[i] & 0xFFFFFFFF);
+
+			Collapse ab = { a, b, CollapseCost(quadrics[a], quadrics[b], vertices[b].Pos) };
+			Collapse ba = { b, a, CollapseCost(quadrics[b], quadrics[a], vertices[a].Pos) };
+			outCollapses.push_back(ab);
+			outCollapses.push_back(ba);
+		}
+
+		std::sort(outCollapses.begin(), outCollapses.end());
+	}
+
+	//Checks collapsing position 'from' onto position 'to' keeps the mesh in shape, and if so works out which of to's
+	//vertices each of from's vertices becomes (outPairs, from's vertex then to's). Returns the triangles it removes, or 0
+	//if it can't be done
+	unsigned int CheckCollapse(const std::vector<SimpleVertex>& vertices, const std::vector<unsigned int>& triangles, const std::vector<unsigned int>& position,
+		const Pass& pass, unsigned int from, unsigned int to, std::vector<unsigned int>& outPairs)
+	{
+		outPairs.clear();
+		unsigned int shared = 0;
+
+		//Triangles along the edge decide where each of from's vertices goes. Across a seam each side has its own pair,
+		//and a vertex that would have to go two ways means the collapse would tear a seam
+		for (unsigned int i = pass.AdjacencyStart[from]; i < pass.AdjacencyStart[from + 1]; ++i)
+		{
+			const unsigned int* corners = &triangles[pass.Adjacency[i] * 3];
+			unsigned int fromVertex = 0xFFFFFFFF;
+			unsigned int toVertex = 0xFFFFFFFF;
+			for (int k = 0; k < 3; ++k)
+			{
+				if (position[corners[k]] == from) fromVertex = corners[k];
+				if (position[corners[k]] == to) toVertex = corners[k];
+			}
+
+			if (toVertex == 0xFFFFFFFF)
+			{
+				continue;
+			}
+
+			++shared;
+			bool known = false;
+			for (size_t p = 0; p < outPairs.size(); p += 2)
+			{
+				if (outPairs[p] == fromVertex)
+				{
+					if (outPairs[p + 1] != toVertex) return 0;
+					known = true;
+				}
+			}
+			if (!known)
+			{
+				outPairs.push_back(fromVertex);
+				outPairs.push_back(toVertex);
+			}
+		}
+
+		//A border vertex can only slide along its border, anything else needs a proper two sided edge
+		if (shared != (pass.Border[from] ? 1u : 2u))
+		{
+			return 0;
+		}
+
+		//Every vertex at from needs somewhere to go (one that doesn't touch the edge is on the other side of a seam it would cross),
+		//and the triangles that stay mustn't flip or collapse to nothing
+		const XMFLOAT3& target = vertices[to].Pos;
+		for (unsigned int i = pass.AdjacencyStart[from]; i < pass.AdjacencyStart[from + 1]; ++i)
+		{
+			const unsigned int* corners = &triangles[pass.Adjacency[i] * 3];
+			bool hasTo = false;
+			int fromCorner = 0;
+			for (int k = 0; k < 3; ++k)
+			{
+				if (position[corners[k]] == to) hasTo = true;
+				if (position[corners[k]] == from) fromCorner = k;
+			}
+
+			bool mapped = false;
+			for (size_t p = 0; p < outPairs.size(); p += 2)
+			{
+				mapped = mapped || outPairs[p] == corners[fromCorner];
+			}
+			if (!mapped)
+			{
+				return 0;
+			}
+
+			if (hasTo)
+			{
+				continue;
+			}
+
+			const XMFLOAT3* moved[3] = { &vertices[corners[0]].Pos, &vertices[corners[1]].Pos, &vertices[corners[2]].Pos };
+			double before[3];
+			TriangleNormal(*moved[0], *moved[1], *moved[2], before);
+			moved[fromCorner] = &target;
+			double after[3];
+			TriangleNormal(*moved[0], *moved[1], *moved[2], after);
+
+			double lengths = Length(before) * Length(after);
+			if (lengths <= 0.0 || before[0] * after[0] + before[1] * after[1] + before[2] * after[2] < MinNormalDot * lengths)
+			{
+				return 0;
+			}
+		}
+
+		//Link condition: the only positions next to both ends should be the far corners of the triangles on the edge,
+		//otherwise the collapse folds two sheets together
+		unsigned int common = 0;
+		for (unsigned int i = pass.AdjacencyStart[to]; i < pass.AdjacencyStart[to + 1]; ++i)
+		{
+			const unsigned int* corners = &triangles[pass.Adjacency[i] * 3];
+			for (int k = 0; k < 3; ++k)
+			{
+				unsigned int neighbour = position[corners[k]];
+				if (neighbour == to || neighbour == from)
+				{
+					continue;
+				}
+
+				//Count each neighbour once, at its first triangle around 'to'
+				bool seen = false;
+				for (unsigned int j = pass.AdjacencyStart[to]; j < i && !seen; ++j)
+				{
+					const unsigned int* earlier = &triangles[pass.Adjacency[j] * 3];
+					seen = position[earlier[0]] == neighbour || position[earlier[1]] == neighbour || position[earlier[2]] == neighbour;
+				}
+				if (seen)
+				{
+					continue;
+				}
+
+				for (unsigned int j = pass.AdjacencyStart[from]; j < pass.AdjacencyStart[from + 1]; ++j)
+				{
+					const unsigned int* around = &triangles[pass.Adjacency[j] * 3];
+					if (position[around[0]] == neighbour || position[around[1]] == neighbour || position[around[2]] == neighbour)
+					{
+						++common;
+						break;
+					}
+				}
+			}
+		}
+
+		return (common == shared) ? shared : 0;
+	}
+}
+
+float MeshSimplifier::Simplify(const std::vector<SimpleVertex>& vertices, const unsigned int* indices, size_t indexCount, size_t targetIndexCount, float maxError, std::vector<unsigned int>& outIndices)
+{
+	std::vector<unsigned int> position;
+	GroupPositions(vertices, indices, indexCount, position);
+
+	//Triangles that are already degenerate have nothing to give the quadrics and just get in the way
+	std::vector<unsigned int>& triangles = outIndices;
+	triangles.clear();
+	triangles.reserve(indexCount);
+	for (size_t i = 0; i + 2 < indexCount; i += 3)
+	{
+		unsigned int a = position[indices[i]], b = position[indices[i + 1]], c = position[indices[i + 2]];
+		if (a != b && b != c && a != c)
+		{
+			triangles.insert(triangles.end(), indices + i, indices + i + 3);
+		}
+	}
+
+	//Each position starts with the planes of its triangles, area weighted, plus a plane standing up from every open edge
+	Quadric zero = {};
+	std::vector<Quadric> quadrics(vertices.size(), zero);
+	for (size_t t = 0; t < triangles.size(); t += 3)
+	{
+		const XMFLOAT3& a = vertices[triangles[t]].Pos;
+		double normal[3];
+		TriangleNormal(a, vertices[triangles[t + 1]].Pos, vertices[triangles[t + 2]].Pos, normal);
+
+		double length = Length(normal);
+		if (length <= 0.0)
+		{
+			continue;
+		}
+
+		double n[3] = { normal[0] / length, normal[1] / length, normal[2] / length };
+		double d = -(n[0] * a.x + n[1] * a.y + n[2] * a.z);
+		for (int k = 0; k < 3; ++k)
+		{
+			AddPlane(quadrics[position[triangles[t + k]]], n, d, length * 0.5);
+		}
+	}
+
+	Pass pass;
+	BeginPass(vertices.size(), triangles, position, pass);
+
+	for (size_t t = 0; t < triangles.size(); t += 3)
+	{
+		for (int k = 0; k < 3; ++k)
+		{
+			unsigned int a = position[triangles[t + k]];
+			unsigned int b = position[triangles[t + (k + 1) % 3]];
+			if (!pass.Border[a] || !pass.Border[b])
+			{
+				continue;
+			}
+
+			//Only open if no other triangle has this edge
+			unsigned int count = 0;
+			for (unsigned int i = pass.AdjacencyStart[a]; i < pass.AdjacencyStart[a + 1]; ++i)
+			{
+				const unsigned int* corners = &triangles[pass.Adjacency[i] * 3];
+				if (position[corners[0]] == b || position[corners[1]] == b || position[corners[2]] == b) ++count;
+			}
+			if (count != 1)
+			{
+				continue;
+			}
+
+			const XMFLOAT3& pa = vertices[a].Pos;
+			const XMFLOAT3& pb = vertices[b].Pos;
+			double normal[3];
+			TriangleNormal(pa, pb, vertices[triangles[t + (k + 2) % 3]].Pos, normal);
+			double edge[3] = { (double)pb.x - pa.x, (double)pb.y - pa.y, (double)pb.z - pa.z };
+			double side[3] = { edge[1] * normal[2] - edge[2] * normal[1], edge[2] * normal[0] - edge[0] * normal[2], edge[0] * normal[1] - edge[1] * normal[0] };
+
+			double length = Length(side);
+			if (length <= 0.0)
+			{
+				continue;
+			}
+
+			double n[3] = { side[0] / length, side[1] / length, side[2] / length };
+			double d = -(n[0] * pa.x + n[1] * pa.y + n[2] * pa.z);
+			double weight = (edge[0] * edge[0] + edge[1] * edge[1] + edge[2] * edge[2]) * BorderWeight;
+			AddPlane(quadrics[a], n, d, weight);
+			AddPlane(quadrics[b], n, d, weight);
+		}
+	}
+
+	//Passes of independent collapses, cheapest first. Anything a collapse touches sits out the rest of the pass, so
+	//adjacency only needs rebuilding between passes
+	std::vector<Collapse> collapses;
+	ListCollapses(vertices, quadrics, pass, collapses);
+
+	double maxCost = (double)maxError * maxError;
+	double reachedCost = 0.0;
+	size_t triangleCount = triangles.size() / 3;
+	size_t targetTriangles = targetIndexCount / 3;
+	std::vector<unsigned int> remap(vertices.size());
+	std::vector<unsigned int> pairs;
+
+	while (triangleCount > targetTriangles)
+	{
+		for (size_t i = 0; i < remap.size(); ++i) remap[i] = (unsigned int)i;
+		size_t collapsed = 0;
+
+		for (size_t c = 0; c < collapses.size() && triangleCount > targetTriangles; ++c)
+		{
+			const Collapse& collapse = collapses[c];
+			if (collapse.Cost > maxCost)
+			{
+				break;
+			}
+
+			if (pass.State[collapse.From] != PositionFree || pass.State[collapse.To] == PositionTouched)
+			{
+				continue;
+			}
+
+			unsigned int removed = CheckCollapse(vertices, triangles, position, pass, collapse.From, collapse.To, pairs);
+			if (removed == 0)
+			{
+				continue;
+			}
+
+			for (size_t p = 0; p < pairs.size(); p += 2)
+			{
+				remap[pairs[p]] = pairs[p + 1];
+			}
+			AddQuadric(quadrics[collapse.To], quadrics[collapse.From]);
+
+			pass.State[collapse.To] = PositionTouched;
+			for (unsigned int i = pass.AdjacencyStart[collapse.From]; i < pass.AdjacencyStart[collapse.From + 1]; ++i)
+			{
+				const unsigned int* corners = &triangles[pass.Adjacency[i] * 3];
+				for (int k = 0; k < 3; ++k) pass.State[position[corners[k]]] = PositionTouched;
+			}
+
+			triangleCount -= removed;
+			reachedCost = std::max(reachedCost, collapse.Cost);
+			++collapsed;
+		}
+
+		if (collapsed == 0)
+		{
+			break;
+		}
+
+		//Point the triangles at the vertices they collapsed onto and drop the ones that now have no area
+		size_t kept = 0;
+		for (size_t t = 0; t < triangles.size(); t += 3)
+		{
+			unsigned int a = remap[triangles[t]], b = remap[triangles[t + 1]], c = remap[triangles[t + 2]];
+			if (position[a] != position[b] && position[b] != position[c] && position[a] != position[c])
+			{
+				triangles[kept++] = a;
+				triangles[kept++] = b;
+				triangles[kept++] = c;
+			}
+		}
+		triangles.resize(kept);
+		triangleCount = kept / 3;
+
+		BeginPass(vertices.size(), triangles, position, pass);
+		ListCollapses(vertices, quadrics, pass, collapses);
+	}
+
+	return (float)sqrt(reachedCost);
+}
+
+unsigned int MeshSimplifier::SelectLod(const MeshCache::MeshLod* lods, unsigned int lodCount, float distance, float pixelScale, float maxPixelError)
+{
+	//Levels get coarser as they go, so stop at the first that would show
+	unsigned int lod = 0;
+	for (unsigned int i = 1; i < lodCount; ++i)
+	{
+		if (lods[i].Error * pixelScale > maxPixelError * distance)
+		{
+			break;
+		}
+		lod = i;
+	}
+	return lod;
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include <vector>
+#include "MeshTypes.h"
+#include "MeshCache.h"
+
+//Level of detail generation for the import pipeline, and picking a level to draw. Simplification is quadric error
+//metric edge collapse (Garland & Heckbert, "Surface Simplification Using Quadric Error Metrics", 1997), but a collapse
+//only ever moves a vertex onto one of its neighbours, so every level indexes the same vertex buffer as the full mesh
+//and costs nothing more than its own range of the index buffer.
+namespace MeshSimplifier
+{
+	//Collapses edges of the triangle list indices[0, indexCount) until it is down to targetIndexCount indices, or until
+	//the next collapse would take the surface further than maxError (mesh units, a mean distance from the quadric's planes)
+	//from where it started. Normal/UV seams and open borders only collapse along themselves so they keep their shape.
+	//outIndices gets the triangles left, the return value is the error reached
+	float Simplify(const std::vector<SimpleVertex>& vertices, const unsigned int* indices, size_t indexCount, size_t targetIndexCount, float maxError, std::vector<unsigned int>& outIndices);
+
+	//The coarsest of lods whose error covers no more than maxPixelError pixels from distance away (0 if there are none).
+	//pixelScale is the pixels one unit covers one unit in front of the camera, viewport height / (2 tan(fovY / 2)).
+	//distance is in mesh units, so divide out any scale in the world matrix first
+	unsigned int SelectLod(const MeshCache::MeshLod* lods, unsigned int lodCount, float distance, float pixelScale, float maxPixelError);
+};
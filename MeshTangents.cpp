@@ -0,0 +1,288 @@
+#include "MeshTangents.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <float.h>
+#include <functional>
+#include <math.h>
+
+namespace
+{
+	//Which way round a triangle's UVs go
+	enum Handedness
+	{
+		HandednessMirrored = 0,		//Negative UV area, bitangent sign -1
+		HandednessNormal = 1,
+		HandednessAny = 2,			//Zero UV area or no usable s/t direction, so it has no tangent of its own to add
+	};
+
+	//MikkTSpace's test, anything bigger than the smallest normal float
+	inline bool NotZero(float value)
+	{
+		return fabsf(value) > FLT_MIN;
+	}
+
+	inline XMFLOAT3 Subtract(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		return XMFLOAT3(a.x - b.x, a.y - b.y, a.z - b.z);
+	}
+
+	inline float Dot(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		return a.x * b.x + a.y * b.y + a.z * b.z;
+	}
+
+	//v with its component along the unit vector n taken out, normalised if there's any length left
+	inline XMFLOAT3 ProjectOntoPlane(const XMFLOAT3& v, const XMFLOAT3& n)
+	{
+		float along = Dot(n, v);
+		XMFLOAT3 projected(v.x - n.x * along, v.y - n.y * along, v.z - n.z * along);
+
+		float length = sqrtf(Dot(projected, projected));
+		if (NotZero(length))
+		{
+			projected = XMFLOAT3(projected.x / length, projected.y / length, projected.z / length);
+		}
+		return projected;
+	}
+
+	inline XMFLOAT3 UnitNormal(const XMFLOAT3& normal)
+	{
+		float length = sqrtf(Dot(normal, normal));
+		return NotZero(length) ? XMFLOAT3(normal.x / length, normal.y / length, normal.z / length) : XMFLOAT3(0.0f, 1.0f, 0.0f);
+	}
+
+	//The triangle's unit s direction, flipped for mirrored UVs (MikkTSpace's vOs, equations 18 and 19 of Mikkelsen's thesis)
+	Handedness Classify(const SimpleVertex& a, const SimpleVertex& b, const SimpleVertex& c, XMFLOAT3& outS)
+	{
+		float s1 = b.TexC.x - a.TexC.x;
+		float t1 = b.TexC.y - a.TexC.y;
+		float s2 = c.TexC.x - a.TexC.x;
+		float t2 = c.TexC.y - a.TexC.y;
+		XMFLOAT3 d1 = Subtract(b.Pos, a.Pos);
+		XMFLOAT3 d2 = Subtract(c.Pos, a.Pos);
+
+		float signedArea = s1 * t2 - t1 * s2;
+		Handedness handedness = signedArea > 0.0f ? HandednessNormal : HandednessMirrored;
+
+		XMFLOAT3 os(t2 * d1.x - t1 * d2.x, t2 * d1.y - t1 * d2.y, t2 * d1.z - t1 * d2.z);
+		XMFLOAT3 ot(s1 * d2.x - s2 * d1.x, s1 * d2.y - s2 * d1.y, s1 * d2.z - s2 * d1.z);
+		float lengthS = sqrtf(Dot(os, os));
+		float lengthT = sqrtf(Dot(ot, ot));
+
+		outS = XMFLOAT3(0.0f, 0.0f, 0.0f);
+		if (!NotZero(signedArea))
+		{
+			return HandednessAny;
+		}
+
+		float sign = (handedness == HandednessNormal) ? 1.0f : -1.0f;
+		if (NotZero(lengthS))
+		{
+			outS = XMFLOAT3(os.x * sign / lengthS, os.y * sign / lengthS, os.z * sign / lengthS);
+		}
+
+		return (NotZero(lengthS) && NotZero(lengthT)) ? handedness : HandednessAny;
+	}
+
+	//Normalised sum, or any direction perpendicular to the normal if the triangles cancelled out or there weren't any
+	XMFLOAT4 FinishTangent(const XMFLOAT3& sum, const XMFLOAT3& normal, Handedness handedness)
+	{
+		float w = (handedness == HandednessMirrored) ? -1.0f : 1.0f;
+
+		float length = sqrtf(Dot(sum, sum));
+		if (NotZero(length))
+		{
+			return XMFLOAT4(sum.x / length, sum.y / length, sum.z / length, w);
+		}
+
+		XMFLOAT3 axis = fabsf(normal.x) < 0.9f ? XMFLOAT3(1.0f, 0.0f, 0.0f) : XMFLOAT3(0.0f, 1.0f, 0.0f);
+		XMFLOAT3 tangent = ProjectOntoPlane(axis, normal);
+		return XMFLOAT4(tangent.x, tangent.y, tangent.z, w);
+	}
+
+	//body(begin, end) over [0, count) in batches of BatchSize, spread over the pool if there is one
+	void ForBatches(ThreadPool* pool, size_t count, const std::function<void(size_t, size_t)>& body)
+	{
+		size_t batchCount = (count + MeshTangents::BatchSize - 1) / MeshTangents::BatchSize;
+		if (pool == nullptr || batchCount <= 1)
+		{
+			body(0, count);
+			return;
+		}
+
+		pool->ParallelFor((unsigned int)batchCount, [&](unsigned int batch)
+		{
+			size_t begin = (size_t)batch * MeshTangents::BatchSize;
+			body(begin, std::min(count, begin + MeshTangents::BatchSize));
+		});
+	}
+}
+
+size_t MeshTangents::Generate(std::vector<SimpleVertex>& vertices, std::vector<unsigned int>& indices, size_t sourceIndexCount, std::vector<XMFLOAT4>& outTangents, ThreadPool* pool)
+{
+	const size_t vertexCount = vertices.size();
+	const size_t sourceTriangles = std::min(sourceIndexCount, indices.size()) / 3;
+
+	//Each corner's share of its vertex's tangent: the triangle's s direction in the plane of the vertex normal, weighted by
+	//the angle at the corner measured in that same plane. Every triangle is worked out on its own
+	std::vector<unsigned char> handedness(sourceTriangles);
+	std::vector<XMFLOAT3> cornerTangents(sourceTriangles * 3);
+	ForBatches(pool, sourceTriangles, [&](size_t begin, size_t end)
+	{
+		for (size_t t = begin; t < end; ++t)
+		{
+			const unsigned int* corners = &indices[t * 3];
+			XMFLOAT3 s;
+			Handedness side = Classify(vertices[corners[0]], vertices[corners[1]], vertices[corners[2]], s);
+			handedness[t] = (unsigned char)side;
+
+			for (int k = 0; k < 3; ++k)
+			{
+				XMFLOAT3& contribution = cornerTangents[t * 3 + k];
+				if (side == HandednessAny)
+				{
+					contribution = XMFLOAT3(0.0f, 0.0f, 0.0f);
+					continue;
+				}
+
+				const SimpleVertex& corner = vertices[corners[k]];
+				const XMFLOAT3& previous = vertices[corners[(k + 2) % 3]].Pos;
+				const XMFLOAT3& next = vertices[corners[(k + 1) % 3]].Pos;
+				XMFLOAT3 normal = UnitNormal(corner.Normal);
+
+				XMFLOAT3 edge1 = ProjectOntoPlane(Subtract(previous, corner.Pos), normal);
+				XMFLOAT3 edge2 = ProjectOntoPlane(Subtract(next, corner.Pos), normal);
+				float cosine = std::max(-1.0f, std::min(1.0f, Dot(edge1, edge2)));
+				float angle = acosf(cosine);
+
+				XMFLOAT3 tangent = ProjectOntoPlane(s, normal);
+				contribution = XMFLOAT3(tangent.x * angle, tangent.y * angle, tangent.z * angle);
+			}
+		}
+	});
+
+	//Corners of each vertex, in index order so sums come out the same however the work was split
+	std::vector<unsigned int> offsets(vertexCount + 1, 0);
+	for (size_t i = 0; i < sourceTriangles * 3; ++i)
+	{
+		offsets[indices[i] + 1]++;
+	}
+	for (size_t v = 0; v < vertexCount; ++v)
+	{
+		offsets[v + 1] += offsets[v];
+	}
+
+	std::vector<unsigned int> vertexCorners(sourceTriangles * 3);
+	std::vector<unsigned int> filled(offsets.begin(), offsets.end() - 1);
+	for (size_t i = 0; i < sourceTriangles * 3; ++i)
+	{
+		vertexCorners[filled[indices[i]]++] = (unsigned int)i;
+	}
+	std::vector<unsigned int>().swap(filled);
+
+	//Each side of a vertex is summed separately. The vertex keeps the side its first corner is on, the other goes to a copy
+	outTangents.resize(vertexCount);
+	std::vector<XMFLOAT4> otherSide(vertexCount);
+	std::vector<unsigned char> keptSide(vertexCount);
+	std::vector<unsigned char> split(vertexCount);
+	ForBatches(pool, vertexCount, [&](size_t begin, size_t end)
+	{
+		for (size_t v = begin; v < end; ++v)
+		{
+			XMFLOAT3 sums[2] = { XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(0.0f, 0.0f, 0.0f) };
+			bool used[2] = { false, false };
+			int first = -1;
+
+			for (unsigned int i = offsets[v]; i < offsets[v + 1]; ++i)
+			{
+				unsigned int corner = vertexCorners[i];
+				int side = handedness[corner / 3];
+				if (side == HandednessAny)
+				{
+					continue;
+				}
+
+				const XMFLOAT3& contribution = cornerTangents[corner];
+				sums[side].x += contribution.x;
+				sums[side].y += contribution.y;
+				sums[side].z += contribution.z;
+				used[side] = true;
+				first = (first < 0) ? side : first;
+			}
+
+			Handedness kept = (first < 0) ? HandednessNormal : (Handedness)first;
+			Handedness other = (kept == HandednessNormal) ? HandednessMirrored : HandednessNormal;
+			XMFLOAT3 normal = UnitNormal(vertices[v].Normal);
+
+			keptSide[v] = (unsigned char)kept;
+			outTangents[v] = FinishTangent(sums[kept], normal, kept);
+			split[v] = used[0] && used[1];
+			if (split[v])
+			{
+				otherSide[v] = FinishTangent(sums[other], normal, other);
+			}
+		}
+	});
+
+	std::vector<unsigned int> copies(vertexCount, 0);
+	size_t splitCount = 0;
+	for (size_t v = 0; v < vertexCount; ++v)
+	{
+		splitCount += split[v];
+	}
+
+	vertices.reserve(vertexCount + splitCount);
+	outTangents.reserve(vertexCount + splitCount);
+	for (size_t v = 0; v < vertexCount; ++v)
+	{
+		if (split[v])
+		{
+			copies[v] = (unsigned int)vertices.size();
+			SimpleVertex copy = vertices[v];
+			vertices.push_back(copy);
+			outTangents.push_back(otherSide[v]);
+		}
+	}
+
+	if (splitCount == 0)
+	{
+		return 0;
+	}
+
+	//Point the other side's corners at the copies. Lower levels of detail weren't part of the sums, so their sides are
+	//worked out here, and ones with no side of their own stay on the original
+	const size_t triangleCount = indices.size() / 3;
+	ForBatches(pool, triangleCount, [&](size_t begin, size_t end)
+	{
+		for (size_t t = begin; t < end; ++t)
+		{
+			unsigned int* corners = &indices[t * 3];
+			int side;
+			if (t < sourceTriangles)
+			{
+				side = handedness[t];
+			}
+			else
+			{
+				XMFLOAT3 s;
+				side = Classify(vertices[corners[0]], vertices[corners[1]], vertices[corners[2]], s);
+			}
+
+			if (side == HandednessAny)
+			{
+				continue;
+			}
+
+			for (int k = 0; k < 3; ++k)
+			{
+				unsigned int v = corners[k];
+				if (v < vertexCount && split[v] && side != keptSide[v])
+				{
+					corners[k] = copies[v];
+				}
+			}
+		}
+	});
+
+	return splitCount;
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include <vector>
+#include "MeshTypes.h"
+
+class ThreadPool;
+
+//Per vertex tangents for normal mapping, worked out the way MikkTSpace does so normal maps baked against it come out right.
+//Each triangle's texture space s direction is projected into the plane of each corner's normal and added to that vertex
+//weighted by the angle at the corner. Triangles whose UVs are mirrored are summed apart from the rest, so a vertex on a
+//mirror seam gets one tangent per side and is split in two. Unlike MikkTSpace, triangles around a vertex are grouped by
+//handedness alone rather than by fans of edge-connected triangles, which only differs where one side of a seam touches
+//a vertex twice without sharing an edge.
+//
+//The bitangent isn't stored: bitangent = w * cross(normal, tangent), with the normal as interpolated, as in MikkTSpace's
+//reference shader.
+namespace MeshTangents
+{
+	//Triangles and vertices are handed to the pool this many at a time
+	const unsigned int BatchSize = 16384;
+
+	//Fills outTangents with one tangent per vertex, xyz the unit tangent perpendicular to the vertex normal and w the sign
+	//of the bitangent. Tangents come from the triangles in indices[0, sourceIndexCount) alone, the full detail mesh, and any
+	//indices after that (lower levels of detail) use whichever copy of a split vertex matches their handedness (the odd
+	//simplified triangle whose UVs folded over keeps the only one there is). Split vertices are appended to vertices.
+	//Vertices no triangle with usable UVs touches get any tangent perpendicular to their normal. pool may be null to do
+	//everything on the calling thread; the result is the same either way. Returns how many vertices were split
+	size_t Generate(std::vector<SimpleVertex>& vertices, std::vector<unsigned int>& indices, size_t sourceIndexCount, std::vector<XMFLOAT4>& outTangents, ThreadPool* pool);
+};
@@ -0,0 +1,389 @@
+#include "MipGenerator.h"
+#include "Simd.h"
+#include "ThreadPool.h"
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+
+namespace
+{
+	//Radius of the Kaiser filter in destination pixels, and how sharply its window falls off
+	const float KaiserWidth = 3.0f;
+	const float KaiserAlpha = 4.0f;
+
+	const float Pi = 3.14159265358979f;
+
+	//Linear values are stored by looking up the byte at the bottom of their bucket, then stepping up past any thresholds
+	//between there and the value, which near black (where sRGB is steepest) is at most a couple
+	const int SrgbBuckets = 4096;
+
+	struct SrgbTables
+	{
+		float ToLinear[256];
+		float Thresholds[256];		//The linear value at which storing rounds up from each byte to the next (past 1 for 255)
+		uint8_t Buckets[SrgbBuckets];
+
+		SrgbTables()
+		{
+			for (int value = 0; value < 256; ++value) ToLinear[value] = Decode(value / 255.0f);
+			for (int value = 0; value < 255; ++value) Thresholds[value] = Decode((value + 0.5f) / 255.0f);
+			Thresholds[255] = 2.0f;
+
+			int value = 0;
+			for (int bucket = 0; bucket < SrgbBuckets; ++bucket)
+			{
+				while ((float)bucket / SrgbBuckets >= Thresholds[value]) ++value;
+				Buckets[bucket] = (uint8_t)value;
+			}
+		}
+
+		static float Decode(float value)
+		{
+			return (value <= 0.04045f) ? value / 12.92f : powf((value + 0.055f) / 1.055f, 2.4f);
+		}
+	};
+
+	const SrgbTables& Srgb()
+	{
+		static const SrgbTables tables;
+		return tables;
+	}
+
+	//Zeroth order modified Bessel function of the first kind, by its power series
+	float BesselI0(float x)
+	{
+		float sum = 1.0f, term = 1.0f;
+		for (int k = 1; k < 32 && term > sum * 1e-8f; ++k)
+		{
+			float factor = x * 0.5f / k;
+			term *= factor * factor;
+			sum += term;
+		}
+		return sum;
+	}
+
+	//x in destination pixels from the centre
+	float Kaiser(float x)
+	{
+		if (fabsf(x) >= KaiserWidth)
+		{
+			return 0.0f;
+		}
+
+		float sinc = (x == 0.0f) ? 1.0f : sinf(Pi * x) / (Pi * x);
+		float t = x / KaiserWidth;
+		return sinc * BesselI0(KaiserAlpha * sqrtf(1.0f - t * t)) / BesselI0(KaiserAlpha);
+	}
+
+	//Which source pixels along one axis make up each destination pixel, and how much of each. The weights for each
+	//destination pixel add up to 1
+	struct Taps
+	{
+		std::vector<uint32_t> Start;	//Into Source and Weight for each destination pixel, with one more for the end
+		std::vector<uint32_t> Source;
+		std::vector<float> Weight;
+	};
+
+	void BuildTaps(uint32_t sourceSize, uint32_t size, const MipGenerator::Settings& settings, Taps& out)
+	{
+		out.Start.assign(1, 0);
+		out.Source.clear();
+		out.Weight.clear();
+
+		float scale = (float)sourceSize / size;
+		float radius = (settings.Filter == MipGenerator::MipFilterBox) ? scale * 0.5f : KaiserWidth * scale;
+		for (uint32_t pixel = 0; pixel < size; ++pixel)
+		{
+			float centre = (pixel + 0.5f) * scale;
+			int first = (int)floorf(centre - radius);
+			int last = (int)ceilf(centre + radius);
+
+			size_t start = out.Weight.size();
+			float total = 0.0f;
+			for (int source = first; source <= last; ++source)
+			{
+				float weight;
+				if (settings.Filter == MipGenerator::MipFilterBox)
+				{
+					//How much of the source pixel the destination one covers
+					float from = std::max((float)source, centre - radius);
+					float to = std::min((float)source + 1.0f, centre + radius);
+					weight = to - from;
+					if (weight <= 0.0f) continue;
+				}
+				else
+				{
+					weight = Kaiser((source + 0.5f - centre) / scale);
+					if (weight == 0.0f) continue;
+				}
+
+				int wrapped = settings.Wrap ? ((source % (int)sourceSize) + (int)sourceSize) % (int)sourceSize :
+					std::min(std::max(source, 0), (int)sourceSize - 1);
+				out.Source.push_back((uint32_t)wrapped);
+				out.Weight.push_back(weight);
+				total += weight;
+			}
+
+			for (size_t tap = start; tap < out.Weight.size(); ++tap) out.Weight[tap] /= total;
+			out.Start.push_back((uint32_t)out.Weight.size());
+		}
+	}
+
+	//One row of RGBA floats across, sourceRow's taps at a time
+	void FilterRow(const float* sourceRow, const Taps& taps, uint32_t width, float* outRow, bool simd)
+	{
+#ifdef SIMD_SSE2
+		if (simd)
+		{
+			for (uint32_t x = 0; x < width; ++x)
+			{
+				__m128 sum = _mm_setzero_ps();
+				for (uint32_t tap = taps.Start[x]; tap < taps.Start[x + 1]; ++tap)
+				{
+					sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(taps.Weight[tap]), _mm_loadu_ps(sourceRow + taps.Source[tap] * 4)));
+				}
+				_mm_storeu_ps(outRow + x * 4, sum);
+			}
+			return;
+		}
+#endif
+		(void)simd;
+		for (uint32_t x = 0; x < width; ++x)
+		{
+			float sum[4] = {};
+			for (uint32_t tap = taps.Start[x]; tap < taps.Start[x + 1]; ++tap)
+			{
+				const float* pixel = sourceRow + taps.Source[tap] * 4;
+				for (int c = 0; c < 4; ++c) sum[c] += taps.Weight[tap] * pixel[c];
+			}
+			memcpy(outRow + x * 4, sum, sizeof(sum));
+		}
+	}
+
+	//Adds weight times a row of floats into sum
+	void AccumulateRow(const float* row, float weight, size_t count, float* sum, bool simd)
+	{
+		size_t i = 0;
+#ifdef SIMD_SSE2
+		if (simd)
+		{
+			__m128 weights = _mm_set1_ps(weight);
+			for (; i + 4 <= count; i += 4)
+			{
+				_mm_storeu_ps(sum + i, _mm_add_ps(_mm_loadu_ps(sum + i), _mm_mul_ps(weights, _mm_loadu_ps(row + i))));
+			}
+		}
+#endif
+		(void)simd;
+		for (; i < count; ++i) sum[i] += weight * row[i];
+	}
+
+	void ClampRow(float* row, size_t count, bool simd)
+	{
+		size_t i = 0;
+#ifdef SIMD_SSE2
+		if (simd)
+		{
+			__m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f);
+			for (; i + 4 <= count; i += 4) _mm_storeu_ps(row + i, _mm_min_ps(_mm_max_ps(_mm_loadu_ps(row + i), zero), one));
+		}
+#endif
+		(void)simd;
+		for (; i < count; ++i) row[i] = std::min(std::max(row[i], 0.0f), 1.0f);
+	}
+
+	//A row of stored pixels to floats, red, green and blue decoded from sRGB if gammaCorrect. Only the straight conversion is
+	//vectorised, sRGB goes through a table
+	void ToFloats(const unsigned char* pixels, uint32_t width, bool gammaCorrect, float* outRow, bool simd)
+	{
+		uint32_t i = 0, count = width * 4;
+#ifdef SIMD_SSE2
+		if (simd && !gammaCorrect)
+		{
+			__m128 scale = _mm_set1_ps(1.0f / 255.0f);
+			__m128i zero = _mm_setzero_si128();
+			for (; i + 16 <= count; i += 16)
+			{
+				__m128i bytes = _mm_loadu_si128((const __m128i*)(pixels + i));
+				__m128i low = _mm_unpacklo_epi8(bytes, zero), high = _mm_unpackhi_epi8(bytes, zero);
+				_mm_storeu_ps(outRow + i, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(low, zero)), scale));
+				_mm_storeu_ps(outRow + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(low, zero)), scale));
+				_mm_storeu_ps(outRow + i + 8, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(high, zero)), scale));
+				_mm_storeu_ps(outRow + i + 12, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(high, zero)), scale));
+			}
+		}
+#endif
+		(void)simd;
+		const float* toLinear = Srgb().ToLinear;
+		for (; i < count; ++i)
+		{
+			outRow[i] = (gammaCorrect && (i & 3) != 3) ? toLinear[pixels[i]] : pixels[i] * (1.0f / 255.0f);
+		}
+	}
+
+	//And back, rounding to nearest (in sRGB, for gammaCorrect's colour). Values must already be clamped to 0..1
+	void ToBytes(const float* row, uint32_t width, bool gammaCorrect, unsigned char* outPixels, bool simd)
+	{
+		uint32_t i = 0, count = width * 4;
+#ifdef SIMD_SSE2
+		if (simd && !gammaCorrect)
+		{
+			__m128 scale = _mm_set1_ps(255.0f), half = _mm_set1_ps(0.5f);
+			for (; i + 16 <= count; i += 16)
+			{
+				__m128i values[4];
+				for (int k = 0; k < 4; ++k) values[k] = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(_mm_loadu_ps(row + i + k * 4), scale), half));
+				__m128i bytes = _mm_packus_epi16(_mm_packs_epi32(values[0], values[1]), _mm_packs_epi32(values[2], values[3]));
+				_mm_storeu_si128((__m128i*)(outPixels + i), bytes);
+			}
+		}
+#endif
+		(void)simd;
+		const SrgbTables& srgb = Srgb();
+		for (; i < count; ++i)
+		{
+			if (gammaCorrect && (i & 3) != 3)
+			{
+				int bucket = std::min((int)(row[i] * SrgbBuckets), SrgbBuckets - 1);
+				int value = srgb.Buckets[bucket];
+				while (row[i] >= srgb.Thresholds[value]) ++value;
+				outPixels[i] = (unsigned char)value;
+			}
+			else
+			{
+				outPixels[i] = (unsigned char)(row[i] * 255.0f + 0.5f);
+			}
+		}
+	}
+}
+
+bool MipGenerator::CanGenerate(DXGI_FORMAT format)
+{
+	switch (format)
+	{
+	case DXGI_FORMAT_R8G8B8A8_TYPELESS: case DXGI_FORMAT_R8G8B8A8_UNORM: case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+	case DXGI_FORMAT_B8G8R8A8_TYPELESS: case DXGI_FORMAT_B8G8R8A8_UNORM: case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+	case DXGI_FORMAT_B8G8R8X8_TYPELESS: case DXGI_FORMAT_B8G8R8X8_UNORM: case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:
+		return true;
+	default:
+		return false;
+	}
+}
+
+uint32_t MipGenerator::FullMipCount(uint32_t width, uint32_t height)
+{
+	uint32_t count = 1;
+	for (uint32_t size = std::max(width, height); size > 1; size >>= 1) ++count;
+	return count;
+}
+
+bool MipGenerator::Generate(const DDSFile::Texture& source, const Settings& settings, std::vector<unsigned char>& outBits, DDSFile::Texture& outTexture,
+	ThreadPool* pool, bool simd)
+{
+	if (!CanGenerate(source.Format) || source.Depth != 1)
+	{
+		return false;
+	}
+
+	DDSFile::Texture texture = source;
+	texture.MipCount = FullMipCount(source.Width, source.Height);
+	texture.BitSize = 0;
+	for (uint32_t mip = 0; mip < texture.MipCount; ++mip)
+	{
+		texture.BitSize += DDSFile::SurfaceSize(texture.Format, DDSFile::MipSize(texture.Width, mip), DDSFile::MipSize(texture.Height, mip));
+	}
+	texture.BitSize *= texture.ArraySize;
+	outBits.resize(texture.BitSize);
+	texture.Bits = outBits.data();
+
+	//Every level's taps along each axis, the same for every item
+	std::vector<Taps> columns(texture.MipCount), rows(texture.MipCount);
+	for (uint32_t mip = 1; mip < texture.MipCount; ++mip)
+	{
+		BuildTaps(DDSFile::MipSize(texture.Width, mip - 1), DDSFile::MipSize(texture.Width, mip), settings, columns[mip]);
+		BuildTaps(DDSFile::MipSize(texture.Height, mip - 1), DDSFile::MipSize(texture.Height, mip), settings, rows[mip]);
+	}
+
+	auto generateItem = [&](unsigned int item)
+	{
+		unsigned char* top = outBits.data() + (DDSFile::Surface(texture, item, 0) - texture.Bits);
+		memcpy(top, DDSFile::Surface(source, item, 0), (size_t)source.Width * source.Height * 4);
+
+		//The level above as floats, which the top level is converted to a row at a time as it's needed
+		std::vector<float> above, level;
+		for (uint32_t mip = 1; mip < texture.MipCount; ++mip)
+		{
+			uint32_t sourceWidth = DDSFile::MipSize(texture.Width, mip - 1);
+			uint32_t width = DDSFile::MipSize(texture.Width, mip);
+			uint32_t height = DDSFile::MipSize(texture.Height, mip);
+			const unsigned char* sourceBytes = outBits.data() + (DDSFile::Surface(texture, item, mip - 1) - texture.Bits);
+			unsigned char* outBytes = outBits.data() + (DDSFile::Surface(texture, item, mip) - texture.Bits);
+			level.resize((size_t)width * height * 4);
+
+			//Each band filters the source rows it needs across first, then down. Neighbouring bands share a few source rows
+			//and each filters those for itself, which costs less than waiting on one another
+			auto filterBand = [&](uint32_t firstRow, uint32_t rowCount)
+			{
+				const Taps& down = rows[mip];
+				uint32_t lastRow = std::min(firstRow + rowCount, height);
+				std::vector<int> slots(DDSFile::MipSize(texture.Height, mip - 1), -1);
+				std::vector<float> across, sourceRow(mip == 1 ? sourceWidth * 4 : 0);
+
+				for (uint32_t y = firstRow; y < lastRow; ++y)
+				{
+					float* out = level.data() + (size_t)y * width * 4;
+					memset(out, 0, width * 4 * sizeof(float));
+					for (uint32_t tap = down.Start[y]; tap < down.Start[y + 1]; ++tap)
+					{
+						uint32_t row = down.Source[tap];
+						if (slots[row] < 0)
+						{
+							slots[row] = (int)(across.size() / (width * 4));
+							across.resize(across.size() + width * 4);
+
+							const float* sourcePixels = sourceRow.data();
+							if (mip == 1)
+							{
+								ToFloats(sourceBytes + (size_t)row * sourceWidth * 4, sourceWidth, settings.GammaCorrect, sourceRow.data(), simd);
+							}
+							else
+							{
+								sourcePixels = above.data() + (size_t)row * sourceWidth * 4;
+							}
+							FilterRow(sourcePixels, columns[mip], width, across.data() + (size_t)slots[row] * width * 4, simd);
+						}
+						AccumulateRow(across.data() + (size_t)slots[row] * width * 4, down.Weight[tap], width * 4, out, simd);
+					}
+
+					ClampRow(out, width * 4, simd);
+					ToBytes(out, width, settings.GammaCorrect, outBytes + (size_t)y * width * 4, simd);
+				}
+			};
+
+			uint32_t rowsPerBatch = (width >= BatchPixels) ? 1 : BatchPixels / width;
+			uint32_t batchCount = (height + rowsPerBatch - 1) / rowsPerBatch;
+			if (pool != nullptr && batchCount > 1)
+			{
+				pool->ParallelFor(batchCount, [&](unsigned int batch) { filterBand(batch * rowsPerBatch, rowsPerBatch); });
+			}
+			else
+			{
+				filterBand(0, height);
+			}
+
+			above.swap(level);
+		}
+	};
+
+	if (pool != nullptr && texture.ArraySize > 1)
+	{
+		pool->ParallelFor(texture.ArraySize, generateItem);
+	}
+	else
+	{
+		for (uint32_t item = 0; item < texture.ArraySize; ++item) generateItem(item);
+	}
+
+	outTexture = texture;
+	return true;
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include "MeshTypes.h"
+#include "DDSFile.h"
+
+class ThreadPool;
+
+//Builds full mip chains on the CPU for the texture cooking tool (TextureBuild), so textures ship with their mips baked in
+//rather than relying on GenerateMips at load, which needs a device context and a format the GPU can render to (the app
+//loads with neither, so a .dds with one mip is sampled without any). Each level is filtered down from the one above it,
+//kept as floats so nothing is rounded twice:
+//  Box      the average of the pixels each one covers, exactly a 2x2 average for even sizes
+//  Kaiser   a Kaiser windowed sinc reaching three destination pixels either side, sharper than box without its
+//           aliasing. Clamped to 0..1, as its negative lobes can ring past either end at hard edges
+//Colour is filtered in linear light when GammaCorrect is set (decoded from sRGB and encoded again after), so mips don't
+//darken; alpha always filters as it's stored. Filtering is separable, a row then a column at a time with SSE2, four
+//channels of a pixel per vector, as is converting to and from bytes; sRGB is converted by table, which SSE2 has no
+//gather for. Array items (and cube faces) are spread over the pool, as are bands of rows in each level. Each level needs
+//the one above, so levels themselves are done in turn
+namespace MipGenerator
+{
+	enum MipFilter
+	{
+		MipFilterBox,
+		MipFilterKaiser,
+	};
+
+	struct Settings
+	{
+		MipFilter Filter;
+
+		//Filter red, green and blue in linear light. Leave it off for data that isn't colour (normal maps, masks)
+		bool GammaCorrect;
+
+		//For tiling textures: filters wrap round to the opposite edge instead of repeating the edge pixels
+		bool Wrap;
+
+		Settings() : Filter(MipFilterKaiser), GammaCorrect(true), Wrap(false) {}
+	};
+
+	//Bands of rows of each level are filtered this many destination pixels at a time on the pool
+	const unsigned int BatchPixels = 16384;
+
+	//8 bit RGBA, BGRA or BGRX
+	bool CanGenerate(DXGI_FORMAT format);
+
+	//Levels in a full chain down to 1x1
+	uint32_t FullMipCount(uint32_t width, uint32_t height);
+
+	//The top mip of every array item of source with a full chain of mips built under it (any it already had are replaced).
+	//outTexture describes the result, with its bits in outBits. pool may be null to do it all on the calling thread.
+	//simd = false runs the scalar code, which the SIMD code must match bit for bit. False if the format can't be filtered
+	//or it's a volume texture
+	bool Generate(const DDSFile::Texture& source, const Settings& settings, std::vector<unsigned char>& outBits, DDSFile::Texture& outTexture,
+		ThreadPool* pool, bool simd = true);
+};
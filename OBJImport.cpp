@@ -0,0 +1,907 @@
+#include "OBJImport.h"
+#include <string>
+#include <chrono>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include "VertexWelder.h"
+#include "MeshNormals.h"
+#include "MeshOptimiser.h"
+#include "MeshSimplifier.h"
+#include "MeshClusters.h"
+#include "MeshTangents.h"
+#include "VertexPacking.h"
+#include "Hash.h"
+#include "DebugLog.h"
+
+namespace
+{
+	//Below this starting threads costs more than parsing on them saves
+	const size_t ParallelParseMinSize = 1024 * 1024;
+
+	//Share of the full mesh's triangles each level of detail aims for, see ImportSettings::LodLevels
+	const float LodTriangleRatios[] = { 0.5f, 0.25f, 0.1f, 0.05f };
+
+	//No level strays further than this from the full mesh, as a fraction of its bounding box diagonal
+	const float LodMaxRelativeError = 0.05f;
+
+	//A level that keeps more than this share of the one before's triangles isn't worth the memory
+	const float LodMinReduction = 0.85f;
+
+	//Stand-in normal for a corner whose smooth normal can't be known until every face has been read. Encodes the
+	//position index so two corners only weld if they'll end up with the same normal. No unit normal has z = -8
+	inline XMFLOAT3 PendingNormal(unsigned int position)
+	{
+		return XMFLOAT3((float)(position & 0xFFF), (float)(position >> 12), -8.0f);
+	}
+
+	//Welding state carried from one window of faces to the next (or used once for a whole file)
+	struct WeldState
+	{
+		VertexWelder Welder;						//Exact, ImportSettings::WeldEpsilon is applied by FinishWeld
+		std::vector<unsigned int> Pending;			//Per welded vertex, the position whose smooth normal it's waiting for, or NoIndex
+		std::vector<float> Accumulated;				//MeshNormals sums, 4 floats per position
+		std::vector<unsigned int> SmoothTriangles;	//Scratch, position indices of triangles that need smooth normals
+		std::vector<OBJParser::MaterialRun> Runs;	//Material runs, FirstCorner counting every corner welded so far
+		bool AnyPending;
+
+		explicit WeldState(size_t expectedVertexCount) : Welder(0.0f, expectedVertexCount), AnyPending(false) {}
+	};
+
+	//Welds every face corner in obj, appending the welded index of each to outIndices. Corners without a texture
+	//coordinate get (0, 0), corners without a normal get one generated as settings.MissingNormals asks
+	void WeldCorners(const OBJParser::ParsedOBJ& obj, const OBJLoader::ImportSettings& settings, WeldState& state, std::vector<unsigned int>& outIndices)
+	{
+		const XMFLOAT2 noTexCoord(0.0f, 0.0f);
+		bool faceted = settings.MissingNormals == OBJLoader::NormalGenerationFaceted;
+
+		size_t firstCorner = outIndices.size();
+		for(size_t run = 0; run < obj.MaterialRuns.size(); run++)
+		{
+			OBJParser::AddMaterialRun(state.Runs, firstCorner + obj.MaterialRuns[run].FirstCorner, obj.MaterialRuns[run].Material);
+		}
+
+		size_t numCorners = obj.VertIndices.size();
+		for(size_t t = 0; t < numCorners; t += 3)
+		{
+			const unsigned int* positions = &obj.VertIndices[t];
+			bool needsSmooth = false;
+
+			for(size_t k = 0; k < 3; k++)
+			{
+				unsigned int texCoord = obj.TextureIndices[t + k];
+				unsigned int normal = obj.NormalIndices[t + k];
+
+				SimpleVertex vertex;
+				vertex.Pos = obj.Vertices[positions[k]];
+				vertex.TexC = (texCoord != OBJParser::NoIndex) ? obj.TexCoords[texCoord] : noTexCoord;
+
+				bool pending = false;
+				if(normal != OBJParser::NoIndex)
+				{
+					vertex.Normal = obj.Normals[normal];
+				}
+				else if(faceted)
+				{
+					vertex.Normal = MeshNormals::FaceNormal(obj.Vertices[positions[0]], obj.Vertices[positions[1]], obj.Vertices[positions[2]]);
+				}
+				else
+				{
+					vertex.Normal = PendingNormal(positions[k]);
+					pending = true;
+					needsSmooth = true;
+				}
+
+				unsigned int index = state.Welder.Add(vertex);
+				if(index == state.Pending.size())
+				{
+					state.Pending.push_back(pending ? positions[k] : OBJParser::NoIndex);
+				}
+				outIndices.push_back(index);
+			}
+
+			if(needsSmooth)
+			{
+				state.SmoothTriangles.insert(state.SmoothTriangles.end(), positions, positions + 3);
+			}
+		}
+
+		if(!state.SmoothTriangles.empty())
+		{
+			if(state.Accumulated.size() < obj.Vertices.size() * 4)
+			{
+				state.Accumulated.resize(obj.Vertices.size() * 4, 0.0f);
+			}
+
+			MeshNormals::AccumulateSmooth(obj.Vertices.data(), state.SmoothTriangles.data(), state.SmoothTriangles.size() / 3, state.Accumulated.data());
+			state.SmoothTriangles.clear();
+			state.AnyPending = true;
+		}
+	}
+
+	//Fills in the smooth normals that were pending and applies the weld epsilon, merging any vertices that have
+	//become the same. Welding exactly first and then again by epsilon gives the same result as welding by epsilon
+	//straight away (the first vertex in each cell still wins)
+	void FinishWeld(WeldState& state, const OBJLoader::ImportSettings& settings, MeshCache::MeshContent& outMesh)
+	{
+		std::vector<SimpleVertex>& vertices = state.Welder.Vertices();
+
+		if(state.AnyPending)
+		{
+			std::vector<XMFLOAT3> smoothNormals(state.Accumulated.size() / 4);
+			MeshNormals::NormaliseSmooth(state.Accumulated.data(), smoothNormals.size(), smoothNormals.data());
+
+			for(size_t i = 0; i < vertices.size(); i++)
+			{
+				if(state.Pending[i] != OBJParser::NoIndex)
+				{
+					vertices[i].Normal = smoothNormals[state.Pending[i]];
+				}
+			}
+		}
+
+		if(!state.AnyPending && settings.WeldEpsilon <= 0.0f)
+		{
+			outMesh.Vertices.swap(vertices);
+			return;
+		}
+
+		VertexWelder welder(settings.WeldEpsilon, vertices.size());
+		std::vector<unsigned int> remap(vertices.size());
+		for(size_t i = 0; i < vertices.size(); i++)
+		{
+			remap[i] = welder.Add(vertices[i]);
+		}
+
+		for(size_t i = 0; i < outMesh.Indices.size(); i++)
+		{
+			outMesh.Indices[i] = remap[outMesh.Indices[i]];
+		}
+
+		outMesh.Vertices.swap(welder.Vertices());
+	}
+
+	//Groups the triangles by material so each material is one range of the index buffer, in the order the OBJ first used
+	//them. Faces before the first "usemtl" get an unnamed material of their own. Meshes without materials stay as one
+	//range with no material table
+	void SplitSubmeshes(const WeldState& state, const OBJParser::ParsedOBJ& obj, MeshCache::MeshContent& mesh)
+	{
+		const std::vector<OBJParser::MaterialRun>& runs = state.Runs;
+		if(runs.empty())
+		{
+			return;
+		}
+
+		mesh.Materials = obj.Materials;
+		mesh.MaterialLibraries = obj.MaterialLibraries;
+
+		unsigned int unnamed = OBJParser::NoIndex;
+		if(runs[0].FirstCorner > 0)
+		{
+			unnamed = (unsigned int)mesh.Materials.size();
+			mesh.Materials.push_back(std::string());
+		}
+
+		//Each material's corner count, then where its range starts
+		size_t materialCount = mesh.Materials.size();
+		std::vector<unsigned int> counts(materialCount, 0);
+		size_t cornerCount = mesh.Indices.size();
+		for(size_t run = 0; run <= runs.size(); run++)
+		{
+			size_t start = (run == 0) ? 0 : runs[run - 1].FirstCorner;
+			size_t end = (run < runs.size()) ? runs[run].FirstCorner : cornerCount;
+			unsigned int material = (run == 0) ? unnamed : runs[run - 1].Material;
+			if(end > start) counts[material] += (unsigned int)(end - start);
+		}
+
+		std::vector<unsigned int> starts(materialCount);
+		unsigned int total = 0;
+		for(size_t material = 0; material < materialCount; material++)
+		{
+			starts[material] = total;
+			total += counts[material];
+
+			if(counts[material] > 0)
+			{
+				MeshCache::Submesh submesh = { starts[material], counts[material], (uint32_t)material, 0 };
+				mesh.Submeshes.push_back(submesh);
+			}
+		}
+
+		//Stable, so triangles keep their file order within a material
+		std::vector<unsigned int> sorted(cornerCount);
+		for(size_t run = 0; run <= runs.size(); run++)
+		{
+			size_t start = (run == 0) ? 0 : runs[run - 1].FirstCorner;
+			size_t end = (run < runs.size()) ? runs[run].FirstCorner : cornerCount;
+			unsigned int material = (run == 0) ? unnamed : runs[run - 1].Material;
+			if(end > start)
+			{
+				memcpy(&sorted[starts[material]], &mesh.Indices[start], (end - start) * sizeof(unsigned int));
+				starts[material] += (unsigned int)(end - start);
+			}
+		}
+
+		mesh.Indices.swap(sorted);
+	}
+
+	//Appends up to 'levels' simplified copies of the mesh to its index buffer, each split into the same materials as the full
+	//mesh, and fills in the LOD table. Every level is simplified from the full mesh, so its error is measured against what
+	//it stands in for rather than piled up down a chain, and each submesh on its own, so material boundaries are treated
+	//as borders and don't open up. Vertices are shared, MeshSimplifier never adds any
+	void GenerateLods(const char* name, unsigned int levels, MeshCache::MeshContent& mesh)
+	{
+		if(mesh.Submeshes.empty())
+		{
+			MeshCache::Submesh wholeMesh = { 0, (uint32_t)mesh.Indices.size(), 0, 0 };
+			mesh.Submeshes.push_back(wholeMesh);
+		}
+
+		MeshCache::MeshLod fullDetail = { 0, (uint32_t)mesh.Submeshes.size(), 0.0f, 0 };
+		mesh.Lods.push_back(fullDetail);
+
+		if(mesh.Vertices.empty())
+		{
+			return;
+		}
+
+		float minimum[3] = { mesh.Vertices[0].Pos.x, mesh.Vertices[0].Pos.y, mesh.Vertices[0].Pos.z };
+		float maximum[3] = { minimum[0], minimum[1], minimum[2] };
+		for(size_t i = 1; i < mesh.Vertices.size(); i++)
+		{
+			const float p[3] = { mesh.Vertices[i].Pos.x, mesh.Vertices[i].Pos.y, mesh.Vertices[i].Pos.z };
+			for(int k = 0; k < 3; k++)
+			{
+				minimum[k] = (p[k] < minimum[k]) ? p[k] : minimum[k];
+				maximum[k] = (p[k] > maximum[k]) ? p[k] : maximum[k];
+			}
+		}
+
+		float diagonal = sqrtf((maximum[0] - minimum[0]) * (maximum[0] - minimum[0]) + (maximum[1] - minimum[1]) * (maximum[1] - minimum[1]) +
+			(maximum[2] - minimum[2]) * (maximum[2] - minimum[2]));
+		float maxError = diagonal * LodMaxRelativeError;
+
+		unsigned int maxLevels = sizeof(LodTriangleRatios) / sizeof(LodTriangleRatios[0]);
+		std::vector<unsigned int> simplified;
+		std::vector<unsigned int> levelIndices;
+		std::vector<MeshCache::Submesh> levelSubmeshes;
+
+		for(unsigned int level = 0; level < levels && level < maxLevels; level++)
+		{
+			const MeshCache::MeshLod previous = mesh.Lods.back();
+			MeshCache::MeshLod lod = { (uint32_t)mesh.Submeshes.size(), fullDetail.SubmeshCount, 0.0f, 0 };
+
+			levelIndices.clear();
+			levelSubmeshes.clear();
+
+			for(unsigned int i = 0; i < fullDetail.SubmeshCount; i++)
+			{
+				const MeshCache::Submesh& source = mesh.Submeshes[i];
+				size_t target = (size_t)(source.IndexCount / 3 * LodTriangleRatios[level]) * 3;
+
+				float error = MeshSimplifier::Simplify(mesh.Vertices, &mesh.Indices[source.IndexStart], source.IndexCount, target, maxError, simplified);
+				lod.Error = std::max(lod.Error, error);
+
+				MeshCache::Submesh submesh = { (uint32_t)(mesh.Indices.size() + levelIndices.size()), (uint32_t)simplified.size(), source.MaterialId, 0 };
+				levelSubmeshes.push_back(submesh);
+				levelIndices.insert(levelIndices.end(), simplified.begin(), simplified.end());
+			}
+
+			//Once the error budget stops it short the levels stop getting smaller
+			size_t previousCount = 0;
+			for(unsigned int i = 0; i < previous.SubmeshCount; i++)
+			{
+				previousCount += mesh.Submeshes[previous.SubmeshStart + i].IndexCount;
+			}
+
+			if(levelIndices.size() > previousCount * LodMinReduction)
+			{
+				break;
+			}
+
+			mesh.Indices.insert(mesh.Indices.end(), levelIndices.begin(), levelIndices.end());
+			mesh.Submeshes.insert(mesh.Submeshes.end(), levelSubmeshes.begin(), levelSubmeshes.end());
+			mesh.Lods.push_back(lod);
+
+			DebugLog("[OBJLoader] %s: LOD %u has %u triangles, error %g\n", name, (unsigned int)(mesh.Lods.size() - 1), (unsigned int)(levelIndices.size() / 3), lod.Error);
+		}
+	}
+
+	//Indices of the full detail mesh, which always come first
+	size_t FullDetailIndexCount(const MeshCache::MeshContent& mesh)
+	{
+		if(mesh.Lods.empty())
+		{
+			return mesh.Indices.size();
+		}
+
+		const MeshCache::Submesh& last = mesh.Submeshes[mesh.Lods[0].SubmeshStart + mesh.Lods[0].SubmeshCount - 1];
+		return last.IndexStart + last.IndexCount;
+	}
+
+	//Reorder triangles for the post-transform cache, then for overdraw, then lay vertices out in the order they're first used.
+	//Triangles are only reordered inside their own submesh so the draw ranges stay valid. The passes never look at how good
+	//the order the mesh came in was, so if that had the better ACMR it's put back
+	void Optimise(const char* name, MeshCache::MeshContent& mesh)
+	{
+		std::vector<unsigned int>& meshIndices = mesh.Indices;
+		std::vector<SimpleVertex>& meshVertices = mesh.Vertices;
+		std::vector<unsigned int> inputIndices(meshIndices);
+		std::vector<SimpleVertex> inputVertices(meshVertices);
+
+		//Measured over the full detail mesh alone. The levels of detail after it reuse its vertices, so counting them too
+		//would make every vertex look transformed several times over
+		size_t fullDetailCount = FullDetailIndexCount(mesh);
+		MeshOptimiser::CacheStats before = MeshOptimiser::AnalyseVertexCache(meshIndices.data(), fullDetailCount, meshVertices.size());
+
+		if(mesh.Submeshes.size() <= 1)
+		{
+			MeshOptimiser::OptimiseVertexCache(meshIndices, meshVertices.size());
+			MeshOptimiser::OptimiseOverdraw(meshIndices, meshVertices);
+		}
+		else
+		{
+			std::vector<unsigned int> range;
+			for(size_t i = 0; i < mesh.Submeshes.size(); i++)
+			{
+				const MeshCache::Submesh& submesh = mesh.Submeshes[i];
+				range.assign(meshIndices.begin() + submesh.IndexStart, meshIndices.begin() + submesh.IndexStart + submesh.IndexCount);
+
+				MeshOptimiser::OptimiseVertexCache(range, meshVertices.size());
+				MeshOptimiser::OptimiseOverdraw(range, meshVertices);
+
+				memcpy(&meshIndices[submesh.IndexStart], range.data(), range.size() * sizeof(unsigned int));
+			}
+		}
+
+		MeshOptimiser::OptimiseVertexFetch(meshVertices, meshIndices);
+
+		MeshOptimiser::CacheStats after = MeshOptimiser::AnalyseVertexCache(meshIndices.data(), fullDetailCount, meshVertices.size());
+
+		if(after.ACMR > before.ACMR)
+		{
+			meshIndices.swap(inputIndices);
+			meshVertices.swap(inputVertices);
+
+			DebugLog("[OBJLoader] %s: ACMR %.3f, ATVR %.3f, kept the order it came in (optimised would be ACMR %.3f)\n", name,
+				before.ACMR, before.ATVR, after.ACMR);
+			return;
+		}
+
+		DebugLog("[OBJLoader] %s: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n", name, before.ACMR, after.ACMR, before.ATVR, after.ATVR);
+	}
+
+	//Cuts every submesh (every level of detail's too) into clusters for culling. Clustering shuffles triangles around
+	//inside each submesh, so the vertices are laid out again afterwards if the mesh is being optimised
+	void BuildClusters(const char* name, bool optimise, MeshCache::MeshContent& mesh)
+	{
+		if(mesh.Submeshes.empty())
+		{
+			MeshClusters::Build(mesh.Vertices, mesh.Indices, 0, mesh.Indices.size(), mesh.Clusters);
+		}
+
+		for(size_t i = 0; i < mesh.Submeshes.size(); i++)
+		{
+			MeshClusters::Build(mesh.Vertices, mesh.Indices, mesh.Submeshes[i].IndexStart, mesh.Submeshes[i].IndexCount, mesh.Clusters);
+		}
+
+		if(optimise)
+		{
+			MeshOptimiser::OptimiseVertexFetch(mesh.Vertices, mesh.Indices);
+		}
+
+		MeshOptimiser::CacheStats after = MeshOptimiser::AnalyseVertexCache(mesh.Indices.data(), FullDetailIndexCount(mesh), mesh.Vertices.size());
+
+		DebugLog("[OBJLoader] %s: %u clusters, %.1f triangles each, ACMR %.3f\n", name, (unsigned int)mesh.Clusters.size(),
+			mesh.Clusters.empty() ? 0.0 : mesh.Indices.size() / 3.0 / mesh.Clusters.size(), after.ACMR);
+	}
+
+	//Tangents for every vertex, from the full detail mesh's triangles (see MeshTangents.h). Runs after everything that
+	//moves vertices, as the ones it splits are added to the end and every pass before it would have to carry the tangents along
+	void GenerateTangents(const char* name, unsigned int threads, MeshCache::MeshContent& mesh)
+	{
+		size_t sourceIndexCount = FullDetailIndexCount(mesh);
+
+		auto start = std::chrono::high_resolution_clock::now();
+		size_t split;
+		if(threads != 1 && sourceIndexCount / 3 > MeshTangents::BatchSize)
+		{
+			//The calling thread works too, so the pool only needs the rest
+			ThreadPool pool(threads > 1 ? threads - 1 : 0);
+			split = MeshTangents::Generate(mesh.Vertices, mesh.Indices, sourceIndexCount, mesh.Tangents, &pool);
+		}
+		else
+		{
+			split = MeshTangents::Generate(mesh.Vertices, mesh.Indices, sourceIndexCount, mesh.Tangents, nullptr);
+		}
+		double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+		DebugLog("[OBJLoader] %s: tangents in %.2f ms, %u vertices split on mirrored UVs\n", name, milliseconds, (unsigned int)split);
+	}
+
+	//BVH over the full detail mesh (see MeshBvh.h). Runs last, as it refers to triangles by where they are in the index buffer
+	void BuildBvh(const char* name, unsigned int threads, MeshCache::MeshContent& mesh)
+	{
+		size_t indexCount = FullDetailIndexCount(mesh);
+
+		auto start = std::chrono::high_resolution_clock::now();
+		if(threads != 1 && indexCount / 3 >= MeshBvh::ParallelMinTriangles)
+		{
+			ThreadPool pool(threads > 1 ? threads - 1 : 0);
+			MeshBvh::Build(mesh.Vertices, mesh.Indices, indexCount, &pool, mesh.BvhNodes, mesh.BvhTriangles);
+		}
+		else
+		{
+			MeshBvh::Build(mesh.Vertices, mesh.Indices, indexCount, nullptr, mesh.BvhNodes, mesh.BvhTriangles);
+		}
+		double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+		DebugLog("[OBJLoader] %s: BVH of %u nodes in %.2f ms, SAH cost %.2f\n", name, (unsigned int)mesh.BvhNodes.size(), milliseconds,
+			MeshBvh::Cost(mesh.BvhNodes.data(), mesh.BvhNodes.size()));
+	}
+
+	//Everything settings ask for after the mesh is welded, in the order each pass needs
+	void FinishMesh(const char* name, const OBJLoader::ImportSettings& settings, MeshCache::MeshContent& mesh)
+	{
+		if(settings.LodLevels > 0)
+		{
+			GenerateLods(name, settings.LodLevels, mesh);
+		}
+
+		if(settings.OptimiseMesh)
+		{
+			Optimise(name, mesh);
+		}
+
+		if(settings.BuildClusters)
+		{
+			BuildClusters(name, settings.OptimiseMesh, mesh);
+		}
+
+		if(settings.GenerateTangents)
+		{
+			GenerateTangents(name, settings.ParseThreads, mesh);
+		}
+
+		if(settings.BuildBvh)
+		{
+			BuildBvh(name, settings.ParseThreads, mesh);
+		}
+	}
+
+	//An old headerless .objBinary with no OBJ beside it is all there is of the mesh, so it's never written to. Newer caches
+	//have bounds, LODs and the rest that it doesn't, so it's rebuilt with what settings ask for (see BuildLegacyMesh) into a
+	//version 2 cache of its own at binaryFilename + ".v2", kept up to date with the old file and the settings the way the
+	//cache of an OBJ is. outMesh.File has the old file mapped when this is called, and the cache when it returns
+	bool PrepareLegacyCache(const char* filename, const std::string& binaryFilename, bool invertTexCoords, const OBJLoader::ImportSettings& settings, OBJLoader::PreparedMesh& outMesh)
+	{
+		MappedFile legacyFile;
+		outMesh.File.Close();
+		if(!legacyFile.Open(binaryFilename.c_str()))
+		{
+			return false;
+		}
+
+		std::string cacheFilename = binaryFilename + ".v2";
+		MeshCache::MeshView view;
+		if(outMesh.File.Open(cacheFilename.c_str()) && MeshCache::Open(outMesh.File.Data(), outMesh.File.Size(), view) &&
+			MeshCache::MatchesSource(view, legacyFile.Data(), legacyFile.Size()) &&
+			view.Header->SettingsHash == OBJLoader::SettingsHash(settings, invertTexCoords))
+		{
+			OBJLoader::PrepareFromView(filename, view, outMesh);
+			return true;
+		}
+
+		//Windows won't let us overwrite a file that's still mapped
+		outMesh.File.Close();
+
+		OBJLoader::PreparedMesh legacy;
+		MeshCache::MeshContent mesh;
+		if(!OBJLoader::PrepareLegacyBinary(legacyFile.Data(), legacyFile.Size(), legacy) ||
+			!OBJLoader::BuildLegacyMesh(filename, legacy, invertTexCoords, settings, mesh))
+		{
+			return false;
+		}
+
+		std::vector<unsigned char>& cacheFile = outMesh.Built;
+		MeshCache::Serialise(mesh, legacyFile.Data(), legacyFile.Size(), cacheFile);
+
+		if(!MeshCache::WriteFile(cacheFilename.c_str(), cacheFile))
+		{
+			DebugLog("[OBJLoader] couldn't write %s\n", cacheFilename.c_str());
+		}
+
+		if(!MeshCache::Open(cacheFile.data(), cacheFile.size(), view))
+		{
+			return false;
+		}
+
+		OBJLoader::PrepareFromView(filename, view, outMesh);
+		return true;
+	}
+
+	//Looks up each material name in the .mtl files (relative to the OBJ). Names no library defines keep the defaults
+	//with Defined = false, as do the materials of a library that can't be read
+	void LoadMaterials(const char* filename, const std::vector<std::string>& names, const std::vector<std::string>& libraries, std::vector<MTLParser::Material>& outMaterials)
+	{
+		std::vector<MTLParser::Material> defined;
+		for(size_t i = 0; i < libraries.size(); i++)
+		{
+			std::string path = MTLParser::ResolvePath(filename, libraries[i]);
+			if(!MTLParser::Load(path.c_str(), defined))
+			{
+				DebugLog("[OBJLoader] %s: couldn't read material library %s\n", filename, path.c_str());
+			}
+		}
+
+		outMaterials.resize(names.size());
+		for(size_t i = 0; i < names.size(); i++)
+		{
+			outMaterials[i].Name = names[i];
+			for(size_t j = 0; j < defined.size(); j++)
+			{
+				if(defined[j].Name == names[i])
+				{
+					outMaterials[i] = defined[j];
+					break;
+				}
+			}
+		}
+	}
+}
+
+void OBJLoader::CreateIndices(const std::vector<XMFLOAT3>& inVertices, 
+							  const std::vector<XMFLOAT2>& inTexCoords, 
+							  const std::vector<XMFLOAT3>& inNormals, 
+							  std::vector<unsigned int>& outIndices, 
+							  std::vector<SimpleVertex>& outVertices,
+							  float weldEpsilon)
+{
+	int numVertices = inVertices.size();
+
+	// Hash table from an already-existing SimpleVertex to its corresponding index
+	VertexWelder welder(weldEpsilon, numVertices);
+
+	outIndices.reserve(outIndices.size() + numVertices);
+
+	for(int i = 0; i < numVertices; ++i) //For each vertex
+	{
+		SimpleVertex vertex = {inVertices[i], inNormals[i],  inTexCoords[i]}; 
+
+		// Re-uses the index of a vertex with the same attributes if there is one, otherwise adds it to the buffer
+		outIndices.push_back(welder.Add(vertex));
+	}
+
+	outVertices.swap(welder.Vertices());
+}
+
+void OBJLoader::PrepareFromView(const char* filename, const MeshCache::MeshView& view, PreparedMesh& outMesh)
+{
+	const MeshCache::MeshFileHeader* header = view.Header;
+
+	outMesh.Valid = true;
+	outMesh.Vertices = view.Vertices;
+	outMesh.VertexCount = header->VertexCount;
+	outMesh.VertexStride = header->VertexStride;
+	outMesh.Format = view.Format;
+	outMesh.Indices = view.Indices;
+	outMesh.IndexCount = header->IndexCount;
+	outMesh.IndexFormat = (DXGI_FORMAT)header->IndexFormat;
+	memcpy(outMesh.BoundsMin, header->BoundsMin, sizeof(outMesh.BoundsMin));
+	memcpy(outMesh.BoundsMax, header->BoundsMax, sizeof(outMesh.BoundsMax));
+	memcpy(outMesh.SphereCentre, header->SphereCentre, sizeof(outMesh.SphereCentre));
+	outMesh.SphereRadius = header->SphereRadius;
+	outMesh.Submeshes = view.Submeshes;
+	outMesh.SubmeshCount = view.SubmeshCount;
+	outMesh.Lods = view.Lods;
+	outMesh.LodCount = view.LodCount;
+	outMesh.Clusters = view.Clusters;
+	outMesh.ClusterCount = view.ClusterCount;
+	outMesh.Tangents = view.Tangents;
+	outMesh.BvhNodes = view.BvhNodes;
+	outMesh.BvhNodeCount = view.BvhNodeCount;
+	outMesh.BvhTriangles = view.BvhTriangles;
+	outMesh.BvhTriangleCount = view.BvhTriangleCount;
+
+	std::vector<std::string> materials;
+	std::vector<std::string> libraries;
+	MeshCache::ReadNames(view.Materials, view.MaterialsSize, materials);
+	MeshCache::ReadNames(view.MaterialLibraries, view.MaterialLibrariesSize, libraries);
+	LoadMaterials(filename, materials, libraries, outMesh.Materials);
+
+	//Every range has to have a material to draw with
+	for(unsigned int i = 0; i < outMesh.SubmeshCount; i++)
+	{
+		if(outMesh.Submeshes[i].MaterialId >= outMesh.Materials.size())
+		{
+			outMesh.Materials.resize(outMesh.Submeshes[i].MaterialId + 1);
+		}
+	}
+}
+
+void OBJLoader::MakeBvhTree(const PreparedMesh& mesh, MeshBvh::Tree& outTree)
+{
+	outTree = MeshBvh::Tree();
+	if(mesh.BvhNodes == nullptr)
+	{
+		return;
+	}
+
+	outTree.Nodes.assign(mesh.BvhNodes, mesh.BvhNodes + mesh.BvhNodeCount);
+	outTree.Triangles.assign(mesh.BvhTriangles, mesh.BvhTriangles + mesh.BvhTriangleCount);
+
+	outTree.Positions.resize(mesh.VertexCount);
+	const unsigned char* vertices = (const unsigned char*)mesh.Vertices;
+	for(unsigned int i = 0; i < mesh.VertexCount; i++)
+	{
+		if(mesh.Format == VertexFormatPacked)
+		{
+			SimpleVertex vertex;
+			VertexPacking::Unpack((const PackedVertex*)(vertices + (size_t)i * mesh.VertexStride), 1, mesh.BoundsMin, mesh.BoundsMax, &vertex);
+			outTree.Positions[i] = vertex.Pos;
+		}
+		else
+		{
+			outTree.Positions[i] = ((const SimpleVertex*)(vertices + (size_t)i * mesh.VertexStride))->Pos;
+		}
+	}
+
+	outTree.Corners.resize(mesh.BvhTriangleCount * 3);
+	for(unsigned int i = 0; i < mesh.BvhTriangleCount * 3; i++)
+	{
+		size_t index = (size_t)mesh.BvhTriangles[i / 3] * 3 + i % 3;
+		outTree.Corners[i] = (mesh.IndexFormat == DXGI_FORMAT_R32_UINT) ? ((const uint32_t*)mesh.Indices)[index] : ((const uint16_t*)mesh.Indices)[index];
+	}
+}
+
+uint64_t OBJLoader::SettingsHash(const ImportSettings& settings, bool invertTexCoords)
+{
+	//Each one widened to its own slot, so struct padding never gets hashed
+	float weldEpsilon = settings.WeldEpsilon;
+	uint32_t weldBits;
+	memcpy(&weldBits, &weldEpsilon, sizeof(weldBits));
+
+	const uint32_t values[] =
+	{
+		weldBits, settings.OptimiseMesh ? 1u : 0u, (uint32_t)settings.Format, (uint32_t)settings.MissingNormals, settings.LodLevels,
+		settings.BuildClusters ? 1u : 0u, settings.GenerateTangents ? 1u : 0u, settings.BuildBvh ? 1u : 0u, invertTexCoords ? 1u : 0u
+	};
+	return HashBytes(values, sizeof(values));
+}
+
+bool OBJLoader::PrepareLegacyBinary(const void* fileData, size_t fileSize, PreparedMesh& outMesh)
+{
+	unsigned int numVertices;
+	unsigned int numIndices;
+
+	if(fileSize < 2 * sizeof(unsigned int))
+	{
+		return false;
+	}
+
+	//Read in array sizes
+	const char* bytes = (const char*)fileData;
+	memcpy(&numVertices, bytes, sizeof(unsigned int));
+	memcpy(&numIndices, bytes + sizeof(unsigned int), sizeof(unsigned int));
+
+	DXGI_FORMAT indexFormat = (numVertices & BinaryIndex32Flag) ? DXGI_FORMAT_R32_UINT : DXGI_FORMAT_R16_UINT;
+	numVertices &= ~BinaryIndex32Flag;
+
+	//The data follows straight after, so point into the file rather than copying it out
+	size_t vertexBytes = sizeof(SimpleVertex) * (size_t)numVertices;
+	size_t indexBytes = MeshCache::IndexSize(indexFormat) * (size_t)numIndices;
+	if(fileSize < 2 * sizeof(unsigned int) + vertexBytes + indexBytes)
+	{
+		return false;
+	}
+
+	const char* finalVerts = bytes + 2 * sizeof(unsigned int);
+
+	//A damaged file fails to load rather than having its indices point past the vertices
+	const void* finalIndices = finalVerts + vertexBytes;
+	for(unsigned int i = 0; i < numIndices; i++)
+	{
+		unsigned int index = (indexFormat == DXGI_FORMAT_R32_UINT) ? ((const uint32_t*)finalIndices)[i] : ((const uint16_t*)finalIndices)[i];
+		if(index >= numVertices)
+		{
+			return false;
+		}
+	}
+
+	outMesh.Valid = true;
+	outMesh.Vertices = finalVerts;
+	outMesh.VertexCount = numVertices;
+	outMesh.VertexStride = sizeof(SimpleVertex);
+	outMesh.Format = VertexFormatFull;
+	outMesh.Indices = finalIndices;
+	outMesh.IndexCount = numIndices;
+	outMesh.IndexFormat = indexFormat;
+
+	return true;
+}
+
+bool OBJLoader::BuildLegacyMesh(const char* name, const PreparedMesh& legacy, bool invertTexCoords, const ImportSettings& settings, MeshCache::MeshContent& outMesh)
+{
+	if(!legacy.Valid)
+	{
+		return false;
+	}
+
+	//Old caches were written with a vertex per corner, so without welding again the triangles would share no edges for the
+	//simplifier and vertex cache to use
+	const SimpleVertex* vertices = (const SimpleVertex*)legacy.Vertices;
+	VertexWelder welder(settings.WeldEpsilon, legacy.VertexCount);
+	outMesh.Indices.resize(legacy.IndexCount);
+	for(unsigned int i = 0; i < legacy.IndexCount; i++)
+	{
+		unsigned int index = (legacy.IndexFormat == DXGI_FORMAT_R32_UINT) ? ((const uint32_t*)legacy.Indices)[i] : ((const uint16_t*)legacy.Indices)[i];
+		outMesh.Indices[i] = welder.Add(vertices[index]);
+	}
+	outMesh.Vertices.swap(welder.Vertices());
+
+	outMesh.Format = settings.Format;
+	outMesh.SettingsHash = SettingsHash(settings, invertTexCoords);
+
+	DebugLog("[OBJLoader] %s: welded %u -> %u vertices\n", name, legacy.VertexCount, (unsigned int)outMesh.Vertices.size());
+
+	FinishMesh(name, settings, outMesh);
+	return true;
+}
+
+//Faces without normals get generated ones (see ImportSettings::MissingNormals), but faces without texture coordinates just get (0, 0).
+//If your .obj file has no lines beginning with "vt", then you'll need to change the Export settings in your modelling software so that it exports the texture coordinates.
+//If you still have no "vt" lines, you'll need to do some texture unwrapping, also known as UV unwrapping.
+bool OBJLoader::BuildMesh(const char* name, const char* objData, size_t objSize, bool invertTexCoords, const ImportSettings& settings, MeshCache::MeshContent& outMesh)
+{
+	//DirectX uses 1 index buffer, OBJ is optimized for storage and not rendering and so uses 3 smaller index buffers.....great...
+	//We'll have to merge this into 1 index buffer which we'll do after loading in all of the required data.
+	OBJParser::ParsedOBJ obj;
+
+	bool parsed;
+	if(settings.ParseThreads != 1 && objSize >= ParallelParseMinSize)
+	{
+		//The calling thread parses too, so the pool only needs the rest
+		ThreadPool pool(settings.ParseThreads > 1 ? settings.ParseThreads - 1 : 0);
+		parsed = OBJParser::ParseParallel(objData, objSize, obj, invertTexCoords, pool);
+	}
+	else
+	{
+		parsed = OBJParser::Parse(objData, objSize, obj, invertTexCoords);
+	}
+
+	if(!parsed)
+	{
+		return false;
+	}
+
+	//Each face corner goes straight into the welder, which hands back its index in the single index buffer
+	unsigned int numIndices = obj.VertIndices.size();
+	WeldState state(numIndices);
+	outMesh.Indices.reserve(numIndices);
+
+	auto weldStart = std::chrono::high_resolution_clock::now();
+	WeldCorners(obj, settings, state, outMesh.Indices);
+	FinishWeld(state, settings, outMesh);
+	SplitSubmeshes(state, obj, outMesh);
+	double weldMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - weldStart).count();
+
+	outMesh.Format = settings.Format;
+	outMesh.SettingsHash = SettingsHash(settings, invertTexCoords);
+
+	DebugLog("[OBJLoader] %s: welded %u -> %u vertices in %.2f ms\n", name, numIndices, (unsigned int)outMesh.Vertices.size(), weldMilliseconds);
+
+	FinishMesh(name, settings, outMesh);
+	return true;
+}
+
+bool OBJLoader::BuildMeshStreaming(const char* filename, size_t windowSize, bool invertTexCoords, const ImportSettings& settings, MeshCache::MeshContent& outMesh)
+{
+	//Faces are welded window by window as they're parsed, so the only things that grow with the file are the
+	//v/vt/vn arrays (which faces can point anywhere back into) and the finished mesh itself
+	OBJParser::ParsedOBJ obj;
+	WeldState state(0);
+	std::vector<unsigned int>& meshIndices = outMesh.Indices;
+
+	auto weldStart = std::chrono::high_resolution_clock::now();
+	bool parsed = OBJParser::ParseStream(filename, windowSize, invertTexCoords, obj, [&settings, &state, &meshIndices](const OBJParser::ParsedOBJ& window)
+	{
+		WeldCorners(window, settings, state, meshIndices);
+		return true;
+	});
+
+	if(!parsed)
+	{
+		return false;
+	}
+
+	FinishWeld(state, settings, outMesh);
+	SplitSubmeshes(state, obj, outMesh);
+	double weldMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - weldStart).count();
+
+	outMesh.Format = settings.Format;
+	outMesh.SettingsHash = SettingsHash(settings, invertTexCoords);
+
+	DebugLog("[OBJLoader] %s: streamed in %u KB windows, welded %u -> %u vertices in %.2f ms\n", filename, (unsigned int)(windowSize / 1024),
+		(unsigned int)meshIndices.size(), (unsigned int)outMesh.Vertices.size(), weldMilliseconds);
+
+	FinishMesh(filename, settings, outMesh);
+	return true;
+}
+
+bool OBJLoader::Prepare(const char* filename, bool invertTexCoords, const ImportSettings& settings, PreparedMesh& outMesh)
+{
+	std::string binaryFilename = filename;
+	binaryFilename.append("Binary");
+
+	//Both files are mapped rather than read, so vertex and index data goes from the OS file cache straight to
+	//CreateBuffer without a copy on our heap. The OBJ is needed to check the cache against (and to rebuild it)
+	MappedFile sourceFile;
+	bool haveSource = sourceFile.Open(filename);
+
+	MappedFile& binaryFile = outMesh.File;
+	if(binaryFile.Open(binaryFilename.c_str()))
+	{
+		if(MeshCache::IsContainer(binaryFile.Data(), binaryFile.Size()))
+		{
+			MeshCache::MeshView view;
+
+			//Without the OBJ we take whatever the cache has, otherwise it has to match both the OBJ and the settings (every
+			//one that changes the result, see SettingsHash). Caches written before materials were supported have no material
+			//table even when the OBJ uses them
+			if(MeshCache::Open(binaryFile.Data(), binaryFile.Size(), view) &&
+				(!haveSource || (MeshCache::MatchesSource(view, sourceFile.Data(), sourceFile.Size()) &&
+					view.Header->SettingsHash == SettingsHash(settings, invertTexCoords) &&
+					(view.Materials != nullptr || !OBJParser::UsesMaterials((const char*)sourceFile.Data(), sourceFile.Size())))))
+			{
+				PrepareFromView(filename, view, outMesh);
+				return true;
+			}
+
+			DebugLog("[OBJLoader] %s is out of date or damaged, rebuilding\n", binaryFilename.c_str());
+		}
+		else if(!haveSource)
+		{
+			//Old headerless cache with no OBJ to rebuild it from, so it's the best we've got. It's left as it is and a
+			//version 2 rebuild of it used instead
+			return PrepareLegacyCache(filename, binaryFilename, invertTexCoords, settings, outMesh);
+		}
+
+		//Windows won't let us overwrite a file that's still mapped
+		binaryFile.Close();
+	}
+
+	if(!haveSource)
+	{
+		return false;
+	}
+
+	//Huge OBJs are parsed a window at a time so the text and per-corner indices never have to fit in memory at once.
+	//The mapping is still used for the source hash, which reads through it without keeping it resident
+	MeshCache::MeshContent mesh;
+	bool streamed = settings.StreamWindow > 0 && sourceFile.Size() > settings.StreamWindow;
+	bool built = streamed ? BuildMeshStreaming(filename, settings.StreamWindow, invertTexCoords, settings, mesh) :
+		BuildMesh(filename, (const char*)sourceFile.Data(), sourceFile.Size(), invertTexCoords, settings, mesh);
+	if(!built)
+	{
+		return false;
+	}
+
+	//Output data into binary file, the next time you run this function, the binary file will be up to date and will load that instead which is much quicker than parsing
+	std::vector<unsigned char>& cacheFile = outMesh.Built;
+	MeshCache::Serialise(mesh, sourceFile.Data(), sourceFile.Size(), cacheFile);
+
+	if(!MeshCache::WriteFile(binaryFilename.c_str(), cacheFile))
+	{
+		DebugLog("[OBJLoader] couldn't write %s\n", binaryFilename.c_str());
+	}
+
+	//Upload straight from the serialised copy so there's only one way data gets to the GPU
+	MeshCache::MeshView view;
+	if(!MeshCache::Open(cacheFile.data(), cacheFile.size(), view))
+	{
+		return false;
+	}
+
+	PrepareFromView(filename, view, outMesh);
+	return true;
+}
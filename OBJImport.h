@@ -0,0 +1,148 @@
+#pragma once
+#include <vector>
+#include "OBJParser.h"
+#include "MeshCache.h"
+#include "MappedFile.h"
+#include "MeshTypes.h"
+#include "MTLParser.h"
+#include "MeshBvh.h"
+
+//The CPU half of OBJLoader: OBJ text in, welded/optimised mesh and .objBinary cache out. No Direct3D here, so
+//this (with OBJParser, VertexWelder, MeshSimplifier, MeshOptimiser, MeshClusters, MeshTangents, MeshBounds, MeshBvh, VertexPacking and MeshCache) builds on its own for headless
+//tools and benchmarks. OBJLoader.h adds the device side on top - uploading a PreparedMesh and the input layouts.
+namespace OBJLoader
+{
+	//Where the normals come from for faces that don't give any
+	enum NormalGeneration
+	{
+		NormalGenerationSmooth = 0,		//Area weighted average of the triangles around each position
+		NormalGenerationFaceted = 1,	//Each triangle's own normal, so every edge stays hard
+	};
+
+	//Optional knobs for turning a text OBJ into a mesh. The defaults are what the scene uses
+	struct ImportSettings
+	{
+		//Vertices whose attributes all fall in the same grid cell of this size get merged. 0 = only merge exact duplicates
+		float WeldEpsilon;
+
+		//Run the MeshOptimiser passes (vertex cache, overdraw and vertex fetch order) before writing the cache
+		bool OptimiseMesh;
+
+		//VertexFormatPacked halves the vertex data, but needs drawing with a shader that decodes it (see VertexPacking.h)
+		VertexFormat Format;
+
+		//Only used for faces without normals
+		NormalGeneration MissingNormals;
+
+		//Threads to parse the OBJ text with (see OBJParser::ParseParallel), and to generate tangents and build the BVH with.
+		//1 = just the calling thread, 0 = one per hardware thread. Only kicks in for files of a megabyte or more, or meshes of
+		//more than MeshTangents::BatchSize or MeshBvh::ParallelMinTriangles triangles
+		unsigned int ParseThreads;
+
+		//OBJs bigger than this many bytes are parsed in windows of this size (see BuildMeshStreaming). 0 = never
+		size_t StreamWindow;
+
+		//Simplified levels of detail to generate after the full mesh, aiming for 50%, 25%, 10% then 5% of its triangles
+		//(see MeshSimplifier.h). Levels that can't get far enough below the one before without losing the shape are left out. 0 = none
+		unsigned int LodLevels;
+
+		//Split every submesh into clusters of neighbouring triangles with bounds to cull them by (see MeshClusters.h)
+		bool BuildClusters;
+
+		//Add a second vertex stream of tangents for normal mapping (see MeshTangents.h). Vertices on UV mirror seams are split
+		bool GenerateTangents;
+
+		//Build a bounding volume hierarchy over the full detail mesh's triangles for picking and collision (see MeshBvh.h)
+		bool BuildBvh;
+
+		ImportSettings() : WeldEpsilon(0.0f), OptimiseMesh(true), Format(VertexFormatFull), MissingNormals(NormalGenerationSmooth), ParseThreads(1), StreamWindow(64 * 1024 * 1024), LodLevels(3), BuildClusters(true),
+			GenerateTangents(false), BuildBvh(true) {}
+	};
+
+	//A mesh that has been read (or rebuilt) on the CPU and is ready for CreateBuffers. Owns the memory its pointers
+	//point into, either the mapped cache file or a freshly serialised one, so it can't be copied
+	struct PreparedMesh
+	{
+		MappedFile File;
+		std::vector<unsigned char> Built;
+
+		bool Valid;
+		const void* Vertices;
+		unsigned int VertexCount;
+		unsigned int VertexStride;
+		VertexFormat Format;
+		const void* Indices;
+		unsigned int IndexCount;
+		DXGI_FORMAT IndexFormat;
+		float BoundsMin[3];
+		float BoundsMax[3];
+		float SphereCentre[3];
+		float SphereRadius;
+
+		//Draw ranges, one per material per level of detail. None for old caches, which are drawn as one range
+		const MeshCache::Submesh* Submeshes;
+		unsigned int SubmeshCount;
+
+		//Which submeshes make up each level of detail. None if the cache has no LODs, when every submesh is the full mesh
+		const MeshCache::MeshLod* Lods;
+		unsigned int LodCount;
+
+		//Culling bounds for runs of each submesh, in index buffer order. None if the cache has no clusters
+		const MeshCache::MeshCluster* Clusters;
+		unsigned int ClusterCount;
+
+		//One per vertex, bound as a second vertex buffer. None if the cache has no tangents
+		const PackedTangent* Tangents;
+
+		//The full detail mesh's BVH, see MakeBvhTree. None if the cache has no BVH
+		const MeshCache::BvhNode* BvhNodes;
+		unsigned int BvhNodeCount;
+		const uint32_t* BvhTriangles;
+		unsigned int BvhTriangleCount;
+
+		//Indexed by Submesh::MaterialId, read from the .mtl files the OBJ names every time (they aren't part of the cache)
+		std::vector<MTLParser::Material> Materials;
+
+		PreparedMesh() : Valid(false), Vertices(nullptr), VertexCount(0), VertexStride(0), Format(VertexFormatFull), Indices(nullptr), IndexCount(0), IndexFormat(DXGI_FORMAT_R16_UINT), SphereRadius(0.0f), Submeshes(nullptr), SubmeshCount(0), Lods(nullptr), LodCount(0), Clusters(nullptr), ClusterCount(0), Tangents(nullptr),
+			BvhNodes(nullptr), BvhNodeCount(0), BvhTriangles(nullptr), BvhTriangleCount(0) {}
+	};
+
+	//Identifies everything in settings, and invertTexCoords, that changes what BuildMesh makes. A cache whose header has
+	//another one was built with other settings and gets rebuilt. ParseThreads and StreamWindow only change how the mesh is
+	//built, not what comes out, so they're left out
+	uint64_t SettingsHash(const ImportSettings& settings, bool invertTexCoords);
+
+	//Set in the vertex count of a pre-version 2 .objBinary file when its indices are 32-bit rather than 16-bit
+	const unsigned int BinaryIndex32Flag = 0x80000000;
+
+	//Everything Load does that doesn't need the device (safe to run on any thread). CreateBuffers in OBJLoader.h does the upload.
+	//Uses filename + "Binary" (see MeshCache.h) when it is up to date with filename, otherwise rebuilds it from the OBJ.
+	//Without the OBJ, an old headerless filename + "Binary" is never written to: it's rebuilt into filename + "Binary.v2"
+	bool Prepare(const char* filename, bool invertTexCoords, const ImportSettings& settings, PreparedMesh& outMesh);
+
+	//Helper methods for the above method
+	//Re-creates a single index buffer from the 3 given in the OBJ file, welding vertices with the same attributes into one
+	void CreateIndices(const std::vector<XMFLOAT3>& inVertices, const std::vector<XMFLOAT2>& inTexCoords, const std::vector<XMFLOAT3>& inNormals, std::vector<unsigned int>& outIndices, std::vector<SimpleVertex>& outVertices, float weldEpsilon = 0.0f);
+
+	//Turns the text of an OBJ file into a welded (and optionally optimised) mesh. 'name' is only used for logging
+	bool BuildMesh(const char* name, const char* objData, size_t objSize, bool invertTexCoords, const ImportSettings& settings, MeshCache::MeshContent& outMesh);
+
+	//Same result as BuildMesh, but reads the file windowSize bytes at a time and welds each window's faces as it goes,
+	//for OBJs too big to load whole. Peak memory is one window plus the v/vt/vn arrays plus the welded mesh
+	bool BuildMeshStreaming(const char* filename, size_t windowSize, bool invertTexCoords, const ImportSettings& settings, MeshCache::MeshContent& outMesh);
+
+	//Points outMesh at the arrays in a validated version 2 cache. filename is the OBJ, which "mtllib" paths are relative to
+	void PrepareFromView(const char* filename, const MeshCache::MeshView& view, PreparedMesh& outMesh);
+
+	//Copies the BVH out of a prepared mesh along with the positions of the triangles it holds, so it can be queried after the
+	//mesh's memory is gone. Packed positions are decoded. outTree is left empty if the mesh has no BVH
+	void MakeBvhTree(const PreparedMesh& mesh, MeshBvh::Tree& outTree);
+
+	//Points outMesh at the arrays in a headerless .objBinary from before version 2 of the format
+	bool PrepareLegacyBinary(const void* fileData, size_t fileSize, PreparedMesh& outMesh);
+
+	//The mesh in a headerless .objBinary read by PrepareLegacyBinary, welded again (by settings.WeldEpsilon, as those files
+	//have a vertex per corner) and put through everything after welding that settings ask for, as BuildMesh would. The
+	//texture coordinates are taken as the file has them, invertTexCoords only goes into outMesh.SettingsHash
+	bool BuildLegacyMesh(const char* name, const PreparedMesh& legacy, bool invertTexCoords, const ImportSettings& settings, MeshCache::MeshContent& outMesh);
+};
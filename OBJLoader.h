@@ -2,22 +2,24 @@
 #include <windows.h>
 #include <d3d11_1.h>
 #include <directxmath.h>
-#include <fstream>		//For loading in an external file
-#include <vector>		//For storing the XMFLOAT3/2 variables
-#include <map>			//For fast searching when re-creating the index buffer
+#include "OBJImport.h"
 #include "Structures.h"
 
 using namespace DirectX;
 
 namespace OBJLoader
 {
-	//The only method you'll need to call
-	MeshData Load(char* filename, ID3D11Device* _pd3dDevice, bool invertTexCoords = true);
+	//The only method you'll need to call.
+	//Uses filename + "Binary" (see MeshCache.h) when it is up to date with filename, otherwise rebuilds it from the OBJ
+	MeshData Load(char* filename, ID3D11Device* _pd3dDevice, bool invertTexCoords = true, const ImportSettings& settings = ImportSettings());
 
-	//Helper methods for the above method
-	//Searhes to see if a similar vertex already exists in the buffer -- if true, we re-use that index
-	bool FindSimilarVertex(const SimpleVertex& vertex, std::map<SimpleVertex, unsigned short>& vertToIndexMap, unsigned short& index);
+	//Load split in two: Prepare (OBJImport.h) does everything that doesn't need the device, then the upload
+	MeshData CreateBuffers(ID3D11Device* _pd3dDevice, const PreparedMesh& mesh);
 
-	//Re-creates a single index buffer from the 3 given in the OBJ file
-	void CreateIndices(const std::vector<XMFLOAT3>& inVertices, const std::vector<XMFLOAT2>& inTexCoords, const std::vector<XMFLOAT3>& inNormals, std::vector<unsigned short>& outIndices, std::vector<XMFLOAT3>& outVertices, std::vector<XMFLOAT2>& outTexCoords, std::vector<XMFLOAT3>& outNormals);
+	//Uploads vertices (vertexStride bytes each) and indices (in indexFormat) to new GPU buffers
+	MeshData CreateBuffers(ID3D11Device* _pd3dDevice, const void* vertices, unsigned int numVertices, unsigned int vertexStride, const void* indices, unsigned int numIndices, DXGI_FORMAT indexFormat);
+
+	//Fills in the input layout matching a vertex format, for CreateInputLayout, with TANGENT read from input slot 1 after
+	//the rest if withTangents is set. Returns the number of elements
+	UINT GetInputLayout(VertexFormat format, D3D11_INPUT_ELEMENT_DESC outLayout[MeshCache::MaxAttributes], bool withTangents = false);
 };
\ No newline at end of file
@@ -0,0 +1,568 @@
+#include "OBJParser.h"
+#include "FloatParser.h"
+#include <fstream>
+#include <string.h>
+
+namespace
+{
+	inline bool IsDigit(char c)
+	{
+		return (unsigned char)(c - '0') < 10;
+	}
+
+	inline bool IsBlank(char c)
+	{
+		return c == ' ' || c == '\t';
+	}
+
+	inline void SkipBlanks(const char*& cursor, const char* end)
+	{
+		while (cursor < end && IsBlank(*cursor))
+			++cursor;
+	}
+
+	inline void SkipLine(const char*& cursor, const char* end)
+	{
+		while (cursor < end && *cursor != '\n')
+			++cursor;
+	}
+
+	//How many of each attribute come before the text being parsed, for resolving negative indices
+	struct IndexBase
+	{
+		size_t Vertices;
+		size_t TexCoords;
+		size_t Normals;
+	};
+
+	const IndexBase noBase = { 0, 0, 0 };
+
+	//OBJ indices start at 1, negative ones count back from the last element read so far, 0 means "not given"
+	inline unsigned int ResolveIndex(int index, size_t count)
+	{
+		if (index > 0) return (unsigned int)(index - 1);
+		if (index < 0) return (unsigned int)((long long)count + index);	//Too far back wraps to a huge index, caught by IndicesInRange
+		return OBJParser::NoIndex;
+	}
+
+	//Reads one "v", "v/vt", "v//vn" or "v/vt/vn" face corner into corner[3] (position, texcoord, normal).
+	//Returns false if it isn't in one of those forms
+	inline bool ParseFaceCorner(const char*& cursor, const char* end, const OBJParser::ParsedOBJ& obj, const IndexBase& base, unsigned int corner[3])
+	{
+		if (!IsDigit(*cursor) && *cursor != '-' && *cursor != '+') return false;
+
+		int v = OBJParser::ParseInt(cursor, end);
+		int vt = 0;
+		int vn = 0;
+		if (v == 0) return false;
+
+		if (cursor < end && *cursor == '/')
+		{
+			++cursor;
+			if (cursor < end && *cursor != '/')
+			{
+				vt = OBJParser::ParseInt(cursor, end);
+			}
+
+			if (cursor < end && *cursor == '/')
+			{
+				++cursor;
+				vn = OBJParser::ParseInt(cursor, end);
+			}
+		}
+
+		corner[0] = ResolveIndex(v, base.Vertices + obj.Vertices.size());
+		corner[1] = ResolveIndex(vt, base.TexCoords + obj.TexCoords.size());
+		corner[2] = ResolveIndex(vn, base.Normals + obj.Normals.size());
+		return true;
+	}
+
+	//Index of name in names, adding it if it's new
+	unsigned int FindOrAdd(std::vector<std::string>& names, const std::string& name)
+	{
+		for (size_t i = 0; i < names.size(); ++i)
+		{
+			if (names[i] == name) return (unsigned int)i;
+		}
+
+		names.push_back(name);
+		return (unsigned int)(names.size() - 1);
+	}
+
+	//True if the line at cursor starts with keyword followed by a blank
+	inline bool IsKeyword(const char* cursor, const char* end, const char* keyword, size_t length)
+	{
+		return (size_t)(end - cursor) > length && memcmp(cursor, keyword, length) == 0 && IsBlank(cursor[length]);
+	}
+
+	inline void AddCorner(OBJParser::ParsedOBJ& out, const unsigned int corner[3])
+	{
+		out.VertIndices.push_back(corner[0]);
+		out.TextureIndices.push_back(corner[1]);
+		out.NormalIndices.push_back(corner[2]);
+	}
+
+	//The body of Parse: reads every line in [cursor, end) into out. Returns false on a malformed face
+	bool ParseLines(const char* cursor, const char* end, OBJParser::ParsedOBJ& out, bool invertTexCoords, const IndexBase& base)
+	{
+		XMFLOAT3 vert;
+		XMFLOAT2 texCoord;
+		XMFLOAT3 normal;
+
+		while (cursor < end)
+		{
+			//Skip leading whitespace and blank lines
+			while (cursor < end && (IsBlank(*cursor) || *cursor == '\r' || *cursor == '\n'))
+				++cursor;
+
+			if (cursor >= end)
+				break;
+
+			//We only care about vertex positions, texture coordinates, normals, faces and materials.
+			//Comments, objects, groups, smoothing groups etc. fall through to SkipLine below
+			if (cursor[0] == 'v' && cursor + 1 < end)
+			{
+				if (IsBlank(cursor[1])) //Vertex position
+				{
+					cursor += 1;
+					vert.x = FloatParser::Parse(cursor, end);
+					vert.y = FloatParser::Parse(cursor, end);
+					vert.z = FloatParser::Parse(cursor, end);
+
+					out.Vertices.push_back(vert);
+				}
+				else if (cursor[1] == 't' && cursor + 2 < end && IsBlank(cursor[2])) //Texture coordinate
+				{
+					cursor += 2;
+					texCoord.x = FloatParser::Parse(cursor, end);
+					texCoord.y = FloatParser::Parse(cursor, end);
+
+					if (invertTexCoords) texCoord.y = 1.0f - texCoord.y;
+
+					out.TexCoords.push_back(texCoord);
+				}
+				else if (cursor[1] == 'n' && cursor + 2 < end && IsBlank(cursor[2])) //Normal
+				{
+					cursor += 2;
+					normal.x = FloatParser::Parse(cursor, end);
+					normal.y = FloatParser::Parse(cursor, end);
+					normal.z = FloatParser::Parse(cursor, end);
+
+					out.Normals.push_back(normal);
+				}
+			}
+			else if (cursor[0] == 'f' && cursor + 1 < end && IsBlank(cursor[1])) //Face
+			{
+				cursor += 1;
+
+				//Polygons are split into a fan of triangles around their first corner
+				unsigned int first[3];
+				unsigned int previous[3];
+				int cornerCount = 0;
+
+				while (true)
+				{
+					SkipBlanks(cursor, end);
+					if (cursor >= end || *cursor == '\r' || *cursor == '\n' || *cursor == '#')
+						break;
+
+					unsigned int corner[3];
+					if (!ParseFaceCorner(cursor, end, out, base, corner))
+					{
+						return false;
+					}
+
+					if (cornerCount == 0)
+					{
+						memcpy(first, corner, sizeof(first));
+					}
+					else if (cornerCount >= 2)
+					{
+						AddCorner(out, first);
+						AddCorner(out, previous);
+						AddCorner(out, corner);
+					}
+
+					memcpy(previous, corner, sizeof(previous));
+					++cornerCount;
+				}
+
+				if (cornerCount < 3)
+				{
+					return false;
+				}
+			}
+			else if (IsKeyword(cursor, end, "usemtl", 6))
+			{
+				cursor += 6;
+				unsigned int material = FindOrAdd(out.Materials, OBJParser::ParseName(cursor, end));
+				OBJParser::AddMaterialRun(out.MaterialRuns, out.VertIndices.size(), material);
+			}
+			else if (IsKeyword(cursor, end, "mtllib", 6))
+			{
+				//Several files can be listed on one line
+				cursor += 6;
+				std::string names = OBJParser::ParseName(cursor, end);
+				for (size_t start = 0; start < names.size();)
+				{
+					size_t split = names.find_first_of(" \t", start);
+					if (split == std::string::npos) split = names.size();
+					if (split > start) FindOrAdd(out.MaterialLibraries, names.substr(start, split - start));
+					start = split + 1;
+				}
+			}
+
+			SkipLine(cursor, end);
+		}
+
+		return true;
+	}
+
+	//Counts the v, vt and vn lines in [cursor, end), recognising them exactly as ParseLines does
+	void CountAttributes(const char* cursor, const char* end, IndexBase& outCounts)
+	{
+		outCounts = noBase;
+
+		while (cursor < end)
+		{
+			while (cursor < end && (IsBlank(*cursor) || *cursor == '\r' || *cursor == '\n'))
+				++cursor;
+
+			if (cursor >= end)
+				break;
+
+			if (cursor[0] == 'v' && cursor + 1 < end)
+			{
+				if (IsBlank(cursor[1]))
+					++outCounts.Vertices;
+				else if (cursor[1] == 't' && cursor + 2 < end && IsBlank(cursor[2]))
+					++outCounts.TexCoords;
+				else if (cursor[1] == 'n' && cursor + 2 < end && IsBlank(cursor[2]))
+					++outCounts.Normals;
+			}
+
+			SkipLine(cursor, end);
+		}
+	}
+
+	template<typename T>
+	void CopyInto(std::vector<T>& destination, size_t offset, const std::vector<T>& source)
+	{
+		if (!source.empty())
+		{
+			memcpy(&destination[offset], source.data(), source.size() * sizeof(T));
+		}
+	}
+
+	//Make sure every face only points at data we actually loaded before anyone indexes with it
+	bool IndicesInRange(const OBJParser::ParsedOBJ& obj)
+	{
+		size_t numIndices = obj.VertIndices.size();
+		for (size_t i = 0; i < numIndices; ++i)
+		{
+			if (obj.VertIndices[i] >= obj.Vertices.size() ||
+				(obj.TextureIndices[i] != OBJParser::NoIndex && obj.TextureIndices[i] >= obj.TexCoords.size()) ||
+				(obj.NormalIndices[i] != OBJParser::NoIndex && obj.NormalIndices[i] >= obj.Normals.size()))
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+}
+
+bool OBJParser::ReadFile(const char* filename, std::vector<char>& buffer)
+{
+	std::ifstream inFile(filename, std::ios::in | std::ios::binary | std::ios::ate);
+
+	if (!inFile.good())
+	{
+		return false;
+	}
+
+	std::streamsize size = inFile.tellg();
+	inFile.seekg(0, std::ios::beg);
+
+	buffer.resize((size_t)size);
+	inFile.read(buffer.data(), size);
+
+	return inFile.gcount() == size;
+}
+
+float OBJParser::ParseFloat(const char*& cursor, const char* end)
+{
+	return FloatParser::Parse(cursor, end);
+}
+
+int OBJParser::ParseInt(const char*& cursor, const char* end)
+{
+	SkipBlanks(cursor, end);
+
+	bool negative = false;
+	if (cursor < end && (*cursor == '-' || *cursor == '+'))
+	{
+		negative = *cursor == '-';
+		++cursor;
+	}
+
+	int value = 0;
+	while (cursor < end && IsDigit(*cursor))
+	{
+		value = value * 10 + (*cursor - '0');
+		++cursor;
+	}
+
+	return negative ? -value : value;
+}
+
+std::string OBJParser::ParseName(const char*& cursor, const char* end)
+{
+	SkipBlanks(cursor, end);
+
+	const char* start = cursor;
+	SkipLine(cursor, end);
+
+	const char* nameEnd = cursor;
+	while (nameEnd > start && (IsBlank(nameEnd[-1]) || nameEnd[-1] == '\r'))
+		--nameEnd;
+
+	return std::string(start, nameEnd);
+}
+
+bool OBJParser::UsesMaterials(const char* data, size_t size)
+{
+	const char* end = data + size;
+	for (const char* cursor = data; cursor < end;)
+	{
+		const char* found = (const char*)memchr(cursor, 'u', end - cursor);
+		if (!found)
+		{
+			return false;
+		}
+
+		//Only at the start of a line (after any blanks)
+		const char* lineStart = found;
+		while (lineStart > data && IsBlank(lineStart[-1]))
+			--lineStart;
+
+		if ((lineStart == data || lineStart[-1] == '\n') && IsKeyword(found, end, "usemtl", 6))
+		{
+			return true;
+		}
+
+		cursor = found + 1;
+	}
+
+	return false;
+}
+
+void OBJParser::AddMaterialRun(std::vector<MaterialRun>& runs, size_t firstCorner, unsigned int material)
+{
+	if (!runs.empty())
+	{
+		MaterialRun& last = runs.back();
+		if (last.Material == material)
+		{
+			return;
+		}
+
+		//"usemtl" twice with no faces in between, only the second one counts
+		if (last.FirstCorner == firstCorner)
+		{
+			last.Material = material;
+			if (runs.size() >= 2 && runs[runs.size() - 2].Material == material)
+			{
+				runs.pop_back();
+			}
+			return;
+		}
+	}
+
+	MaterialRun run = { firstCorner, material };
+	runs.push_back(run);
+}
+
+bool OBJParser::Parse(const char* data, size_t size, ParsedOBJ& out, bool invertTexCoords)
+{
+	return ParseLines(data, data + size, out, invertTexCoords, noBase) && IndicesInRange(out);
+}
+
+bool OBJParser::ParseParallel(const char* data, size_t size, ParsedOBJ& out, bool invertTexCoords, ThreadPool& pool)
+{
+	//A few chunks per thread so one slow chunk doesn't leave everyone else waiting, but none so small the
+	//per-chunk overhead shows
+	const size_t minimumChunkSize = 64 * 1024;
+	size_t chunkCount = (pool.ThreadCount() + 1) * 4;
+	if (chunkCount > size / minimumChunkSize)
+	{
+		chunkCount = size / minimumChunkSize;
+	}
+
+	if (chunkCount <= 1)
+	{
+		return Parse(data, size, out, invertTexCoords);
+	}
+
+	//Cut just after the first line break past each even split
+	const char* end = data + size;
+	std::vector<const char*> bounds(chunkCount + 1);
+	bounds[0] = data;
+	bounds[chunkCount] = end;
+	for (size_t i = 1; i < chunkCount; ++i)
+	{
+		const char* split = data + size / chunkCount * i;
+		if (split < bounds[i - 1]) split = bounds[i - 1];
+
+		const char* lineBreak = (const char*)memchr(split, '\n', end - split);
+		bounds[i] = lineBreak ? lineBreak + 1 : end;
+	}
+
+	//Count each chunk's attributes first, so every chunk knows how many came before it (for negative indices)
+	//and where its own go in the output
+	std::vector<IndexBase> counts(chunkCount);
+	pool.ParallelFor((unsigned int)chunkCount, [&](unsigned int i)
+	{
+		CountAttributes(bounds[i], bounds[i + 1], counts[i]);
+	});
+
+	std::vector<IndexBase> bases(chunkCount);
+	IndexBase total = { out.Vertices.size(), out.TexCoords.size(), out.Normals.size() };
+	for (size_t i = 0; i < chunkCount; ++i)
+	{
+		bases[i] = total;
+		total.Vertices += counts[i].Vertices;
+		total.TexCoords += counts[i].TexCoords;
+		total.Normals += counts[i].Normals;
+	}
+
+	std::vector<ParsedOBJ> chunks(chunkCount);
+	std::vector<char> parsed(chunkCount);
+	pool.ParallelFor((unsigned int)chunkCount, [&](unsigned int i)
+	{
+		ParsedOBJ& chunk = chunks[i];
+		chunk.Vertices.reserve(counts[i].Vertices);
+		chunk.TexCoords.reserve(counts[i].TexCoords);
+		chunk.Normals.reserve(counts[i].Normals);
+
+		parsed[i] = ParseLines(bounds[i], bounds[i + 1], chunk, invertTexCoords, bases[i]);
+	});
+
+	//Stitch the chunks together in file order. Indices are already absolute so they're copied as they are
+	std::vector<size_t> cornerOffsets(chunkCount);
+	size_t cornerCount = out.VertIndices.size();
+	for (size_t i = 0; i < chunkCount; ++i)
+	{
+		if (!parsed[i])
+		{
+			return false;
+		}
+
+		cornerOffsets[i] = cornerCount;
+		cornerCount += chunks[i].VertIndices.size();
+	}
+
+	out.Vertices.resize(total.Vertices);
+	out.TexCoords.resize(total.TexCoords);
+	out.Normals.resize(total.Normals);
+	out.VertIndices.resize(cornerCount);
+	out.TextureIndices.resize(cornerCount);
+	out.NormalIndices.resize(cornerCount);
+
+	//Material names are numbered by first use, so renumber each chunk's into the file's order. Faces at the start of a
+	//chunk before its first "usemtl" just carry on the previous chunk's run
+	for (size_t i = 0; i < chunkCount; ++i)
+	{
+		const ParsedOBJ& chunk = chunks[i];
+		for (size_t library = 0; library < chunk.MaterialLibraries.size(); ++library)
+		{
+			FindOrAdd(out.MaterialLibraries, chunk.MaterialLibraries[library]);
+		}
+
+		for (size_t run = 0; run < chunk.MaterialRuns.size(); ++run)
+		{
+			unsigned int material = FindOrAdd(out.Materials, chunk.Materials[chunk.MaterialRuns[run].Material]);
+			AddMaterialRun(out.MaterialRuns, cornerOffsets[i] + chunk.MaterialRuns[run].FirstCorner, material);
+		}
+	}
+
+	pool.ParallelFor((unsigned int)chunkCount, [&](unsigned int i)
+	{
+		const ParsedOBJ& chunk = chunks[i];
+		CopyInto(out.Vertices, bases[i].Vertices, chunk.Vertices);
+		CopyInto(out.TexCoords, bases[i].TexCoords, chunk.TexCoords);
+		CopyInto(out.Normals, bases[i].Normals, chunk.Normals);
+		CopyInto(out.VertIndices, cornerOffsets[i], chunk.VertIndices);
+		CopyInto(out.TextureIndices, cornerOffsets[i], chunk.TextureIndices);
+		CopyInto(out.NormalIndices, cornerOffsets[i], chunk.NormalIndices);
+	});
+
+	return IndicesInRange(out);
+}
+
+bool OBJParser::ParseStream(const char* filename, size_t windowSize, bool invertTexCoords, ParsedOBJ& out, const FaceCallback& onFaces)
+{
+	std::ifstream inFile(filename, std::ios::in | std::ios::binary);
+
+	if (!inFile.good())
+	{
+		return false;
+	}
+
+	std::vector<char> window(windowSize > 0 ? windowSize : 1);
+	size_t carried = 0;
+
+	while (true)
+	{
+		inFile.read(window.data() + carried, window.size() - carried);
+		size_t filled = carried + (size_t)inFile.gcount();
+		bool lastWindow = !inFile.good();
+
+		if (inFile.bad())
+		{
+			return false;
+		}
+
+		//Only parse whole lines, the partial one at the end is carried over to the start of the next window
+		const char* start = window.data();
+		const char* end = start + filled;
+		const char* linesEnd = end;
+		if (!lastWindow)
+		{
+			while (linesEnd > start && linesEnd[-1] != '\n')
+				--linesEnd;
+
+			if (linesEnd == start)
+			{
+				//One line longer than the whole window, make room for the rest of it
+				carried = filled;
+				window.resize(window.size() * 2);
+				continue;
+			}
+		}
+
+		if (!ParseLines(start, linesEnd, out, invertTexCoords, noBase) || !IndicesInRange(out) || !onFaces(out))
+		{
+			return false;
+		}
+
+		out.VertIndices.clear();
+		out.TextureIndices.clear();
+		out.NormalIndices.clear();
+
+		//Whatever material the window ended with carries on into the next one
+		if (!out.MaterialRuns.empty())
+		{
+			MaterialRun current = { 0, out.MaterialRuns.back().Material };
+			out.MaterialRuns.assign(1, current);
+		}
+
+		if (lastWindow)
+		{
+			return true;
+		}
+
+		carried = (size_t)(end - linesEnd);
+		memmove(window.data(), linesEnd, carried);
+	}
+}
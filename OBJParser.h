@@ -0,0 +1,74 @@
+#pragma once
+#include <functional>
+#include <string>
+#include <vector>
+#include "MeshTypes.h"
+#include "ThreadPool.h"
+
+//Single pass OBJ text parser. The whole file is read into one buffer and walked with a pointer, numbers are
+//converted in place so there's no std::string (or any other allocation) per token - only the output vectors grow.
+namespace OBJParser
+{
+	//In TextureIndices/NormalIndices for a face corner that didn't give one ("v", "v//vn" or "v/vt")
+	const unsigned int NoIndex = 0xFFFFFFFF;
+
+	//The faces from one "usemtl" line up to the next: every corner from FirstCorner up to the next run's FirstCorner
+	struct MaterialRun
+	{
+		size_t FirstCorner;
+		unsigned int Material;		//Index into ParsedOBJ::Materials
+	};
+
+	//Everything we care about from an OBJ file. The three index lists are parallel, one entry per triangle corner:
+	//polygons have already been split into triangles, and OBJ's 1-based (or negative, relative) indices turned into 0-based ones
+	struct ParsedOBJ
+	{
+		std::vector<XMFLOAT3> Vertices;
+		std::vector<XMFLOAT3> Normals;
+		std::vector<XMFLOAT2> TexCoords;
+
+		std::vector<unsigned int> VertIndices;
+		std::vector<unsigned int> TextureIndices;
+		std::vector<unsigned int> NormalIndices;
+
+		//Material names in the order "usemtl" first used them, and the .mtl files named by "mtllib" (as written in the OBJ).
+		//Faces before the first run have no material. "o" and "g" don't change what faces are drawn with, so are skipped
+		std::vector<std::string> Materials;
+		std::vector<std::string> MaterialLibraries;
+		std::vector<MaterialRun> MaterialRuns;
+	};
+
+	//Reads the entire file into buffer with one read call. Returns false if the file can't be opened
+	bool ReadFile(const char* filename, std::vector<char>& buffer);
+
+	//Parses an in-memory OBJ file. Returns false if a face references data that doesn't exist
+	bool Parse(const char* data, size_t size, ParsedOBJ& out, bool invertTexCoords);
+
+	//Parse spread over a thread pool (and the calling thread): the text is cut into line aligned chunks, each chunk's
+	//v/vt/vn lines are counted, then the chunks are parsed at the same time and stitched together in order.
+	//Gives exactly the same result as Parse. Small files just get Parse
+	bool ParseParallel(const char* data, size_t size, ParsedOBJ& out, bool invertTexCoords, ThreadPool& pool);
+
+	//Called by ParseStream after each window. 'obj' holds every v/vt/vn read so far but only the faces from that window,
+	//which are thrown away afterwards. Return false to stop parsing
+	typedef std::function<bool(const ParsedOBJ& obj)> FaceCallback;
+
+	//Parse for files too big to read in one go: reads windowSize bytes at a time and hands each window's faces to onFaces,
+	//so only one window of text and one window of face indices are held at once. Same result as Parse (faces can only
+	//use data defined earlier in the file, as OBJ requires). Returns false if the file can't be read, a face is bad or onFaces fails
+	bool ParseStream(const char* filename, size_t windowSize, bool invertTexCoords, ParsedOBJ& out, const FaceCallback& onFaces);
+
+	//True if the text has any "usemtl" lines, without parsing anything else
+	bool UsesMaterials(const char* data, size_t size);
+
+	//Starts a run of 'material' at firstCorner, merging it with the previous run if nothing changed
+	void AddMaterialRun(std::vector<MaterialRun>& runs, size_t firstCorner, unsigned int material);
+
+	//Helper methods for the above, exposed so other parsers can share them.
+	//Both advance 'cursor' past the number they read and stop at 'end'
+	float ParseFloat(const char*& cursor, const char* end);
+	int ParseInt(const char*& cursor, const char* end);
+
+	//The rest of the line after skipping blanks, without trailing blanks or the line break. Leaves cursor on the line break
+	std::string ParseName(const char*& cursor, const char* end);
+};
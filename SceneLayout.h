@@ -0,0 +1,65 @@
+#pragma once
+#include "MeshTypes.h"
+
+//Where everything in the boat scene starts out: the five cameras and the placement of each model. Application builds
+//the scene from this, and Benchmarks uses the same numbers to measure what each camera would draw without a GPU
+namespace SceneLayout
+{
+	struct CameraPreset
+	{
+		const char* Name;
+		XMFLOAT3 Eye;
+		XMFLOAT3 At;		//A point to look at if LookAt is set, otherwise the direction to look in
+		XMFLOAT3 Up;
+		float NearDepth;
+		float FarDepth;
+		bool LookAt;		//Camera's last constructor argument
+	};
+
+	//Numpad 1 to 5. The first and third person cameras follow the boat, these are where they start
+	const unsigned int CameraCount = 5;
+	const CameraPreset Cameras[CameraCount] =
+	{
+		{ "free move", XMFLOAT3(0.0f, 5.0f, 25.0f), XMFLOAT3(0.0f, 0.0f, -1.0f), XMFLOAT3(0.0f, 1.0f, 0.0f), 0.01f, 150.0f, true },
+		{ "first person", XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(0.0f, 0.0f, -1.0f), XMFLOAT3(0.0f, 1.0f, 0.0f), 0.01f, 150.0f, false },
+		{ "bird's eye", XMFLOAT3(0.0f, 65.0f, 0.0f), XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(1.0f, 0.0f, 0.0f), 0.01f, 250.0f, true },
+		{ "third person", XMFLOAT3(0.0f, 20.0f, -15.0f), XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(0.0f, 1.0f, 0.0f), 0.01f, 150.0f, true },
+		{ "static perspective", XMFLOAT3(10.0f, 50.0f, 15.0f), XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(0.0f, 1.0f, 0.0f), 0.01f, 250.0f, true },
+	};
+
+	//Every camera has a 90 degree vertical field of view on a window this size
+	const float FieldOfView = 1.570796327f;
+	const unsigned int WindowWidth = 1920;
+	const unsigned int WindowHeight = 1080;
+
+	//How many pixels a level of detail's error can cover before the next finer level is drawn instead (see MeshSimplifier::SelectLod).
+	//The error is how far the worst vertex moved, most of the surface moves a fraction of that
+	const float LodPixelError = 4.0f;
+
+	//GPU memory the streamed textures' mips share (see AssetManager::SetTextureBudget)
+	const unsigned long long TextureBudget = 16ull * 1024 * 1024;
+
+	//The rocks ringing the water, all copies of rockBorder.obj moved (not scaled or turned) to these positions
+	const unsigned int RockCount = 28;
+	const XMFLOAT3 Rocks[RockCount] =
+	{
+		XMFLOAT3(-50.0f, -6.0f, 67.0f), XMFLOAT3(-25.0f, -6.0f, 67.0f), XMFLOAT3(0.0f, -6.0f, 67.0f), XMFLOAT3(25.0f, -6.0f, 67.0f), XMFLOAT3(50.0f, -6.0f, 67.0f),
+		XMFLOAT3(-50.0f, -7.0f, -67.0f), XMFLOAT3(-25.0f, -7.0f, -67.0f), XMFLOAT3(0.0f, -7.0f, -67.0f), XMFLOAT3(25.0f, -7.0f, -67.0f), XMFLOAT3(50.0f, -7.0f, -67.0f),
+		XMFLOAT3(-70.0f, -7.0f, 55.0f), XMFLOAT3(-70.0f, -7.0f, 40.0f), XMFLOAT3(-70.0f, -7.0f, 25.0f), XMFLOAT3(-70.0f, -7.0f, 10.0f), XMFLOAT3(-70.0f, -7.0f, -5.0f),
+		XMFLOAT3(-70.0f, -7.0f, -20.0f), XMFLOAT3(-70.0f, -7.0f, -35.0f), XMFLOAT3(-70.0f, -7.0f, -50.0f), XMFLOAT3(-70.0f, -7.0f, -65.0f),
+		XMFLOAT3(70.0f, -7.0f, 55.0f), XMFLOAT3(70.0f, -7.0f, 40.0f), XMFLOAT3(70.0f, -7.0f, 25.0f), XMFLOAT3(70.0f, -7.0f, 10.0f), XMFLOAT3(70.0f, -7.0f, -5.0f),
+		XMFLOAT3(70.0f, -7.0f, -20.0f), XMFLOAT3(70.0f, -7.0f, -35.0f), XMFLOAT3(70.0f, -7.0f, -50.0f), XMFLOAT3(70.0f, -7.0f, -65.0f),
+	};
+
+	//The boat starts at the origin at this scale
+	const float BoatScale = 0.25f;
+
+	const XMFLOAT3 WaterPosition(0.0f, -1.5f, 0.0f);
+
+	//How far VSWATER's waves move a water vertex along x, and the same again along y
+	const float WaterWaveHeight = 1.8f;
+
+	//The sky sphere is scaled up around the scene then slowly turned about the y axis
+	const float SkyScale = 120.0f;
+	const XMFLOAT3 SkyPosition(0.0f, 5.0f, 0.0f);
+};
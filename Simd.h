@@ -0,0 +1,24 @@
+#pragma once
+
+//SSE2 is always there on x64 (and is what MSVC targets for x86 by default), so the vectorised paths only need
+//this one check. Anything else falls back to the scalar loops next to them, which must give the same results
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define SIMD_SSE2 1
+#include <emmintrin.h>
+#endif
+
+//Index of the lowest set bit, value must not be 0
+#ifdef _MSC_VER
+#include <intrin.h>
+inline unsigned int CountTrailingZeros(unsigned int value)
+{
+	unsigned long index;
+	_BitScanForward(&index, value);
+	return (unsigned int)index;
+}
+#else
+inline unsigned int CountTrailingZeros(unsigned int value)
+{
+	return (unsigned int)__builtin_ctz(value);
+}
+#endif
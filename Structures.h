@@ -2,21 +2,14 @@
 #include <Windows.h>
 #include <d3d11.h>
 #include <directxmath.h>
+#include <vector>
+#include "MeshTypes.h"
+#include "MeshCache.h"
+#include "MeshBvh.h"
+#include "MTLParser.h"
 
 using namespace DirectX;
 
-struct SimpleVertex
-{
-	XMFLOAT3 Pos;
-	XMFLOAT3 Normal;
-	XMFLOAT2 TexC;
-
-	bool operator<(const SimpleVertex other) const
-	{
-		return memcmp((void*)this, (void*)& other, sizeof(SimpleVertex)) > 0;
-	};
-};
-
 struct MeshData
 {
 	ID3D11Buffer* VertexBuffer;
@@ -24,6 +17,21 @@ struct MeshData
 	UINT VBStride;
 	UINT VBOffset;
 	UINT IndexCount;
+	DXGI_FORMAT IndexFormat; //DXGI_FORMAT_R16_UINT or DXGI_FORMAT_R32_UINT, whichever the mesh needed
+	VertexFormat Format;
+	XMFLOAT3 PositionScale; //Position = Pos * PositionScale + PositionOffset for packed vertices
+	XMFLOAT3 PositionOffset;
+	std::vector<MeshCache::Submesh> Submeshes; //DrawIndexed ranges, one per material per level of detail. Empty = one range of IndexCount
+	std::vector<MTLParser::Material> Materials; //Indexed by Submesh::MaterialId
+	std::vector<MeshCache::MeshLod> Lods; //Which submeshes each level of detail draws. Empty = they're all the full mesh
+	XMFLOAT3 BoundsMin; //Axis aligned box, in mesh units
+	XMFLOAT3 BoundsMax;
+	XMFLOAT3 SphereCentre; //Smallest bounding sphere, in mesh units, for picking a level of detail
+	float SphereRadius;
+	float UvDensity; //Texture coordinate units per mesh unit over the full detail surface, for picking texture mips (see TextureStreaming.h). 0 if not known
+	std::vector<MeshCache::MeshCluster> Clusters; //Culling bounds for runs of each submesh (see MeshClusters.h). Empty = no culling below whole meshes
+	ID3D11Buffer* TangentBuffer; //PackedTangent per vertex for input slot 1 (see MeshTangents.h), nullptr if the mesh has none
+	MeshBvh::Tree Bvh; //Full detail triangles for picking and collision on the CPU, in mesh units. Empty if the cache has no BVH
 };
 
 struct ConstantBuffer
@@ -50,7 +58,9 @@ struct ConstantBuffer
 	float SpecularPower;
 	XMFLOAT3 EyePosW;
 
-	
+	//For packed vertices - (see VertexPacking.h)
+	XMFLOAT4 PosDecodeScale;
+	XMFLOAT4 PosDecodeOffset;
 };
 
 struct SCamera
@@ -0,0 +1,281 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <memory>
+#include <vector>
+#include "BlockDecoder.h"
+#include "BlockEncoder.h"
+#include "DDSFile.h"
+#include "DebugLog.h"
+#include "MappedFile.h"
+#include "MipGenerator.h"
+#include "ThreadPool.h"
+
+namespace
+{
+	struct FormatName
+	{
+		const char* Name;
+		DXGI_FORMAT Format;
+		DXGI_FORMAT SrgbFormat;		//DXGI_FORMAT_UNKNOWN if there isn't one
+	};
+
+	//"none" leaves the pixels uncompressed, for baking mips alone
+
+	const FormatName formats[] =
+	{
+		{ "bc1", DXGI_FORMAT_BC1_UNORM, DXGI_FORMAT_BC1_UNORM_SRGB },
+		{ "bc3", DXGI_FORMAT_BC3_UNORM, DXGI_FORMAT_BC3_UNORM_SRGB },
+		{ "bc5", DXGI_FORMAT_BC5_UNORM, DXGI_FORMAT_UNKNOWN },
+		{ "bc7", DXGI_FORMAT_BC7_UNORM, DXGI_FORMAT_BC7_UNORM_SRGB },
+		{ "none", DXGI_FORMAT_UNKNOWN, DXGI_FORMAT_UNKNOWN },
+	};
+
+	bool IsSrgb(DXGI_FORMAT format)
+	{
+		return format == DXGI_FORMAT_R8G8B8A8_UNORM_SRGB || format == DXGI_FORMAT_B8G8R8A8_UNORM_SRGB || format == DXGI_FORMAT_B8G8R8X8_UNORM_SRGB;
+	}
+
+	//Peak signal to noise ratio of the top mip of the first item, over the channels the format keeps (alpha only for
+	//formats that store more than a cutout of it)
+	double TopMipPsnr(const DDSFile::Texture& source, const DDSFile::Texture& encoded, ThreadPool* pool)
+	{
+		std::vector<unsigned char> decoded;
+		if (!BlockDecoder::Decode(encoded, 0, 0, decoded, pool))
+		{
+			return 0.0;
+		}
+
+		bool bgra = source.Format != DXGI_FORMAT_R8G8B8A8_TYPELESS && source.Format != DXGI_FORMAT_R8G8B8A8_UNORM &&
+			source.Format != DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
+		bool opaque = source.Format == DXGI_FORMAT_B8G8R8X8_TYPELESS || source.Format == DXGI_FORMAT_B8G8R8X8_UNORM ||
+			source.Format == DXGI_FORMAT_B8G8R8X8_UNORM_SRGB;
+		int channels = (encoded.Format == DXGI_FORMAT_BC5_UNORM) ? 2 : (encoded.Format == DXGI_FORMAT_BC1_UNORM ||
+			encoded.Format == DXGI_FORMAT_BC1_UNORM_SRGB || opaque) ? 3 : 4;
+
+		const unsigned char* pixels = DDSFile::Surface(source, 0, 0);
+		double squaredError = 0.0;
+		for (size_t i = 0; i < decoded.size(); i += 4)
+		{
+			for (int c = 0; c < channels; ++c)
+			{
+				int original = pixels[i + ((bgra && c != 3) ? 2 - c : c)];
+				double difference = (double)decoded[i + c] - original;
+				squaredError += difference * difference;
+			}
+		}
+
+		double meanSquaredError = squaredError / ((double)(decoded.size() / 4) * channels);
+		return (meanSquaredError > 0.0) ? 10.0 * log10(255.0 * 255.0 / meanSquaredError) : INFINITY;
+	}
+}
+
+//Command line front end to BlockEncoder for build machines with no GPU, to cook textures to the block compressed format
+//they'll be sampled in:
+//
+//  TextureBuild [--format bc1|bc3|bc5|bc7|none] [--quality fast|normal|high] [--srgb] [--mips box|kaiser] [--linear-mips] [--wrap] [--threads n] input.dds output.dds
+//  TextureBuild [--format ...] [--quality ...] [--srgb] [--mips ...] [--linear-mips] [--wrap] [--threads n] --size width height input.rgba output.dds
+//
+//The input is an 8 bit RGBA, BGRA or BGRX .dds (every mip and array item of it is encoded, cubes and volumes included)
+//or, with --size, raw RGBA8 pixels. The default is BC7 at normal quality. The output is sRGB if the input is or --srgb is
+//given (BC5 has no sRGB format, so it stays linear). --mips replaces whatever mips the input has with a full chain built
+//from its top level (see MipGenerator.h) before it's encoded, filtering colour in linear light unless --linear-mips is
+//given or the format is BC5; --wrap is for textures that tile. Exit code is 0 on success, 1 on failure
+int main(int argc, char** argv)
+{
+	const FormatName* format = &formats[3];
+	BlockEncoder::Quality quality = BlockEncoder::QualityNormal;
+	bool srgb = false;
+	int threads = 0;
+	bool generateMips = false;
+	MipGenerator::Settings mipSettings;
+	uint32_t rawWidth = 0, rawHeight = 0;
+	const char* inputName = nullptr;
+	const char* outputName = nullptr;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		const char* arg = argv[i];
+
+		if (strcmp(arg, "--format") == 0 && i + 1 < argc)
+		{
+			const char* name = argv[++i];
+			format = nullptr;
+			for (const FormatName& candidate : formats)
+			{
+				if (strcmp(candidate.Name, name) == 0) format = &candidate;
+			}
+			if (format == nullptr)
+			{
+				DebugLog("TextureBuild: unknown format %s\n", name);
+				return 1;
+			}
+		}
+		else if (strcmp(arg, "--quality") == 0 && i + 1 < argc)
+		{
+			const char* name = argv[++i];
+			if (strcmp(name, "fast") == 0) quality = BlockEncoder::QualityFast;
+			else if (strcmp(name, "normal") == 0) quality = BlockEncoder::QualityNormal;
+			else if (strcmp(name, "high") == 0) quality = BlockEncoder::QualityHigh;
+			else
+			{
+				DebugLog("TextureBuild: unknown quality %s\n", name);
+				return 1;
+			}
+		}
+		else if (strcmp(arg, "--srgb") == 0)
+		{
+			srgb = true;
+		}
+		else if (strcmp(arg, "--mips") == 0 && i + 1 < argc)
+		{
+			const char* name = argv[++i];
+			generateMips = true;
+			if (strcmp(name, "box") == 0) mipSettings.Filter = MipGenerator::MipFilterBox;
+			else if (strcmp(name, "kaiser") == 0) mipSettings.Filter = MipGenerator::MipFilterKaiser;
+			else
+			{
+				DebugLog("TextureBuild: unknown mip filter %s\n", name);
+				return 1;
+			}
+		}
+		else if (strcmp(arg, "--linear-mips") == 0)
+		{
+			mipSettings.GammaCorrect = false;
+		}
+		else if (strcmp(arg, "--wrap") == 0)
+		{
+			mipSettings.Wrap = true;
+		}
+		else if (strcmp(arg, "--threads") == 0 && i + 1 < argc)
+		{
+			threads = atoi(argv[++i]);
+		}
+		else if (strcmp(arg, "--size") == 0 && i + 2 < argc)
+		{
+			rawWidth = (uint32_t)atoi(argv[++i]);
+			rawHeight = (uint32_t)atoi(argv[++i]);
+		}
+		else if (arg[0] == '-')
+		{
+			DebugLog("TextureBuild: unknown option %s\n", arg);
+			return 1;
+		}
+		else if (inputName == nullptr)
+		{
+			inputName = arg;
+		}
+		else if (outputName == nullptr)
+		{
+			outputName = arg;
+		}
+	}
+
+	if (inputName == nullptr || outputName == nullptr)
+	{
+		DebugLog("usage: TextureBuild [--format bc1|bc3|bc5|bc7|none] [--quality fast|normal|high] [--srgb] [--mips box|kaiser] [--linear-mips] [--wrap] [--threads n] [--size width height] input output.dds\n");
+		return 1;
+	}
+
+	MappedFile input;
+	DDSFile::Texture source;
+	if (rawWidth > 0 && rawHeight > 0)
+	{
+		if (!input.Open(inputName) || input.Size() < (size_t)rawWidth * rawHeight * 4)
+		{
+			DebugLog("%s: not found or smaller than %ux%u RGBA8\n", inputName, rawWidth, rawHeight);
+			return 1;
+		}
+
+		source = DDSFile::Texture();
+		source.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+		source.Width = rawWidth;
+		source.Height = rawHeight;
+		source.Depth = 1;
+		source.MipCount = 1;
+		source.ArraySize = 1;
+		source.Bits = input.Data();
+		source.BitSize = (size_t)rawWidth * rawHeight * 4;
+	}
+	else if (!DDSFile::Open(inputName, input, source))
+	{
+		DebugLog("%s: not found or not a .dds this understands\n", inputName);
+		return 1;
+	}
+
+	DXGI_FORMAT target = format->Format;
+	if ((srgb || IsSrgb(source.Format)) && format->SrgbFormat != DXGI_FORMAT_UNKNOWN)
+	{
+		target = format->SrgbFormat;
+	}
+
+	//--threads 1 works on this thread alone, any other count is this thread plus that many less one workers
+	std::unique_ptr<ThreadPool> pool;
+	if (threads != 1)
+	{
+		pool.reset(new ThreadPool(threads > 1 ? threads - 1 : 0));
+	}
+
+	std::vector<unsigned char> mipBits;
+	if (generateMips)
+	{
+		if (format->Format == DXGI_FORMAT_BC5_UNORM)
+		{
+			mipSettings.GammaCorrect = false;
+		}
+
+		DDSFile::Texture mipped;
+		auto start = std::chrono::high_resolution_clock::now();
+		if (!MipGenerator::Generate(source, mipSettings, mipBits, mipped, pool.get()))
+		{
+			DebugLog("%s: mips can only be built for 8 bit RGBA, BGRA or BGRX, and not for volumes\n", inputName);
+			return 1;
+		}
+		DebugLog("%s: %u mips (%s%s%s) in %.3f s\n", inputName, mipped.MipCount, (mipSettings.Filter == MipGenerator::MipFilterBox) ? "box" : "Kaiser",
+			mipSettings.GammaCorrect ? ", gamma correct" : "", mipSettings.Wrap ? ", wrapped" : "",
+			std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count());
+		source = mipped;
+	}
+
+	if (target == DXGI_FORMAT_UNKNOWN)
+	{
+		if (!DDSFile::Save(outputName, source))
+		{
+			DebugLog("%s: couldn't be written\n", outputName);
+			return 1;
+		}
+		DebugLog("%s: %ux%u, %u mips, %u items, uncompressed: %u KB\n", outputName, source.Width, source.Height, source.MipCount, source.ArraySize,
+			(unsigned int)(source.BitSize / 1024));
+		return 0;
+	}
+
+	std::vector<unsigned char> bits;
+	DDSFile::Texture encoded;
+	auto start = std::chrono::high_resolution_clock::now();
+	if (!BlockEncoder::Encode(source, target, quality, bits, encoded, pool.get()))
+	{
+		DebugLog("%s: only 8 bit RGBA, BGRA or BGRX can be encoded\n", inputName);
+		return 1;
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+	if (!DDSFile::Save(outputName, encoded))
+	{
+		DebugLog("%s: couldn't be written\n", outputName);
+		return 1;
+	}
+
+	uint64_t pixels = 0;
+	for (uint32_t mip = 0; mip < source.MipCount; ++mip)
+	{
+		pixels += (uint64_t)DDSFile::MipSize(source.Width, mip) * DDSFile::MipSize(source.Height, mip) * DDSFile::MipSize(source.Depth, mip);
+	}
+	pixels *= source.ArraySize;
+
+	DebugLog("%s: %ux%u, %u mips, %u items to %s%s: %u KB from %u KB (%.1f:1) in %.3f s, %.2f MP/s on %u threads, PSNR %.2f dB\n", outputName,
+		source.Width, source.Height, source.MipCount, source.ArraySize, format->Name, (target == format->Format) ? "" : " sRGB",
+		(unsigned int)(encoded.BitSize / 1024), (unsigned int)(source.BitSize / 1024), (double)source.BitSize / encoded.BitSize, seconds,
+		pixels / 1000000.0 / seconds, pool ? pool->ThreadCount() + 1 : 1, TopMipPsnr(source, encoded, pool.get()));
+	return 0;
+}
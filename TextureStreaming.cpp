@@ -0,0 +1,125 @@
+#include "TextureStreaming.h"
+#include <math.h>
+
+namespace
+{
+	uint32_t Index(const void* indices, DXGI_FORMAT indexFormat, uint32_t i)
+	{
+		return (indexFormat == DXGI_FORMAT_R16_UINT) ? ((const uint16_t*)indices)[i] : ((const uint32_t*)indices)[i];
+	}
+}
+
+void TextureStreaming::AddArea(const SimpleVertex* vertices, const void* indices, DXGI_FORMAT indexFormat, uint32_t indexStart, uint32_t indexCount, SurfaceArea& ioArea)
+{
+	for (uint32_t i = 0; i + 2 < indexCount; i += 3)
+	{
+		const SimpleVertex& a = vertices[Index(indices, indexFormat, indexStart + i)];
+		const SimpleVertex& b = vertices[Index(indices, indexFormat, indexStart + i + 1)];
+		const SimpleVertex& c = vertices[Index(indices, indexFormat, indexStart + i + 2)];
+
+		double ab[3] = { (double)b.Pos.x - a.Pos.x, (double)b.Pos.y - a.Pos.y, (double)b.Pos.z - a.Pos.z };
+		double ac[3] = { (double)c.Pos.x - a.Pos.x, (double)c.Pos.y - a.Pos.y, (double)c.Pos.z - a.Pos.z };
+		double cross[3] = { ab[1] * ac[2] - ab[2] * ac[1], ab[2] * ac[0] - ab[0] * ac[2], ab[0] * ac[1] - ab[1] * ac[0] };
+		ioArea.Mesh += 0.5 * sqrt(cross[0] * cross[0] + cross[1] * cross[1] + cross[2] * cross[2]);
+
+		double uvCross = ((double)b.TexC.x - a.TexC.x) * ((double)c.TexC.y - a.TexC.y) - ((double)b.TexC.y - a.TexC.y) * ((double)c.TexC.x - a.TexC.x);
+		ioArea.Uv += 0.5 * fabs(uvCross);
+	}
+}
+
+float TextureStreaming::UvDensity(const SurfaceArea& area)
+{
+	return (area.Mesh > 0.0) ? (float)sqrt(area.Uv / area.Mesh) : 0.0f;
+}
+
+float TextureStreaming::PixelsPerUv(float uvDensity, float distance, float pixelScale)
+{
+	if (!(distance > 0.0f) || !(uvDensity > 0.0f))
+	{
+		return INFINITY;
+	}
+
+	//A mesh unit covers pixelScale / distance pixels, and uvDensity texture coordinate units of it
+	return pixelScale / (distance * uvDensity);
+}
+
+uint32_t TextureStreaming::WantedMip(uint32_t size, float pixelsPerUv)
+{
+	float texelsPerPixel = (float)size / pixelsPerUv;
+	if (!(texelsPerPixel > 1.0f))
+	{
+		return 0;
+	}
+
+	//Each mip halves the texels per pixel, so this is the last one still with one or more
+	int mip = (int)floorf(log2f(texelsPerPixel));
+	return (uint32_t)((mip < 31) ? mip : 31);
+}
+
+uint32_t TextureStreaming::StartMip(const DDSFile::Texture& texture, uint32_t mip)
+{
+	if (!DDSFile::IsCompressed(texture.Format))
+	{
+		return mip;
+	}
+
+	while (mip > 0 && ((DDSFile::MipSize(texture.Width, mip) & 3) != 0 || (DDSFile::MipSize(texture.Height, mip) & 3) != 0))
+	{
+		--mip;
+	}
+	return mip;
+}
+
+uint32_t TextureStreaming::TailMip(const DDSFile::Texture& texture)
+{
+	uint32_t mip = 0;
+	while (mip + 1 < texture.MipCount && (DDSFile::MipSize(texture.Width, mip) > TailSize || DDSFile::MipSize(texture.Height, mip) > TailSize))
+	{
+		++mip;
+	}
+	return StartMip(texture, mip);
+}
+
+uint64_t TextureStreaming::ResidentBytes(const DDSFile::Texture& texture, uint32_t mip)
+{
+	uint64_t bytes = 0;
+	for (uint32_t level = mip; level < texture.MipCount; ++level)
+	{
+		bytes += DDSFile::SurfaceSize(texture.Format, DDSFile::MipSize(texture.Width, level), DDSFile::MipSize(texture.Height, level)) *
+			(uint64_t)DDSFile::MipSize(texture.Depth, level);
+	}
+	return bytes * texture.ArraySize;
+}
+
+uint64_t TextureStreaming::FitBudget(const Request* requests, size_t count, uint64_t budgetBytes, uint32_t* outMips)
+{
+	uint64_t total = 0;
+
+	for (uint32_t bias = 0; ; ++bias)
+	{
+		total = 0;
+		bool allTails = true;
+		for (size_t i = 0; i < count; ++i)
+		{
+			uint32_t tail = TailMip(*requests[i].Texture);
+			uint32_t mip = requests[i].WantedMip + bias;
+			if (mip >= tail)
+			{
+				mip = tail;
+			}
+			else
+			{
+				allTails = false;
+			}
+
+			outMips[i] = StartMip(*requests[i].Texture, mip);
+			total += ResidentBytes(*requests[i].Texture, outMips[i]);
+		}
+
+		//Every texture is as coarse as it goes, there's nothing more to give up
+		if (total <= budgetBytes || allTails)
+		{
+			return total;
+		}
+	}
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include "MeshTypes.h"
+#include "DDSFile.h"
+
+//Decides which mips of each texture need to be on the GPU, so AssetManager can load a texture with only its smallest
+//mips and stream finer ones in as the camera gets close enough to see them. How fine a texture needs to be comes from
+//its footprint on screen: how many pixels one unit of texture coordinates covers at the nearest point of the mesh it's
+//drawn on (from the mesh's UvDensity and its distance from the camera). Mip m of a texture N texels across puts N >> m
+//texels on those pixels, and the finest mip that's needed is the smallest that still gives every pixel a texel of its own.
+//Mips no bigger than TailSize across are always kept, so there's always something to draw, and a memory budget is met
+//by pushing every texture the same number of mips coarser until they fit. The CPU side only, no Direct3D
+namespace TextureStreaming
+{
+	//Mips this many texels across or fewer (on both sides) are loaded with the texture and stay resident
+	const uint32_t TailSize = 64;
+
+	//Triangle areas summed over a mesh, in mesh units and in texture coordinates
+	struct SurfaceArea
+	{
+		double Mesh;
+		double Uv;
+
+		SurfaceArea() : Mesh(0.0), Uv(0.0) {}
+	};
+
+	//Adds the triangles of indices[indexStart, indexStart + indexCount), 16 or 32 bit as indexFormat says
+	void AddArea(const SimpleVertex* vertices, const void* indices, DXGI_FORMAT indexFormat, uint32_t indexStart, uint32_t indexCount, SurfaceArea& ioArea);
+
+	//Texture coordinate units per mesh unit, averaged over the surface by area. 0 if it has no area
+	float UvDensity(const SurfaceArea& area);
+
+	//Screen pixels one texture coordinate unit covers on a mesh with uvDensity 'distance' mesh units away, with pixelScale
+	//pixels per unit at distance 1 (half the window height over tan(fovY / 2)). Infinite when distance or uvDensity isn't
+	//above 0, as the camera is inside the mesh's bounds or its density isn't known, which asks for the finest mip
+	float PixelsPerUv(float uvDensity, float distance, float pixelScale);
+
+	//The finest mip worth having for a texture 'size' texels across (the larger of its width and height) drawn at pixelsPerUv
+	uint32_t WantedMip(uint32_t size, float pixelsPerUv);
+
+	//Direct3D 11 only creates block compressed textures whose top mip is whole blocks across, so a texture can only be
+	//made from the mips below one that is: 'mip' if it can, otherwise the next finer one that can
+	uint32_t StartMip(const DDSFile::Texture& texture, uint32_t mip);
+
+	//The largest mip no bigger than TailSize (or the smallest mip, if none are) moved to its StartMip. 0 for textures too
+	//small to stream
+	uint32_t TailMip(const DDSFile::Texture& texture);
+
+	//Bytes of every array item's mips from 'mip' down to the smallest
+	uint64_t ResidentBytes(const DDSFile::Texture& texture, uint32_t mip);
+
+	//A texture and the finest mip it asked for
+	struct Request
+	{
+		const DDSFile::Texture* Texture;
+		uint32_t WantedMip;
+	};
+
+	//The finest mip each request can have (outMips, one per request) with all of them together within budgetBytes: what
+	//each asked for if that fits, otherwise every texture one mip coarser than it asked, then two and so on, none coarser
+	//than its TailMip and each moved to its StartMip. Returns the bytes that takes, over the budget only if the tails are
+	uint64_t FitBudget(const Request* requests, size_t count, uint64_t budgetBytes, uint32_t* outMips);
+};
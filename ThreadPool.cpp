@@ -0,0 +1,128 @@
+#include "ThreadPool.h"
+#include <atomic>
+#include <memory>
+
+ThreadPool::ThreadPool(unsigned int threadCount) : _busyCount(0), _stopping(false)
+{
+	if (threadCount == 0)
+	{
+		unsigned int hardwareThreads = std::thread::hardware_concurrency();
+		threadCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+	}
+
+	_workers.reserve(threadCount);
+	for (unsigned int i = 0; i < threadCount; ++i)
+	{
+		_workers.push_back(std::thread(&ThreadPool::WorkerLoop, this));
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stopping = true;
+	}
+	_jobAvailable.notify_all();
+
+	//Workers finish whatever is still queued before they exit
+	for (size_t i = 0; i < _workers.size(); ++i)
+	{
+		_workers[i].join();
+	}
+}
+
+void ThreadPool::Submit(std::function<void()> job)
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_jobs.push_back(std::move(job));
+	}
+	_jobAvailable.notify_one();
+}
+
+void ThreadPool::WaitIdle()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	_idle.wait(lock, [this] { return _jobs.empty() && _busyCount == 0; });
+}
+
+void ThreadPool::ParallelFor(unsigned int count, const std::function<void(unsigned int)>& body)
+{
+	//Helpers that only get going after everything has been claimed find nothing to do, but still hold on to
+	//this, so it has to outlive the call
+	struct Loop
+	{
+		std::atomic<unsigned int> Next;
+		std::atomic<unsigned int> Finished;
+		unsigned int Count;
+		const std::function<void(unsigned int)>* Body;
+		std::mutex Mutex;
+		std::condition_variable Done;
+	};
+
+	std::shared_ptr<Loop> loop = std::make_shared<Loop>();
+	loop->Next = 0;
+	loop->Finished = 0;
+	loop->Count = count;
+	loop->Body = &body;
+
+	auto work = [loop]
+	{
+		unsigned int index;
+		while ((index = loop->Next++) < loop->Count)
+		{
+			(*loop->Body)(index);
+
+			if (++loop->Finished == loop->Count)
+			{
+				std::lock_guard<std::mutex> lock(loop->Mutex);
+				loop->Done.notify_all();
+			}
+		}
+	};
+
+	unsigned int helpers = (count > 1) ? count - 1 : 0;
+	if (helpers > ThreadCount()) helpers = ThreadCount();
+	for (unsigned int i = 0; i < helpers; ++i)
+	{
+		Submit(work);
+	}
+
+	work();
+
+	std::unique_lock<std::mutex> lock(loop->Mutex);
+	loop->Done.wait(lock, [&loop] { return loop->Finished == loop->Count; });
+}
+
+void ThreadPool::WorkerLoop()
+{
+	for (;;)
+	{
+		std::function<void()> job;
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_jobAvailable.wait(lock, [this] { return _stopping || !_jobs.empty(); });
+
+			if (_jobs.empty())
+			{
+				return;
+			}
+
+			job = std::move(_jobs.front());
+			_jobs.pop_front();
+			++_busyCount;
+		}
+
+		job();
+
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			--_busyCount;
+			if (_jobs.empty() && _busyCount == 0)
+			{
+				_idle.notify_all();
+			}
+		}
+	}
+}
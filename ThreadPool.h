@@ -0,0 +1,43 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//Fixed set of worker threads pulling jobs off a shared queue, for CPU-side asset work (parsing, decoding, building
+//caches). Nothing submitted here may touch the immediate context - GPU resource creation stays on the main thread
+class ThreadPool
+{
+public:
+	//0 = one worker per hardware thread, minus one for the main thread
+	explicit ThreadPool(unsigned int threadCount = 0);
+	~ThreadPool();
+
+	void Submit(std::function<void()> job);
+
+	//Blocks until the queue is empty and every worker is idle
+	void WaitIdle();
+
+	//Calls body(0) .. body(count - 1) spread over the workers and the calling thread, returning when all have finished.
+	//The caller works through whatever the workers haven't picked up, so this is safe to call from inside a job
+	//(it just runs serially if every worker is busy)
+	void ParallelFor(unsigned int count, const std::function<void(unsigned int)>& body);
+
+	unsigned int ThreadCount() const { return (unsigned int)_workers.size(); }
+
+private:
+	ThreadPool(const ThreadPool&);
+	ThreadPool& operator=(const ThreadPool&);
+
+	void WorkerLoop();
+
+	std::vector<std::thread> _workers;
+	std::deque<std::function<void()>> _jobs;
+	std::mutex _mutex;
+	std::condition_variable _jobAvailable;
+	std::condition_variable _idle;
+	unsigned int _busyCount;
+	bool _stopping;
+};
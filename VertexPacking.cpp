@@ -0,0 +1,258 @@
+#include "VertexPacking.h"
+#include <math.h>
+#include <string.h>
+
+namespace
+{
+	const float UnormMax = 65535.0f;
+	const float SnormMax = 32767.0f;
+
+	inline float Clamp(float value, float low, float high)
+	{
+		return value < low ? low : (value > high ? high : value);
+	}
+
+	inline float SignNotZero(float value)
+	{
+		return value >= 0.0f ? 1.0f : -1.0f;
+	}
+}
+
+void VertexPacking::PositionDecode(const float boundsMin[3], const float boundsMax[3], float outScale[3], float outOffset[3])
+{
+	for (int k = 0; k < 3; ++k)
+	{
+		outScale[k] = boundsMax[k] - boundsMin[k];
+		outOffset[k] = boundsMin[k];
+	}
+}
+
+void VertexPacking::Pack(const SimpleVertex* vertices, size_t count, const float boundsMin[3], const float boundsMax[3], PackedVertex* outVertices)
+{
+	float scale[3];
+	float offset[3];
+	PositionDecode(boundsMin, boundsMax, scale, offset);
+
+	//A flat axis (a plane, say) has nothing to encode
+	float inverseScale[3];
+	for (int k = 0; k < 3; ++k)
+	{
+		inverseScale[k] = scale[k] > 0.0f ? 1.0f / scale[k] : 0.0f;
+	}
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		const SimpleVertex& vertex = vertices[i];
+		PackedVertex& packed = outVertices[i];
+
+		const float position[3] = { vertex.Pos.x, vertex.Pos.y, vertex.Pos.z };
+		for (int k = 0; k < 3; ++k)
+		{
+			float fraction = Clamp((position[k] - offset[k]) * inverseScale[k], 0.0f, 1.0f);
+			packed.Pos[k] = (unsigned short)(fraction * UnormMax + 0.5f);
+		}
+		packed.Pos[3] = 0xFFFF;		//w = 1
+
+		EncodeOctahedral(vertex.Normal, packed.Normal);
+
+		packed.TexC[0] = FloatToHalf(vertex.TexC.x);
+		packed.TexC[1] = FloatToHalf(vertex.TexC.y);
+	}
+}
+
+void VertexPacking::Unpack(const PackedVertex* vertices, size_t count, const float boundsMin[3], const float boundsMax[3], SimpleVertex* outVertices)
+{
+	float scale[3];
+	float offset[3];
+	PositionDecode(boundsMin, boundsMax, scale, offset);
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		const PackedVertex& packed = vertices[i];
+		SimpleVertex& vertex = outVertices[i];
+
+		vertex.Pos.x = packed.Pos[0] / UnormMax * scale[0] + offset[0];
+		vertex.Pos.y = packed.Pos[1] / UnormMax * scale[1] + offset[1];
+		vertex.Pos.z = packed.Pos[2] / UnormMax * scale[2] + offset[2];
+		vertex.Normal = DecodeOctahedral(packed.Normal);
+		vertex.TexC.x = HalfToFloat(packed.TexC[0]);
+		vertex.TexC.y = HalfToFloat(packed.TexC[1]);
+	}
+}
+
+unsigned short VertexPacking::FloatToHalf(float value)
+{
+	unsigned int bits;
+	memcpy(&bits, &value, sizeof(bits));
+
+	unsigned int sign = (bits >> 16) & 0x8000;
+	unsigned int magnitude = bits & 0x7FFFFFFF;
+
+	//NaN stays NaN, infinity and anything too big become infinity
+	if (magnitude > 0x7F800000)
+	{
+		return (unsigned short)(sign | 0x7E00);
+	}
+	if (magnitude >= 0x477FF000)
+	{
+		return (unsigned short)(sign | 0x7C00);
+	}
+
+	//Too small for a normal half, shift into a denormal (or zero) and round
+	if (magnitude < 0x38800000)
+	{
+		if (magnitude < 0x33000000)
+		{
+			return (unsigned short)sign;
+		}
+
+		unsigned int exponent = magnitude >> 23;
+		unsigned int mantissa = (magnitude & 0x007FFFFF) | 0x00800000;
+		unsigned int shift = 126 - exponent;
+		unsigned int half = mantissa >> shift;
+		unsigned int remainder = mantissa & ((1u << shift) - 1);
+		unsigned int halfway = 1u << (shift - 1);
+
+		if (remainder > halfway || (remainder == halfway && (half & 1)))
+		{
+			++half;
+		}
+		return (unsigned short)(sign | half);
+	}
+
+	//Normal range: rebias the exponent and round the mantissa from 23 to 10 bits (a carry correctly bumps the exponent)
+	unsigned int half = (magnitude - 0x38000000) >> 13;
+	unsigned int remainder = magnitude & 0x1FFF;
+	if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1)))
+	{
+		++half;
+	}
+	return (unsigned short)(sign | half);
+}
+
+float VertexPacking::HalfToFloat(unsigned short value)
+{
+	unsigned int sign = (unsigned int)(value & 0x8000) << 16;
+	unsigned int exponent = (value >> 10) & 0x1F;
+	unsigned int mantissa = value & 0x3FF;
+	unsigned int bits;
+
+	if (exponent == 0x1F)
+	{
+		bits = sign | 0x7F800000 | (mantissa << 13);
+	}
+	else if (exponent != 0)
+	{
+		bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+	}
+	else if (mantissa == 0)
+	{
+		bits = sign;
+	}
+	else
+	{
+		//Denormal half, normalise it
+		exponent = 113;
+		while ((mantissa & 0x400) == 0)
+		{
+			mantissa <<= 1;
+			--exponent;
+		}
+		bits = sign | (exponent << 23) | ((mantissa & 0x3FF) << 13);
+	}
+
+	float result;
+	memcpy(&result, &bits, sizeof(result));
+	return result;
+}
+
+void VertexPacking::PackTangents(const XMFLOAT4* tangents, size_t count, PackedTangent* outTangents)
+{
+	for (size_t i = 0; i < count; ++i)
+	{
+		const float value[4] = { tangents[i].x, tangents[i].y, tangents[i].z, tangents[i].w };
+		for (int k = 0; k < 4; ++k)
+		{
+			outTangents[i].Tangent[k] = (short)floorf(Clamp(value[k], -1.0f, 1.0f) * SnormMax + 0.5f);
+		}
+	}
+}
+
+XMFLOAT4 VertexPacking::UnpackTangent(const PackedTangent& packed)
+{
+	return XMFLOAT4(Clamp(packed.Tangent[0] / SnormMax, -1.0f, 1.0f), Clamp(packed.Tangent[1] / SnormMax, -1.0f, 1.0f),
+		Clamp(packed.Tangent[2] / SnormMax, -1.0f, 1.0f), Clamp(packed.Tangent[3] / SnormMax, -1.0f, 1.0f));
+}
+
+void VertexPacking::EncodeOctahedral(const XMFLOAT3& normal, short outEncoded[2])
+{
+	float length = fabsf(normal.x) + fabsf(normal.y) + fabsf(normal.z);
+	if (length == 0.0f)
+	{
+		outEncoded[0] = 0;
+		outEncoded[1] = 0;
+		return;
+	}
+
+	//Project onto the octahedron |x| + |y| + |z| = 1, then fold the lower half over the diagonals
+	float x = normal.x / length;
+	float y = normal.y / length;
+	if (normal.z < 0.0f)
+	{
+		float foldedX = (1.0f - fabsf(y)) * SignNotZero(x);
+		float foldedY = (1.0f - fabsf(x)) * SignNotZero(y);
+		x = foldedX;
+		y = foldedY;
+	}
+
+	outEncoded[0] = (short)floorf(Clamp(x, -1.0f, 1.0f) * SnormMax + 0.5f);
+	outEncoded[1] = (short)floorf(Clamp(y, -1.0f, 1.0f) * SnormMax + 0.5f);
+}
+
+XMFLOAT3 VertexPacking::DecodeOctahedral(const short encoded[2])
+{
+	//Same as the shader, which gets x and y already converted from SNORM
+	float x = Clamp(encoded[0] / SnormMax, -1.0f, 1.0f);
+	float y = Clamp(encoded[1] / SnormMax, -1.0f, 1.0f);
+	float z = 1.0f - fabsf(x) - fabsf(y);
+
+	float t = Clamp(-z, 0.0f, 1.0f);
+	x += x >= 0.0f ? -t : t;
+	y += y >= 0.0f ? -t : t;
+
+	float length = sqrtf(x * x + y * y + z * z);
+	return XMFLOAT3(x / length, y / length, z / length);
+}
+
+VertexPacking::PackingError VertexPacking::MeasureError(const std::vector<SimpleVertex>& vertices, const float boundsMin[3], const float boundsMax[3])
+{
+	std::vector<PackedVertex> packed(vertices.size());
+	std::vector<SimpleVertex> unpacked(vertices.size());
+	Pack(vertices.data(), vertices.size(), boundsMin, boundsMax, packed.data());
+	Unpack(packed.data(), packed.size(), boundsMin, boundsMax, unpacked.data());
+
+	PackingError error = { 0.0f, 0.0f, 0.0f };
+
+	for (size_t i = 0; i < vertices.size(); ++i)
+	{
+		const SimpleVertex& a = vertices[i];
+		const SimpleVertex& b = unpacked[i];
+
+		float dx = a.Pos.x - b.Pos.x;
+		float dy = a.Pos.y - b.Pos.y;
+		float dz = a.Pos.z - b.Pos.z;
+		error.Position = fmaxf(error.Position, sqrtf(dx * dx + dy * dy + dz * dz));
+
+		//Compare directions, the OBJ's normals aren't always exactly unit length
+		float lengthA = sqrtf(a.Normal.x * a.Normal.x + a.Normal.y * a.Normal.y + a.Normal.z * a.Normal.z);
+		if (lengthA > 0.0f)
+		{
+			float cosine = (a.Normal.x * b.Normal.x + a.Normal.y * b.Normal.y + a.Normal.z * b.Normal.z) / lengthA;
+			error.NormalDegrees = fmaxf(error.NormalDegrees, acosf(Clamp(cosine, -1.0f, 1.0f)) * 57.29578f);
+		}
+
+		error.TexCoord = fmaxf(error.TexCoord, fmaxf(fabsf(a.TexC.x - b.TexC.x), fabsf(a.TexC.y - b.TexC.y)));
+	}
+
+	return error;
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <vector>
+#include "MeshTypes.h"
+
+//Conversion between SimpleVertex (32 bytes) and PackedVertex (16 bytes).
+//Positions are stored as 16-bit fractions of the mesh's bounding box so precision scales with the mesh rather than
+//the world, normals use the octahedral mapping (unit sphere folded onto a square, under 0.05 degrees off at 16 bits)
+//and UVs are half floats. The vertex shader undoes all three, see VSPACKED in DX11 Framework.fx
+namespace VertexPacking
+{
+	//Position = packed * scale + offset, for the box [boundsMin, boundsMax]
+	void PositionDecode(const float boundsMin[3], const float boundsMax[3], float outScale[3], float outOffset[3]);
+
+	void Pack(const SimpleVertex* vertices, size_t count, const float boundsMin[3], const float boundsMax[3], PackedVertex* outVertices);
+	void Unpack(const PackedVertex* vertices, size_t count, const float boundsMin[3], const float boundsMax[3], SimpleVertex* outVertices);
+
+	//Round to nearest even, overflow goes to infinity
+	unsigned short FloatToHalf(float value);
+	float HalfToFloat(unsigned short value);
+
+	//Tangents for the second vertex stream (see MeshTangents.h), each component rounded to the nearest 16-bit step
+	void PackTangents(const XMFLOAT4* tangents, size_t count, PackedTangent* outTangents);
+	XMFLOAT4 UnpackTangent(const PackedTangent& packed);
+
+	void EncodeOctahedral(const XMFLOAT3& normal, short outEncoded[2]);
+	XMFLOAT3 DecodeOctahedral(const short encoded[2]);
+
+	//Worst case difference between a mesh and its packed round trip
+	struct PackingError
+	{
+		float Position;		//Largest distance, in mesh units
+		float NormalDegrees;	//Largest angle between original and decoded normal
+		float TexCoord;		//Largest absolute UV difference
+	};
+
+	PackingError MeasureError(const std::vector<SimpleVertex>& vertices, const float boundsMin[3], const float boundsMax[3]);
+};
@@ -0,0 +1,119 @@
+#include "VertexWelder.h"
+#include <string.h>
+#include <math.h>
+
+namespace
+{
+	const unsigned int EmptySlot = 0xFFFFFFFF;
+
+	inline unsigned int FloatBits(float value)
+	{
+		//+0 and -0 compare equal as floats so they should weld too
+		if (value == 0.0f) value = 0.0f;
+
+		unsigned int bits;
+		memcpy(&bits, &value, sizeof(bits));
+		return bits;
+	}
+
+	inline size_t HashKey(const unsigned int* components)
+	{
+		//Simple multiply-xorshift mix of the eight words, good enough to spread float bit patterns
+		unsigned long long hash = 0x9E3779B97F4A7C15ull;
+		for (int i = 0; i < 8; ++i)
+		{
+			hash = (hash ^ components[i]) * 0xFF51AFD7ED558CCDull;
+			hash ^= hash >> 32;
+		}
+		return (size_t)hash;
+	}
+
+	inline size_t NextPowerOfTwo(size_t value)
+	{
+		size_t result = 16;
+		while (result < value) result <<= 1;
+		return result;
+	}
+}
+
+VertexWelder::VertexWelder(float epsilon, size_t expectedVertexCount)
+{
+	_inverseEpsilon = (epsilon > 0.0f) ? 1.0f / epsilon : 0.0f;
+
+	_vertices.reserve(expectedVertexCount);
+	_keys.reserve(expectedVertexCount);
+
+	//Keep the table at most half full
+	_table.assign(NextPowerOfTwo(expectedVertexCount * 2), EmptySlot);
+	_mask = _table.size() - 1;
+}
+
+VertexWelder::Key VertexWelder::MakeKey(const SimpleVertex& vertex) const
+{
+	const float values[8] =
+	{
+		vertex.Pos.x, vertex.Pos.y, vertex.Pos.z,
+		vertex.Normal.x, vertex.Normal.y, vertex.Normal.z,
+		vertex.TexC.x, vertex.TexC.y
+	};
+
+	Key key;
+	for (int i = 0; i < 8; ++i)
+	{
+		if (_inverseEpsilon > 0.0f)
+		{
+			key.Components[i] = (unsigned int)(long long)floorf(values[i] * _inverseEpsilon + 0.5f);
+		}
+		else
+		{
+			key.Components[i] = FloatBits(values[i]);
+		}
+	}
+
+	return key;
+}
+
+void VertexWelder::Grow()
+{
+	_table.assign(_table.size() * 2, EmptySlot);
+	_mask = _table.size() - 1;
+
+	unsigned int count = (unsigned int)_keys.size();
+	for (unsigned int i = 0; i < count; ++i)
+	{
+		size_t slot = HashKey(_keys[i].Components) & _mask;
+		while (_table[slot] != EmptySlot)
+		{
+			slot = (slot + 1) & _mask;
+		}
+		_table[slot] = i;
+	}
+}
+
+unsigned int VertexWelder::Add(const SimpleVertex& vertex)
+{
+	Key key = MakeKey(vertex);
+
+	size_t slot = HashKey(key.Components) & _mask;
+	while (_table[slot] != EmptySlot)
+	{
+		unsigned int existing = _table[slot];
+		if (memcmp(_keys[existing].Components, key.Components, sizeof(key.Components)) == 0)
+		{
+			return existing;
+		}
+		slot = (slot + 1) & _mask;
+	}
+
+	unsigned int index = (unsigned int)_vertices.size();
+	_vertices.push_back(vertex);
+	_keys.push_back(key);
+	_table[slot] = index;
+
+	if (_vertices.size() * 2 > _table.size())
+	{
+		Grow();
+	}
+
+	return index;
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <vector>
+#include "MeshTypes.h"
+
+//Merges identical vertices so each unique (position, normal, texcoord) combination is only stored once.
+//Backed by an open-addressing hash table (linear probing, power of two size) over a packed 32 byte key, so a
+//lookup is one hash plus usually a single 32 byte compare rather than a walk down a std::map.
+//
+//With an epsilon of 0 vertices must match bit for bit (apart from -0 == +0). With a positive epsilon every
+//component is snapped to a grid of that size first, so vertices that only differ by exporter rounding noise
+//collapse together. The first vertex seen in each cell is the one that gets kept.
+class VertexWelder
+{
+public:
+	VertexWelder(float epsilon = 0.0f, size_t expectedVertexCount = 0);
+
+	//Returns the index of the matching vertex, adding it to Vertices() first if there isn't one yet
+	unsigned int Add(const SimpleVertex& vertex);
+
+	const std::vector<SimpleVertex>& Vertices() const { return _vertices; }
+	std::vector<SimpleVertex>& Vertices() { return _vertices; }
+
+private:
+	struct Key
+	{
+		unsigned int Components[8];
+	};
+
+	Key MakeKey(const SimpleVertex& vertex) const;
+	void Grow();
+
+	float _inverseEpsilon;
+	std::vector<SimpleVertex> _vertices;
+	std::vector<Key> _keys;			//Parallel to _vertices
+	std::vector<unsigned int> _table;	//Index into _vertices, or EmptySlot
+	size_t _mask;
+};